@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -24,6 +24,12 @@
 #include <Cutelyst/Response>
 
 #include <QUrl>
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+#include <QRandomGenerator>
+#else
+#include <QUuid>
+#endif
+#include <QMessageAuthenticationCode>
 #include <QLoggingCategory>
 
 using namespace Cutelyst;
@@ -118,6 +124,30 @@ void CredentialHttp::setRequireSsl(bool require)
     d->requireSsl = require;
 }
 
+void CredentialHttp::setVerifiedCache(int ttl, int maxEntries)
+{
+    Q_D(CredentialHttp);
+    d->verifiedCacheTtl = qint64(ttl) * 1000;
+    d->verifiedCacheMaxEntries = maxEntries;
+    d->verifiedCache.clear();
+    if (ttl > 0 && d->verifiedCacheKey.isEmpty()) {
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+        quint32 key[8];
+        QRandomGenerator::system()->fillRange(key);
+        d->verifiedCacheKey = QByteArray(reinterpret_cast<const char *>(key), sizeof(key));
+#else
+        d->verifiedCacheKey = QUuid::createUuid().toRfc4122() + QUuid::createUuid().toRfc4122();
+#endif
+        d->verifiedCacheTimer.start();
+    }
+}
+
+void CredentialHttp::clearVerifiedCache()
+{
+    Q_D(CredentialHttp);
+    d->verifiedCache.clear();
+}
+
 AuthenticationUser CredentialHttp::authenticate(Cutelyst::Context *c, AuthenticationRealm *realm, const ParamsMultiMap &authinfo)
 {
     Q_D(CredentialHttp);
@@ -164,6 +194,57 @@ bool CredentialHttpPrivate::checkPassword(const AuthenticationUser &user, const
     return false;
 }
 
+bool CredentialHttpPrivate::checkPasswordCached(AuthenticationRealm *realm, const AuthenticationUser &user, const ParamsMultiMap &authinfo)
+{
+    if (verifiedCacheTtl <= 0) {
+        return checkPassword(user, authinfo);
+    }
+
+    QMessageAuthenticationCode code(QCryptographicHash::Sha256, verifiedCacheKey);
+    code.addData(realm->name().toUtf8());
+    code.addData("\0", 1);
+    code.addData(authinfo.value(usernameField).toUtf8());
+    code.addData("\0", 1);
+    code.addData(authinfo.value(passwordField).toUtf8());
+    const QByteArray key = code.result();
+
+    const QString storedPassword = user.value(passwordField).toString();
+    const qint64 now = verifiedCacheTimer.elapsed();
+
+    auto it = verifiedCache.find(key);
+    if (it != verifiedCache.end()) {
+        if (it->expires > now && it->storedPassword == storedPassword) {
+            return true;
+        }
+        verifiedCache.erase(it);
+    }
+
+    if (!checkPassword(user, authinfo)) {
+        return false;
+    }
+
+    if (verifiedCache.size() >= verifiedCacheMaxEntries) {
+        auto cacheIt = verifiedCache.begin();
+        while (cacheIt != verifiedCache.end()) {
+            if (cacheIt->expires <= now) {
+                cacheIt = verifiedCache.erase(cacheIt);
+            } else {
+                ++cacheIt;
+            }
+        }
+
+        if (verifiedCache.size() >= verifiedCacheMaxEntries) {
+            verifiedCache.clear();
+        }
+    }
+
+    if (verifiedCacheMaxEntries > 0) {
+        verifiedCache.insert(key, { storedPassword, now + verifiedCacheTtl });
+    }
+
+    return true;
+}
+
 AuthenticationUser CredentialHttpPrivate::authenticateBasic(Context *c, AuthenticationRealm *realm, const ParamsMultiMap &authinfo)
 {
     Q_UNUSED(authinfo)
@@ -180,7 +261,7 @@ AuthenticationUser CredentialHttpPrivate::authenticateBasic(Context *c, Authenti
     AuthenticationUser _user = realm->findUser(c, auth);
     if (!_user.isNull()) {
         auth.insert(passwordField, userPass.second);
-        if (checkPassword(_user, auth)) {
+        if (checkPasswordCached(realm, _user, auth)) {
             user = _user;
         } else {
             qCDebug(C_CREDENTIALHTTP) << "Password didn't match";
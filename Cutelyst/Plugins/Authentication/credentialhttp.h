@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -122,6 +122,23 @@ public:
      */
     void setRequireSsl(bool require);
 
+    /**
+     * Enables caching of successfully verified credentials for \p ttl seconds,
+     * keeping at most \p maxEntries of them, a \p ttl of 0 (the default) disables it.
+     *
+     * Checking hashed passwords is expensive by design, with this enabled clients
+     * sending the same basic auth credentials on every request only pay for it once.
+     * Entries are kept in memory keyed by an HMAC of the realm name, username and
+     * password using a random key, and are only used if the password stored for the
+     * user did not change since they were verified.
+     */
+    void setVerifiedCache(int ttl, int maxEntries = 1024);
+
+    /**
+     * Removes all verified credentials from the cache, \sa setVerifiedCache().
+     */
+    void clearVerifiedCache();
+
     AuthenticationUser authenticate(Context *c, AuthenticationRealm *realm, const ParamsMultiMap &authinfo) final;
 
 protected:
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -21,12 +21,21 @@
 
 #include "credentialhttp.h"
 
+#include <QElapsedTimer>
+#include <QHash>
+
 namespace Cutelyst {
 
 class CredentialHttpPrivate
 {
 public:
+    struct VerifiedCredential {
+        QString storedPassword;
+        qint64 expires;
+    };
+
     bool checkPassword(const AuthenticationUser &user, const ParamsMultiMap &authinfo);
+    bool checkPasswordCached(AuthenticationRealm *realm, const AuthenticationUser &user, const ParamsMultiMap &authinfo);
     AuthenticationUser authenticateBasic(Context *c, AuthenticationRealm *realm, const ParamsMultiMap &authinfo);
     AuthenticationUser authenticationFailed(Context *c, AuthenticationRealm *realm, const ParamsMultiMap &authinfo);
 
@@ -44,6 +53,11 @@ public:
     QString passwordPreSalt;
     QString passwordPostSalt;
     QString authorizationRequiredMessage;
+    QHash<QByteArray, VerifiedCredential> verifiedCache;
+    QByteArray verifiedCacheKey;
+    QElapsedTimer verifiedCacheTimer;
+    qint64 verifiedCacheTtl = 0;
+    int verifiedCacheMaxEntries = 1024;
     bool requireSsl = false;
 };
 
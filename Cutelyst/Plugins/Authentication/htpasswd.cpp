@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2014-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2014-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -18,6 +18,11 @@
 #include "htpasswd.h"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QTemporaryFile>
 #include <QLoggingCategory>
 
@@ -25,8 +30,136 @@
 
 using namespace Cutelyst;
 
+namespace Cutelyst {
+
+typedef QHash<QByteArray, QByteArray> HtpasswdUsers;
+
+class HtpasswdIndex
+{
+public:
+    explicit HtpasswdIndex(const QString &filename) : filename(filename) {}
+
+    static QSharedPointer<HtpasswdIndex> instance(const QString &filename);
+
+    QSharedPointer<const HtpasswdUsers> users();
+    void reload();
+
+private:
+    bool changed(QDateTime &newModified, qint64 &newSize) const;
+    HtpasswdUsers load() const;
+
+    const QString filename;
+    QMutex mutex;
+    QElapsedTimer lastCheck;
+    QDateTime modified;
+    qint64 size = -1;
+    QSharedPointer<const HtpasswdUsers> current;
+};
+
+}
+
+QSharedPointer<HtpasswdIndex> HtpasswdIndex::instance(const QString &filename)
+{
+    // Each worker thread has its own store, they all share the parsed file
+    static QMutex mutex;
+    static QHash<QString, QWeakPointer<HtpasswdIndex>> indexes;
+
+    const QString key = QFileInfo(filename).absoluteFilePath();
+
+    QMutexLocker locker(&mutex);
+    QSharedPointer<HtpasswdIndex> ret = indexes.value(key).toStrongRef();
+    if (!ret) {
+        ret = QSharedPointer<HtpasswdIndex>::create(key);
+        indexes.insert(key, ret);
+    }
+    return ret;
+}
+
+QSharedPointer<const HtpasswdUsers> HtpasswdIndex::users()
+{
+    QMutexLocker locker(&mutex);
+    if (current && lastCheck.isValid() && !lastCheck.hasExpired(1000)) {
+        return current;
+    }
+    lastCheck.start();
+
+    QDateTime newModified;
+    qint64 newSize;
+    if (!changed(newModified, newSize) && current) {
+        return current;
+    }
+
+    // Parse outside the lock so that readers keep using the previous index
+    locker.unlock();
+    const HtpasswdUsers newUsers = load();
+    locker.relock();
+
+    // The file is only parsed again once it changes
+    modified = newModified;
+    size = newSize;
+    current = QSharedPointer<const HtpasswdUsers>::create(newUsers);
+    return current;
+}
+
+void HtpasswdIndex::reload()
+{
+    QMutexLocker locker(&mutex);
+    // Forces the next call to users() to check the file
+    lastCheck.invalidate();
+}
+
+bool HtpasswdIndex::changed(QDateTime &newModified, qint64 &newSize) const
+{
+    QFileInfo info(filename);
+    if (info.exists()) {
+        newModified = info.lastModified();
+        newSize = info.size();
+    } else {
+        newModified = QDateTime();
+        newSize = -1;
+    }
+    return newModified != modified || newSize != size;
+}
+
+HtpasswdUsers HtpasswdIndex::load() const
+{
+    HtpasswdUsers users;
+
+    // Removing the file revokes access to everyone
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        qCWarning(CUTELYST_UTILS_AUTH) << "Failed to open htpasswd file" << filename << file.errorString();
+        return users;
+    }
+
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        // Only the user of a broken line loses access, keeping
+        // what was loaded before could keep revoked users valid
+        QByteArrayList parts = line.split(':');
+        if (parts.size() < 2 || parts.first().isEmpty()) {
+            qCWarning(CUTELYST_UTILS_AUTH) << "Skipping malformed line" << lineNumber << "of htpasswd file" << filename;
+            continue;
+        }
+
+        if (!users.contains(parts.first())) {
+            QByteArray password = parts.at(1);
+            users.insert(parts.first(), password.replace(',', ':'));
+        }
+    }
+
+    return users;
+}
+
 StoreHtpasswd::StoreHtpasswd(const QString &name, QObject *parent) : AuthenticationStore(parent)
   , m_filename(name)
+  , m_index(HtpasswdIndex::instance(name))
 {
 
 }
@@ -74,7 +207,15 @@ void StoreHtpasswd::addUser(const ParamsMultiMap &user)
 
     if (!tmp.rename(m_filename)) {
         qCWarning(CUTELYST_UTILS_AUTH) << "Failed to rename temporary file";
+        return;
     }
+
+    m_index->reload();
+}
+
+void StoreHtpasswd::reload()
+{
+    m_index->reload();
 }
 
 AuthenticationUser StoreHtpasswd::findUser(Context *c, const ParamsMultiMap &userInfo)
@@ -82,19 +223,12 @@ AuthenticationUser StoreHtpasswd::findUser(Context *c, const ParamsMultiMap &use
     AuthenticationUser ret;
     const QString username = userInfo.value(QStringLiteral("username"));
 
-    QFile file(m_filename);
-    if (file.open(QFile::ReadOnly | QFile::Text)) {
-        while (!file.atEnd()) {
-            QByteArray line = file.readLine();
-            QByteArrayList parts = line.trimmed().split(':');
-            if (parts.size() >= 2 && !parts.first().startsWith('#') && parts.first() == username.toLatin1()) {
-                ret.insert(QStringLiteral("username"), username);
-                ret.setId(username);
-                QByteArray password = parts.at(1);
-                ret.insert(QStringLiteral("password"), QString::fromLatin1(password.replace(',', ':')));
-                break;
-            }
-        }
+    const QSharedPointer<const HtpasswdUsers> users = m_index->users();
+    auto it = users->constFind(username.toLatin1());
+    if (it != users->constEnd()) {
+        ret.insert(QStringLiteral("username"), username);
+        ret.setId(username);
+        ret.insert(QStringLiteral("password"), QString::fromLatin1(it.value()));
     }
     return ret;
 }
@@ -21,14 +21,22 @@
 #include <Cutelyst/cutelyst_global.h>
 #include <Cutelyst/Plugins/Authentication/authenticationstore.h>
 
+#include <QSharedPointer>
+
 namespace Cutelyst {
 
+class HtpasswdIndex;
 class CUTELYST_PLUGIN_AUTHENTICATION_EXPORT StoreHtpasswd : public AuthenticationStore
 {
     Q_OBJECT
 public:
     /**
      * Constructs a new htpasswd store object with the given parent to represent the file with the specified name.
+     *
+     * The file is parsed once into an in memory index that is shared by all stores
+     * of the process using the same file, it is reloaded when its modification time
+     * or size changes, which is checked at most once per second. If the file
+     * is missing there are no users, malformed lines are skipped.
      */
     explicit StoreHtpasswd(const QString &name, QObject *parent = nullptr);
     virtual ~StoreHtpasswd() override;
@@ -38,6 +46,12 @@ public:
      */
     void addUser(const ParamsMultiMap &user);
 
+    /**
+     * Makes the next lookup check the file for changes
+     * without waiting for the once per second check.
+     */
+    void reload();
+
     /**
      * Reimplemented from AuthenticationStore::findUser().
      */
@@ -55,6 +69,7 @@ public:
 
 private:
     QString m_filename;
+    QSharedPointer<HtpasswdIndex> m_index;
 };
 
 }
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "loadshedding_p.h"
+
+#include <Cutelyst/Application>
+#include <Cutelyst/Engine>
+#include <Cutelyst/Context>
+#include <Cutelyst/Action>
+#include <Cutelyst/Request>
+#include <Cutelyst/Response>
+
+#include <QLoggingCategory>
+#include <QMutex>
+
+#include <chrono>
+
+Q_LOGGING_CATEGORY(C_LOADSHEDDING, "cutelyst.plugin.loadshedding", QtWarningMsg)
+
+using namespace Cutelyst;
+
+// Counters are never freed, Actions of all threads point to them
+static QMutex countersMutex;
+static QHash<QString, LoadSheddingCounters *> countersByAction;
+
+LoadShedding::LoadShedding(Application *parent) : Plugin(parent)
+  , d_ptr(new LoadSheddingPrivate)
+{
+    d_ptr->q_ptr = this;
+}
+
+LoadShedding::~LoadShedding()
+{
+    // Requests still running (async ones) must not stay accounted,
+    // they didn't finish so they don't count for the latency
+    for (auto it = d_ptr->running.constBegin(); it != d_ptr->running.constEnd(); ++it) {
+        it.value().counters->inFlight.fetch_sub(1, std::memory_order_relaxed);
+    }
+    delete d_ptr;
+}
+
+void LoadShedding::setMaxInFlight(int requests)
+{
+    Q_D(LoadShedding);
+    d->maxInFlight = requests;
+}
+
+int LoadShedding::maxInFlight() const
+{
+    Q_D(const LoadShedding);
+    return d->maxInFlight;
+}
+
+void LoadShedding::setQueueDeadline(int msecs)
+{
+    Q_D(LoadShedding);
+    d->queueDeadline = msecs;
+}
+
+int LoadShedding::queueDeadline() const
+{
+    Q_D(const LoadShedding);
+    return d->queueDeadline;
+}
+
+void LoadShedding::setTargetLatency(int msecs)
+{
+    Q_D(LoadShedding);
+    d->targetLatency = msecs;
+}
+
+int LoadShedding::targetLatency() const
+{
+    Q_D(const LoadShedding);
+    return d->targetLatency;
+}
+
+void LoadShedding::setRetryAfter(int seconds)
+{
+    Q_D(LoadShedding);
+    d->retryAfter = seconds;
+}
+
+int LoadShedding::retryAfter() const
+{
+    Q_D(const LoadShedding);
+    return d->retryAfter;
+}
+
+QVariantMap LoadShedding::stats() const
+{
+    QVariantMap ret;
+
+    QMutexLocker locker(&countersMutex);
+    for (auto it = countersByAction.constBegin(); it != countersByAction.constEnd(); ++it) {
+        const LoadSheddingCounters *counters = it.value();
+        ret.insert(it.key(), QVariantMap{
+                       {QStringLiteral("in_flight"), counters->inFlight.load(std::memory_order_relaxed)},
+                       {QStringLiteral("accepted"), quint64(counters->accepted.load(std::memory_order_relaxed))},
+                       {QStringLiteral("rejected_in_flight"), quint64(counters->rejectedInFlight.load(std::memory_order_relaxed))},
+                       {QStringLiteral("rejected_deadline"), quint64(counters->rejectedDeadline.load(std::memory_order_relaxed))},
+                       {QStringLiteral("rejected_latency"), quint64(counters->rejectedLatency.load(std::memory_order_relaxed))},
+                       {QStringLiteral("latency_ms"), counters->latency.load(std::memory_order_relaxed) / 1000000.0},
+                   });
+    }
+
+    return ret;
+}
+
+bool LoadShedding::setup(Application *app)
+{
+    Q_D(LoadShedding);
+
+    const QVariantMap config = app->engine()->config(QStringLiteral("Cutelyst_LoadShedding_Plugin"));
+    d->maxInFlight = config.value(QStringLiteral("max_in_flight"), d->maxInFlight).toInt();
+    d->queueDeadline = config.value(QStringLiteral("queue_deadline"), d->queueDeadline).toInt();
+    d->targetLatency = config.value(QStringLiteral("target_latency"), d->targetLatency).toInt();
+    d->retryAfter = config.value(QStringLiteral("retry_after"), d->retryAfter).toInt();
+
+    connect(app, &Application::beforeDispatch, this, [d](Context *c) {
+        d->beforeDispatch(c);
+    });
+    connect(app, &Application::afterDispatch, this, [d](Context *c) {
+        d->afterDispatch(c);
+    });
+
+    return true;
+}
+
+qint64 LoadShedding::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+qint64 LoadShedding::queueTime(Context *c) const
+{
+    return c->request()->elapsed();
+}
+
+LoadSheddingCounters *LoadSheddingPrivate::sharedCounters(const QString &reverse)
+{
+    QMutexLocker locker(&countersMutex);
+    auto it = countersByAction.find(reverse);
+    if (it == countersByAction.end()) {
+        it = countersByAction.insert(reverse, new LoadSheddingCounters);
+    }
+    return it.value();
+}
+
+bool LoadSheddingPrivate::shedByLatency(LoadSheddingCounters *counters, qint64 targetLatency)
+{
+    const qint64 latency = counters->latency.load(std::memory_order_relaxed);
+    if (latency <= targetLatency) {
+        return false;
+    }
+
+    // Refuse the fraction of requests that exceeds the target, the
+    // credit spreads the refusals evenly instead of drawing random numbers
+    const int share = int((latency - targetLatency) * 1024 / latency);
+    const int credit = counters->shedCredit.fetch_add(share, std::memory_order_relaxed) + share;
+    if (credit >= 1024) {
+        counters->shedCredit.fetch_sub(1024, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void LoadSheddingPrivate::release(const LoadSheddingRunning &running, qint64 now)
+{
+    LoadSheddingCounters *counters = running.counters;
+    counters->inFlight.fetch_sub(1, std::memory_order_relaxed);
+
+    // Exponential moving average with a weight of 1/8, updates from other
+    // threads might get lost but that only delays the average a bit
+    const qint64 sample = now - running.start;
+    const qint64 latency = counters->latency.load(std::memory_order_relaxed);
+    counters->latency.store(latency ? latency + (sample - latency) / 8 : sample, std::memory_order_relaxed);
+}
+
+LoadSheddingRule LoadSheddingPrivate::parseRule(Action *action) const
+{
+    LoadSheddingRule rule;
+
+    const QMap<QString, QString> attributes = action->attributes();
+    auto value = [&attributes, action] (const QString &name, int defaultValue) {
+        auto it = attributes.constFind(name);
+        if (it == attributes.constEnd()) {
+            return defaultValue;
+        }
+
+        bool ok;
+        const int ret = it.value().toInt(&ok);
+        if (!ok || ret < 0) {
+            qCCritical(C_LOADSHEDDING) << "Invalid" << name << "attribute" << it.value() << "for action" << action->reverse();
+            return defaultValue;
+        }
+        return ret;
+    };
+
+    rule.maxInFlight = value(QStringLiteral("MaxInFlight"), maxInFlight);
+    rule.queueDeadline = value(QStringLiteral("QueueDeadline"), queueDeadline);
+    rule.targetLatency = qint64(value(QStringLiteral("TargetLatency"), targetLatency)) * 1000000;
+
+    if (rule.maxInFlight || rule.queueDeadline || rule.targetLatency) {
+        rule.counters = sharedCounters(action->reverse());
+    }
+
+    return rule;
+}
+
+void LoadSheddingPrivate::reject(Context *c, const char *reason)
+{
+    qCDebug(C_LOADSHEDDING) << "Refusing request to" << c->action()->reverse() << reason;
+
+    Response *res = c->response();
+    res->setStatus(Response::ServiceUnavailable);
+    res->setHeader(QStringLiteral("RETRY_AFTER"), QString::number(retryAfter));
+    res->setContentType(QStringLiteral("text/plain; charset=utf-8"));
+    res->setBody(QByteArrayLiteral("Service Unavailable"));
+    c->detach();
+}
+
+void LoadSheddingPrivate::beforeDispatch(Context *c)
+{
+    Action *action = c->action();
+    if (!action) {
+        return;
+    }
+
+    // Rules are cached per Application instance so there is no need to lock
+    auto it = rules.find(action);
+    if (it == rules.end()) {
+        it = rules.insert(action, parseRule(action));
+    }
+
+    const LoadSheddingRule &rule = it.value();
+    LoadSheddingCounters *counters = rule.counters;
+    if (!counters) {
+        return;
+    }
+
+    if (rule.queueDeadline && q_ptr->queueTime(c) > rule.queueDeadline) {
+        counters->rejectedDeadline.fetch_add(1, std::memory_order_relaxed);
+        reject(c, "queue deadline exceeded");
+        return;
+    }
+
+    if (rule.targetLatency && shedByLatency(counters, rule.targetLatency)) {
+        counters->rejectedLatency.fetch_add(1, std::memory_order_relaxed);
+        reject(c, "latency above target");
+        return;
+    }
+
+    const int inFlight = counters->inFlight.fetch_add(1, std::memory_order_relaxed);
+    if (rule.maxInFlight && inFlight >= rule.maxInFlight) {
+        counters->inFlight.fetch_sub(1, std::memory_order_relaxed);
+        counters->rejectedInFlight.fetch_add(1, std::memory_order_relaxed);
+        reject(c, "too many requests in flight");
+        return;
+    }
+
+    counters->accepted.fetch_add(1, std::memory_order_relaxed);
+    running.insert(c, { counters, q_ptr->now() });
+
+    // Async requests might be dropped without reaching afterDispatch
+    QObject::connect(c, &QObject::destroyed, q_ptr, [this, c] {
+        afterDispatch(c);
+    });
+}
+
+void LoadSheddingPrivate::afterDispatch(Context *c)
+{
+    auto it = running.find(c);
+    if (it != running.end()) {
+        release(it.value(), q_ptr->now());
+        running.erase(it);
+    }
+}
+
+#include "moc_loadshedding.cpp"
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef LOADSHEDDING_H
+#define LOADSHEDDING_H
+
+#include <Cutelyst/cutelyst_global.h>
+#include <Cutelyst/Plugin>
+
+#include <QVariantMap>
+
+namespace Cutelyst {
+
+class Context;
+class LoadSheddingPrivate;
+
+/**
+ * @class Cutelyst::LoadShedding loadshedding.h Cutelyst/Plugins/LoadShedding/LoadShedding
+ * @brief Rejects requests before dispatching them when an action is overloaded.
+ *
+ * Right after the Dispatcher finds the action for a request the plugin decides if it's worth
+ * executing it, requests that are refused get a <CODE>503 Service Unavailable</CODE> response with
+ * a @a Retry-After header and the action is not executed, answering quickly leaves the workers
+ * free to handle the requests that are still likely to succeed.
+ *
+ * A request is refused when:
+ * @li it waited in the engine for longer than the queue deadline, the client has probably given up;
+ * @li the action already has the maximum number of requests in flight;
+ * @li the average latency of the action is above its target, in that case the excess fraction
+ * of the requests is refused until the latency goes down.
+ *
+ * In flight requests and latencies are shared by all threads of the process but not among worker
+ * processes, so limits apply to each process.
+ *
+ * <H3>Usage</H3>
+ *
+ * @code{.cpp}
+ * bool MyCutelystApp::init()
+ * {
+ *     // other initialization stuff
+ *     new LoadShedding(this);
+ *     // maybe more initialization stuff
+ * }
+ *
+ * class Reports : public Controller
+ * {
+ *     Q_OBJECT
+ * public:
+ *     // At most 4 reports built at the same time, and don't start one
+ *     // if the request had to wait for more than 2 seconds
+ *     C_ATTR(build, :Local :MaxInFlight(4) :QueueDeadline(2000) :AutoArgs)
+ *     void build(Context *c);
+ *
+ *     // Keep the latency around 50 milliseconds
+ *     C_ATTR(search, :Local :TargetLatency(50) :AutoArgs)
+ *     void search(Context *c);
+ * };
+ * @endcode
+ *
+ * <H3>Attributes</H3>
+ *
+ * Attributes override the global policy for an action, a value of @c 0 disables the check.
+ *
+ * @par :MaxInFlight(requests)
+ * Maximum number of requests being handled by the action at the same time.
+ *
+ * @par :QueueDeadline(milliseconds)
+ * Maximum time since the engine started to receive the request.
+ *
+ * @par :TargetLatency(milliseconds)
+ * Average time the action should take to be handled, asynchronous actions count until they finish.
+ *
+ * <H3>Configuration</H3>
+ *
+ * The plugin reads the @c Cutelyst_LoadShedding_Plugin section of your application configuration
+ * file, these values apply to all actions without their own attributes.
+ *
+ * @par max_in_flight
+ * Integer value, default: @c 0 (unlimited)
+ *
+ * @par queue_deadline
+ * Integer value in milliseconds, default: @c 0 (no deadline)
+ *
+ * @par target_latency
+ * Integer value in milliseconds, default: @c 0 (no adaptive shedding)
+ *
+ * @par retry_after
+ * Integer value in seconds, default: @c 1
+ *
+ * Value of the @a Retry-After header sent with refused requests.
+ *
+ * @par Logging category
+ * @c cutelyst.plugin.loadshedding
+ */
+class CUTELYST_PLUGIN_LOADSHEDDING_EXPORT LoadShedding : public Plugin
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(LoadShedding)
+public:
+    /**
+     * Constructs a new LoadShedding object with the given @a parent.
+     */
+    LoadShedding(Application *parent);
+
+    /**
+     * Deconstructs the LoadShedding object.
+     */
+    virtual ~LoadShedding() override;
+
+    /**
+     * Sets the maximum number of requests in flight for actions without the @c :MaxInFlight attribute,
+     * @c 0 means unlimited.
+     */
+    void setMaxInFlight(int requests);
+
+    /**
+     * Returns the maximum number of requests in flight for actions without the @c :MaxInFlight attribute.
+     */
+    int maxInFlight() const;
+
+    /**
+     * Sets the queue deadline in milliseconds for actions without the @c :QueueDeadline attribute,
+     * @c 0 disables it.
+     */
+    void setQueueDeadline(int msecs);
+
+    /**
+     * Returns the queue deadline in milliseconds for actions without the @c :QueueDeadline attribute.
+     */
+    int queueDeadline() const;
+
+    /**
+     * Sets the target latency in milliseconds for actions without the @c :TargetLatency attribute,
+     * @c 0 disables adaptive shedding.
+     */
+    void setTargetLatency(int msecs);
+
+    /**
+     * Returns the target latency in milliseconds for actions without the @c :TargetLatency attribute.
+     */
+    int targetLatency() const;
+
+    /**
+     * Sets the value in seconds of the @a Retry-After header sent with refused requests.
+     */
+    void setRetryAfter(int seconds);
+
+    /**
+     * Returns the value in seconds of the @a Retry-After header sent with refused requests.
+     */
+    int retryAfter() const;
+
+    /**
+     * Returns the counters of this process keyed by the action reverse, each entry has
+     * @c in_flight, @c accepted, @c rejected_in_flight, @c rejected_deadline, @c rejected_latency
+     * and @c latency_ms (the moving average).
+     */
+    QVariantMap stats() const;
+
+protected:
+    LoadSheddingPrivate *d_ptr;
+
+    virtual bool setup(Application *app) override;
+
+    /**
+     * Returns the time of a monotonic clock in nanoseconds, used to measure the latency of actions.
+     * Reimplement it to control the time seen by the plugin, like in tests.
+     */
+    virtual qint64 now() const;
+
+    /**
+     * Returns for how many milliseconds the request of @a c waited before being dispatched, which is
+     * compared to the queue deadline, by default Request::elapsed().
+     */
+    virtual qint64 queueTime(Context *c) const;
+
+private:
+    friend class LoadSheddingPrivate;
+};
+
+}
+
+#endif // LOADSHEDDING_H
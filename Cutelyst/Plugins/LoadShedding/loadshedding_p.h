@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef LOADSHEDDING_P_H
+#define LOADSHEDDING_P_H
+
+#include "loadshedding.h"
+
+#include <QHash>
+
+#include <atomic>
+
+namespace Cutelyst {
+
+class Action;
+
+// Shared by the Application instances of all threads
+struct LoadSheddingCounters {
+    std::atomic<int> inFlight{0};
+    // Moving average of the latency in nanoseconds
+    std::atomic<qint64> latency{0};
+    // Fraction of a request owed to adaptive shedding, in 1/1024 units
+    std::atomic<int> shedCredit{0};
+    std::atomic<quint64> accepted{0};
+    std::atomic<quint64> rejectedInFlight{0};
+    std::atomic<quint64> rejectedDeadline{0};
+    std::atomic<quint64> rejectedLatency{0};
+};
+
+struct LoadSheddingRule {
+    LoadSheddingCounters *counters = nullptr;
+    qint64 queueDeadline = 0;
+    qint64 targetLatency = 0;
+    int maxInFlight = 0;
+};
+
+struct LoadSheddingRunning {
+    LoadSheddingCounters *counters;
+    qint64 start;
+};
+
+class LoadSheddingPrivate
+{
+public:
+    static LoadSheddingCounters *sharedCounters(const QString &reverse);
+    static bool shedByLatency(LoadSheddingCounters *counters, qint64 targetLatency);
+    static void release(const LoadSheddingRunning &running, qint64 now);
+    LoadSheddingRule parseRule(Action *action) const;
+    void reject(Context *c, const char *reason);
+
+    void beforeDispatch(Context *c);
+    void afterDispatch(Context *c);
+
+    QHash<Action *, LoadSheddingRule> rules;
+    QHash<Context *, LoadSheddingRunning> running;
+    LoadShedding *q_ptr = nullptr;
+    int maxInFlight = 0;
+    int queueDeadline = 0;
+    int targetLatency = 0;
+    int retryAfter = 1;
+};
+
+}
+
+#endif // LOADSHEDDING_P_H
@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "ratelimit_p.h"
+
+#include <Cutelyst/Application>
+#include <Cutelyst/Engine>
+#include <Cutelyst/Context>
+#include <Cutelyst/Action>
+#include <Cutelyst/Request>
+#include <Cutelyst/Response>
+
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QUuid>
+
+#include <chrono>
+#include <limits>
+#include <new>
+
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <errno.h>
+#endif
+
+Q_LOGGING_CATEGORY(C_RATELIMIT, "cutelyst.plugin.ratelimit", QtWarningMsg)
+
+using namespace Cutelyst;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "RateLimit needs lock free 64 bit atomics to share memory among processes");
+
+// How many slots are looked at for a key before giving up
+#define MAX_PROBES 16
+
+// Nanoseconds between warnings about the table being full
+#define TABLE_FULL_WARNING_INTERVAL Q_INT64_C(10000000000)
+
+// Requests of this process allowed because the table was full
+static std::atomic<quint64> tableFullCount{0};
+static std::atomic<qint64> tableFullWarned{0};
+
+RateLimit::RateLimit(Application *parent) : Plugin(parent)
+  , d_ptr(new RateLimitPrivate)
+{
+}
+
+RateLimit::~RateLimit()
+{
+    delete d_ptr;
+}
+
+void RateLimit::setTableSize(int entries)
+{
+    Q_D(RateLimit);
+    d->tableSize = entries;
+}
+
+int RateLimit::tableSize() const
+{
+    Q_D(const RateLimit);
+    return d->tableSize;
+}
+
+quint64 RateLimit::tableFull() const
+{
+    return tableFullCount.load(std::memory_order_relaxed);
+}
+
+qint64 RateLimit::take(const QString &key, int limit, int period, int burst)
+{
+    Q_D(RateLimit);
+
+    if (Q_UNLIKELY(!d->table || limit <= 0 || period <= 0)) {
+        return 0;
+    }
+
+    const qint64 interval = qint64(period) * 1000000000 / limit;
+    const qint64 tolerance = interval * ((burst > 0 ? burst : limit) - 1);
+
+    const qint64 wait = RateLimitPrivate::take(d->table, RateLimitPrivate::hashKey(d->table, key), interval, tolerance);
+    return (wait + 999999) / 1000000;
+}
+
+bool RateLimit::setup(Application *app)
+{
+    Q_D(RateLimit);
+
+    const QVariantMap config = app->engine()->config(QStringLiteral("Cutelyst_RateLimit_Plugin"));
+    d->tableSize = config.value(QStringLiteral("table_size"), d->tableSize).toInt();
+
+    d->table = RateLimitPrivate::sharedTable(d->tableSize);
+    if (!d->table) {
+        return false;
+    }
+
+    connect(app, &Application::beforeDispatch, this, [d](Context *c) {
+        d->beforeDispatch(c);
+    });
+
+    return true;
+}
+
+const RateLimitTable *RateLimitPrivate::sharedTable(int size)
+{
+    // All Application instances of this process use the same table, and
+    // as it's created before forking so do the worker processes
+    static QMutex mutex;
+    static RateLimitTable table;
+
+    QMutexLocker locker(&mutex);
+    if (table.slots) {
+        return &table;
+    }
+
+    quint64 slots = MAX_PROBES;
+    while (slots < quint64(size)) {
+        slots <<= 1;
+    }
+    const size_t bytes = slots * sizeof(RateLimitSlot);
+
+#ifdef Q_OS_UNIX
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        qCCritical(C_RATELIMIT) << "Failed to map" << bytes << "bytes of shared memory" << strerror(errno);
+        return nullptr;
+    }
+#else
+    void *memory = ::operator new(bytes);
+#endif
+
+    auto slot = static_cast<RateLimitSlot *>(memory);
+    for (quint64 i = 0; i < slots; ++i) {
+        new (slot + i) RateLimitSlot;
+    }
+
+    // Seeds make it hard for clients to pick keys that collide
+    const QByteArray seeds = QUuid::createUuid().toRfc4122();
+    memcpy(&table.seed1, seeds.constData(), sizeof(uint));
+    memcpy(&table.seed2, seeds.constData() + sizeof(uint), sizeof(uint));
+    table.mask = slots - 1;
+    table.slots = slot;
+
+    qCInfo(C_RATELIMIT) << "Created shared table with" << slots << "buckets," << bytes << "bytes";
+
+    return &table;
+}
+
+RateLimitSlot *RateLimitPrivate::findSlot(const RateLimitTable *table, quint64 key, qint64 now)
+{
+    RateLimitSlot *oldest = nullptr;
+    quint64 oldestKey = 0;
+    qint64 oldestTat = std::numeric_limits<qint64>::max();
+
+    for (quint64 i = 0; i < MAX_PROBES; ++i) {
+        RateLimitSlot *slot = table->slots + ((key + i) & table->mask);
+
+        quint64 current = slot->key.load(std::memory_order_acquire);
+        if (current == key) {
+            return slot;
+        }
+
+        if (current == 0) {
+            if (slot->key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                return slot;
+            } else if (current == key) {
+                // Another worker claimed it for the same key
+                return slot;
+            }
+        }
+
+        const qint64 tat = slot->tat.load(std::memory_order_relaxed);
+        if (tat < oldestTat) {
+            oldest = slot;
+            oldestKey = current;
+            oldestTat = tat;
+        }
+    }
+
+    // A bucket whose arrival time has passed is full, which is the same
+    // state a new bucket starts with, so it can be handed to another key
+    if (oldest && oldestTat <= now && oldest->key.compare_exchange_strong(oldestKey, key, std::memory_order_acq_rel)) {
+        return oldest;
+    }
+
+    return nullptr;
+}
+
+qint64 RateLimitPrivate::take(const RateLimitTable *table, quint64 key, qint64 interval, qint64 tolerance)
+{
+    const qint64 now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    RateLimitSlot *slot = findSlot(table, key, now);
+    if (Q_UNLIKELY(!slot)) {
+        const quint64 count = tableFullCount.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        // Once per interval, a full table would otherwise flood the log
+        qint64 warned = tableFullWarned.load(std::memory_order_relaxed);
+        if ((!warned || now - warned >= TABLE_FULL_WARNING_INTERVAL)
+                && tableFullWarned.compare_exchange_strong(warned, now, std::memory_order_relaxed)) {
+            qCWarning(C_RATELIMIT) << "Table is full, allowed" << count << "requests without limits so far, consider increasing table_size";
+        }
+        return 0;
+    }
+
+    qint64 tat = slot->tat.load(std::memory_order_relaxed);
+    while (true) {
+        const qint64 start = qMax(tat, now);
+        if (start - now > tolerance) {
+            return start - now - tolerance;
+        }
+
+        // On failure tat is updated with the value another thread or process stored
+        if (slot->tat.compare_exchange_weak(tat, start + interval, std::memory_order_relaxed)) {
+            return 0;
+        }
+    }
+}
+
+quint64 RateLimitPrivate::hashKey(const RateLimitTable *table, const QString &key)
+{
+    const quint64 ret = (quint64(qHash(key, table->seed1)) << 32) | qHash(key, table->seed2);
+    // Zero marks an empty slot
+    return ret ? ret : 1;
+}
+
+RateLimitRule RateLimitPrivate::parseRule(Action *action)
+{
+    RateLimitRule rule;
+
+    const QString limit = action->attribute(QStringLiteral("RateLimit"));
+    if (limit.isEmpty()) {
+        return rule;
+    }
+
+    const int slash = limit.indexOf(QLatin1Char('/'));
+    const int requests = limit.leftRef(slash).trimmed().toInt();
+    const int period = slash == -1 ? 1 : limit.midRef(slash + 1).trimmed().toInt();
+    if (requests <= 0 || period <= 0) {
+        qCCritical(C_RATELIMIT) << "Invalid RateLimit attribute" << limit << "for action" << action->reverse();
+        return rule;
+    }
+
+    int burst = action->attribute(QStringLiteral("RateLimitBurst")).toInt();
+    if (burst <= 0) {
+        burst = requests;
+    }
+
+    rule.interval = qint64(period) * 1000000000 / requests;
+    rule.tolerance = rule.interval * (burst - 1);
+
+    const QString key = action->attribute(QStringLiteral("RateLimitKey"));
+    if (key.startsWith(QLatin1String("header:"))) {
+        rule.source = RateLimitRule::Header;
+        rule.sourceName = key.mid(7);
+    } else if (key.startsWith(QLatin1String("query:"))) {
+        rule.source = RateLimitRule::Query;
+        rule.sourceName = key.mid(6);
+    } else if (!key.isEmpty() && key != QLatin1String("ip")) {
+        qCWarning(C_RATELIMIT) << "Unknown RateLimitKey" << key << "for action" << action->reverse() << "using the client address";
+    }
+
+    return rule;
+}
+
+void RateLimitPrivate::reject(Context *c, qint64 wait)
+{
+    const qint64 seconds = qMax(Q_INT64_C(1), (wait + 999999999) / 1000000000);
+
+    qCDebug(C_RATELIMIT) << "Too many requests to" << c->action()->reverse() << "from" << c->request()->addressString()
+                         << "retry after" << seconds << "seconds";
+
+    Response *res = c->response();
+    res->setStatus(Response::TooManyRequests);
+    res->setHeader(QStringLiteral("RETRY_AFTER"), QString::number(seconds));
+    res->setContentType(QStringLiteral("text/plain; charset=utf-8"));
+    res->setBody(QByteArrayLiteral("Too Many Requests"));
+    c->detach();
+}
+
+void RateLimitPrivate::beforeDispatch(Context *c)
+{
+    Action *action = c->action();
+    if (!action) {
+        return;
+    }
+
+    // Rules are cached per Application instance so there is no need to lock
+    auto it = rules.find(action);
+    if (it == rules.end()) {
+        it = rules.insert(action, parseRule(action));
+    }
+
+    const RateLimitRule &rule = it.value();
+    if (!rule.interval) {
+        return;
+    }
+
+    QString identity;
+    if (rule.source == RateLimitRule::Header) {
+        identity = c->request()->header(rule.sourceName);
+    } else if (rule.source == RateLimitRule::Query) {
+        identity = c->request()->queryParam(rule.sourceName);
+    }
+    if (identity.isEmpty()) {
+        identity = c->request()->addressString();
+    }
+
+    const quint64 key = hashKey(table, action->reverse() + QLatin1Char('\n') + identity);
+    const qint64 wait = take(table, key, rule.interval, rule.tolerance);
+    if (wait) {
+        reject(c, wait);
+    }
+}
+
+#include "moc_ratelimit.cpp"
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <Cutelyst/cutelyst_global.h>
+#include <Cutelyst/Plugin>
+
+namespace Cutelyst {
+
+class Context;
+class RateLimitPrivate;
+
+/**
+ * @class Cutelyst::RateLimit ratelimit.h Cutelyst/Plugins/RateLimit/RateLimit
+ * @brief Limits how often clients can call an action, across all threads and forked workers.
+ *
+ * The limits are enforced with the generic cell rate algorithm (GCRA): each bucket is a single
+ * timestamp kept in a lock-free hash table. The table lives in anonymous shared memory that is
+ * mapped when the plugin is set up, so when the application is loaded before the engine forks
+ * all worker processes and threads update the same buckets, no external store is needed.
+ *
+ * <H3>Usage</H3>
+ *
+ * Register the plugin in your application and add the @c :RateLimit attribute to the actions
+ * that should be limited. When a client goes over the limit the action is not executed, the
+ * response gets the <CODE>429 Too Many Requests</CODE> status and a @a Retry-After header
+ * with the number of seconds to wait.
+ *
+ * @code{.cpp}
+ * bool MyCutelystApp::init()
+ * {
+ *     // other initialization stuff
+ *     new RateLimit(this);
+ *     // maybe more initialization stuff
+ * }
+ *
+ * class Api : public Controller
+ * {
+ *     Q_OBJECT
+ * public:
+ *     // At most 10 requests every 60 seconds from each IP address
+ *     C_ATTR(login, :Local :RateLimit(10/60) :AutoArgs)
+ *     void login(Context *c);
+ *
+ *     // 100 requests every second per API key, allowing bursts of 500 requests
+ *     C_ATTR(search, :Local :RateLimit(100/1) :RateLimitBurst(500) :RateLimitKey('header:X-Api-Key') :AutoArgs)
+ *     void search(Context *c);
+ * };
+ * @endcode
+ *
+ * <H3>Attributes</H3>
+ *
+ * @par :RateLimit(requests/seconds)
+ * Allows @a requests every @a seconds, each action has its own buckets.
+ *
+ * @par :RateLimitBurst(requests)
+ * How many requests can be done at once after the client has been idle, defaults to @a requests.
+ *
+ * @par :RateLimitKey(source)
+ * What identifies a client, @c ip (the default), <CODE>header:Name</CODE> for the value of a request
+ * header or <CODE>query:name</CODE> for a query parameter. When the value is empty the client IP
+ * address is used.
+ *
+ * Limits that don't map to a single action can be checked from code with take().
+ *
+ * <H3>Configuration</H3>
+ *
+ * The plugin reads the @c Cutelyst_RateLimit_Plugin section of your application configuration file.
+ *
+ * @par table_size
+ * Integer value, default: @c 65536
+ *
+ * Maximum number of buckets, rounded up to a power of two, each one uses 16 bytes. When the table
+ * is full requests are allowed, counted in tableFull() and a warning is logged, buckets that are
+ * fully refilled are reused.
+ *
+ * @note The table is only shared among processes when the application is loaded before forking,
+ * in lazy mode each worker process gets its own table.
+ *
+ * @par Logging category
+ * @c cutelyst.plugin.ratelimit
+ */
+class CUTELYST_PLUGIN_RATELIMIT_EXPORT RateLimit : public Plugin
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(RateLimit)
+public:
+    /**
+     * Constructs a new RateLimit object with the given @a parent.
+     */
+    RateLimit(Application *parent);
+
+    /**
+     * Deconstructs the RateLimit object.
+     */
+    virtual ~RateLimit() override;
+
+    /**
+     * Sets the maximum number of buckets, it must be called before setup() and the
+     * first RateLimit set up in the process defines the size of the shared table.
+     */
+    void setTableSize(int entries);
+
+    /**
+     * Returns the maximum number of buckets.
+     */
+    int tableSize() const;
+
+    /**
+     * Returns how many requests of this process were allowed without being limited because
+     * the table was full, a warning is logged at most every 10 seconds while it happens.
+     */
+    quint64 tableFull() const;
+
+    /**
+     * Takes one request from the bucket identified by @a key, which allows @a limit requests every
+     * @a period seconds with bursts of up to @a burst requests, if @a burst is 0 @a limit is used.
+     *
+     * Returns 0 if the request is allowed, otherwise the number of milliseconds until it will be.
+     */
+    qint64 take(const QString &key, int limit, int period, int burst = 0);
+
+protected:
+    RateLimitPrivate *d_ptr;
+
+    virtual bool setup(Application *app) override;
+};
+
+}
+
+#endif // RATELIMIT_H
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef RATELIMIT_P_H
+#define RATELIMIT_P_H
+
+#include "ratelimit.h"
+
+#include <QHash>
+
+#include <atomic>
+
+namespace Cutelyst {
+
+class Action;
+
+// Lives in shared memory, each field must be lock free
+// so that forked processes can update them
+struct RateLimitSlot {
+    std::atomic<quint64> key{0};
+    // GCRA theoretical arrival time, in nanoseconds of the monotonic clock
+    std::atomic<qint64> tat{0};
+};
+
+struct RateLimitTable {
+    RateLimitSlot *slots = nullptr;
+    quint64 mask = 0;
+    uint seed1 = 0;
+    uint seed2 = 0;
+};
+
+struct RateLimitRule {
+    enum Source {
+        Address,
+        Header,
+        Query,
+    };
+
+    // Nanoseconds between requests and how far ahead
+    // of the current time a bucket can be
+    qint64 interval = 0;
+    qint64 tolerance = 0;
+    QString sourceName;
+    Source source = Address;
+};
+
+class RateLimitPrivate
+{
+public:
+    static const RateLimitTable *sharedTable(int size);
+    static RateLimitSlot *findSlot(const RateLimitTable *table, quint64 key, qint64 now);
+    static qint64 take(const RateLimitTable *table, quint64 key, qint64 interval, qint64 tolerance);
+    static quint64 hashKey(const RateLimitTable *table, const QString &key);
+    static RateLimitRule parseRule(Action *action);
+    static void reject(Context *c, qint64 wait);
+
+    void beforeDispatch(Context *c);
+
+    QHash<Action *, RateLimitRule> rules;
+    const RateLimitTable *table = nullptr;
+    int tableSize = 65536;
+};
+
+}
+
+#endif // RATELIMIT_P_H
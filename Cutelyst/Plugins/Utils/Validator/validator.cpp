@@ -17,6 +17,11 @@
  */
 
 #include "validator_p.h"
+#include "validatoralpha.h"
+#include "validatoralphadash.h"
+#include "validatoralphanum.h"
+#include "validatoremail.h"
+#include "validatorip.h"
 #include <Cutelyst/context.h>
 #include <Cutelyst/request.h>
 #include <Cutelyst/application.h>
@@ -142,4 +147,14 @@ void Validator::addValidator(ValidatorRule *v)
 void Validator::loadTranslations(Application *app)
 {
     app->loadTranslations(QStringLiteral("plugin_utils_validator"));
+
+    // Compile the regular expressions shared by all validators before forking
+    app->addWarmUp(QStringLiteral("Validator"), [] (Application *) {
+        ValidatorAlpha::validate(QStringLiteral("a"));
+        ValidatorAlphaDash::validate(QStringLiteral("a"));
+        ValidatorAlphaNum::validate(QStringLiteral("a"));
+        ValidatorIp::validate(QStringLiteral("127.0.0.1"));
+        ValidatorEmail::validate(QStringLiteral("a@[127.0.0.1]"), ValidatorEmail::RFC5322);
+        ValidatorEmail::validate(QStringLiteral("a@[IPv6:1:2:3:4:5:6:7:8]"), ValidatorEmail::RFC5322);
+    });
 }
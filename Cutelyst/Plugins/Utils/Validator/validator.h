@@ -316,6 +316,9 @@ public:
 
     /*!
      * \brief Loads the translations for the plugin.
+     *
+     * This also registers an Application::addWarmUp() step that compiles the regular
+     * expressions used by the validators, so that forked workers share them.
      */
     static void loadTranslations(Application *app);
 
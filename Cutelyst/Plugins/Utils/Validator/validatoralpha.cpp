@@ -66,7 +66,8 @@ bool ValidatorAlpha::validate(const QString &value, bool asciiOnly)
             }
         }
     } else {
-        valid = value.contains(QRegularExpression(QStringLiteral("^[\\pL\\pM]+$")));
+        static const QRegularExpression regex(QStringLiteral("^[\\pL\\pM]+$"));
+        valid = value.contains(regex);
     }
 
     return valid;
@@ -65,7 +65,8 @@ bool ValidatorAlphaDash::validate(const QString &value, bool asciiOnly)
             }
         }
     } else {
-        valid = value.contains(QRegularExpression(QStringLiteral("^[\\pL\\pM\\pN_-]+$")));
+        static const QRegularExpression regex(QStringLiteral("^[\\pL\\pM\\pN_-]+$"));
+        valid = value.contains(regex);
     }
     return valid;
 }
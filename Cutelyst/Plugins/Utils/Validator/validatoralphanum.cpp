@@ -66,7 +66,8 @@ bool ValidatorAlphaNum::validate(const QString &value, bool asciiOnly)
             }
         }
     } else {
-        valid = value.contains(QRegularExpression(QStringLiteral("^[\\pL\\pM\\pN]+$")));
+        static const QRegularExpression regex(QStringLiteral("^[\\pL\\pM\\pN]+$"));
+        valid = value.contains(regex);
     }
     return valid;
 }
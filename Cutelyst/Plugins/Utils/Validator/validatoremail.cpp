@@ -580,7 +580,7 @@ bool ValidatorEmailPrivate::checkEmail(const QString &address, ValidatorEmail::O
                     int index = -1;
                     QString addressLiteral = parseLiteral;
 
-                    QRegularExpression ipv4Regex(QStringLiteral("\\b(?:(?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)\\.){3}(?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)$"));
+                    static const QRegularExpression ipv4Regex(QStringLiteral("\\b(?:(?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)\\.){3}(?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)$"));
                     QRegularExpressionMatch ipv4Match = ipv4Regex.match(addressLiteral);
                     if (ipv4Match.hasMatch()) {
                         index = addressLiteral.lastIndexOf(ipv4Match.captured());
@@ -626,9 +626,10 @@ bool ValidatorEmailPrivate::checkEmail(const QString &address, ValidatorEmail::O
                         } else if ((ipv6.rightRef(2).at(1) == QLatin1Char(':')) && (ipv6.rightRef(2).at(0) != QLatin1Char(':'))) {
                             returnStatus.push_back(ValidatorEmail::RFC5322IPv6ColonEnd); // Address ends with a single colon
                         } else {
+                            static const QRegularExpression groupRegex(QStringLiteral("^[0-9A-Fa-f]{0,4}$"));
                             int unmatchedChars = 0;
                             for (const QString &ip : matchesIP) {
-                                if (!ip.contains(QRegularExpression(QStringLiteral("^[0-9A-Fa-f]{0,4}$")))) {
+                                if (!ip.contains(groupRegex)) {
                                     unmatchedChars++;
                                 }
                             }
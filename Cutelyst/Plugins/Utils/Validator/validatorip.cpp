@@ -61,7 +61,8 @@ bool ValidatorIp::validate(const QString &value, Constraints constraints)
     bool valid = true;
 
     // simple check for an IPv4 address with four parts, because QHostAddress also tolerates addresses like 192.168.2 and fills them with 0 somewhere
-    if (!value.contains(QLatin1Char(':')) && !value.contains(QRegularExpression(QStringLiteral("^\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}$")))) {
+    static const QRegularExpression ipv4Regex(QStringLiteral("^\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}$"));
+    if (!value.contains(QLatin1Char(':')) && !value.contains(ipv4Regex)) {
 
         valid = false;
 
@@ -28,6 +28,7 @@
 
 #include <QString>
 #include <QDirIterator>
+#include <QPointer>
 #include <QtCore/QLoggingCategory>
 #include <QTranslator>
 
@@ -62,6 +63,14 @@ CuteleeView::CuteleeView(QObject *parent, const QString &name) : View(new Cutele
         d->cutelystVar = app->config(QStringLiteral("CUTELYST_VAR"), QStringLiteral("c")).toString();
 
         app->loadTranslations(QStringLiteral("plugin_view_cutelee"));
+
+        // With the cache enabled compile the templates before forking
+        QPointer<CuteleeView> view(this);
+        app->addWarmUp(QStringLiteral("CuteleeView"), [view] (Application *) {
+            if (view && view->isCaching()) {
+                view->preloadTemplates();
+            }
+        });
     } else {
         // make sure templates can be found on the current directory
         setIncludePaths({ QDir::currentPath() });
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -27,6 +27,7 @@
 
 #include <QString>
 #include <QDirIterator>
+#include <QPointer>
 #include <QtCore/QLoggingCategory>
 #include <QTranslator>
 
@@ -61,6 +62,14 @@ GrantleeView::GrantleeView(QObject *parent, const QString &name) : View(new Gran
         d->cutelystVar = app->config(QStringLiteral("CUTELYST_VAR"), QStringLiteral("c")).toString();
 
         app->loadTranslations(QStringLiteral("plugin_view_grantlee"));
+
+        // With the cache enabled compile the templates before forking
+        QPointer<GrantleeView> view(this);
+        app->addWarmUp(QStringLiteral("GrantleeView"), [view] (Application *) {
+            if (view && view->isCaching()) {
+                view->preloadTemplates();
+            }
+        });
     } else {
         // make sure templates can be found on the current directory
         setIncludePaths({ QDir::currentPath() });
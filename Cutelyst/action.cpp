@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2017 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -16,12 +16,24 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include "action_p.h"
+#include "actioninvoker.h"
 #include "controller.h"
 #include "context.h"
 #include "common.h"
 
 using namespace Cutelyst;
 
+// Shared by all actions to fill the missing arguments
+static const QStringList &emptyArgs()
+{
+    static const QStringList args = {
+        QString(), QString(), QString(),
+        QString(), QString(), QString(),
+        QString(), QString(), QString(),
+    };
+    return args;
+}
+
 Action::Action(QObject *parent) : Component(new ActionPrivate, parent)
 {
 }
@@ -48,6 +60,12 @@ void Action::setMethod(const QMetaMethod &method)
     }
 }
 
+void Action::setInvoker(ActionInvoker *invoker)
+{
+    Q_D(Action);
+    d->invoker = invoker;
+}
+
 void Action::setController(Controller *controller)
 {
     Q_D(Action);
@@ -152,6 +170,20 @@ bool Action::doExecute(Context *c)
     }
 
     bool ret;
+    if (d->invoker) {
+        bool methodRet;
+        ret = d->invoker->invoke(d->controller, c, c->request()->args(), &methodRet);
+        if (!ret) {
+            qCWarning(CUTELYST_CONTROLLER) << "Failed to convert arguments of" << d->reverse << c->request()->args();
+            if (d->evaluateBool) {
+                c->detach();
+            }
+            methodRet = false;
+        }
+        c->setState(methodRet);
+        return methodRet;
+    }
+
     if (d->evaluateBool) {
         bool methodRet;
 
@@ -164,7 +196,7 @@ bool Action::doExecute(Context *c)
         } else {
             QStringList args = c->request()->args();
             // Fill the missing arguments
-            args.append(d->emptyArgs);
+            args.append(emptyArgs());
 
             ret = d->method.invoke(d->controller,
                                    Qt::DirectConnection,
@@ -200,7 +232,7 @@ bool Action::doExecute(Context *c)
         } else {
             QStringList args = c->request()->args();
             // Fill the missing arguments
-            args.append(d->emptyArgs);
+            args.append(emptyArgs());
 
             ret = d->method.invoke(d->controller,
                                    Qt::DirectConnection,
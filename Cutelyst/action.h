@@ -30,6 +30,7 @@ namespace Cutelyst {
 class Controller;
 class Dispatcher;
 class ActionPrivate;
+class ActionInvoker;
 /*! \class Action action.h Cutelyst/Action
  * \brief This class represents a %Cutelyst %Action.
  *
@@ -148,6 +149,12 @@ protected:
      */
     void setMethod(const QMetaMethod &method);
 
+    /*!
+     * Sets the invoker used to call the method directly,
+     * it is owned by the controller.
+     */
+    void setInvoker(ActionInvoker *invoker);
+
     /**
      * The controller which this action belongs to
      */
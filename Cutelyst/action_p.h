@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2017 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -30,13 +30,9 @@ public:
 
     QString ns;
     QMetaMethod method;
+    ActionInvoker *invoker = nullptr;
     QMap<QString, QString> attributes;
     Controller *controller = nullptr;
-    QStringList emptyArgs = {
-        QString(), QString(), QString(),
-        QString(), QString(), QString(),
-        QString(), QString(), QString(),
-    };
     qint8 numberOfArgs = -1;
     qint8 numberOfCaptures = -1;
     bool evaluateBool = false;
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CUTELYST_ACTIONINVOKER_H
+#define CUTELYST_ACTIONINVOKER_H
+
+#include <QtCore/QStringList>
+
+#include <tuple>
+#include <type_traits>
+
+namespace Cutelyst {
+
+class Context;
+class Controller;
+
+/**
+ * Calls an action method directly through a member function pointer,
+ * avoiding QMetaMethod::invoke() and converting the request arguments
+ * to the method's parameter types.
+ *
+ * Invokers are created by Controller::registerAction().
+ */
+class ActionInvoker
+{
+public:
+    virtual ~ActionInvoker() {}
+
+    /**
+     * Number of parameters of the method, including the Context
+     */
+    virtual int parameterCount() const = 0;
+
+    /**
+     * Calls the method on \p controller, \p ret receives the method return
+     * value or true if it returns void. Returns false if an argument could
+     * not be converted to the parameter type.
+     */
+    virtual bool invoke(Controller *controller, Context *c, const QStringList &args, bool *ret) const = 0;
+};
+
+namespace ActionArgument {
+
+template <typename T>
+struct Converter;
+
+template <>
+struct Converter<QString> {
+    static inline QString convert(const QStringList &args, int i, bool *ok) {
+        Q_UNUSED(ok)
+        return i < args.size() ? args.at(i) : QString();
+    }
+};
+
+template <>
+struct Converter<QStringList> {
+    static inline QStringList convert(const QStringList &args, int i, bool *ok) {
+        Q_UNUSED(i)
+        Q_UNUSED(ok)
+        return args;
+    }
+};
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+template <>
+struct Converter<QStringRef> {
+    static inline QStringRef convert(const QStringList &args, int i, bool *ok) {
+        Q_UNUSED(ok)
+        return i < args.size() ? QStringRef(&args.at(i)) : QStringRef();
+    }
+};
+#endif
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+template <>
+struct Converter<QStringView> {
+    static inline QStringView convert(const QStringList &args, int i, bool *ok) {
+        Q_UNUSED(ok)
+        return i < args.size() ? QStringView(args.at(i)) : QStringView();
+    }
+};
+#endif
+
+#define CUTELYST_ACTION_NUMBER_CONVERTER(Type, Method) \
+template <> \
+struct Converter<Type> { \
+    static inline Type convert(const QStringList &args, int i, bool *ok) { \
+        if (i >= args.size()) { \
+            return Type(); \
+        } \
+        bool valid; \
+        const Type ret = args.at(i).Method(&valid); \
+        if (!valid) { \
+            *ok = false; \
+        } \
+        return ret; \
+    } \
+};
+
+CUTELYST_ACTION_NUMBER_CONVERTER(int, toInt)
+CUTELYST_ACTION_NUMBER_CONVERTER(uint, toUInt)
+CUTELYST_ACTION_NUMBER_CONVERTER(qint64, toLongLong)
+CUTELYST_ACTION_NUMBER_CONVERTER(quint64, toULongLong)
+CUTELYST_ACTION_NUMBER_CONVERTER(double, toDouble)
+
+#undef CUTELYST_ACTION_NUMBER_CONVERTER
+
+template <int...>
+struct IndexList {};
+
+template <int N, int... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeIndexList<0, I...> {
+    typedef IndexList<I...> Type;
+};
+
+template <typename R>
+struct Caller {
+    template <typename C, typename M, typename... Values>
+    static inline bool call(C *obj, M method, Context *c, Values&&... values) {
+        return (obj->*method)(c, std::forward<Values>(values)...);
+    }
+};
+
+template <>
+struct Caller<void> {
+    template <typename C, typename M, typename... Values>
+    static inline bool call(C *obj, M method, Context *c, Values&&... values) {
+        (obj->*method)(c, std::forward<Values>(values)...);
+        return true;
+    }
+};
+
+}
+
+template <typename C, typename R, typename... Args>
+class TypedActionInvoker final : public ActionInvoker
+{
+    static_assert(std::is_same<R, void>::value || std::is_same<R, bool>::value,
+                  "Actions must return void or bool");
+public:
+    typedef R (C::*Method)(Context *, Args...);
+
+    explicit TypedActionInvoker(Method method) : m_method(method) {}
+
+    virtual int parameterCount() const override {
+        return int(sizeof...(Args)) + 1;
+    }
+
+    virtual bool invoke(Controller *controller, Context *c, const QStringList &args, bool *ret) const override {
+        return call(static_cast<C *>(controller), c, args, ret,
+                    typename ActionArgument::MakeIndexList<int(sizeof...(Args))>::Type());
+    }
+
+private:
+    template <int... I>
+    inline bool call(C *obj, Context *c, const QStringList &args, bool *ret, ActionArgument::IndexList<I...>) const {
+        Q_UNUSED(args)
+        bool ok = true;
+        // Braced initialization guarantees left to right conversion
+        std::tuple<typename std::decay<Args>::type...> values{
+            ActionArgument::Converter<typename std::decay<Args>::type>::convert(args, I, &ok)...
+        };
+        if (!ok) {
+            return false;
+        }
+
+        *ret = ActionArgument::Caller<R>::call(obj, m_method, c, std::move(std::get<I>(values))...);
+        return true;
+    }
+
+    Method m_method;
+};
+
+}
+
+#endif // CUTELYST_ACTIONINVOKER_H
@@ -30,6 +30,7 @@
 #include "dispatchtype.h"
 #include "view.h"
 #include "stats.h"
+#include "stats_p.h"
 #include "utils.h"
 
 #include <QtCore/QDir>
@@ -40,6 +41,9 @@
 #include <QtCore/QTranslator>
 #include <QtCore/QFileInfo>
 #include <QtCore/QLocale>
+#include <QtCore/QElapsedTimer>
+
+#include <algorithm>
 
 Q_LOGGING_CATEGORY(CUTELYST_DISPATCHER, "cutelyst.dispatcher", QtWarningMsg)
 Q_LOGGING_CATEGORY(CUTELYST_DISPATCHER_PATH, "cutelyst.dispatcher.path", QtWarningMsg)
@@ -75,6 +79,7 @@ Application::Application(QObject *parent) :
 
 Application::~Application()
 {
+    d_ptr->logAggregatedStats();
     delete d_ptr;
 }
 
@@ -171,6 +176,12 @@ Component *Application::createComponentPlugin(const QString &name, QObject *pare
     return nullptr;
 }
 
+void Application::addWarmUp(const QString &name, std::function<void(Application *)> warmUp)
+{
+    Q_D(Application);
+    d->warmUps.push_back({ name, warmUp });
+}
+
 const char *Application::cutelystVersion()
 {
     return VERSION;
@@ -261,16 +272,31 @@ bool Application::setup(Engine *engine)
     }
     d->init = true;
 
+    // Time spent on each setup phase, reported on core zero
+    QVector<QStringList> tableStartup;
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+    QElapsedTimer phaseTimer;
+    phaseTimer.start();
+    auto addPhase = [&tableStartup, &phaseTimer] (const QString &phase, const QString &name) {
+        tableStartup.append({ phase, name, QString::number(phaseTimer.nsecsElapsed() / 1000000.0, 'f', 3) + QLatin1String("ms") });
+        phaseTimer.restart();
+    };
+
     d->useStats = CUTELYST_STATS().isDebugEnabled();
     d->engine = engine;
     d->config = engine->config(QLatin1String("Cutelyst"));
 
     d->setupHome();
+    addPhase(QStringLiteral("Config"), QString());
 
     // Call the virtual application init
     // to setup Controllers plugins stuff
-    if (init()) {
+    const bool initialized = init();
+    addPhase(QStringLiteral("Application"), QString::fromLatin1(metaObject()->className()) + QLatin1String("::init"));
+    if (initialized) {
         d->setupChildren(children());
+        addPhase(QStringLiteral("Components"), QString());
 
         bool zeroCore = engine->workerCore() == 0;
 
@@ -283,6 +309,7 @@ bool Application::setup(Engine *engine)
             tablePlugins.append({ plugin->objectName() });
             // Configure plugins
             plugin->setup(this);
+            addPhase(QStringLiteral("Plugin"), plugin->objectName());
         }
 
         if (zeroCore && !tablePlugins.isEmpty()) {
@@ -343,12 +370,31 @@ bool Application::setup(Engine *engine)
                                                         QLatin1String("Loaded components:")).constData();
         }
 
+        phaseTimer.restart();
         const auto controllers = d->controllers;
         for (Controller *controller : controllers) {
             controller->d_ptr->init(this, d->dispatcher);
+            addPhase(QStringLiteral("Controller"), QString::fromLatin1(controller->metaObject()->className()));
         }
 
         d->dispatcher->setupActions(d->controllers, d->dispatchers, d->engine->workerCore() == 0);
+        addPhase(QStringLiteral("Dispatcher"), QString::fromLatin1(d->dispatcher->metaObject()->className()));
+
+        // Steps might register other steps so don't iterate a copy
+        for (size_t i = 0; i < d->warmUps.size(); ++i) {
+            const auto warmUp = d->warmUps[i];
+            warmUp.second(this);
+            addPhase(QStringLiteral("WarmUp"), warmUp.first);
+        }
+
+        if (zeroCore) {
+            tableStartup.append({ QStringLiteral("Total"), QString(),
+                                  QString::number(startupTimer.nsecsElapsed() / 1000000.0, 'f', 3) + QLatin1String("ms") });
+            qCInfo(CUTELYST_STATS) << Utils::buildTable(tableStartup, {
+                                                            QLatin1String("Phase"), QLatin1String("Name"), QLatin1String("Time")
+                                                        },
+                                                        QLatin1String("Startup profile:")).constData();
+        }
 
         if (zeroCore) {
             qCInfo(CUTELYST_CORE) << qPrintable(QString::fromLatin1("%1 powered by Cutelyst %2, Qt %3.")
@@ -395,6 +441,49 @@ void Application::handleRequest(EngineRequest *request)
 
         d->dispatcher->prepareAction(c);
 
+        if (Q_UNLIKELY(request->status & (EngineRequest::BodyStreaming | EngineRequest::ExpectContinue))) {
+            Action *action = c->action();
+            bool defer = false;
+            bool askBody = false;
+            if (request->status & EngineRequest::BodyStreaming) {
+                // The action expects the whole body
+                if (!action || !action->attributes().contains(QStringLiteral("StreamingBody"))) {
+                    request->status &= ~EngineRequest::BodyStreaming;
+                    defer = true;
+                }
+            } else if (action && !action->attributes().contains(QStringLiteral("ExpectContinue"))) {
+                // The beforeDispatch hooks, Begin and Auto would see an empty
+                // body, so ask for it now and dispatch once it's received
+                request->status &= ~EngineRequest::ExpectContinue;
+                defer = true;
+                askBody = true;
+            } else if (action) {
+                // Begin and Auto run before the body is received,
+                // anything they parsed from it is parsed again
+                connect(request->body, &QIODevice::readChannelFinished, c, [priv] {
+                    priv->request->d_ptr->resetBody();
+                });
+            }
+
+            if (defer) {
+                // The actions dispatched while detached are
+                // queued and executed when attaching
+                c->detachAsync();
+                connect(request->body, &QIODevice::readChannelFinished, c, [=] {
+                    Q_EMIT beforeDispatch(c);
+
+                    d->dispatcher->dispatch(c);
+
+                    c->attachAsync();
+                });
+
+                if (askBody) {
+                    request->continueBody();
+                }
+                return;
+            }
+        }
+
         Q_EMIT beforeDispatch(c);
 
         d->dispatcher->dispatch(c);
@@ -714,6 +803,59 @@ void Cutelyst::ApplicationPrivate::logRequestUploads(const QVector<Cutelyst::Upl
                                                    QLatin1String("File Uploads are:")).constData();
 }
 
+void ApplicationPrivate::aggregateStats(Stats *stats)
+{
+    const StatsPrivate *statsPriv = stats->d_ptr;
+    for (const StatsAction &stat : statsPriv->actions) {
+        if (!stat.end) {
+            continue;
+        }
+
+        // Strip the indentation and arrow added for nested actions
+        QString name = stat.action.trimmed();
+        if (name.startsWith(QLatin1String("-> "))) {
+            name.remove(0, 3);
+        }
+
+        ActionStatsTotal &total = statsTotals[name];
+        ++total.count;
+        total.time += stat.end - stat.begin;
+        total.cpu += stat.cpuEnd - stat.cpuBegin;
+        total.allocations += stat.allocEnd - stat.allocBegin;
+        total.bytes += stat.bytesEnd - stat.bytesBegin;
+    }
+}
+
+void ApplicationPrivate::logAggregatedStats()
+{
+    if (statsTotals.isEmpty()) {
+        return;
+    }
+
+    QVector<QStringList> table;
+    auto it = statsTotals.constBegin();
+    while (it != statsTotals.constEnd()) {
+        const ActionStatsTotal &total = it.value();
+        table.append({ it.key(),
+                       QString::number(total.count),
+                       QString::number(total.time / total.count / 1000000000.0, 'f') + QLatin1Char('s'),
+                       QString::number(total.cpu / total.count / 1000000000.0, 'f') + QLatin1Char('s'),
+                       QString::number(total.allocations / total.count),
+                       QString::number(total.bytes / total.count) });
+        ++it;
+    }
+    std::sort(table.begin(), table.end(), [] (const QStringList &a, const QStringList &b) {
+        return a.first() < b.first();
+    });
+
+    qCInfo(CUTELYST_STATS) << Utils::buildTable(table, {
+                                                    QStringLiteral("Action"), QStringLiteral("Calls"),
+                                                    QStringLiteral("Avg Time"), QStringLiteral("Avg CPU"),
+                                                    QStringLiteral("Avg Allocs"), QStringLiteral("Avg Bytes")
+                                                },
+                                                QStringLiteral("Aggregated action stats:")).constData();
+}
+
 Component *ApplicationPrivate::createComponentPlugin(const QString &name, QObject *parent, const QString &directory)
 {
     Component *component = nullptr;
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2017 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -23,6 +23,8 @@
 #include <QtCore/QLocale>
 #include <QtCore/QVector>
 
+#include <functional>
+
 #include <Cutelyst/cutelyst_global.h>
 
 class QTranslator;
@@ -156,6 +158,23 @@ public:
      */
     Component *createComponentPlugin(const QString &name, QObject *parent = nullptr);
 
+    /**
+     * Registers a warm-up step named \p name.
+     *
+     * Warm-up steps run in the order they were added, after plugins, controllers
+     * and the dispatcher are set up and before the engine forks. Use them to build
+     * caches that are only read afterwards, like compiled templates or regular
+     * expressions, so that forked workers share that memory instead of each building
+     * its own copy. The time spent on each step shows up in the startup profile.
+     *
+     * Resources that can't be shared among processes, like database connections
+     * and prepared statements, should still be created on \sa postFork().
+     *
+     * Steps must be added before setup finishes, i.e. from init(), a Plugin::setup()
+     * or a Controller::preFork() reimplementation.
+     */
+    void addWarmUp(const QString &name, std::function<void(Cutelyst::Application *)> warmUp);
+
     /**
      * Returns cutelyst version.
      */
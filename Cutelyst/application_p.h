@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2017 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -25,8 +25,19 @@
 #include "context.h"
 #include "componentfactory.h"
 
+#include <vector>
+
 namespace Cutelyst {
 
+struct ActionStatsTotal {
+    quint64 count = 0;
+    qint64 time = 0;
+    qint64 cpu = 0;
+    quint64 allocations = 0;
+    quint64 bytes = 0;
+};
+
+class Stats;
 class ApplicationPrivate
 {
     Q_DECLARE_PUBLIC(Application)
@@ -38,6 +49,8 @@ public:
     void logRequestParameters(const ParamsMultiMap &params, const QString &title);
     void logRequestUploads(const QVector<Upload *> &uploads);
     Component *createComponentPlugin(const QString &name, QObject *parent, const QString &directory);
+    void aggregateStats(Stats *stats);
+    void logAggregatedStats();
 
     Application *q_ptr;
     Dispatcher *dispatcher;
@@ -53,6 +66,8 @@ public:
     bool useStats;
     bool init = false;
     QHash<QLocale, QVector<QTranslator*>> translators;
+    QHash<QString, ActionStatsTotal> statsTotals;
+    std::vector<std::pair<QString, std::function<void(Application *)> > > warmUps;
 };
 
 }
@@ -36,5 +36,6 @@ Q_DECLARE_LOGGING_CATEGORY(CUTELYST_STATS)
 Q_DECLARE_LOGGING_CATEGORY(CUTELYST_COMPONENT)
 Q_DECLARE_LOGGING_CATEGORY(CUTELYST_UTILS_AUTH)
 Q_DECLARE_LOGGING_CATEGORY(CUTELYST_ASYNC)
+Q_DECLARE_LOGGING_CATEGORY(CUTELYST_EVENTSTREAM)
 
 #endif // COMMON_H
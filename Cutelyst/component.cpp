@@ -84,10 +84,11 @@ bool Component::execute(Context *c)
             }
         }
 
-        QStack<Component *> stack = d->aroundRoles;
-        // first item on the stack is always the execution code
-        stack.push_front(this);
-        if (!aroundExecute(c, stack)) {
+        if (d->aroundStack.isEmpty()) {
+            if (!doExecute(c)) {
+                return false;
+            }
+        } else if (!aroundExecute(c, d->aroundStack)) {
             return false;
         }
 
@@ -159,7 +160,15 @@ void Component::applyRoles(const QStack<Cutelyst::Component *> &roles)
         }
     }
     d->roles = roles;
-    d->proccessRoles = true;
+
+    if (!d->aroundRoles.isEmpty()) {
+        // first item on the stack is always the execution code
+        d->aroundStack = d->aroundRoles;
+        d->aroundStack.push_front(this);
+    }
+
+    // Most actions have no roles, let them call doExecute() directly
+    d->proccessRoles = !roles.isEmpty();
 }
 
 bool Component::dispatcherReady(const Dispatcher *dispatch, Controller *controller)
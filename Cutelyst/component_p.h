@@ -33,6 +33,8 @@ public:
     QString reverse;
     QStack<Component *> beforeRoles;
     QStack<Component *> aroundRoles;
+    // aroundRoles with the component itself at the bottom
+    QStack<Component *> aroundStack;
     QStack<Component *> afterRoles;
     QStack<Component *> roles;
     bool proccessRoles = false;
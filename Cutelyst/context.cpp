@@ -26,6 +26,7 @@
 #include "application.h"
 #include "stats.h"
 #include "enginerequest.h"
+#include "application_p.h"
 
 #include "config.h"
 
@@ -358,6 +359,9 @@ void Context::detachAsync()
     Q_D(Context);
     ++d->asyncDetached;
     d->engineRequest->status |= EngineRequest::Async;
+
+    // Coalesced chunks must not wait for the next write
+    d->engineRequest->flushChunkBuffer();
 }
 
 void Context::attachAsync()
@@ -525,10 +529,14 @@ void Context::finalize()
             average = QString::number(1.0 / enlapsed, 'f');
             average.truncate(average.size() - 3);
         }
-        qCInfo(CUTELYST_STATS) << qPrintable(QStringLiteral("Request took: %1s (%2/s)\n%3")
+        qCInfo(CUTELYST_STATS) << qPrintable(QStringLiteral("Request took: %1s (%2/s) CPU: %3s Allocations: %4 (%5 bytes)\n%6")
                                              .arg(QString::number(enlapsed, 'f'),
                                                   average,
+                                                  QString::number(d->stats->cpuTime() / 1000000000.0, 'f'),
+                                                  QString::number(d->stats->allocations()),
+                                                  QString::number(d->stats->allocatedBytes()),
                                                   QString::fromLatin1(d->stats->report())));
+        d->app->d_ptr->aggregateStats(d->stats);
         delete d->stats;
         d->stats = nullptr;
     }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2019 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -25,6 +25,7 @@
 #include "context_p.h"
 
 #include <QMetaClassInfo>
+#include <QMutex>
 #include <QRegularExpression>
 
 using namespace Cutelyst;
@@ -38,6 +39,7 @@ Controller::~Controller()
 {
     Q_D(Controller);
     qDeleteAll(d->actionList);
+    qDeleteAll(d->invokers);
     delete d_ptr;
 }
 
@@ -96,47 +98,14 @@ void ControllerPrivate::init(Application *app, Dispatcher *_dispatcher)
     q->setParent(app);
 
     const QMetaObject *meta = q->metaObject();
-    const QString className = QString::fromLatin1(meta->className());
-    q->setObjectName(className);
-
-    bool namespaceFound = false;
-    for (int i = meta->classInfoCount() - 1; i >= 0; --i) {
-        if (qstrcmp(meta->classInfo(i).name(), "Namespace") == 0) {
-            pathPrefix = QString::fromLatin1(meta->classInfo(i).value());
-            while (pathPrefix.startsWith(QLatin1Char('/'))) {
-                pathPrefix.remove(0, 1);
-            }
-            namespaceFound = true;
-            break;
-        }
-    }
-
-    if (!namespaceFound) {
-        QString controlerNS;
-        bool lastWasUpper = true;
+    q->setObjectName(QString::fromLatin1(meta->className()));
 
-        for (int i = 0; i < className.length(); ++i) {
-            const QChar c = className.at(i);
-            if (c.isLower() || c.isDigit()) {
-                controlerNS.append(c);
-                lastWasUpper = false;
-            } else if (c == QLatin1Char('_')) {
-                controlerNS.append(c);
-                lastWasUpper = true;
-            } else {
-                if (!lastWasUpper) {
-                    controlerNS.append(QLatin1Char('/'));
-                }
-                if (c != QLatin1Char(':')) {
-                    controlerNS.append(c.toLower());
-                }
-                lastWasUpper = true;
-            }
-        }
-        pathPrefix = controlerNS;
-    }
+    // The namespace and the parsed action attributes only depend on the
+    // class, so they are built once and shared by every Application instance
+    metadata = sharedMetadata(meta);
+    pathPrefix = metadata->pathPrefix;
 
-    registerActionMethods(meta, q, app);
+    registerActionMethods(q, app);
 }
 
 void ControllerPrivate::setupFinished()
@@ -182,6 +151,20 @@ bool Controller::_DISPATCH(Context *c)
         }
     }
 
+    // The client is waiting for "100 Continue" to send the body, now that
+    // Begin and Auto of an :ExpectContinue action accepted the request ask
+    // for it and wait to dispatch the Action, if they were async the body
+    // is asked for right away
+    EngineRequest *engineRequest = c->d_ptr->engineRequest;
+    if (ret && Q_UNLIKELY(engineRequest->status & EngineRequest::ExpectContinue)) {
+        engineRequest->status &= ~EngineRequest::ExpectContinue;
+        c->detachAsync();
+        connect(engineRequest->body, &QIODevice::readChannelFinished, c, [c] {
+            c->attachAsync();
+        });
+        engineRequest->continueBody();
+    }
+
     // Dispatch to Action
     if (ret) {
         if (asyncDetached) {
@@ -203,6 +186,12 @@ bool Controller::_DISPATCH(Context *c)
     return ret;
 }
 
+void Controller::registerActionInvoker(const char *name, ActionInvoker *invoker)
+{
+    Q_D(Controller);
+    d->invokers.insert(QByteArray(name), invoker);
+}
+
 Action *ControllerPrivate::actionClass(const QVariantHash &args)
 {
     const auto attributes = args.value(QStringLiteral("attributes")).value<QMap<QString, QString> >();
@@ -238,6 +227,12 @@ Action *ControllerPrivate::createAction(const QVariantHash &args, const QMetaMet
     }
     action->applyRoles(roles);
     action->setMethod(method);
+
+    ActionInvoker *invoker = invokerFor(method);
+    if (invoker) {
+        action->setInvoker(invoker);
+    }
+
     action->setController(controller);
     action->setName(args.value(QStringLiteral("name")).toString());
     action->setReverse(args.value(QStringLiteral("reverse")).toString());
@@ -246,8 +241,107 @@ Action *ControllerPrivate::createAction(const QVariantHash &args, const QMetaMet
     return action;
 }
 
-void ControllerPrivate::registerActionMethods(const QMetaObject *meta, Controller *controller, Application *app)
+ActionInvoker *ControllerPrivate::invokerFor(const QMetaMethod &method) const
+{
+    auto it = invokers.constFind(method.name());
+    while (it != invokers.constEnd() && it.key() == method.name()) {
+        if (it.value()->parameterCount() == method.parameterCount()) {
+            return it.value();
+        }
+        ++it;
+    }
+    return nullptr;
+}
+
+void ControllerPrivate::registerActionMethods(Controller *controller, Application *app)
 {
+    for (const ActionMetadata &actionMetadata : metadata->actions) {
+        QMap<QString, QString> attributes = actionMetadata.attributes;
+        if (!actionMetadata.autoArgs.isEmpty() && invokerFor(actionMetadata.method)) {
+            // Typed actions also take numeric arguments
+            attributes.insert(actionMetadata.autoArgs, QString::number(autoArgsCount(actionMetadata.method, true)));
+        }
+
+        Action *action = createAction({
+                                          {QStringLiteral("name"), QVariant::fromValue(actionMetadata.name)},
+                                          {QStringLiteral("reverse"), QVariant::fromValue(actionMetadata.reverse)},
+                                          {QStringLiteral("namespace"), QVariant::fromValue(pathPrefix)},
+                                          {QStringLiteral("attributes"), QVariant::fromValue(attributes)}
+                                      },
+                                      actionMetadata.method,
+                                      controller,
+                                      app);
+
+        actions.insertMulti(action->reverse(), action);
+        actionList.append(action);
+    }
+}
+
+QSharedPointer<const ControllerMetadata> ControllerPrivate::sharedMetadata(const QMetaObject *meta)
+{
+    static QMutex mutex;
+    // Weak so that classes of unloaded plugins are dropped along with
+    // their last controller, a new class might get the same address
+    static QHash<const QMetaObject *, QWeakPointer<const ControllerMetadata> > cache;
+
+    QMutexLocker locker(&mutex);
+    const QSharedPointer<const ControllerMetadata> cached = cache.value(meta).toStrongRef();
+    if (cached) {
+        return cached;
+    }
+
+    auto it = cache.begin();
+    while (it != cache.end()) {
+        if (it.value().isNull()) {
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const QString className = QString::fromLatin1(meta->className());
+
+    QString pathPrefix;
+    bool namespaceFound = false;
+    for (int i = meta->classInfoCount() - 1; i >= 0; --i) {
+        if (qstrcmp(meta->classInfo(i).name(), "Namespace") == 0) {
+            pathPrefix = QString::fromLatin1(meta->classInfo(i).value());
+            while (pathPrefix.startsWith(QLatin1Char('/'))) {
+                pathPrefix.remove(0, 1);
+            }
+            namespaceFound = true;
+            break;
+        }
+    }
+
+    if (!namespaceFound) {
+        QString controlerNS;
+        bool lastWasUpper = true;
+
+        for (int i = 0; i < className.length(); ++i) {
+            const QChar c = className.at(i);
+            if (c.isLower() || c.isDigit()) {
+                controlerNS.append(c);
+                lastWasUpper = false;
+            } else if (c == QLatin1Char('_')) {
+                controlerNS.append(c);
+                lastWasUpper = true;
+            } else {
+                if (!lastWasUpper) {
+                    controlerNS.append(QLatin1Char('/'));
+                }
+                if (c != QLatin1Char(':')) {
+                    controlerNS.append(c.toLower());
+                }
+                lastWasUpper = true;
+            }
+        }
+        pathPrefix = controlerNS;
+    }
+
+    auto ret = QSharedPointer<ControllerMetadata>::create();
+    ret->pathPrefix = pathPrefix;
+
     // Setup actions
     for (int i = 0; i < meta->methodCount(); ++i) {
         const QMetaMethod method = meta->method(i);
@@ -268,32 +362,26 @@ void ControllerPrivate::registerActionMethods(const QMetaObject *meta, Controlle
                     attributeArray.append(classInfo.value());
                 }
             }
-            QMap<QString, QString> attrs = parseAttributes(method, attributeArray, name);
 
-            QString reverse;
-            if (controller->ns().isEmpty()) {
-                reverse = QString::fromLatin1(name);
+            ActionMetadata actionMetadata;
+            actionMetadata.method = method;
+            actionMetadata.name = name;
+            actionMetadata.attributes = parseAttributes(method, attributeArray, name, pathPrefix, &actionMetadata.autoArgs);
+            if (pathPrefix.isEmpty()) {
+                actionMetadata.reverse = QString::fromLatin1(name);
             } else {
-                reverse = controller->ns() + QLatin1Char('/') + QString::fromLatin1(name);
+                actionMetadata.reverse = pathPrefix + QLatin1Char('/') + QString::fromLatin1(name);
             }
-
-            Action *action = createAction({
-                                              {QStringLiteral("name"), QVariant::fromValue(name)},
-                                              {QStringLiteral("reverse"), QVariant::fromValue(reverse)},
-                                              {QStringLiteral("namespace"), QVariant::fromValue(controller->ns())},
-                                              {QStringLiteral("attributes"), QVariant::fromValue(attrs)}
-                                          },
-                                          method,
-                                          controller,
-                                          app);
-
-            actions.insertMulti(action->reverse(), action);
-            actionList.append(action);
+            ret->actions.push_back(actionMetadata);
         }
     }
+
+    cache.insert(meta, ret);
+
+    return ret;
 }
 
-QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &method, const QByteArray &str, const QByteArray &name)
+QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &method, const QByteArray &str, const QByteArray &name, const QString &pathPrefix, QString *autoArgs)
 {
     QMap<QString, QString> ret;
     std::vector<std::pair<QString, QString> > attributes;
@@ -375,12 +463,12 @@ QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &met
         QString value = i->second;
         if (key == QLatin1String("Global")) {
             key = QStringLiteral("Path");
-            value = parsePathAttr(QLatin1Char('/') + QString::fromLatin1(name));
+            value = parsePathAttr(pathPrefix, QLatin1Char('/') + QString::fromLatin1(name));
         } else if (key == QLatin1String("Local")) {
             key = QStringLiteral("Path");
-            value = parsePathAttr(QString::fromLatin1(name));
+            value = parsePathAttr(pathPrefix, QString::fromLatin1(name));
         } else if (key == QLatin1String("Path")) {
-            value = parsePathAttr(value);
+            value = parsePathAttr(pathPrefix, value);
         } else if (key == QLatin1String("Args")) {
             QString args = value;
             if (!args.isEmpty()) {
@@ -390,7 +478,7 @@ QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &met
             QString captureArgs = value;
             value = captureArgs.remove(QRegularExpression(QStringLiteral("\\D")));
         } else if (key == QLatin1String("Chained")) {
-            value = parseChainedAttr(value);
+            value = parseChainedAttr(pathPrefix, value);
         }
 
         ret.insertMulti(key, value);
@@ -414,14 +502,8 @@ QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &met
 
             // If the signature is not QStringList we count them
             if (!(method.parameterCount() == 2 && method.parameterType(1) == QMetaType::QStringList)) {
-                int parameterCount = 0;
-                for (int i2 = 1; i2 < method.parameterCount(); ++i2) {
-                    int typeId = method.parameterType(i2);
-                    if (typeId == QMetaType::QString) {
-                        ++parameterCount;
-                    }
-                }
-                ret.insert(parameterName, QString::number(parameterCount));
+                ret.insert(parameterName, QString::number(autoArgsCount(method, false)));
+                *autoArgs = parameterName;
             }
         }
 
@@ -435,6 +517,31 @@ QMap<QString, QString> ControllerPrivate::parseAttributes(const QMetaMethod &met
     return ret;
 }
 
+int ControllerPrivate::autoArgsCount(const QMetaMethod &method, bool typed)
+{
+    int parameterCount = 0;
+    for (int i = 1; i < method.parameterCount(); ++i) {
+        switch (method.parameterType(i)) {
+        case QMetaType::QString:
+            ++parameterCount;
+            break;
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+            // Only registerAction() converts arguments to numbers
+            if (typed) {
+                ++parameterCount;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return parameterCount;
+}
+
 QStack<Component *> ControllerPrivate::gatherActionRoles(const QVariantHash &args)
 {
     QStack<Component *> roles;
@@ -450,7 +557,7 @@ QStack<Component *> ControllerPrivate::gatherActionRoles(const QVariantHash &arg
     return roles;
 }
 
-QString ControllerPrivate::parsePathAttr(const QString &value)
+QString ControllerPrivate::parsePathAttr(const QString &pathPrefix, const QString &value)
 {
     QString ret = pathPrefix;
     if (value.startsWith(QLatin1Char('/'))) {
@@ -461,7 +568,7 @@ QString ControllerPrivate::parsePathAttr(const QString &value)
     return ret;
 }
 
-QString ControllerPrivate::parseChainedAttr(const QString &attr)
+QString ControllerPrivate::parseChainedAttr(const QString &pathPrefix, const QString &attr)
 {
     QString ret = QStringLiteral("/");
     if (attr.isEmpty()) {
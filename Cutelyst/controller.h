@@ -22,6 +22,7 @@
 
 #include <Cutelyst/cutelyst_global.h>
 #include <Cutelyst/action.h>
+#include <Cutelyst/actioninvoker.h>
 #include <Cutelyst/context.h>
 #include <Cutelyst/request.h>
 #include <Cutelyst/response.h>
@@ -30,6 +31,7 @@
 #define C_PATH(X, Y) Q_CLASSINFO(STR(X ## _Path), STR(Y))
 #define C_NAMESPACE(value) Q_CLASSINFO("Namespace", value)
 #define C_ATTR(X, Y) Q_CLASSINFO(STR(X), STR(Y)) Q_INVOKABLE
+#define CUTELYST_ACTION(Class, Method) registerAction(#Method, &Class::Method)
 
 #  define CActionFor(str) \
     ([this]() -> Cutelyst::Action * { \
@@ -85,6 +87,21 @@ class ControllerPrivate;
  * \n However if no Args value is set, assumed to 'slurp' all
  *    remaining path parts under this namespace.
  *
+ * \b :StreamingBody - When the engine dispatches requests before their
+ * body is received, like cutelyst-wsgi with post buffering set to 0, the
+ * action runs right away and reads the body as it arrives using the
+ * Request::body() readyRead() signal. If the client disconnects before
+ * sending the whole body readChannelFinished() is never emitted, readyRead()
+ * is emitted and reading fails with errorString() set instead. Actions
+ * without it are only dispatched once the whole body is available.
+ *
+ * \b :ExpectContinue - When the client sends "Expect: 100-continue" the
+ * Begin and Auto actions run before the client is asked for the body, so
+ * they can reject a request without it being uploaded. They and the
+ * Application::beforeDispatch() hooks, like CSRFProtection, must not rely
+ * on the body. Once received the body is parsed again for the action.
+ * Actions without it are only dispatched once the whole body is available.
+ *
  * There are also three special methods that can be implemented
  * that will be automatically dispatched, they are Begin(),
  * Auto() and End().
@@ -167,9 +184,30 @@ protected:
      */
     bool _DISPATCH(Context *c);
 
+    /**
+     * Registers \p method to be called directly when the action named \p name
+     * is executed, instead of going through QMetaMethod::invoke(). The request
+     * arguments are converted to the method parameter types, supported types
+     * are QString, QStringView, QStringRef (Qt 5), int, uint, qint64, quint64,
+     * double and QStringList which receives all arguments. If an argument
+     * can not be converted the action fails as if it returned false.
+     *
+     * The method must still be declared with C_ATTR so its attributes are
+     * known, call this from the constructor:
+     * \code{.cpp}
+     * CUTELYST_ACTION(Users, view); // same as registerAction("view", &Users::view)
+     * \endcode
+     */
+    template <typename C, typename R, typename... Args>
+    inline void registerAction(const char *name, R (C::*method)(Context *, Args...)) {
+        registerActionInvoker(name, new TypedActionInvoker<C, R, Args...>(method));
+    }
+
     ControllerPrivate *d_ptr;
 
 private:
+    void registerActionInvoker(const char *name, ActionInvoker *invoker);
+
     Q_DECLARE_PRIVATE(Controller)
     friend class Application;
     friend class Dispatcher;
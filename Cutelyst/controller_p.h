@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2014-2017 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2014-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -21,8 +21,32 @@
 #include "controller.h"
 #include "component.h"
 
+#include <QtCore/QSharedPointer>
+
+#include <vector>
+
 namespace Cutelyst {
 
+class ActionMetadata
+{
+public:
+    QMetaMethod method;
+    QByteArray name;
+    QString reverse;
+    QMap<QString, QString> attributes;
+    // Args or CaptureArgs when counted by AutoArgs or AutoCaptureArgs
+    QString autoArgs;
+};
+
+// Read-only description of a Controller class,
+// built once per class and shared by all threads
+class ControllerMetadata
+{
+public:
+    QString pathPrefix;
+    std::vector<ActionMetadata> actions;
+};
+
 class ControllerPrivate
 {
     Q_DECLARE_PUBLIC(Controller)
@@ -34,15 +58,20 @@ public:
     void setupFinished();
     Action* actionClass(const QVariantHash &args);
     Action* createAction(const QVariantHash &args, const QMetaMethod &method, Controller *controller, Application *app);
-    void registerActionMethods(const QMetaObject *meta, Controller *controller, Application *app);
-    QMap<QString, QString> parseAttributes(const QMetaMethod &method, const QByteArray &str, const QByteArray &name);
+    void registerActionMethods(Controller *controller, Application *app);
+    // Thread safe, the metadata is kept while some controller of the class uses it
+    static QSharedPointer<const ControllerMetadata> sharedMetadata(const QMetaObject *meta);
+    static QMap<QString, QString> parseAttributes(const QMetaMethod &method, const QByteArray &str, const QByteArray &name, const QString &pathPrefix, QString *autoArgs);
+    static int autoArgsCount(const QMetaMethod &method, bool typed);
+    ActionInvoker *invokerFor(const QMetaMethod &method) const;
     QStack<Component *> gatherActionRoles(const QVariantHash &args);
-    QString parsePathAttr(const QString &value);
-    QString parseChainedAttr(const QString &attr);
+    static QString parsePathAttr(const QString &pathPrefix, const QString &value);
+    static QString parseChainedAttr(const QString &pathPrefix, const QString &attr);
 
     QObject *instantiateClass(const QString &name, const QByteArray &super);
     bool superIsClassName(const QMetaObject *super, const QByteArray &className);
 
+    QSharedPointer<const ControllerMetadata> metadata;
     QString pathPrefix;
     ActionList beginAutoList;
     Action *end = nullptr;
@@ -50,6 +79,7 @@ public:
     Controller *q_ptr;
     Dispatcher *dispatcher = nullptr;
     QMap<QString, Action *> actions;
+    QMultiHash<QByteArray, ActionInvoker *> invokers;
     ActionList actionList;
     bool parsedActions = false;
 };
@@ -114,6 +114,16 @@
 #else
 #  define CUTELYST_WSGI_EXPORT Q_DECL_IMPORT
 #endif
+#if defined(Cutelyst2Qt5RateLimit_EXPORTS)
+#  define CUTELYST_PLUGIN_RATELIMIT_EXPORT Q_DECL_EXPORT
+#else
+#  define CUTELYST_PLUGIN_RATELIMIT_EXPORT Q_DECL_IMPORT
+#endif
+#if defined(Cutelyst2Qt5LoadShedding_EXPORTS)
+#  define CUTELYST_PLUGIN_LOADSHEDDING_EXPORT Q_DECL_EXPORT
+#else
+#  define CUTELYST_PLUGIN_LOADSHEDDING_EXPORT Q_DECL_IMPORT
+#endif
 #if defined(Cutelyst2Qt5UserAgent_EXPORTS)
 #  define CUTELYST_PLUGIN_USERAGENT_EXPORT Q_DECL_EXPORT
 #else
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -267,6 +267,9 @@ const char *Engine::httpStatusMessage(quint16 status, int *len)
     case Response::ExpectationFailed:
         ret = "HTTP/1.1 417 Expectation Failed";
         break;
+    case Response::TooManyRequests:
+        ret = "HTTP/1.1 429 Too Many Requests";
+        break;
     case Response::NotImplemented:
         ret = "HTTP/1.1 501 Not Implemented";
         break;
@@ -22,11 +22,36 @@
 #include <Cutelyst/response_p.h>
 #include <Cutelyst/Context>
 
+#include <QTimer>
 #include <QLoggingCategory>
 Q_LOGGING_CATEGORY(CUTELYST_ENGINEREQUEST, "cutelyst.engine_request", QtWarningMsg)
 
 using namespace Cutelyst;
 
+// Room for the previous chunk CRLF, 16 hex digits and CRLF
+#define CHUNK_HEADROOM 20
+// Bigger chunks are written without being copied
+#define CHUNK_COPY_LIMIT (16 * 1024)
+
+static char *writeChunkHeader(char *end, qint64 len, bool trailer)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    char *ptr = end;
+    *--ptr = '\n';
+    *--ptr = '\r';
+    do {
+        *--ptr = hex[len & 0xF];
+        len >>= 4;
+    } while (len);
+
+    if (trailer) {
+        *--ptr = '\n';
+        *--ptr = '\r';
+    }
+    return ptr;
+}
+
 EngineRequest::EngineRequest()
 {
 
@@ -66,7 +91,7 @@ void EngineRequest::finalizeBody()
         }
     } else if (!(status & EngineRequest::ChunkedDone)) {
         // Write the final '0' chunk
-        doWrite("0\r\n\r\n", 5);
+        finishChunked();
     }
 }
 
@@ -129,6 +154,11 @@ bool EngineRequest::finalizeHeaders()
 
     finalizeCookies();
 
+    if (status & EngineRequest::Chunked) {
+        chunkBuffer.resize(0);
+        chunkTrailerPending = false;
+    }
+
     // Done
     status |= EngineRequest::FinalizedHeaders;
     return writeHeaders(response->status(), headers);
@@ -139,24 +169,89 @@ qint64 EngineRequest::write(const char *data, qint64 len)
     if (!(status & EngineRequest::Chunked)) {
         return doWrite(data, len);
     } else if (!(status & EngineRequest::ChunkedDone)) {
-        const QByteArray chunkSize = QByteArray::number(len, 16).toUpper();
-        QByteArray chunk;
-        chunk.reserve(int(len + chunkSize.size() + 4));
-        chunk.append(chunkSize).append("\r\n", 2)
-                .append(data, int(len)).append("\r\n", 2);
+        // An empty chunk finishes the body
+        if (!len) {
+            return finishChunked() ? 0 : -1;
+        }
 
-        qint64 retWrite = doWrite(chunk.data(), chunk.size());
+        const qint64 buffered = qMax(chunkBuffer.size() - CHUNK_HEADROOM, 0);
+        if (buffered + len <= CHUNK_COPY_LIMIT) {
+            if (chunkBuffer.isEmpty()) {
+                chunkBuffer.reserve(CHUNK_HEADROOM + qMax(chunkedMinimumSize, 512));
+                chunkBuffer.resize(CHUNK_HEADROOM);
+            }
+            chunkBuffer.append(data, int(len));
 
-        // Flag if we wrote an empty chunk
-        if (!len) {
-            status |= EngineRequest::ChunkedDone;
+            // Coalesce small writes while the action runs, async
+            // writes like server-sent events must go out right away
+            if (buffered + len < chunkedMinimumSize && !(status & EngineRequest::Async)) {
+                return len;
+            }
+            return flushChunkBuffer() ? len : -1;
         }
 
-        return retWrite == chunk.size() ? len : -1;
+        if (!flushChunkBuffer()) {
+            return -1;
+        }
+
+        // The data is written as is and the CRLF that
+        // ends it goes together with the next chunk size
+        char header[CHUNK_HEADROOM];
+        const char *ptr = writeChunkHeader(header + CHUNK_HEADROOM, len, chunkTrailerPending);
+        const qint64 headerLen = header + CHUNK_HEADROOM - ptr;
+        chunkTrailerPending = true;
+        if (doWrite(ptr, headerLen) != headerLen || doWrite(data, len) != len) {
+            return -1;
+        }
+        return len;
     }
     return -1;
 }
 
+bool EngineRequest::flushChunkBuffer()
+{
+    if (chunkBuffer.size() <= CHUNK_HEADROOM) {
+        return true;
+    }
+
+    // The chunk size is written in the space reserved before the data
+    char *begin = chunkBuffer.data();
+    const char *ptr = writeChunkHeader(begin + CHUNK_HEADROOM, chunkBuffer.size() - CHUNK_HEADROOM, chunkTrailerPending);
+    const qint64 len = chunkBuffer.size() - (ptr - begin);
+    chunkTrailerPending = true;
+
+    const bool ret = doWrite(ptr, len) == len;
+    chunkBuffer.resize(CHUNK_HEADROOM);
+    return ret;
+}
+
+bool EngineRequest::finishChunked()
+{
+    bool ret = flushChunkBuffer();
+
+    if (chunkTrailerPending) {
+        ret &= doWrite("\r\n0\r\n\r\n", 7) == 7;
+    } else {
+        ret &= doWrite("0\r\n\r\n", 5) == 5;
+    }
+    chunkTrailerPending = false;
+    status |= EngineRequest::ChunkedDone;
+    return ret;
+}
+
+EngineRequest::StreamingFraming EngineRequest::streamingFraming() const
+{
+    return CloseConnection;
+}
+
+void EngineRequest::continueBody()
+{
+    QIODevice *device = body;
+    QTimer::singleShot(0, context, [device] {
+        Q_EMIT device->readChannelFinished();
+    });
+}
+
 bool EngineRequest::webSocketHandshake(const QString &key, const QString &origin, const QString &protocol)
 {
     if (status & EngineRequest::FinalizedHeaders) {
@@ -203,6 +298,11 @@ void EngineRequest::processingFinished()
 {
 }
 
+qint64 EngineRequest::bytesToWrite() const
+{
+    return 0;
+}
+
 bool EngineRequest::webSocketHandshakeDo(const QString &key, const QString &origin, const QString &protocol)
 {
     Q_UNUSED(key)
@@ -49,9 +49,17 @@ public:
         ChunkedDone = 0x08,
         Async = 0x10,
         Finalized = 0x20,
+        BodyStreaming = 0x40,
+        ExpectContinue = 0x80,
     };
     Q_DECLARE_FLAGS(Status, StatusFlag)
 
+    enum StreamingFraming {
+        CloseConnection,
+        ChunkedEncoding,
+        NativeFraming,
+    };
+
     explicit EngineRequest();
 
     virtual ~EngineRequest();
@@ -95,6 +103,37 @@ public:
      */
     qint64 write(const char *data, qint64 len);
 
+    /*!
+     * Writes the data coalesced by chunked transfer encoding,
+     * called when the request becomes async
+     */
+    bool flushChunkBuffer();
+
+    /*!
+     * Reimplement to tell how a body written with Response::write()
+     * without a Content-Length is delimited. The default closes the
+     * connection once the response is done, HTTP/1.1 engines should
+     * return ChunkedEncoding and protocols that frame the body by
+     * themselves, like HTTP/2, NativeFraming.
+     */
+    virtual StreamingFraming streamingFraming() const;
+
+    /*!
+     * Called when ExpectContinue is set and the action needs the body,
+     * the context is detached until the body is received. Engines must
+     * ask the client for the body and emit readChannelFinished() on
+     * \ref body once it's complete, but never from within this call.
+     * The default implementation assumes the body is already available.
+     */
+    virtual void continueBody();
+
+    /*!
+     * Reimplement to return how many bytes written with doWrite()
+     * are still buffered waiting to be sent to the client.
+     * The default implementation returns 0.
+     */
+    virtual qint64 bytesToWrite() const;
+
     bool webSocketHandshake(const QString &key, const QString &origin, const QString &protocol);
 
     virtual bool webSocketSendTextMessage(const QString &message);
@@ -175,7 +214,11 @@ public:
     /*! Connection status */
     Status status = InitialState;
 
-    /*! The QIODevice containing the body (if any) of the request
+    /*! The QIODevice containing the body (if any) of the request,
+     * when BodyStreaming is set the request was dispatched before
+     * the body was received, and readChannelFinished() is emitted
+     * once the whole body is available, it's not emitted if the
+     * connection is closed before that
      * \note It's deleted when Context gets deleted */
     QIODevice *body = nullptr;
 
@@ -191,6 +234,16 @@ public:
 
     /*! The elapsed timer since the start of request */
     QElapsedTimer elapsed;
+
+    /*! Minimum size of the chunks written with chunked transfer encoding,
+     * smaller writes are coalesced until the request becomes async */
+    int chunkedMinimumSize = 0;
+
+private:
+    bool finishChunked();
+
+    QByteArray chunkBuffer;
+    bool chunkTrailerPending = false;
 };
 
 }
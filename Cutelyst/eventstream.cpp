@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "eventstream_p.h"
+
+#include "common.h"
+#include "context.h"
+#include "request.h"
+#include "response.h"
+
+#include <QHash>
+#include <QTimer>
+
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(CUTELYST_EVENTSTREAM, "cutelyst.eventstream", QtWarningMsg)
+
+using namespace Cutelyst;
+
+EventStream::EventStream(Context *c) : QObject(c)
+  , d_ptr(new EventStreamPrivate)
+{
+    Q_D(EventStream);
+    d->q_ptr = this;
+    d->context = c;
+
+    Response *res = c->response();
+    res->setContentType(QStringLiteral("text/event-stream"));
+    res->setHeader(QStringLiteral("CACHE_CONTROL"), QStringLiteral("no-cache"));
+    // Stops nginx from buffering the events
+    res->setHeader(QStringLiteral("X_ACCEL_BUFFERING"), QStringLiteral("no"));
+
+    c->detachAsync();
+
+    d->heartbeat = new QTimer(this);
+    connect(d->heartbeat, &QTimer::timeout, this, [this] {
+        sendComment();
+    });
+    d->heartbeat->start(15000);
+
+    // Sends the headers right away so the client knows the stream is open
+    sendComment();
+}
+
+EventStream::~EventStream()
+{
+    Q_D(EventStream);
+    const auto channels = d->channels;
+    for (EventStreamChannel *channel : channels) {
+        channel->unsubscribe(this);
+    }
+    delete d_ptr;
+}
+
+QString EventStream::lastEventId() const
+{
+    Q_D(const EventStream);
+    return d->context->request()->header(QStringLiteral("LAST_EVENT_ID"));
+}
+
+bool EventStream::setRetry(int msecs)
+{
+    Q_D(EventStream);
+    return d->write(QByteArrayLiteral("retry: ") + QByteArray::number(msecs) + QByteArrayLiteral("\n\n"));
+}
+
+void EventStream::setHeartbeat(int msecs)
+{
+    Q_D(EventStream);
+    if (msecs > 0 && !d->closed) {
+        d->heartbeat->start(msecs);
+    } else {
+        d->heartbeat->stop();
+    }
+}
+
+int EventStream::heartbeat() const
+{
+    Q_D(const EventStream);
+    return d->heartbeat->isActive() ? d->heartbeat->interval() : 0;
+}
+
+void EventStream::setMaxPendingBytes(qint64 bytes)
+{
+    Q_D(EventStream);
+    d->maxPendingBytes.store(bytes, std::memory_order_relaxed);
+}
+
+qint64 EventStream::maxPendingBytes() const
+{
+    Q_D(const EventStream);
+    return d->maxPendingBytes.load(std::memory_order_relaxed);
+}
+
+bool EventStream::send(const QByteArray &data, const QString &event, const QString &id)
+{
+    Q_D(EventStream);
+    return d->write(encode(data, event, id));
+}
+
+bool EventStream::sendComment(const QByteArray &comment)
+{
+    Q_D(EventStream);
+
+    QByteArray frame;
+    frame.reserve(comment.size() + 4);
+    frame.append(':');
+    if (!comment.isEmpty()) {
+        // Comments can't span lines
+        frame.append(' ');
+        frame.append(QByteArray(comment).replace('\n', ' ').replace('\r', ' '));
+    }
+    frame.append("\n\n", 2);
+
+    return d->write(frame);
+}
+
+bool EventStream::sendEncoded(const QByteArray &frame)
+{
+    Q_D(EventStream);
+    return d->write(frame);
+}
+
+bool EventStream::isClosed() const
+{
+    Q_D(const EventStream);
+    return d->closed;
+}
+
+void EventStream::close()
+{
+    Q_D(EventStream);
+    if (d->closed) {
+        return;
+    }
+
+    d->closed = true;
+    d->heartbeat->stop();
+
+    const auto channels = d->channels;
+    for (EventStreamChannel *channel : channels) {
+        channel->unsubscribe(this);
+    }
+
+    Q_EMIT closed();
+
+    if (d->writing) {
+        // Finalizing would delete the engine request while it's blocked
+        d->attachAfterWrite = true;
+    } else {
+        d->attach();
+    }
+}
+
+static void appendField(QByteArray &frame, const char *name, int len, const QString &value)
+{
+    frame.append(name, len);
+    // Line breaks would end the field
+    const QByteArray utf8 = value.toUtf8();
+    if (utf8.contains('\n') || utf8.contains('\r')) {
+        frame.append(QByteArray(utf8).replace('\n', QByteArray()).replace('\r', QByteArray()));
+    } else {
+        frame.append(utf8);
+    }
+    frame.append('\n');
+}
+
+QByteArray EventStream::encode(const QByteArray &data, const QString &event, const QString &id)
+{
+    QByteArray ret;
+    ret.reserve(data.size() + event.size() + id.size() + 32);
+
+    if (!id.isNull()) {
+        appendField(ret, "id: ", 4, id);
+    }
+
+    if (!event.isEmpty()) {
+        appendField(ret, "event: ", 7, event);
+    }
+
+    // Each line of the data needs its own field, clients
+    // take CRLF, LF and CR as line endings
+    const char *ptr = data.constData();
+    const int size = data.size();
+    int pos = 0;
+    Q_FOREVER {
+        int eol = pos;
+        while (eol < size && ptr[eol] != '\n' && ptr[eol] != '\r') {
+            ++eol;
+        }
+
+        ret.append("data: ", 6);
+        ret.append(ptr + pos, eol - pos);
+        ret.append('\n');
+
+        if (eol == size) {
+            break;
+        } else if (ptr[eol] == '\r' && eol + 1 < size && ptr[eol + 1] == '\n') {
+            ++eol;
+        }
+        pos = eol + 1;
+    }
+
+    ret.append('\n');
+
+    return ret;
+}
+
+void EventStream::deliverPending()
+{
+    Q_D(EventStream);
+
+    QVector<QByteArray> frames;
+    qint64 bytes;
+    bool overflow;
+    {
+        QMutexLocker locker(&d->pendingMutex);
+        d->scheduled = false;
+        if (d->writing) {
+            // Called from the loop the engine runs while blocked, the
+            // frames stay queued until it returns so they keep their order
+            if (d->overflow || d->pendingBytes + d->context->response()->bytesToWrite() > d->maxPendingBytes.load(std::memory_order_relaxed)) {
+                locker.unlock();
+                qCWarning(CUTELYST_EVENTSTREAM) << "Client is too slow, dropping events and closing the stream";
+                close();
+            }
+            return;
+        }
+        frames.swap(d->pending);
+        bytes = d->pendingBytes;
+        d->pendingBytes = 0;
+        overflow = d->overflow;
+    }
+
+    if (d->closed) {
+        return;
+    }
+
+    // What the engine still has to send is only known in this thread,
+    // together with the queue it can't go over the limit either
+    if (!overflow) {
+        bytes += d->context->response()->bytesToWrite();
+        overflow = bytes > d->maxPendingBytes.load(std::memory_order_relaxed);
+    }
+
+    if (overflow) {
+        qCWarning(CUTELYST_EVENTSTREAM) << "Client is too slow, dropping events and closing the stream";
+        close();
+        return;
+    }
+
+    for (const QByteArray &frame : frames) {
+        if (!d->write(frame)) {
+            return;
+        }
+    }
+}
+
+bool EventStreamPrivate::write(const QByteArray &frame)
+{
+    if (closed) {
+        return false;
+    }
+
+    if (writing) {
+        // Queued behind the frame the engine is still sending
+        enqueue(frame);
+        return true;
+    }
+
+    Response *res = context->response();
+    writing = true;
+    const qint64 written = res->write(frame);
+    writing = false;
+
+    if (attachAfterWrite) {
+        attachAfterWrite = false;
+        attach();
+        return false;
+    }
+
+    if (written != frame.size()) {
+        qCDebug(CUTELYST_EVENTSTREAM) << "Failed to write, closing the stream";
+        q_ptr->close();
+        return false;
+    }
+
+    const qint64 bytes = res->bytesToWrite();
+    if (bytes > maxPendingBytes.load(std::memory_order_relaxed)) {
+        qCWarning(CUTELYST_EVENTSTREAM) << "Client is too slow," << bytes << "bytes not sent, closing the stream";
+        q_ptr->close();
+        return false;
+    }
+
+    // Frames queued while the engine was blocked
+    QMutexLocker locker(&pendingMutex);
+    if (!scheduled && (!pending.isEmpty() || overflow)) {
+        scheduled = true;
+        QMetaObject::invokeMethod(q_ptr, "deliverPending", Qt::QueuedConnection);
+    }
+
+    return true;
+}
+
+void EventStreamPrivate::attach()
+{
+    // Attaching finalizes the request which might delete the
+    // Context and this object, so don't do it from within this call
+    Context *c = context;
+    QTimer::singleShot(0, c, [c] {
+        c->attachAsync();
+    });
+}
+
+void EventStreamPrivate::enqueue(const QByteArray &frame)
+{
+    QMutexLocker locker(&pendingMutex);
+    if (overflow) {
+        return;
+    }
+
+    // A slow client can't make the process buffer events without limit,
+    // what the engine still has to send is added by deliverPending()
+    if (pendingBytes + frame.size() > maxPendingBytes.load(std::memory_order_relaxed)) {
+        overflow = true;
+        pending.clear();
+        pendingBytes = 0;
+    } else {
+        pending.append(frame);
+        pendingBytes += frame.size();
+    }
+
+    // A single call delivers everything queued until it runs
+    if (!scheduled) {
+        scheduled = true;
+        QMetaObject::invokeMethod(q_ptr, "deliverPending", Qt::QueuedConnection);
+    }
+}
+
+EventStreamChannel::EventStreamChannel(int historySize)
+  : d_ptr(new EventStreamChannelPrivate)
+{
+    d_ptr->historySize = historySize;
+}
+
+EventStreamChannel::~EventStreamChannel()
+{
+    delete d_ptr;
+}
+
+EventStreamChannel *EventStreamChannel::channel(const QString &name)
+{
+    static QMutex mutex;
+    static QHash<QString, EventStreamChannel *> channels;
+
+    QMutexLocker locker(&mutex);
+    auto it = channels.find(name);
+    if (it == channels.end()) {
+        it = channels.insert(name, new EventStreamChannel);
+    }
+    return it.value();
+}
+
+int EventStreamChannel::historySize() const
+{
+    Q_D(const EventStreamChannel);
+    return d->historySize;
+}
+
+void EventStreamChannel::subscribe(EventStream *stream)
+{
+    Q_D(EventStreamChannel);
+
+    if (stream->isClosed()) {
+        return;
+    }
+
+    const QString lastEventId = stream->lastEventId();
+    QVector<QByteArray> missed;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->subscribers.contains(stream)) {
+            return;
+        }
+
+        if (!lastEventId.isEmpty()) {
+            auto it = std::find_if(d->history.cbegin(), d->history.cend(), [&lastEventId] (const EventStreamEvent &event) {
+                return event.id == lastEventId;
+            });
+            it = it == d->history.cend() ? d->history.cbegin() : it + 1;
+            for (; it != d->history.cend(); ++it) {
+                missed.append(it->frame);
+            }
+        }
+
+        d->subscribers.append(stream);
+    }
+    stream->d_ptr->channels.append(this);
+
+    // Events published from now on are queued after these
+    for (const QByteArray &frame : missed) {
+        if (!stream->d_ptr->write(frame)) {
+            break;
+        }
+    }
+}
+
+void EventStreamChannel::unsubscribe(EventStream *stream)
+{
+    Q_D(EventStreamChannel);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->subscribers.removeOne(stream);
+    }
+    stream->d_ptr->channels.removeOne(this);
+}
+
+int EventStreamChannel::subscribers() const
+{
+    Q_D(const EventStreamChannel);
+    QMutexLocker locker(&d->mutex);
+    return d->subscribers.size();
+}
+
+QString EventStreamChannel::publish(const QByteArray &data, const QString &event, const QString &id)
+{
+    Q_D(EventStreamChannel);
+
+    QMutexLocker locker(&d->mutex);
+    const QString eventId = id.isEmpty() ? QString::number(++d->sequence) : id;
+
+    // Encoded once, the subscribers share the same buffer
+    const QByteArray frame = EventStream::encode(data, event, eventId);
+
+    if (d->historySize > 0) {
+        d->history.push_back({ eventId, frame });
+        if (int(d->history.size()) > d->historySize) {
+            d->history.pop_front();
+        }
+    }
+
+    const auto subscribers = d->subscribers;
+    for (EventStream *stream : subscribers) {
+        stream->d_ptr->enqueue(frame);
+    }
+
+    return eventId;
+}
+
+#include "moc_eventstream.cpp"
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CUTELYST_EVENTSTREAM_H
+#define CUTELYST_EVENTSTREAM_H
+
+#include <Cutelyst/cutelyst_global.h>
+
+#include <QObject>
+
+namespace Cutelyst {
+
+class Context;
+class EventStreamChannel;
+class EventStreamPrivate;
+class EventStreamChannelPrivate;
+
+/**
+ * @class Cutelyst::EventStream eventstream.h Cutelyst/EventStream
+ * @brief Streams Server-Sent Events to the client of a request.
+ *
+ * Creating an EventStream sets the @c text/event-stream response headers and detaches
+ * the Context, the connection stays open until close() is called or the client goes away,
+ * the object is a child of the Context and is deleted with it.
+ *
+ * Events can be sent directly with send() or the stream can be subscribed to an
+ * EventStreamChannel to receive the events published from any thread.
+ *
+ * @code{.cpp}
+ * void Root::events(Context *c)
+ * {
+ *     auto stream = new EventStream(c);
+ *     stream->setRetry(5000);
+ *     EventStreamChannel::channel(QStringLiteral("news"))->subscribe(stream);
+ * }
+ * @endcode
+ *
+ * A comment is written every heartbeat() milliseconds so that proxies don't close idle
+ * connections, it's also how clients that went away are noticed.
+ *
+ * When the data written to a stream is not sent to the client as fast as it's produced
+ * and the pending bytes go over maxPendingBytes() the stream is closed, browsers reconnect
+ * by themselves and send the last event id they got, which lets the EventStreamChannel
+ * resume from there.
+ */
+class CUTELYST_LIBRARY EventStream : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(EventStream)
+public:
+    /**
+     * Starts streaming events in the response of @a c and detaches it.
+     */
+    explicit EventStream(Context *c);
+    virtual ~EventStream() override;
+
+    /**
+     * Returns the value of the @a Last-Event-ID header sent by a reconnecting client.
+     */
+    QString lastEventId() const;
+
+    /**
+     * Tells the client to wait @a msecs milliseconds before reconnecting.
+     */
+    bool setRetry(int msecs);
+
+    /**
+     * Sets the interval in milliseconds of the keep alive comments, 0 disables them, defaults to 15000.
+     */
+    void setHeartbeat(int msecs);
+
+    /**
+     * Returns the interval in milliseconds of the keep alive comments.
+     */
+    int heartbeat() const;
+
+    /**
+     * Sets how many bytes can be waiting to be sent to the client before the stream is closed, defaults to 1MiB.
+     */
+    void setMaxPendingBytes(qint64 bytes);
+
+    /**
+     * Returns how many bytes can be waiting to be sent to the client before the stream is closed.
+     */
+    qint64 maxPendingBytes() const;
+
+    /**
+     * Sends an event with @a data, which might have multiple lines, optionally
+     * with an @a event type and an @a id.
+     *
+     * Returns false if the stream is closed.
+     */
+    bool send(const QByteArray &data, const QString &event = QString(), const QString &id = QString());
+
+    /**
+     * Sends a @a comment, which is ignored by clients.
+     */
+    bool sendComment(const QByteArray &comment = QByteArray());
+
+    /**
+     * Sends an event already encoded with encode().
+     */
+    bool sendEncoded(const QByteArray &frame);
+
+    /**
+     * Returns true if the stream was closed, either by calling close(),
+     * because the client went away or because it was too slow.
+     */
+    bool isClosed() const;
+
+    /**
+     * Finishes the response and attaches the Context.
+     */
+    void close();
+
+    /**
+     * Encodes an event in the <CODE>text/event-stream</CODE> format, the result can be
+     * sent to many streams with sendEncoded().
+     */
+    static QByteArray encode(const QByteArray &data, const QString &event = QString(), const QString &id = QString());
+
+Q_SIGNALS:
+    /**
+     * Emitted once when the stream is closed.
+     */
+    void closed();
+
+protected:
+    EventStreamPrivate *d_ptr;
+
+private Q_SLOTS:
+    void deliverPending();
+
+private:
+    friend class EventStreamChannel;
+};
+
+/**
+ * @class Cutelyst::EventStreamChannel eventstream.h Cutelyst/EventStream
+ * @brief Broadcasts Server-Sent Events to the EventStream objects subscribed to it.
+ *
+ * Events are encoded a single time when published and the same buffer is queued to
+ * each subscriber, which writes it from the thread its Context lives in, so publishing
+ * doesn't block on slow clients and can be done from any thread.
+ *
+ * The last historySize() events are kept so that subscribers with a Last-Event-ID
+ * receive the events they missed, if the id is not known anymore all of the kept
+ * events are sent.
+ */
+class CUTELYST_LIBRARY EventStreamChannel
+{
+    Q_DECLARE_PRIVATE(EventStreamChannel)
+public:
+    /**
+     * Constructs a channel that keeps the last @a historySize events,
+     * it must outlive its subscribers.
+     */
+    explicit EventStreamChannel(int historySize = 64);
+    ~EventStreamChannel();
+
+    /**
+     * Returns the channel named @a name shared by the whole process,
+     * it's created on first use and never deleted.
+     *
+     * Each name keeps its channel and history until the process exits, so names
+     * should come from a fixed set like "news" or "status". Channels created on
+     * demand, for example one per user, should be owned by the application
+     * instead, deleting them once their subscribers are gone.
+     */
+    static EventStreamChannel *channel(const QString &name);
+
+    /**
+     * Returns the number of events kept to resume subscribers.
+     */
+    int historySize() const;
+
+    /**
+     * Adds @a stream to the subscribers and sends it the events it missed,
+     * the stream is removed when it's closed or deleted.
+     */
+    void subscribe(EventStream *stream);
+
+    /**
+     * Removes @a stream from the subscribers.
+     */
+    void unsubscribe(EventStream *stream);
+
+    /**
+     * Returns the number of subscribers.
+     */
+    int subscribers() const;
+
+    /**
+     * Sends an event to all subscribers, when @a id is empty a sequential number is used.
+     *
+     * Returns the id of the event.
+     */
+    QString publish(const QByteArray &data, const QString &event = QString(), const QString &id = QString());
+
+protected:
+    EventStreamChannelPrivate *d_ptr;
+
+private:
+    Q_DISABLE_COPY(EventStreamChannel)
+};
+
+}
+
+#endif // CUTELYST_EVENTSTREAM_H
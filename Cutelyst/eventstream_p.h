@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CUTELYST_EVENTSTREAM_P_H
+#define CUTELYST_EVENTSTREAM_P_H
+
+#include "eventstream.h"
+
+#include <QMutex>
+#include <QVector>
+
+#include <atomic>
+#include <deque>
+
+class QTimer;
+
+namespace Cutelyst {
+
+class EventStreamPrivate
+{
+public:
+    bool write(const QByteArray &frame);
+    // Called by publishers from any thread
+    void enqueue(const QByteArray &frame);
+    void attach();
+
+    EventStream *q_ptr;
+    Context *context;
+    QTimer *heartbeat = nullptr;
+    QVector<EventStreamChannel *> channels;
+
+    // Guards the frames queued by channels
+    QMutex pendingMutex;
+    QVector<QByteArray> pending;
+    qint64 pendingBytes = 0;
+    bool overflow = false;
+
+    std::atomic<qint64> maxPendingBytes{1024 * 1024};
+    bool closed = false;
+    bool scheduled = false;
+    // The engine might wait for the client inside write(), like HTTP/2 does
+    // when its flow control window is exhausted, running a nested event loop
+    bool writing = false;
+    bool attachAfterWrite = false;
+};
+
+struct EventStreamEvent {
+    QString id;
+    QByteArray frame;
+};
+
+class EventStreamChannelPrivate
+{
+public:
+    mutable QMutex mutex;
+    QVector<EventStream *> subscribers;
+    std::deque<EventStreamEvent> history;
+    quint64 sequence = 0;
+    int historySize;
+};
+
+}
+
+#endif // CUTELYST_EVENTSTREAM_P_H
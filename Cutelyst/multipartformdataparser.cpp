@@ -19,6 +19,14 @@
 #include "upload_p.h"
 #include "common.h"
 
+#include <QtCore/qalgorithms.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace Cutelyst;
 
 Uploads MultiPartFormDataParser::parse(QIODevice *body, const QString &contentType, int bufferSize)
@@ -82,7 +90,6 @@ Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize, QI
     int bufferSkip = 0;
     int boundarySize = boundary.size();
     ParserState state = FindBoundary;
-    QByteArrayMatcher matcher(boundary);
 
     while (pos < contentLength) {
         qint64 len = body->read(buffer + bufferSkip, bufferSize - bufferSkip);
@@ -98,7 +105,7 @@ Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize, QI
         while (i < len) {
             switch (state) {
             case FindBoundary:
-                i += findBoundary(buffer + i, len - i, matcher, boundarySize, state);
+                i += findBoundary(buffer + i, len - i, boundary, state);
                 break;
             case EndBoundaryCR:
                 // TODO the "--" case
@@ -124,6 +131,10 @@ Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize, QI
                     if (pch == NULL) {
                         headerLine.append(buffer + i, len - i);
                         i = len;
+                    } else if (headerLine.isEmpty() && pch + 1 < buffer + len && pch[1] == '\n') {
+                        // The whole line is in the buffer, parse it in place
+                        parseHeader(headers, buffer + i, int(pch - buffer - i));
+                        i = int(pch - buffer) + 1;
                     } else {
                         headerLine.append(buffer + i, pch - buffer - i);
                         i = pch - buffer;
@@ -133,10 +144,8 @@ Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize, QI
                 break;
             case FinishHeader:
                 if (buffer[i] == '\n') {
-                    int dotdot = headerLine.indexOf(':');
-                    headers.setHeader(QString::fromLatin1(headerLine.left(dotdot)),
-                                      QString::fromLatin1(headerLine.mid(dotdot + 1).trimmed()));
-                    headerLine = QByteArray();
+                    parseHeader(headers, headerLine.constData(), headerLine.size());
+                    headerLine.clear();
                     state = StartHeaders;
                 } else {
 //                    qCDebug(CUTELYST_MULTIPART) << "FinishHeader return!";
@@ -156,7 +165,7 @@ Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize, QI
                 startOffset = pos - len + i;
                 state = EndData;
             case EndData:
-                i += findBoundary(buffer + i, len - i, matcher, boundarySize, state);
+                i += findBoundary(buffer + i, len - i, boundary, state);
 
                 if (state == EndBoundaryCR) {
 //                    qCDebug(CUTELYST_MULTIPART) << "EndData" << body->pos() - len + i - boundaryLength - 1;
@@ -181,16 +190,96 @@ Uploads MultiPartFormDataParserPrivate::execute(char *buffer, int bufferSize, QI
     return ret;
 }
 
-int MultiPartFormDataParserPrivate::findBoundary(char *buffer, int len, const QByteArrayMatcher &matcher, int boundarySize, MultiPartFormDataParserPrivate::ParserState &state)
+int MultiPartFormDataParserPrivate::findBoundary(char *buffer, int len, const QByteArray &boundary, MultiPartFormDataParserPrivate::ParserState &state)
 {
-    int i = matcher.indexIn(buffer, len);
+    int i = indexOfBoundary(buffer, len, boundary.constData(), boundary.size());
     //    qCDebug(CUTELYST_MULTIPART) << "findBoundary" << QByteArray(buffer, len);
     if (i != -1) {
         //        qCDebug(CUTELYST_MULTIPART) << "FindBoundary: found at" << i << body->pos() << len << body->pos() - len + i << i + boundaryLength;
         state = EndBoundaryCR;
-        return i + boundarySize - 1;
+        return i + boundary.size() - 1;
     }
     return len;
 }
 
+int MultiPartFormDataParserPrivate::indexOfBoundary(const char *buffer, int len, const char *boundary, int boundarySize)
+{
+    // The boundary always starts with "--" so its first and last bytes
+    // are compared together to discard most candidates, and only those
+    // get the full comparison
+    const int last = boundarySize - 1;
+    const int end = len - last;
+    int i = 0;
+
+#if defined(__AVX2__)
+    const __m256i firstByte = _mm256_set1_epi8(boundary[0]);
+    const __m256i lastByte = _mm256_set1_epi8(boundary[last]);
+    for (; i + 32 <= end; i += 32) {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + i));
+        const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buffer + i + last));
+        quint32 mask = quint32(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(firstByte, blockFirst),
+                                                                     _mm256_cmpeq_epi8(lastByte, blockLast))));
+        while (mask) {
+            const int candidate = i + int(qCountTrailingZeroBits(mask));
+            if (memcmp(buffer + candidate + 1, boundary + 1, size_t(last - 1)) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i firstByte = _mm_set1_epi8(boundary[0]);
+    const __m128i lastByte = _mm_set1_epi8(boundary[last]);
+    for (; i + 16 <= end; i += 16) {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + i));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + i + last));
+        quint32 mask = quint32(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstByte, blockFirst),
+                                                               _mm_cmpeq_epi8(lastByte, blockLast))));
+        while (mask) {
+            const int candidate = i + int(qCountTrailingZeroBits(mask));
+            if (memcmp(buffer + candidate + 1, boundary + 1, size_t(last - 1)) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // The last byte of the boundary is usually rarer than the leading dashes
+    while (i < end) {
+        auto pch = static_cast<const char *>(memchr(buffer + i + last, boundary[last], size_t(end - i)));
+        if (pch == nullptr) {
+            break;
+        }
+
+        const int candidate = int(pch - buffer) - last;
+        if (memcmp(buffer + candidate, boundary, size_t(last)) == 0) {
+            return candidate;
+        }
+        i = candidate + 1;
+    }
+
+    return -1;
+}
+
+void MultiPartFormDataParserPrivate::parseHeader(Headers &headers, const char *line, int size)
+{
+    auto colon = static_cast<const char *>(memchr(line, ':', size_t(size)));
+    if (colon == nullptr) {
+        return;
+    }
+
+    const char *value = colon + 1;
+    const char *end = line + size;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        ++value;
+    }
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+
+    headers.setHeader(QString::fromLatin1(line, int(colon - line)),
+                      QString::fromLatin1(value, int(end - value)));
+}
+
 #include "moc_multipartformdataparser_p.cpp"
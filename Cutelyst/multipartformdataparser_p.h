@@ -19,8 +19,7 @@
 #define MULTIPARTFORMDATA_P_H
 
 #include "multipartformdataparser.h"
-
-#include <QByteArrayMatcher>
+#include "headers.h"
 
 namespace Cutelyst {
 
@@ -41,7 +40,9 @@ public:
     Q_ENUM(ParserState)
 
     static Uploads execute(char *buffer, int bufferSize, QIODevice *body, const QByteArray &boundary);
-    static inline int findBoundary(char *buffer, int len, const QByteArrayMatcher &matcher, int boundarySize, ParserState &state);
+    static inline int findBoundary(char *buffer, int len, const QByteArray &boundary, ParserState &state);
+    static int indexOfBoundary(const char *buffer, int len, const char *boundary, int boundarySize);
+    static inline void parseHeader(Headers &headers, const char *line, int size);
 };
 
 }
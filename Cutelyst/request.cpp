@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -17,12 +17,16 @@
  */
 #include "request_p.h"
 #include "engine.h"
+#include "context.h"
 #include "enginerequest.h"
 #include "common.h"
 #include "multipartformdataparser.h"
 #include "utils.h"
 
 #include <QHostInfo>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QMutex>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -73,23 +77,82 @@ QString Request::hostname() const
         return ret;
     }
 
-    const QHostInfo ptr = QHostInfo::fromName(d->engineRequest->remoteAddress.toString());
-    if (ptr.error() != QHostInfo::NoError) {
-        qCDebug(CUTELYST_REQUEST) << "DNS lookup for the client hostname failed" << d->engineRequest->remoteAddress;
+    const QHostAddress &address = d->engineRequest->remoteAddress;
+    if (HostnameCache::lookup(address, ret)) {
+        d->remoteHostname = ret;
         return ret;
     }
 
-    d->remoteHostname = ptr.hostName();
-    ret = d->remoteHostname;
+    if (HostnameCache::stub) {
+        ret = HostnameCache::stub(address);
+    } else {
+        const QHostInfo ptr = QHostInfo::fromName(address.toString());
+        if (ptr.error() != QHostInfo::NoError) {
+            qCDebug(CUTELYST_REQUEST) << "DNS lookup for the client hostname failed" << address;
+        } else {
+            ret = ptr.hostName();
+        }
+    }
+    HostnameCache::insert(address, ret);
+
+    d->remoteHostname = ret;
     return ret;
 }
 
+void Request::hostnameAsync(std::function<void (const QString &)> callback) const
+{
+    Q_D(const Request);
+
+    QString hostname = d->remoteHostname;
+    const QHostAddress &address = d->engineRequest->remoteAddress;
+    if (!hostname.isEmpty() || HostnameCache::lookup(address, hostname)) {
+        d->remoteHostname = hostname;
+        callback(hostname);
+        return;
+    }
+
+    Context *c = d->engineRequest->context;
+    c->detachAsync();
+
+    RequestPrivate *priv = d_ptr;
+    auto lookup = new HostnameLookup(address, [=] (const QString &hostname) {
+        priv->remoteHostname = hostname;
+        callback(hostname);
+        c->attachAsync();
+    }, c);
+
+    if (HostnameCache::stub) {
+        // Answered from the event loop just like a real lookup
+        QMetaObject::invokeMethod(lookup, "stubLookedUp", Qt::QueuedConnection);
+    } else {
+        QHostInfo::lookupHost(address.toString(), lookup, SLOT(lookedUp(QHostInfo)));
+    }
+}
+
+void Request::setHostnameLookup(const std::function<QString (const QHostAddress &)> &lookup)
+{
+    HostnameCache::stub = lookup;
+    HostnameCache::clear();
+}
+
 quint16 Request::port() const
 {
     Q_D(const Request);
     return d->engineRequest->remotePort;
 }
 
+qint64 Request::elapsed() const
+{
+    Q_D(const Request);
+    if (d->engineRequest->elapsed.isValid()) {
+        return d->engineRequest->elapsed.elapsed();
+    } else if (d->engineRequest->startOfRequest) {
+        // uWSGI stores the wall clock time in microseconds
+        return qMax(Q_INT64_C(0), QDateTime::currentMSecsSinceEpoch() - qint64(d->engineRequest->startOfRequest / 1000));
+    }
+    return -1;
+}
+
 QUrl Request::uri() const
 {
     Q_D(const Request);
@@ -520,6 +583,16 @@ void RequestPrivate::parseBody() const
     parserStatus |= RequestPrivate::BodyParsed;
 }
 
+void RequestPrivate::resetBody()
+{
+    qDeleteAll(uploads);
+    uploads.clear();
+    uploadsMap.clear();
+    bodyParam.clear();
+    bodyData.clear();
+    parserStatus &= ~RequestPrivate::BodyParsed;
+}
+
 static inline bool isSlit(QChar c)
 {
     return c == QLatin1Char(';') || c == QLatin1Char(',');
@@ -670,4 +743,107 @@ QVariantMap RequestPrivate::paramsMultiMapToVariantMap(const ParamsMultiMap &par
     return ret;
 }
 
+struct HostnameEntry {
+    QString hostname;
+    qint64 expires;
+};
+
+// Reverse lookups are usually slow, keep them for the whole process
+static QMutex hostnameMutex;
+static QHash<QHostAddress, HostnameEntry> hostnameEntries;
+
+// QHostInfo doesn't expose the record TTL
+static const qint64 hostnameTtl = 5 * 60 * 1000;
+static const qint64 hostnameNegativeTtl = 60 * 1000;
+static const int hostnameMaxEntries = 4096;
+
+static qint64 hostnameClock()
+{
+    static QElapsedTimer timer = [] {
+        QElapsedTimer ret;
+        ret.start();
+        return ret;
+    }();
+    return timer.elapsed();
+}
+
+std::function<QString(const QHostAddress &)> HostnameCache::stub;
+
+bool HostnameCache::lookup(const QHostAddress &address, QString &hostname)
+{
+    const qint64 now = hostnameClock();
+
+    QMutexLocker locker(&hostnameMutex);
+    auto it = hostnameEntries.constFind(address);
+    if (it != hostnameEntries.constEnd() && it->expires > now) {
+        hostname = it->hostname;
+        return true;
+    }
+    return false;
+}
+
+void HostnameCache::insert(const QHostAddress &address, const QString &hostname)
+{
+    const qint64 now = hostnameClock();
+
+    QMutexLocker locker(&hostnameMutex);
+    if (hostnameEntries.size() >= hostnameMaxEntries) {
+        auto it = hostnameEntries.begin();
+        while (it != hostnameEntries.end()) {
+            if (it->expires <= now) {
+                it = hostnameEntries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (hostnameEntries.size() >= hostnameMaxEntries) {
+            hostnameEntries.erase(hostnameEntries.begin());
+        }
+    }
+
+    const qint64 ttl = hostname.isEmpty() ? hostnameNegativeTtl : hostnameTtl;
+    hostnameEntries.insert(address, { hostname, now + ttl });
+}
+
+void HostnameCache::clear()
+{
+    QMutexLocker locker(&hostnameMutex);
+    hostnameEntries.clear();
+}
+
+HostnameLookup::HostnameLookup(const QHostAddress &address, std::function<void (const QString &)> callback, QObject *parent) : QObject(parent)
+  , m_address(address)
+  , m_callback(callback)
+{
+}
+
+void HostnameLookup::lookedUp(const QHostInfo &info)
+{
+    QString hostname;
+    if (info.error() != QHostInfo::NoError) {
+        qCDebug(CUTELYST_REQUEST) << "DNS lookup for the client hostname failed" << m_address;
+    } else {
+        hostname = info.hostName();
+    }
+    finished(hostname);
+}
+
+void HostnameLookup::stubLookedUp()
+{
+    finished(HostnameCache::stub ? HostnameCache::stub(m_address) : QString());
+}
+
+void HostnameLookup::finished(const QString &hostname)
+{
+    HostnameCache::insert(m_address, hostname);
+
+    // The callback might finish the request, engines can then
+    // delete the Context right away and with it its children
+    setParent(nullptr);
+    deleteLater();
+    m_callback(hostname);
+}
+
 #include "moc_request.cpp"
+#include "moc_request_p.cpp"
@@ -21,6 +21,8 @@
 #include <QtCore/qobject.h>
 #include <QtCore/qstringlist.h>
 
+#include <functional>
+
 #include <Cutelyst/cutelyst_global.h>
 #include <Cutelyst/paramsmultimap.h>
 #include <Cutelyst/headers.h>
@@ -86,15 +88,48 @@ public:
      * or null if not found or an error has happened.
      *
      * This functions makes blocking call to do a reverse
-     * DNS lookup if the engine didn't set the hostname.
+     * DNS lookup if the engine didn't set the hostname and
+     * the address is not in the process wide cache, prefer
+     * hostnameAsync() on busy servers.
      */
     QString hostname() const;
 
+    /**
+     * Resolves the hostname of the client without blocking, \p callback
+     * is called with the hostname or a null string if not found.
+     *
+     * When the hostname is not already known or cached the remaining of
+     * the action chain is suspended with Context::detachAsync() while the
+     * reverse DNS lookup happens, and resumed after \p callback returns,
+     * otherwise \p callback is called right away.
+     *
+     * Results are kept in a bounded process wide cache, successful
+     * lookups for 5 minutes and failed ones for 1 minute.
+     */
+    void hostnameAsync(std::function<void(const QString &hostname)> callback) const;
+
+    /**
+     * Replaces the reverse DNS lookup used by hostname() and hostnameAsync()
+     * with \p lookup which must return the hostname of the given address or
+     * a null string, this is mostly useful for tests that can't rely on
+     * the network. hostnameAsync() still calls it from the event loop, like
+     * a real lookup. Passing an empty function restores the default lookup
+     * and clears the cache.
+     */
+    static void setHostnameLookup(const std::function<QString(const QHostAddress &address)> &lookup);
+
     /**
      * Returns the originating port of the client
      */
     quint16 port() const;
 
+    /**
+     * Returns the number of milliseconds since the engine started to receive this request,
+     * before dispatching it's the time the request waited to be handled,
+     * or -1 if the engine doesn't track it.
+     */
+    qint64 elapsed() const;
+
     /**
      * Returns the uri as close as possible to what
      * the user has in his browser url.
@@ -26,6 +26,7 @@
 #include <QtCore/QUrlQuery>
 #include <QtCore/QUrl>
 #include <QtNetwork/QHostAddress>
+#include <QtNetwork/QHostInfo>
 
 namespace Cutelyst {
 
@@ -46,6 +47,7 @@ public:
     inline void parseUrlQuery() const;
     inline void parseBody() const;
     inline void parseCookies() const;
+    void resetBody();
 
     static inline ParamsMultiMap parseUrlEncoded(const QByteArray &line);
     static inline QVariantMap paramsMultiMapToVariantMap(const ParamsMultiMap &params);
@@ -73,6 +75,33 @@ public:
     mutable ParserStatus parserStatus = NotParsed;
 };
 
+class HostnameCache
+{
+public:
+    static bool lookup(const QHostAddress &address, QString &hostname);
+    static void insert(const QHostAddress &address, const QString &hostname);
+    static void clear();
+
+    static std::function<QString(const QHostAddress &address)> stub;
+};
+
+class HostnameLookup : public QObject
+{
+    Q_OBJECT
+public:
+    HostnameLookup(const QHostAddress &address, std::function<void(const QString &)> callback, QObject *parent);
+
+public Q_SLOTS:
+    void lookedUp(const QHostInfo &info);
+    void stubLookedUp();
+
+private:
+    void finished(const QString &hostname);
+
+    QHostAddress m_address;
+    std::function<void(const QString &)> m_callback;
+};
+
 }
 
 #endif // CUTELYST_REQUEST_P_H
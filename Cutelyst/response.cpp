@@ -52,7 +52,17 @@ qint64 Response::writeData(const char *data, qint64 len)
 
     // Finalize headers if someone manually writes output
     if (!(d->engineRequest->status & EngineRequest::FinalizedHeaders)) {
-        if (d->headers.header(QStringLiteral("TRANSFER_ENCODING")) == QLatin1String("chunked")) {
+        const EngineRequest::StreamingFraming framing = d->engineRequest->streamingFraming();
+        if (framing == EngineRequest::NativeFraming) {
+            // The protocol delimits the body by itself
+            d->headers.removeHeader(QStringLiteral("TRANSFER_ENCODING"));
+            d->engineRequest->status |= EngineRequest::IOWrite;
+        } else if (d->headers.header(QStringLiteral("TRANSFER_ENCODING")) == QLatin1String("chunked")) {
+            d->engineRequest->status |= EngineRequest::IOWrite | EngineRequest::Chunked;
+        } else if (d->headers.contentLength() >= 0) {
+            d->engineRequest->status |= EngineRequest::IOWrite;
+        } else if (framing == EngineRequest::ChunkedEncoding) {
+            d->headers.setHeader(QStringLiteral("TRANSFER_ENCODING"), QStringLiteral("chunked"));
             d->engineRequest->status |= EngineRequest::IOWrite | EngineRequest::Chunked;
         } else {
             // When chunked encoding is not set the client can only know
@@ -330,6 +340,12 @@ bool Response::isSequential() const
     return true;
 }
 
+qint64 Response::bytesToWrite() const
+{
+    Q_D(const Response);
+    return d->engineRequest->bytesToWrite();
+}
+
 qint64 Response::size() const
 {
     Q_D(const Response);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2013-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -74,6 +74,7 @@ public:
         UnsupportedMediaType         = 415,
         RequestedRangeNotSatisfiable = 416,
         ExpectationFailed            = 417,
+        TooManyRequests              = 429,
         InternalServerError          = 500,
         NotImplemented               = 501,
         BadGateway                   = 502,
@@ -334,6 +335,12 @@ public:
      */
     virtual qint64 size() const override;
 
+    /**
+     * Returns the number of bytes written that the engine didn't send to the
+     * client yet, a growing value means the client is reading slowly.
+     */
+    virtual qint64 bytesToWrite() const override;
+
     /*!
      * Sends the websocket handshake, if no parameters are defined it will use header data.
      * Returns true in case of success, false otherwise, which can be due missing support on
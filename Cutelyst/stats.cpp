@@ -26,12 +26,20 @@
 
 #include <QtCore/QStringList>
 
+#ifdef Q_OS_UNIX
+#include <time.h>
+#endif
+
 using namespace Cutelyst;
 
+Stats::AllocationCounter StatsPrivate::allocationCounter = nullptr;
+
 Stats::Stats(EngineRequest *request) : d_ptr(new StatsPrivate)
 {
     Q_D(Stats);
     d->engineRequest = request;
+    d->cpuBegin = threadCpuTime();
+    d->allocationCount(&d->allocBegin, &d->bytesBegin);
 }
 
 Stats::~Stats()
@@ -45,6 +53,8 @@ void Stats::profileStart(const QString &action)
     StatsAction stat;
     stat.action = action;
     stat.begin = d->engineRequest->elapsed.nsecsElapsed();
+    stat.cpuBegin = threadCpuTime();
+    d->allocationCount(&stat.allocBegin, &stat.bytesBegin);
     d->actions.push_back(stat);
 }
 
@@ -54,6 +64,8 @@ void Stats::profileEnd(const QString &action)
     for (auto &stat : d->actions) {
         if (stat.action == action) {
             stat.end = d->engineRequest->elapsed.nsecsElapsed();
+            stat.cpuEnd = threadCpuTime();
+            d->allocationCount(&stat.allocEnd, &stat.bytesEnd);
             break;
         }
     }
@@ -69,13 +81,69 @@ QByteArray Stats::report()
     }
 
     QVector<QStringList> table;
-    for (const auto &stat : d->actions) {
-        table.append({ stat.action,
-                       QString::number((stat.end - stat.begin)/1000000000.0, 'f') + QLatin1Char('s') });
-    }
+    if (d->allocationCounter) {
+        for (const auto &stat : d->actions) {
+            table.append({ stat.action,
+                           QString::number((stat.end - stat.begin)/1000000000.0, 'f') + QLatin1Char('s'),
+                           QString::number((stat.cpuEnd - stat.cpuBegin)/1000000000.0, 'f') + QLatin1Char('s'),
+                           QString::number(stat.allocEnd - stat.allocBegin),
+                           QString::number(stat.bytesEnd - stat.bytesBegin) });
+        }
 
-    ret = Utils::buildTable(table, {
-                                QStringLiteral("Action"), QStringLiteral("Time")
-                            });
+        ret = Utils::buildTable(table, {
+                                    QStringLiteral("Action"), QStringLiteral("Time"), QStringLiteral("CPU"),
+                                    QStringLiteral("Allocs"), QStringLiteral("Bytes")
+                                });
+    } else {
+        for (const auto &stat : d->actions) {
+            table.append({ stat.action,
+                           QString::number((stat.end - stat.begin)/1000000000.0, 'f') + QLatin1Char('s'),
+                           QString::number((stat.cpuEnd - stat.cpuBegin)/1000000000.0, 'f') + QLatin1Char('s') });
+        }
+
+        ret = Utils::buildTable(table, {
+                                    QStringLiteral("Action"), QStringLiteral("Time"), QStringLiteral("CPU")
+                                });
+    }
     return ret;
 }
+
+qint64 Stats::cpuTime() const
+{
+    Q_D(const Stats);
+    return threadCpuTime() - d->cpuBegin;
+}
+
+quint64 Stats::allocations() const
+{
+    Q_D(const Stats);
+    quint64 count = 0;
+    quint64 bytes = 0;
+    d->allocationCount(&count, &bytes);
+    return count - d->allocBegin;
+}
+
+quint64 Stats::allocatedBytes() const
+{
+    Q_D(const Stats);
+    quint64 count = 0;
+    quint64 bytes = 0;
+    d->allocationCount(&count, &bytes);
+    return bytes - d->bytesBegin;
+}
+
+void Stats::setAllocationCounter(Stats::AllocationCounter counter)
+{
+    StatsPrivate::allocationCounter = counter;
+}
+
+qint64 Stats::threadCpuTime()
+{
+#if defined(Q_OS_UNIX) && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return qint64(ts.tv_sec) * Q_INT64_C(1000000000) + ts.tv_nsec;
+    }
+#endif
+    return 0;
+}
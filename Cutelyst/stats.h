@@ -26,10 +26,16 @@ namespace Cutelyst {
 
 class EngineRequest;
 class StatsPrivate;
-class Stats
+class CUTELYST_LIBRARY Stats
 {
     Q_DECLARE_PRIVATE(Stats)
 public:
+    /**
+     * Function used to read the number of allocations and the amount of
+     * allocated bytes of the calling thread, the values must be monotonic.
+     */
+    typedef void (*AllocationCounter)(quint64 *count, quint64 *bytes);
+
     /**
      * Constructs a new stats object with the given parent.
      */
@@ -51,7 +57,38 @@ public:
      */
     virtual QByteArray report();
 
+    /**
+     * Returns the thread CPU time in nanoseconds used since this object was created,
+     * for async requests it also includes the time spent on other requests
+     * while this one was waiting.
+     */
+    qint64 cpuTime() const;
+
+    /**
+     * Returns the number of memory allocations done since this object was created,
+     * it's always 0 if no allocation counter was set.
+     */
+    quint64 allocations() const;
+
+    /**
+     * Returns the number of allocated bytes since this object was created,
+     * it's always 0 if no allocation counter was set.
+     */
+    quint64 allocatedBytes() const;
+
+    /**
+     * Sets the process wide allocation \p counter, engines that are able to
+     * count allocations should set this before any request is processed.
+     */
+    static void setAllocationCounter(AllocationCounter counter);
+
+    /**
+     * Returns the current thread CPU time in nanoseconds.
+     */
+    static qint64 threadCpuTime();
+
 protected:
+    friend class ApplicationPrivate;
     StatsPrivate *d_ptr;
 };
 
@@ -28,14 +28,31 @@ struct StatsAction {
     QString action;
     qint64 begin = 0;
     qint64 end = 0;
+    qint64 cpuBegin = 0;
+    qint64 cpuEnd = 0;
+    quint64 allocBegin = 0;
+    quint64 allocEnd = 0;
+    quint64 bytesBegin = 0;
+    quint64 bytesEnd = 0;
 };
 
 class EngineRequest;
 class StatsPrivate
 {
 public:
+    inline void allocationCount(quint64 *count, quint64 *bytes) const {
+        if (allocationCounter) {
+            allocationCounter(count, bytes);
+        }
+    }
+
     std::vector<StatsAction> actions;
     EngineRequest *engineRequest;
+    qint64 cpuBegin = 0;
+    quint64 allocBegin = 0;
+    quint64 bytesBegin = 0;
+
+    static Stats::AllocationCounter allocationCounter;
 };
 
 }
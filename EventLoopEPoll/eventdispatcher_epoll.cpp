@@ -28,11 +28,28 @@ EventDispatcherEPoll::EventDispatcherEPoll(QObject* parent)
 {
 }
 
+EventDispatcherEPoll::EventDispatcherEPoll(bool useURing, QObject *parent)
+    : QAbstractEventDispatcher(parent), d_ptr(new EventDispatcherEPollPrivate(this, useURing))
+{
+}
+
 EventDispatcherEPoll::~EventDispatcherEPoll()
 {
     delete d_ptr;
 }
 
+bool EventDispatcherEPoll::setEdgeTriggered(qintptr fd)
+{
+    Q_D(EventDispatcherEPoll);
+    return d->setEdgeTriggered(static_cast<int>(fd));
+}
+
+bool EventDispatcherEPoll::setExclusive(qintptr fd)
+{
+    Q_D(EventDispatcherEPoll);
+    return d->setExclusive(static_cast<int>(fd));
+}
+
 bool EventDispatcherEPoll::processEvents(QEventLoop::ProcessEventsFlags flags)
 {
     Q_D(EventDispatcherEPoll);
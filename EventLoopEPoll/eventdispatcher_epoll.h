@@ -28,7 +28,7 @@ class EventDispatcherEPollPrivate;
 #  define CUTELYST_EVENTLOOP_EPOLL_EXPORT Q_DECL_IMPORT
 #endif
 
-class CUTELYST_EVENTLOOP_EPOLL_EXPORT EventDispatcherEPoll final : public QAbstractEventDispatcher {
+class CUTELYST_EVENTLOOP_EPOLL_EXPORT EventDispatcherEPoll : public QAbstractEventDispatcher {
     Q_OBJECT
 public:
     explicit EventDispatcherEPoll(QObject *parent = nullptr);
@@ -56,6 +56,25 @@ public:
     virtual void interrupt() override;
     virtual void flush() override;
 
+    /**
+     * Switches the socket notifiers of \p fd to edge triggered mode,
+     * whoever reads from it must drain the socket on each notification.
+     * Enabling and disabling notifiers then no longer calls epoll_ctl().
+     * Returns false if \p fd has no notifiers or io_uring is in use.
+     */
+    bool setEdgeTriggered(qintptr fd);
+
+    /**
+     * Registers the socket notifiers of \p fd with EPOLLEXCLUSIVE, so a
+     * listening socket shared by many threads or processes only wakes
+     * one of them per connection. Must be called after enabling them.
+     * Returns false if \p fd has no notifiers or io_uring is in use.
+     */
+    bool setExclusive(qintptr fd);
+
+protected:
+    EventDispatcherEPoll(bool useURing, QObject *parent);
+
 private:
     Q_DISABLE_COPY(EventDispatcherEPoll)
     Q_DECLARE_PRIVATE(EventDispatcherEPoll)
@@ -18,7 +18,6 @@
 #include <QtCore/QCoreApplication>
 #include <QPointer>
 #include <QSocketNotifier>
-#include <QVector>
 
 #include <unistd.h>
 #include <sys/epoll.h>
@@ -29,16 +28,38 @@
 #include "eventdispatcher_epoll.h"
 #include "eventdispatcher_epoll_p.h"
 
-EventDispatcherEPollPrivate::EventDispatcherEPollPrivate(EventDispatcherEPoll* const q)
+#define EVENTS_BUFFER_SIZE 256
+#define EVENTS_BUFFER_MAX_SIZE 8192
+
+EventDispatcherEPollPrivate::EventDispatcherEPollPrivate(EventDispatcherEPoll* const q, bool useURing)
     : q_ptr(q)
 {
+#ifdef HAVE_IO_URING
+    if (useURing) {
+        m_uring = new URingPoller;
+    }
+#else
+    Q_UNUSED(useURing)
+#endif
     createEpoll();
 }
 
 EventDispatcherEPollPrivate::~EventDispatcherEPollPrivate()
 {
     close(m_event_fd);
-    close(m_epoll_fd);
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+    }
+#ifdef HAVE_IO_URING
+    delete m_uring;
+#endif
+
+    for (SocketNotifierInfo *info : m_pending) {
+        info->deref();
+    }
+    for (SocketNotifierInfo *info : m_replay) {
+        info->deref();
+    }
 
     auto it = m_handles.constBegin();
     while (it != m_handles.constEnd()) {
@@ -50,25 +71,105 @@ EventDispatcherEPollPrivate::~EventDispatcherEPollPrivate()
 
 void EventDispatcherEPollPrivate::createEpoll()
 {
-    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
-    if (Q_UNLIKELY(-1 == m_epoll_fd)) {
-        qErrnoWarning("epoll_create1() failed");
-        abort();
+#ifdef HAVE_IO_URING
+    if (m_uring && !m_uring->init(4096)) {
+        qWarning("%s: io_uring setup failed, falling back to epoll", Q_FUNC_INFO);
+        delete m_uring;
+        m_uring = nullptr;
     }
 
+    if (!m_uring) {
+#endif
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (Q_UNLIKELY(-1 == m_epoll_fd)) {
+            qErrnoWarning("epoll_create1() failed");
+            abort();
+        }
+#ifdef HAVE_IO_URING
+    }
+#endif
+
     m_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
     if (Q_UNLIKELY(-1 == m_event_fd)) {
         qErrnoWarning("eventfd() failed");
         abort();
     }
 
-    struct epoll_event e;
-    e.events = EPOLLIN;
     m_event_fd_info = new EventFdInfo(m_event_fd, this);
-    e.data.ptr = m_event_fd_info;
-    if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_event_fd, &e))) {
+    watchAdd(m_event_fd, EPOLLIN, m_event_fd_info);
+}
+
+bool EventDispatcherEPollPrivate::watchAdd(int fd, quint32 events, EpollAbastractEvent *data)
+{
+#ifdef HAVE_IO_URING
+    if (m_uring) {
+        m_uring->add(fd, events, data);
+        return true;
+    }
+#endif
+
+    struct epoll_event e;
+    e.events = events;
+    e.data.ptr = data;
+    if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &e))) {
         qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        return false;
+    }
+    return true;
+}
+
+bool EventDispatcherEPollPrivate::watchMod(int fd, quint32 events, EpollAbastractEvent *data)
+{
+#ifdef HAVE_IO_URING
+    if (m_uring) {
+        m_uring->mod(fd, events, data);
+        return true;
+    }
+#endif
+
+    struct epoll_event e;
+    e.events = events;
+    e.data.ptr = data;
+    if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &e))) {
+        qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        return false;
+    }
+    return true;
+}
+
+bool EventDispatcherEPollPrivate::watchDel(int fd)
+{
+#ifdef HAVE_IO_URING
+    if (m_uring) {
+        m_uring->del(fd);
+        return true;
+    }
+#endif
+
+    struct epoll_event e;
+    if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &e))) {
+        // The fd might have been closed already
+        if (EBADF != errno) {
+            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+            return false;
+        }
     }
+    return true;
+}
+
+int EventDispatcherEPollPrivate::waitEvents(struct epoll_event *events, int maxevents, int timeout)
+{
+#ifdef HAVE_IO_URING
+    if (m_uring) {
+        return m_uring->wait(events, maxevents, timeout);
+    }
+#endif
+
+    int n_events;
+    do {
+        n_events = epoll_wait(m_epoll_fd, events, maxevents, timeout);
+    } while (Q_UNLIKELY(-1 == n_events && errno == EINTR));
+    return n_events;
 }
 
 bool EventDispatcherEPollPrivate::processEvents(QEventLoop::ProcessEventsFlags flags)
@@ -100,7 +201,9 @@ bool EventDispatcherEPollPrivate::processEvents(QEventLoop::ProcessEventsFlags f
         int timeout = 0;
 
         if (!exclude_timers && !m_zero_timers.isEmpty()) {
-            QVector<ZeroTimer*> timers;
+            // Take the buffer so nested event loops get their own
+            std::vector<ZeroTimer*> timers;
+            timers.swap(m_zero_timers_buffer);
             auto it = m_zero_timers.constBegin();
             while (it != m_zero_timers.constEnd()) {
                 ZeroTimer *data = it.value();
@@ -124,17 +227,28 @@ bool EventDispatcherEPollPrivate::processEvents(QEventLoop::ProcessEventsFlags f
 
                 data->deref();
             }
+
+            timers.clear();
+            m_zero_timers_buffer.swap(timers);
         }
 
-        if (can_wait && !result) {
+        if (can_wait && !result && m_replay.empty()) {
             Q_EMIT q->aboutToBlock();
             timeout = -1;
         }
 
-        struct epoll_event events[10024];
-        do {
-            n_events = epoll_wait(m_epoll_fd, events, 10024, timeout);
-        } while (Q_UNLIKELY(-1 == n_events && errno == EINTR));
+        if (!m_pending.empty()) {
+            applyPendingUpdates();
+        }
+
+        // Take the buffer so nested event loops get their own
+        std::vector<struct epoll_event> events;
+        events.swap(m_events);
+        if (events.empty()) {
+            events.resize(EVENTS_BUFFER_SIZE);
+        }
+
+        n_events = waitEvents(events.data(), int(events.size()), timeout);
 
         for (int i = 0; i < n_events; ++i) {
             struct epoll_event &e = events[i];
@@ -151,6 +265,16 @@ bool EventDispatcherEPollPrivate::processEvents(QEventLoop::ProcessEventsFlags f
 
             data->deref();
         }
+
+        if (n_events == int(events.size()) && events.size() < EVENTS_BUFFER_MAX_SIZE) {
+            events.resize(events.size() * 2);
+        }
+        m_events.swap(events);
+
+        if (!m_replay.empty()) {
+            replayMissedEdges();
+            result = true;
+        }
     }
 
     exclude_notifiers && disableSocketNotifiers(false);
@@ -180,11 +304,24 @@ void SocketNotifierInfo::process(quint32 events)
 {
     QEvent e(QEvent::SockAct);
 
-    if (r && (events & EPOLLIN)) {
+    if (edgeTriggered) {
+        // Kept until the notifier is enabled again as
+        // the kernel won't report the same edge twice
+        if (!r && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            missed |= EPOLLIN;
+        }
+        if (!w && (events & (EPOLLOUT | EPOLLERR))) {
+            missed |= EPOLLOUT;
+        }
+    }
+
+    // Like QEventDispatcherUNIX report errors to the notifiers,
+    // an edge triggered socket would not be notified again
+    if (r && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
         QCoreApplication::sendEvent(r, &e);
     }
 
-    if (w && (events & EPOLLOUT)) {
+    if (w && (events & (EPOLLOUT | EPOLLERR))) {
         QCoreApplication::sendEvent(w, &e);
     }
 
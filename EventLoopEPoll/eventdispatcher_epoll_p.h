@@ -24,6 +24,14 @@
 
 #include <QtCore/QAtomicInt>
 
+#include <sys/epoll.h>
+
+#include <vector>
+
+#ifdef HAVE_IO_URING
+#include <liburing.h>
+#endif
+
 class EpollAbastractEvent
 {
 public:
@@ -62,6 +70,18 @@ public:
     QSocketNotifier *w = nullptr;
     QSocketNotifier *x = nullptr;
     quint32 events = 0;
+    // events currently set with epoll_ctl()
+    quint32 registered = 0;
+    // edges that arrived while the notifier of their type was disabled
+    quint32 missed = 0;
+    // missed edges to deliver once their notifier got enabled again
+    quint32 replay = 0;
+    bool inKernel = false;
+    bool queued = false;
+    bool edgeTriggered = false;
+    // EPOLLEXCLUSIVE can't be modified, changes remove and add it again
+    bool exclusive = false;
+    bool rearm = false;
 };
 
 class ZeroTimer final : public EpollAbastractEvent
@@ -91,16 +111,62 @@ public:
     Qt::TimerType type;
 };
 
+#ifdef HAVE_IO_URING
+/**
+ * Replaces epoll_ctl() and epoll_wait() with one shot polls submitted
+ * on an io_uring, registration changes are queued as SQEs and submitted
+ * together with the wait on a single io_uring_enter() call.
+ */
+class URingPoller
+{
+public:
+    URingPoller() = default;
+    ~URingPoller();
+
+    bool init(unsigned entries);
+
+    void add(int fd, quint32 events, EpollAbastractEvent *data);
+    void mod(int fd, quint32 events, EpollAbastractEvent *data);
+    void del(int fd);
+
+    int wait(struct epoll_event *events, int maxevents, int timeout);
+
+private:
+    struct Watch {
+        EpollAbastractEvent *data;
+        quint32 events;
+        quint32 gen;
+        bool armed;
+    };
+
+    io_uring_sqe *getSqe();
+    void arm(int fd, Watch &watch);
+    void cancel(int fd, Watch &watch);
+
+    struct io_uring m_ring;
+    QHash<int, Watch> m_watches;
+    std::vector<int> m_rearm;
+    quint32 m_gen = 0;
+    bool m_initialized = false;
+};
+#endif
+
 class EventDispatcherEPoll;
 
 class Q_DECL_HIDDEN EventDispatcherEPollPrivate {
 public:
-    EventDispatcherEPollPrivate(EventDispatcherEPoll* const q);
+    EventDispatcherEPollPrivate(EventDispatcherEPoll* const q, bool useURing = false);
     ~EventDispatcherEPollPrivate();
     void createEpoll();
+    bool watchAdd(int fd, quint32 events, EpollAbastractEvent *data);
+    bool watchMod(int fd, quint32 events, EpollAbastractEvent *data);
+    bool watchDel(int fd);
+    int waitEvents(struct epoll_event *events, int maxevents, int timeout);
     bool processEvents(QEventLoop::ProcessEventsFlags flags);
     void registerSocketNotifier(QSocketNotifier *notifier);
     void unregisterSocketNotifier(QSocketNotifier *notifier);
+    bool setEdgeTriggered(int fd);
+    bool setExclusive(int fd);
     void registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object);
     void registerZeroTimer(int timerId, QObject *object);
     bool unregisterTimer(int timerId);
@@ -125,7 +191,18 @@ private:
     QHash<QSocketNotifier*, SocketNotifierInfo*> m_notifiers;
     QHash<int, TimerInfo*> m_timers;
     QHash<int, ZeroTimer*> m_zero_timers;
-
+    std::vector<SocketNotifierInfo*> m_pending;
+    std::vector<SocketNotifierInfo*> m_replay;
+    std::vector<struct epoll_event> m_events;
+    std::vector<ZeroTimer*> m_zero_timers_buffer;
+    bool m_notifiers_disabled = false;
+#ifdef HAVE_IO_URING
+    URingPoller *m_uring = nullptr;
+#endif
+
+    void queueUpdate(SocketNotifierInfo *info);
+    void applyPendingUpdates();
+    void replayMissedEdges();
     bool disableSocketNotifiers(bool disable);
     bool disableTimers(bool disable);
 };
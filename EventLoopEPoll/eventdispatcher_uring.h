@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2017 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef EVENTDISPATCHER_URING_H
+#define EVENTDISPATCHER_URING_H
+
+#include "eventdispatcher_epoll.h"
+
+/**
+ * Same as EventDispatcherEPoll but readiness of socket notifiers, timers
+ * and the wake up eventfd is polled on an io_uring, registration changes
+ * are batched and submitted with the wait on a single syscall.
+ * If io_uring is not available at runtime it falls back to epoll.
+ */
+class CUTELYST_EVENTLOOP_EPOLL_EXPORT EventDispatcherURing final : public EventDispatcherEPoll {
+    Q_OBJECT
+public:
+    explicit EventDispatcherURing(QObject *parent = nullptr);
+    virtual ~EventDispatcherURing() override;
+
+private:
+    Q_DISABLE_COPY(EventDispatcherURing)
+};
+
+#endif // EVENTDISPATCHER_URING_H
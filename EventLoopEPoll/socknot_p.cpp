@@ -23,21 +23,22 @@
 #include <errno.h>
 #include "eventdispatcher_epoll_p.h"
 
+#ifndef EPOLLEXCLUSIVE
+#  define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
 void EventDispatcherEPollPrivate::registerSocketNotifier(QSocketNotifier *notifier)
 {
     Q_ASSERT(notifier != 0);
     Q_ASSUME(notifier != 0);
 
-    int events = 0;
+    quint32 events = 0;
     int fd = static_cast<int>(notifier->socket());
 
-    epoll_event e;
-
     SocketNotifierInfo *data;
     auto it = m_handles.find(fd);
     if (it == m_handles.end()) {
         data = new SocketNotifierInfo(fd);
-        e.data.ptr = data;
 
         switch (notifier->type()) {
         case QSocketNotifier::Read:
@@ -57,23 +58,15 @@ void EventDispatcherEPollPrivate::registerSocketNotifier(QSocketNotifier *notifi
         }
 
         data->events = events;
-        e.events = events;
-
-        int res = epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &e);
-        if (Q_UNLIKELY(res != 0)) {
-            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
-            delete data;
-            return;
-        }
 
         m_handles.insert(fd, data);
+        queueUpdate(data);
     } else {
         data = static_cast<SocketNotifierInfo *>(it.value());
         Q_ASSERT(data);
 
         QSocketNotifier **n = nullptr;
         if (data) {
-            e.data.ptr = data;
             switch (notifier->type()) {
             case QSocketNotifier::Read:
                 events = EPOLLIN;
@@ -100,13 +93,19 @@ void EventDispatcherEPollPrivate::registerSocketNotifier(QSocketNotifier *notifi
             Q_ASSERT((data->events & events) == 0);
 
             data->events |= events;
-            e.events      = data->events;
             *n            = notifier;
 
-            int res = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &e);
-            if (Q_UNLIKELY(res != 0)) {
-                qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
-                return;
+            if (!data->edgeTriggered || events == EPOLLPRI) {
+                queueUpdate(data);
+            } else if (data->missed & events) {
+                // The edge was consumed while the notifier was disabled,
+                // it's delivered again without asking the kernel
+                data->missed &= ~events;
+                if (!data->replay) {
+                    data->ref();
+                    m_replay.push_back(data);
+                }
+                data->replay |= events;
             }
             data->ref(); //we are reusing data
         }
@@ -128,35 +127,36 @@ void EventDispatcherEPollPrivate::unregisterSocketNotifier(QSocketNotifier *noti
     if (Q_LIKELY(it != m_notifiers.end())) {
         SocketNotifierInfo *info = it.value();
 
-        struct epoll_event e;
-        e.data.ptr = info;
-
+        quint32 events;
         if (info->r == notifier) {
-            info->events &= ~EPOLLIN;
+            events        = EPOLLIN;
             info->r       = nullptr;
         }
         else if (info->w == notifier) {
-            info->events &= ~EPOLLOUT;
+            events        = EPOLLOUT;
             info->w       = nullptr;
         }
         else if (info->x == notifier) {
-            info->events &= ~EPOLLPRI;
+            events        = EPOLLPRI;
             info->x       = nullptr;
         }
         else {
             qFatal("%s: internal error: cannot find socket notifier", Q_FUNC_INFO);
         }
-
-        e.events = info->events;
-
-        int res;
+        info->events &= ~events;
+        info->replay &= ~events;
 
         if (info->r || info->w || info->x) {
-            res = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, info->fd, &e);
+            // Edge triggered sockets are always registered for reading
+            // and writing, process() skips the disabled notifiers
+            if (!info->edgeTriggered || events == EPOLLPRI) {
+                queueUpdate(info);
+            }
         } else {
-            res = epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, info->fd, &e);
-            if (Q_UNLIKELY(res != 0 && EBADF == errno)) {
-                res = 0;
+            // Removal can't wait as the descriptor is about to be closed
+            if (info->inKernel) {
+                watchDel(info->fd);
+                info->inKernel = false;
             }
 
             auto hi = m_handles.find(info->fd);
@@ -164,30 +164,143 @@ void EventDispatcherEPollPrivate::unregisterSocketNotifier(QSocketNotifier *noti
             m_handles.erase(hi);
         }
 
-        if (Q_UNLIKELY(res != 0)) {
-            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        m_notifiers.erase(it); // Hash is not rehashed
+        info->deref();
+    }
+}
+
+bool EventDispatcherEPollPrivate::setEdgeTriggered(int fd)
+{
+#ifdef HAVE_IO_URING
+    // io_uring polls are one shot, they are always re-armed
+    if (m_uring) {
+        return false;
+    }
+#endif
+
+    auto it = m_handles.constFind(fd);
+    if (it == m_handles.constEnd()) {
+        return false;
+    }
+
+    auto info = dynamic_cast<SocketNotifierInfo *>(it.value());
+    if (!info) {
+        return false;
+    }
+
+    if (!info->edgeTriggered) {
+        info->edgeTriggered = true;
+        queueUpdate(info);
+    }
+    return true;
+}
+
+bool EventDispatcherEPollPrivate::setExclusive(int fd)
+{
+#ifdef HAVE_IO_URING
+    if (m_uring) {
+        return false;
+    }
+#endif
+
+    auto it = m_handles.constFind(fd);
+    if (it == m_handles.constEnd()) {
+        return false;
+    }
+
+    auto info = dynamic_cast<SocketNotifierInfo *>(it.value());
+    if (!info || info->edgeTriggered) {
+        return false;
+    }
+
+    if (!info->exclusive) {
+        info->exclusive = true;
+        info->rearm = info->inKernel;
+        queueUpdate(info);
+    }
+    return true;
+}
+
+void EventDispatcherEPollPrivate::queueUpdate(SocketNotifierInfo *info)
+{
+    if (!info->queued) {
+        info->queued = true;
+        info->ref();
+        m_pending.push_back(info);
+    }
+}
+
+void EventDispatcherEPollPrivate::applyPendingUpdates()
+{
+    // Notifier changes made since the last wait are applied at once,
+    // toggles that cancel each other don't reach the kernel
+    for (SocketNotifierInfo *info : m_pending) {
+        info->queued = false;
+
+        // All notifiers might have been removed after queueing
+        if (info->r || info->w || info->x) {
+            quint32 events = 0;
+            if (!m_notifiers_disabled) {
+                if (info->edgeTriggered) {
+                    // Readiness is filtered by SocketNotifierInfo::process()
+                    // so toggling notifiers doesn't require epoll_ctl()
+                    events = EPOLLIN | EPOLLOUT | EPOLLET | (info->events & EPOLLPRI);
+                } else {
+                    events = info->events;
+                }
+            }
+
+            if (info->exclusive) {
+                if (info->inKernel && (events != info->registered || info->rearm)) {
+                    watchDel(info->fd);
+                    info->inKernel = false;
+                }
+
+                if (!info->inKernel && events && Q_LIKELY(watchAdd(info->fd, events | EPOLLEXCLUSIVE, info))) {
+                    info->inKernel = true;
+                    info->registered = events;
+                }
+            } else if (!info->inKernel) {
+                if (Q_LIKELY(watchAdd(info->fd, events, info))) {
+                    info->inKernel = true;
+                    info->registered = events;
+                }
+            } else if (events != info->registered || info->rearm) {
+                if (Q_LIKELY(watchMod(info->fd, events, info))) {
+                    info->registered = events;
+                }
+            }
+            info->rearm = false;
         }
 
-        m_notifiers.erase(it); // Hash is not rehashed
+        info->deref();
+    }
+    m_pending.clear();
+}
+
+void EventDispatcherEPollPrivate::replayMissedEdges()
+{
+    // Take the buffer as notifiers might be toggled while processing
+    std::vector<SocketNotifierInfo*> infos;
+    infos.swap(m_replay);
+
+    for (SocketNotifierInfo *info : infos) {
+        const quint32 events = info->replay;
+        info->replay = 0;
+        if (events && info->canProcess()) {
+            info->process(events);
+        }
         info->deref();
     }
 }
 
 bool EventDispatcherEPollPrivate::disableSocketNotifiers(bool disable)
 {
-    epoll_event e;
+    m_notifiers_disabled = disable;
 
     auto it = m_notifiers.constBegin();
     while (it != m_notifiers.constEnd()) {
-        SocketNotifierInfo *info  = it.value();
-
-        e.events = disable ? 0 : info->events;
-        e.data.ptr = info;
-        int res = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, info->fd, &e);
-        if (Q_UNLIKELY(res != 0)) {
-            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
-        }
-
+        queueUpdate(it.value());
         ++it;
     }
 
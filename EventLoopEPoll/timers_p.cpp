@@ -235,12 +235,7 @@ void EventDispatcherEPollPrivate::registerTimer(int timerId, int interval, Qt::T
             return;
         }
 
-        struct epoll_event event;
-        event.events = EPOLLIN;
-        event.data.ptr = data;
-
-        if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event))) {
-            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
+        if (Q_UNLIKELY(!watchAdd(fd, EPOLLIN, data))) {
             delete data;
             close(fd);
             return;
@@ -266,9 +261,7 @@ bool EventDispatcherEPollPrivate::unregisterTimer(int timerId)
 
         int fd = data->fd;
 
-        if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, 0))) {
-            qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
-        }
+        watchDel(fd);
 
         close(fd);
         data->deref();
@@ -301,9 +294,7 @@ bool EventDispatcherEPollPrivate::unregisterTimers(QObject *object)
             result = true;
             int fd = data->fd;
 
-            if (Q_UNLIKELY(-1 == epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, 0))) {
-                qErrnoWarning("%s: epoll_ctl() failed", Q_FUNC_INFO);
-            }
+            watchDel(fd);
 
             close(fd);
 
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2017 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "eventdispatcher_epoll_p.h"
+
+#include <errno.h>
+#include <string.h>
+
+// user_data 0 is used by POLL_REMOVE requests, so generations start at 1
+static inline quint64 watchUserData(int fd, quint32 gen)
+{
+    return (quint64(gen) << 32) | quint32(fd);
+}
+
+URingPoller::~URingPoller()
+{
+    if (m_initialized) {
+        io_uring_queue_exit(&m_ring);
+    }
+}
+
+bool URingPoller::init(unsigned entries)
+{
+    if (m_initialized) {
+        return true;
+    }
+
+    const int ret = io_uring_queue_init(entries, &m_ring, 0);
+    if (ret < 0) {
+        qWarning("%s: io_uring_queue_init() failed: %s", Q_FUNC_INFO, strerror(-ret));
+        return false;
+    }
+    m_initialized = true;
+    return true;
+}
+
+void URingPoller::add(int fd, quint32 events, EpollAbastractEvent *data)
+{
+    Watch &watch = m_watches[fd];
+    watch.data = data;
+    watch.events = events;
+    watch.gen = 0;
+    watch.armed = false;
+    if (events) {
+        arm(fd, watch);
+    }
+}
+
+void URingPoller::mod(int fd, quint32 events, EpollAbastractEvent *data)
+{
+    auto it = m_watches.find(fd);
+    if (Q_UNLIKELY(it == m_watches.end())) {
+        add(fd, events, data);
+        return;
+    }
+
+    Watch &watch = it.value();
+    watch.data = data;
+    if (watch.events == events) {
+        return;
+    }
+    watch.events = events;
+
+    // A poll can't be modified in place, drop it and arm a new one
+    if (watch.armed) {
+        cancel(fd, watch);
+    }
+    if (events) {
+        arm(fd, watch);
+    }
+}
+
+void URingPoller::del(int fd)
+{
+    auto it = m_watches.find(fd);
+    if (it != m_watches.end()) {
+        if (it->armed) {
+            cancel(fd, it.value());
+        }
+        m_watches.erase(it);
+    }
+}
+
+int URingPoller::wait(struct epoll_event *events, int maxevents, int timeout)
+{
+    // One shot polls that fired on the last round are armed again
+    // so that the level triggered semantics of epoll are kept
+    for (int fd : m_rearm) {
+        auto it = m_watches.find(fd);
+        if (it != m_watches.end() && !it->armed && it->events) {
+            arm(fd, it.value());
+        }
+    }
+    m_rearm.clear();
+
+    int ret;
+    do {
+        if (timeout == 0) {
+            ret = io_uring_submit(&m_ring);
+        } else {
+            ret = io_uring_submit_and_wait(&m_ring, 1);
+        }
+    } while (Q_UNLIKELY(ret == -EINTR && timeout != 0 && !io_uring_cq_ready(&m_ring)));
+
+    if (Q_UNLIKELY(ret < 0 && ret != -EINTR && ret != -EBUSY)) {
+        qWarning("%s: io_uring_submit() failed: %s", Q_FUNC_INFO, strerror(-ret));
+    }
+
+    int n_events = 0;
+    unsigned consumed = 0;
+    unsigned head;
+    struct io_uring_cqe *cqe;
+    io_uring_for_each_cqe(&m_ring, head, cqe) {
+        if (n_events == maxevents) {
+            break;
+        }
+        ++consumed;
+
+        const quint64 userData = cqe->user_data;
+        if (userData == 0) {
+            continue;
+        }
+
+        const int fd = int(quint32(userData));
+        auto it = m_watches.find(fd);
+        if (it == m_watches.end() || it->gen != quint32(userData >> 32)) {
+            // Completion of a poll that was canceled or replaced
+            continue;
+        }
+
+        it->armed = false;
+        if (cqe->res == -ECANCELED) {
+            continue;
+        }
+
+        struct epoll_event &e = events[n_events++];
+        e.events = cqe->res < 0 ? quint32(EPOLLERR) : quint32(cqe->res);
+        e.data.ptr = it->data;
+        m_rearm.push_back(fd);
+    }
+    io_uring_cq_advance(&m_ring, consumed);
+
+    return n_events;
+}
+
+io_uring_sqe *URingPoller::getSqe()
+{
+    io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+    while (Q_UNLIKELY(!sqe)) {
+        // Submission queue is full, flush it and try again
+        io_uring_submit(&m_ring);
+        sqe = io_uring_get_sqe(&m_ring);
+    }
+    return sqe;
+}
+
+void URingPoller::arm(int fd, Watch &watch)
+{
+    if (++m_gen == 0) {
+        m_gen = 1;
+    }
+    watch.gen = m_gen;
+    watch.armed = true;
+
+    io_uring_sqe *sqe = getSqe();
+    io_uring_prep_poll_add(sqe, fd, watch.events);
+    sqe->user_data = watchUserData(fd, watch.gen);
+}
+
+void URingPoller::cancel(int fd, Watch &watch)
+{
+    io_uring_sqe *sqe = getSqe();
+    // liburing changed the poll_remove signature, so fill it by hand
+    io_uring_prep_rw(IORING_OP_POLL_REMOVE, sqe, -1, nullptr, 0, 0);
+    sqe->addr = watchUserData(fd, watch.gen);
+    sqe->user_data = 0;
+
+    // Generation 0 is never armed, so late completions get ignored
+    watch.gen = 0;
+    watch.armed = false;
+}
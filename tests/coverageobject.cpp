@@ -19,6 +19,7 @@ public:
 protected:
     virtual qint64 doWrite(const char *data, qint64 len) final;
     virtual bool writeHeaders(quint16 status, const Headers &headers) final;
+    virtual StreamingFraming streamingFraming() const final;
 
 public:
     QByteArray m_responseData;
@@ -108,6 +109,7 @@ QVariantMap TestEngine::createRequest(const QString &method, const QString &path
     req.headers = headersCL;
     req.elapsed.start();
     req.body = bodyDevice;
+    req.chunkedMinimumSize = headersCL.header(QStringLiteral("X-Test-Chunked-Min-Size")).toInt();
 
     processRequest(&req);
 
@@ -174,3 +176,11 @@ bool TestEngineConnection::writeHeaders(quint16 status, const Headers &headers)
 
     return true;
 }
+
+EngineRequest::StreamingFraming TestEngineConnection::streamingFraming() const
+{
+    if (headers.header(QStringLiteral("X-Test-Framing")) == QLatin1String("chunked")) {
+        return ChunkedEncoding;
+    }
+    return CloseConnection;
+}
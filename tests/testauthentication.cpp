@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QNetworkCookie>
 #include <QUrlQuery>
+#include <QTemporaryDir>
 
 #include "headers.h"
 #include "coverageobject.h"
@@ -15,6 +16,7 @@
 #include <Cutelyst/Plugins/Authentication/credentialpassword.h>
 #include <Cutelyst/Plugins/Authentication/credentialhttp.h>
 #include <Cutelyst/Plugins/Authentication/minimal.h>
+#include <Cutelyst/Plugins/Authentication/htpasswd.h>
 #include <Cutelyst/Plugins/Session/Session>
 
 #include <Cutelyst/application.h>
@@ -23,6 +25,23 @@
 
 using namespace Cutelyst;
 
+class PasswordStore : public AuthenticationStore
+{
+public:
+    QString password;
+
+    virtual AuthenticationUser findUser(Context *c, const ParamsMultiMap &userinfo) override {
+        Q_UNUSED(c)
+        if (userinfo.value(QStringLiteral("id")) != QLatin1String("foo")) {
+            return AuthenticationUser();
+        }
+
+        AuthenticationUser user(QStringLiteral("foo"));
+        user.insert(QStringLiteral("password"), password);
+        return user;
+    }
+};
+
 class TestAuthentication : public CoverageObject
 {
     Q_OBJECT
@@ -37,10 +56,19 @@ private Q_SLOTS:
         doTest();
     }
 
+    void testHtpasswdLookup();
+    void testHtpasswdReload();
+    void testHtpasswdFailsClosed();
+
+    void testVerifiedCache();
+
     void cleanupTestCase();
 
 private:
     TestEngine *m_engine;
+    PasswordStore *m_cacheStore;
+    CredentialHttp *m_cacheCredential;
+    QTemporaryDir m_dir;
 
     TestEngine* getEngine();
 
@@ -190,11 +218,23 @@ TestEngine* TestAuthentication::getEngine()
     hashedHttpCredential->setUsernameField(QStringLiteral("id"));
     auth->addRealm(new AuthenticationRealm(hashedStore, hashedHttpCredential, QStringLiteral("httpHashed")));
 
+    auto cachedHttpCredential = new CredentialHttp;
+    cachedHttpCredential->setPasswordType(CredentialHttp::Hashed);
+    cachedHttpCredential->setUsernameField(QStringLiteral("id"));
+    cachedHttpCredential->setVerifiedCache(60, 1);
+    auth->addRealm(new AuthenticationRealm(hashedStore, cachedHttpCredential, QStringLiteral("httpCached")));
+
     auto noneHttpCredential = new CredentialHttp;
     noneHttpCredential->setPasswordType(CredentialHttp::None);
     noneHttpCredential->setUsernameField(QStringLiteral("id"));
     auth->addRealm(clearStore, noneHttpCredential, QStringLiteral("httpNone"));
 
+    m_cacheStore = new PasswordStore;
+    m_cacheCredential = new CredentialHttp;
+    m_cacheCredential->setUsernameField(QStringLiteral("id"));
+    m_cacheCredential->setVerifiedCache(1);
+    auth->addRealm(new AuthenticationRealm(m_cacheStore, m_cacheCredential, QStringLiteral("httpExpiring")));
+
 
     new Session(app);
 
@@ -339,6 +379,25 @@ void TestAuthentication::testController_data()
     QTest::newRow("auth-http-user-realm-test05") << QStringLiteral("/authentication/test/authenticate_user_realm/httpNone")
                                                  << headers << 200 << QByteArrayLiteral("ok");
 
+    headers.clear();
+    headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("123"));
+    QTest::newRow("auth-http-cached-test00") << QStringLiteral("/authentication/test/authenticate_user_realm/httpCached")
+                                             << headers << 200 << QByteArrayLiteral("ok");
+    QTest::newRow("auth-http-cached-test01") << QStringLiteral("/authentication/test/authenticate_user_realm/httpCached")
+                                             << headers << 200 << QByteArrayLiteral("ok");
+    headers.clear();
+    headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("321"));
+    QTest::newRow("auth-http-cached-test02") << QStringLiteral("/authentication/test/authenticate_user_realm/httpCached")
+                                             << headers << 401 << QByteArrayLiteral("fail");
+    headers.clear();
+    headers.setAuthorizationBasic(QStringLiteral("bar"), QStringLiteral("321"));
+    QTest::newRow("auth-http-cached-test03") << QStringLiteral("/authentication/test/authenticate_user_realm/httpCached")
+                                             << headers << 200 << QByteArrayLiteral("ok");
+    headers.clear();
+    headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("123"));
+    QTest::newRow("auth-http-cached-test04") << QStringLiteral("/authentication/test/authenticate_user_realm/httpCached")
+                                             << headers << 200 << QByteArrayLiteral("ok");
+
     headers.clear();
     headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("123"));
     QTest::newRow("auth-http-realm-test00") << QStringLiteral("/authentication/test/authenticate_realm/httpHashed")
@@ -401,6 +460,131 @@ void TestAuthentication::testController_data()
                                              << headers << 401 << QByteArrayLiteral("fail");
 }
 
+static bool writeHtpasswd(const QString &filename, const QByteArray &data)
+{
+    QFile file(filename);
+    return file.open(QFile::WriteOnly | QFile::Truncate) && file.write(data) == data.size();
+}
+
+static QString htpasswdPassword(StoreHtpasswd &store, const QString &username)
+{
+    const AuthenticationUser user = store.findUser(nullptr, { {QStringLiteral("username"), username} });
+    return user.value(QStringLiteral("password")).toString();
+}
+
+void TestAuthentication::testHtpasswdLookup()
+{
+    const QString filename = m_dir.filePath(QStringLiteral("lookup.htpasswd"));
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("# comment\nfoo:123\nbar:sha256,456\nfoo:duplicated\n")));
+
+    StoreHtpasswd store(filename);
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("123"));
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("bar")), QStringLiteral("sha256:456"));
+    QVERIFY(store.findUser(nullptr, { {QStringLiteral("username"), QStringLiteral("baz")} }).isNull());
+
+    // Stores of the same file share the loaded users
+    StoreHtpasswd other(filename);
+    QCOMPARE(htpasswdPassword(other, QStringLiteral("foo")), QStringLiteral("123"));
+
+    store.addUser({ {QStringLiteral("username"), QStringLiteral("baz")}, {QStringLiteral("password"), QStringLiteral("789")} });
+    QCOMPARE(htpasswdPassword(other, QStringLiteral("baz")), QStringLiteral("789"));
+}
+
+void TestAuthentication::testHtpasswdReload()
+{
+    const QString filename = m_dir.filePath(QStringLiteral("reload.htpasswd"));
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("foo:123\n")));
+
+    StoreHtpasswd store(filename);
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("123"));
+
+    // Edited by another process, the size changes along with the
+    // modification time so it is detected on any file system
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("foo:12345\nbar:321\n")));
+    store.reload();
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("12345"));
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("bar")), QStringLiteral("321"));
+}
+
+void TestAuthentication::testHtpasswdFailsClosed()
+{
+    const QString filename = m_dir.filePath(QStringLiteral("closed.htpasswd"));
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("foo:123\nbar:456\nbaz:789\n")));
+
+    StoreHtpasswd store(filename);
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("123"));
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("bar")), QStringLiteral("456"));
+
+    // Only the broken line is dropped
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("foo:123\nbar\nbaz:789\n")));
+    store.reload();
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("123"));
+    QVERIFY(store.findUser(nullptr, { {QStringLiteral("username"), QStringLiteral("bar")} }).isNull());
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("baz")), QStringLiteral("789"));
+
+    // A removed user can't log in anymore
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("foo:123\n")));
+    store.reload();
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("123"));
+    QVERIFY(store.findUser(nullptr, { {QStringLiteral("username"), QStringLiteral("baz")} }).isNull());
+
+    // Neither can anyone once the file is gone
+    QVERIFY(QFile::remove(filename));
+    store.reload();
+    QVERIFY(store.findUser(nullptr, { {QStringLiteral("username"), QStringLiteral("foo")} }).isNull());
+
+    // Picked up again once it's back
+    QVERIFY(writeHtpasswd(filename, QByteArrayLiteral("foo:456\n")));
+    store.reload();
+    QCOMPARE(htpasswdPassword(store, QStringLiteral("foo")), QStringLiteral("456"));
+}
+
+void TestAuthentication::testVerifiedCache()
+{
+    Headers headers;
+    headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("123"));
+    auto login = [this, &headers] {
+        const QVariantMap result = m_engine->createRequest(QStringLiteral("GET"), QStringLiteral("authentication/test/authenticate_realm/httpExpiring"),
+                                                           QByteArray(), headers, nullptr);
+        return result.value(QStringLiteral("statusCode")).toInt();
+    };
+
+    m_cacheStore->password = CredentialPassword::createPassword(QByteArrayLiteral("123"), QCryptographicHash::Sha256, 10, 10, 10);
+    m_cacheCredential->setPasswordType(CredentialHttp::Hashed);
+    QCOMPARE(login(), 200);
+
+    // A clear text comparison with the stored hash fails, so
+    // succeeding means the password wasn't checked again
+    m_cacheCredential->setPasswordType(CredentialHttp::Clear);
+    QCOMPARE(login(), 200);
+    QCOMPARE(login(), 200);
+
+    // Other passwords are still checked
+    headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("321"));
+    QCOMPARE(login(), 401);
+    headers.setAuthorizationBasic(QStringLiteral("foo"), QStringLiteral("123"));
+
+    // Changing the stored password invalidates the entry,
+    // even when the new one is a hash of the same password
+    m_cacheStore->password = CredentialPassword::createPassword(QByteArrayLiteral("123"), QCryptographicHash::Sha256, 10, 10, 10);
+    QCOMPARE(login(), 401);
+    m_cacheCredential->setPasswordType(CredentialHttp::Hashed);
+    QCOMPARE(login(), 200);
+
+    // Entries expire after the TTL
+    m_cacheCredential->setPasswordType(CredentialHttp::Clear);
+    QCOMPARE(login(), 200);
+    QTest::qWait(1100);
+    QCOMPARE(login(), 401);
+
+    // Clearing the cache forces the check too
+    m_cacheCredential->setPasswordType(CredentialHttp::Hashed);
+    QCOMPARE(login(), 200);
+    m_cacheCredential->clearVerifiedCache();
+    m_cacheCredential->setPasswordType(CredentialHttp::Clear);
+    QCOMPARE(login(), 401);
+}
+
 QTEST_MAIN(TestAuthentication)
 
 #include "testauthentication.moc"
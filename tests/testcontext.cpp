@@ -28,6 +28,8 @@ private Q_SLOTS:
         doTest();
     }
 
+    void testWarmUp();
+
     void cleanupTestCase();
 
 private:
@@ -150,6 +152,31 @@ void TestContext::cleanupTestCase()
     delete m_engine;
 }
 
+void TestContext::testWarmUp()
+{
+    auto app = new TestApplication;
+    auto engine = new TestEngine(app, QVariantMap());
+    new ContextTest_NS(app);
+
+    QStringList steps;
+    app->addWarmUp(QStringLiteral("first"), [&steps] (Application *app) {
+        QVERIFY(!app->controllers().isEmpty());
+        steps.append(QStringLiteral("first"));
+        app->addWarmUp(QStringLiteral("nested"), [&steps] (Application *) {
+            steps.append(QStringLiteral("nested"));
+        });
+    });
+    app->addWarmUp(QStringLiteral("second"), [&steps] (Application *) {
+        steps.append(QStringLiteral("second"));
+    });
+    QVERIFY(steps.isEmpty());
+
+    QVERIFY(engine->init());
+    QCOMPARE(steps, QStringList({ QStringLiteral("first"), QStringLiteral("second"), QStringLiteral("nested") }));
+
+    delete engine;
+}
+
 void TestContext::doTest()
 {
     QFETCH(QString, url);
@@ -0,0 +1,224 @@
+#ifndef CPUTOPOLOGYTEST_H
+#define CPUTOPOLOGYTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+
+#include "coverageobject.h"
+#include "cputopology.h"
+
+#include <set>
+
+using namespace CWSGI;
+
+class TestCpuTopology : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestCpuTopology(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testParseCpuList_data();
+    void testParseCpuList();
+
+    void testPlacementFromString();
+    void testTopology();
+    void testInvalid();
+    void testSpread();
+    void testCompact();
+    void testListener();
+    void testIndex();
+
+private:
+    void writeFile(const QString &path, const QByteArray &data);
+    static QVector<int> slotCpus(const std::vector<CpuTopology::Slot> &placed);
+    static QVector<int> slotNodes(const std::vector<CpuTopology::Slot> &placed);
+
+    QTemporaryDir m_dir;
+};
+
+void TestCpuTopology::writeFile(const QString &path, const QByteArray &data)
+{
+    const QString fileName = m_dir.path() + path;
+    QVERIFY(QDir().mkpath(QFileInfo(fileName).path()));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+    QCOMPARE(file.write(data + '\n'), qint64(data.size() + 1));
+}
+
+QVector<int> TestCpuTopology::slotCpus(const std::vector<CpuTopology::Slot> &placed)
+{
+    QVector<int> ret;
+    for (const CpuTopology::Slot &slot : placed) {
+        ret.append(slot.cpus);
+    }
+    return ret;
+}
+
+QVector<int> TestCpuTopology::slotNodes(const std::vector<CpuTopology::Slot> &placed)
+{
+    QVector<int> ret;
+    for (const CpuTopology::Slot &slot : placed) {
+        ret.append(slot.node);
+    }
+    return ret;
+}
+
+void TestCpuTopology::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // Two packages each on its own NUMA node with two cores of two SMT
+    // threads, numbered like Linux does, first threads before siblings
+    writeFile(QStringLiteral("/sys/devices/system/cpu/online"), "0-7");
+    writeFile(QStringLiteral("/sys/devices/system/node/online"), "0-1");
+    writeFile(QStringLiteral("/sys/devices/system/node/node0/cpulist"), "0-1,4-5");
+    writeFile(QStringLiteral("/sys/devices/system/node/node1/cpulist"), "2-3,6-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        const QString topology = QLatin1String("/sys/devices/system/cpu/cpu") + QString::number(cpu) + QLatin1String("/topology/");
+        writeFile(topology + QLatin1String("core_id"), QByteArray::number(cpu % 2));
+        writeFile(topology + QLatin1String("physical_package_id"), QByteArray::number((cpu / 2) % 2));
+    }
+}
+
+void TestCpuTopology::testParseCpuList_data()
+{
+    QTest::addColumn<QByteArray>("list");
+    QTest::addColumn<QVector<int>>("cpus");
+
+    QTest::newRow("empty") << QByteArray() << QVector<int>();
+    QTest::newRow("newline") << QByteArrayLiteral("\n") << QVector<int>();
+    QTest::newRow("single") << QByteArrayLiteral("5\n") << QVector<int>({ 5 });
+    QTest::newRow("range") << QByteArrayLiteral("0-3") << QVector<int>({ 0, 1, 2, 3 });
+    QTest::newRow("commas") << QByteArrayLiteral("1,3,5") << QVector<int>({ 1, 3, 5 });
+    QTest::newRow("mixed") << QByteArrayLiteral("0-3,8,10-11") << QVector<int>({ 0, 1, 2, 3, 8, 10, 11 });
+    QTest::newRow("empty-entry") << QByteArrayLiteral("1,,2,") << QVector<int>({ 1, 2 });
+    QTest::newRow("reversed-range") << QByteArrayLiteral("3-1,4") << QVector<int>({ 4 });
+    QTest::newRow("garbage") << QByteArrayLiteral("a,2,-1,1-b") << QVector<int>({ 2 });
+}
+
+void TestCpuTopology::testParseCpuList()
+{
+    QFETCH(QByteArray, list);
+    QFETCH(QVector<int>, cpus);
+
+    QCOMPARE(CpuTopology::parseCpuList(list), cpus);
+}
+
+void TestCpuTopology::testPlacementFromString()
+{
+    bool ok;
+    QCOMPARE(CpuTopology::placementFromString(QString(), &ok), CpuTopology::Index);
+    QVERIFY(ok);
+    QCOMPARE(CpuTopology::placementFromString(QStringLiteral("index"), &ok), CpuTopology::Index);
+    QVERIFY(ok);
+    QCOMPARE(CpuTopology::placementFromString(QStringLiteral("spread"), &ok), CpuTopology::Spread);
+    QVERIFY(ok);
+    QCOMPARE(CpuTopology::placementFromString(QStringLiteral("compact"), &ok), CpuTopology::Compact);
+    QVERIFY(ok);
+    QCOMPARE(CpuTopology::placementFromString(QStringLiteral("listener"), &ok), CpuTopology::Listener);
+    QVERIFY(ok);
+    QCOMPARE(CpuTopology::placementFromString(QStringLiteral("numa"), &ok), CpuTopology::Index);
+    QVERIFY(!ok);
+}
+
+void TestCpuTopology::testTopology()
+{
+    CpuTopology topology(m_dir.path());
+    QVERIFY(topology.isValid());
+    QCOMPARE(int(topology.cpus().size()), 8);
+    QCOMPARE(topology.nodeCount(), 2);
+    QCOMPARE(topology.packageCount(), 2);
+    QCOMPARE(topology.coreCount(), 4);
+
+    const CpuTopology::Cpu &sibling = topology.cpus()[6];
+    QCOMPARE(sibling.id, 6);
+    QCOMPARE(sibling.core, 0);
+    QCOMPARE(sibling.package, 1);
+    QCOMPARE(sibling.node, 1);
+    QCOMPARE(sibling.sibling, 1);
+}
+
+void TestCpuTopology::testInvalid()
+{
+    CpuTopology topology(m_dir.path() + QLatin1String("/missing"));
+    QVERIFY(!topology.isValid());
+    QVERIFY(topology.place(CpuTopology::Spread, 4, 1).empty());
+}
+
+void TestCpuTopology::testSpread()
+{
+    CpuTopology topology(m_dir.path());
+
+    // One worker per physical core, alternating nodes
+    std::vector<CpuTopology::Slot> placed = topology.place(CpuTopology::Spread, 4, 1);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 0, 2, 1, 3 }));
+    QCOMPARE(slotNodes(placed), QVector<int>({ 0, 1, 0, 1 }));
+
+    std::set<std::pair<int, int>> cores;
+    for (const CpuTopology::Slot &slot : placed) {
+        const CpuTopology::Cpu &cpu = topology.cpus()[size_t(slot.cpus.first())];
+        cores.insert({ cpu.package, cpu.core });
+    }
+    QCOMPARE(int(cores.size()), topology.coreCount());
+
+    // SMT siblings only once all cores are taken, then it wraps
+    placed = topology.place(CpuTopology::Spread, 10, 1);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 0, 2, 1, 3, 4, 6, 5, 7, 0, 2 }));
+
+    // Slots with more CPUs keep them on the same node
+    placed = topology.place(CpuTopology::Spread, 2, 2);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 0, 1, 2, 3 }));
+    QCOMPARE(slotNodes(placed), QVector<int>({ 0, 1 }));
+}
+
+void TestCpuTopology::testCompact()
+{
+    CpuTopology topology(m_dir.path());
+
+    // The first node is filled, siblings included, before the second
+    std::vector<CpuTopology::Slot> placed = topology.place(CpuTopology::Compact, 6, 1);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 0, 4, 1, 5, 2, 6 }));
+    QCOMPARE(slotNodes(placed), QVector<int>({ 0, 0, 0, 0, 1, 1 }));
+
+    // Slots spanning both nodes have no node
+    placed = topology.place(CpuTopology::Compact, 1, 8);
+    QCOMPARE(slotNodes(placed), QVector<int>({ -1 }));
+}
+
+void TestCpuTopology::testListener()
+{
+    CpuTopology topology(m_dir.path());
+
+    // The listener node is filled first, one core at a time
+    std::vector<CpuTopology::Slot> placed = topology.place(CpuTopology::Listener, 6, 1, 1);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 2, 3, 6, 7, 0, 1 }));
+    QCOMPARE(slotNodes(placed), QVector<int>({ 1, 1, 1, 1, 0, 0 }));
+
+    // Unknown nodes spread instead
+    placed = topology.place(CpuTopology::Listener, 4, 1, 5);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 0, 2, 1, 3 }));
+}
+
+void TestCpuTopology::testIndex()
+{
+    CpuTopology topology(m_dir.path());
+
+    // CPUs in the order they are numbered, whatever their node
+    const std::vector<CpuTopology::Slot> placed = topology.place(CpuTopology::Index, 3, 2);
+    QCOMPARE(slotCpus(placed), QVector<int>({ 0, 1, 2, 3, 4, 5 }));
+    QCOMPARE(slotNodes(placed), QVector<int>({ 0, 1, 0 }));
+}
+
+QTEST_MAIN(TestCpuTopology)
+
+#include "testcputopology.moc"
+
+#endif
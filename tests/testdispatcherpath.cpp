@@ -7,12 +7,70 @@
 #include "headers.h"
 #include "coverageobject.h"
 
+#include <Cutelyst/action.h>
 #include <Cutelyst/application.h>
 #include <Cutelyst/controller.h>
 #include <Cutelyst/headers.h>
 
 using namespace Cutelyst;
 
+class TypedActions : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("typed")
+public:
+    explicit TypedActions(QObject *parent) : Controller(parent) {
+        CUTELYST_ACTION(TypedActions, sum);
+        CUTELYST_ACTION(TypedActions, text);
+        CUTELYST_ACTION(TypedActions, list);
+        CUTELYST_ACTION(TypedActions, positive);
+        CUTELYST_ACTION(TypedActions, autoSum);
+    }
+
+    C_ATTR(sum, :Local :Args(2))
+    void sum(Context *c, int a, qint64 b) {
+        c->response()->setBody(QByteArray::number(a + b));
+    }
+
+    C_ATTR(text, :Local :Args(1))
+    void text(Context *c, const QString &value) {
+        c->response()->setBody(QByteArrayLiteral("text ") + value.toLatin1());
+    }
+
+    C_ATTR(list, :Local)
+    void list(Context *c, const QStringList &args) {
+        c->response()->setBody(QByteArray::number(args.size()) + ':' + args.join(QLatin1Char(',')).toLatin1());
+    }
+
+    C_ATTR(positive, :Local :Args(1))
+    bool positive(Context *c, int value) {
+        c->response()->setBody(value > 0 ? QByteArrayLiteral("positive") : QByteArrayLiteral("not positive"));
+        return value > 0;
+    }
+
+    C_ATTR(autoSum, :Local :AutoArgs)
+    void autoSum(Context *c, const QString &label, int a, int b) {
+        c->response()->setBody(label.toLatin1() + ' ' + QByteArray::number(a + b));
+    }
+
+    // Not registered, numbers can't be converted so they aren't counted
+    C_ATTR(autoUntyped, :Local :AutoArgs)
+    void autoUntyped(Context *c, const QString &label, int value) {
+        Q_UNUSED(value)
+        c->response()->setBody(label.toLatin1());
+    }
+
+private:
+    C_ATTR(End,)
+    bool End(Context *c) {
+        // Tells actions that failed apart from empty bodies
+        if (!c->state() && !c->response()->hasBody()) {
+            c->response()->setBody(QByteArrayLiteral("failed"));
+        }
+        return true;
+    }
+};
+
 class TestDispatcherPath : public CoverageObject
 {
     Q_OBJECT
@@ -27,10 +85,13 @@ private Q_SLOTS:
         doTest();
     }
 
+    void testAutoArgs();
+
     void cleanupTestCase();
 
 private:
     TestEngine *m_engine;
+    TypedActions *m_typed = nullptr;
 
     TestEngine* getEngine();
 
@@ -47,6 +108,7 @@ TestEngine* TestDispatcherPath::getEngine()
 {
     auto app = new TestApplication;
     auto engine = new TestEngine(app, QVariantMap());
+    m_typed = new TypedActions(app);
     if (!engine->init()) {
         return nullptr;
     }
@@ -103,6 +165,24 @@ void TestDispatcherPath::testController_data()
     QTest::newRow("path-test19") << QStringLiteral("/test/controller/twoOld/1/2") << QByteArrayLiteral("path /test/controller/twoOld/1/2 args 1/2");
     QTest::newRow("path-test20") << QStringLiteral("/test/controller/twoOld/1/2//") << QByteArrayLiteral("path /test/controller/twoOld/1/2// args 1/2");
     QTest::newRow("path-test21") << QStringLiteral("/") << QByteArrayLiteral("rootAction");
+
+    // Typed actions
+    QTest::newRow("typed-test00") << QStringLiteral("/typed/sum/2/40") << QByteArrayLiteral("42");
+    QTest::newRow("typed-test01") << QStringLiteral("/typed/sum/two/40") << QByteArrayLiteral("failed");
+    QTest::newRow("typed-test02") << QStringLiteral("/typed/text/hello") << QByteArrayLiteral("text hello");
+    QTest::newRow("typed-test03") << QStringLiteral("/typed/list/a/b/c") << QByteArrayLiteral("3:a,b,c");
+    QTest::newRow("typed-test04") << QStringLiteral("/typed/list") << QByteArrayLiteral("0:");
+    QTest::newRow("typed-test05") << QStringLiteral("/typed/positive/5") << QByteArrayLiteral("positive");
+    QTest::newRow("typed-test06") << QStringLiteral("/typed/positive/-5") << QByteArrayLiteral("not positive");
+    QTest::newRow("typed-test07") << QStringLiteral("/typed/autoSum/sum/2/40") << QByteArrayLiteral("sum 42");
+    QTest::newRow("typed-test08") << QStringLiteral("/typed/autoSum/sum/2/40/1") << QByteArrayLiteral("Unknown resource 'typed/autoSum/sum/2/40/1'.");
+}
+
+void TestDispatcherPath::testAutoArgs()
+{
+    // Numeric parameters only count for actions given to registerAction()
+    QCOMPARE(m_typed->actionFor(QStringLiteral("autoSum"))->numberOfArgs(), qint8(3));
+    QCOMPARE(m_typed->actionFor(QStringLiteral("autoUntyped"))->numberOfArgs(), qint8(1));
 }
 
 QTEST_MAIN(TestDispatcherPath)
@@ -0,0 +1,237 @@
+#ifndef EVENTDISPATCHERTEST_H
+#define EVENTDISPATCHERTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QThread>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+
+#include "coverageobject.h"
+
+#include "../EventLoopEPoll/eventdispatcher_epoll.h"
+#ifdef HAVE_IO_URING
+#include "../EventLoopEPoll/eventdispatcher_uring.h"
+#endif
+
+#include <atomic>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+static const QByteArray request = QByteArrayLiteral("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+static const QByteArray response = QByteArrayLiteral("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+
+/**
+ * Answers every read with a small response, it's the part
+ * of a worker that only depends on the event dispatcher.
+ */
+class SmallResponseServer : public QObject
+{
+    Q_OBJECT
+public:
+    std::atomic<int> tid{0};
+    std::atomic<quint64> wakeups{0};
+
+public Q_SLOTS:
+    void listen(const std::vector<int> &fds) {
+        tid = int(syscall(SYS_gettid));
+        connect(QThread::currentThread()->eventDispatcher(), &QAbstractEventDispatcher::awake, this, [this] {
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+        }, Qt::DirectConnection);
+
+        for (int fd : fds) {
+            auto notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, [notifier, fd] {
+                char buf[4096];
+                const ssize_t len = ::read(fd, buf, sizeof(buf));
+                if (len > 0) {
+                    if (::write(fd, response.constData(), size_t(response.size())) != response.size()) {
+                        notifier->setEnabled(false);
+                    }
+                } else if (len == 0) {
+                    notifier->setEnabled(false);
+                }
+            });
+        }
+    }
+
+    void stop() {
+        qDeleteAll(findChildren<QSocketNotifier *>());
+        deleteLater();
+    }
+};
+
+Q_DECLARE_METATYPE(std::vector<int>)
+
+class TestEventDispatcher : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestEventDispatcher(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void benchmarkSmallResponse_data();
+    void benchmarkSmallResponse();
+};
+
+// Counts every syscall entered by the thread \p tid, needs
+// access to the raw_syscalls tracepoint, returns -1 otherwise
+static int openSyscallCounter(int tid)
+{
+    int id = -1;
+    for (const char *path : { "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                              "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id" }) {
+        QFile file(QString::fromLatin1(path));
+        if (file.open(QFile::ReadOnly)) {
+            bool ok;
+            id = file.readAll().trimmed().toInt(&ok);
+            if (ok) {
+                break;
+            }
+            id = -1;
+        }
+    }
+
+    if (id == -1) {
+        return -1;
+    }
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = quint64(id);
+    attr.sample_period = 1;
+    return int(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+}
+
+static quint64 readCounter(int fd)
+{
+    quint64 count = 0;
+    if (fd == -1 || ::read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+void TestEventDispatcher::benchmarkSmallResponse_data()
+{
+    QTest::addColumn<bool>("uring");
+
+    QTest::newRow("epoll") << false;
+#ifdef HAVE_IO_URING
+    QTest::newRow("io_uring") << true;
+#endif
+}
+
+void TestEventDispatcher::benchmarkSmallResponse()
+{
+    QFETCH(bool, uring);
+
+    qRegisterMetaType<std::vector<int>>();
+
+    // Many connections with one request each per round, like
+    // a worker serving keep-alive clients
+    const int connections = 16;
+    const int rounds = qEnvironmentVariableIsEmpty("CUTELYST_BENCHMARK_LARGE") ? 500 : 50000;
+
+    std::vector<int> clients;
+    std::vector<int> servers;
+    for (int i = 0; i < connections; ++i) {
+        int fds[2];
+        QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+        clients.push_back(fds[0]);
+        servers.push_back(fds[1]);
+    }
+
+    QThread thread;
+#ifdef HAVE_IO_URING
+    if (uring) {
+        thread.setEventDispatcher(new EventDispatcherURing);
+    } else {
+        thread.setEventDispatcher(new EventDispatcherEPoll);
+    }
+#else
+    Q_UNUSED(uring)
+    thread.setEventDispatcher(new EventDispatcherEPoll);
+#endif
+    thread.start();
+
+    // Deleted on the server thread by stop()
+    auto server = new SmallResponseServer;
+    server->moveToThread(&thread);
+    QMetaObject::invokeMethod(server, "listen", Qt::BlockingQueuedConnection, Q_ARG(std::vector<int>, servers));
+
+    auto round = [&] {
+        for (int fd : clients) {
+            if (::write(fd, request.constData(), size_t(request.size())) != request.size()) {
+                return false;
+            }
+        }
+        char buf[256];
+        for (int fd : clients) {
+            ssize_t received = 0;
+            while (received < response.size()) {
+                const ssize_t len = ::read(fd, buf, sizeof(buf));
+                if (len <= 0) {
+                    return false;
+                }
+                received += len;
+            }
+        }
+        return true;
+    };
+
+    // Warm up so lazy allocations don't count
+    QVERIFY(round());
+
+    const int counter = openSyscallCounter(server->tid);
+    const quint64 syscallsBefore = readCounter(counter);
+    const quint64 wakeupsBefore = server->wakeups;
+    quint64 requests = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        for (int i = 0; i < rounds; ++i) {
+            QVERIFY(round());
+        }
+        requests += quint64(rounds * connections);
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    const quint64 syscalls = readCounter(counter) - syscallsBefore;
+    const quint64 wakeups = server->wakeups - wakeupsBefore;
+    if (counter != -1) {
+        ::close(counter);
+    }
+
+    qInfo("%s: %.0f requests/s, %.2f loop wakeups/request, %s syscalls/request",
+          QTest::currentDataTag(),
+          requests * 1e9 / elapsed,
+          double(wakeups) / requests,
+          counter == -1 ? "n/a (no access to the raw_syscalls tracepoint)"
+                        : qPrintable(QString::number(double(syscalls) / requests, 'f', 2)));
+
+    QMetaObject::invokeMethod(server, "stop", Qt::BlockingQueuedConnection);
+    for (int fd : clients) {
+        ::close(fd);
+    }
+    for (int fd : servers) {
+        ::close(fd);
+    }
+    thread.quit();
+    thread.wait();
+}
+
+QTEST_MAIN(TestEventDispatcher)
+
+#include "testeventdispatcher.moc"
+
+#endif
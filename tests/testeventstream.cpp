@@ -0,0 +1,374 @@
+#ifndef EVENTSTREAMTEST_H
+#define EVENTSTREAMTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QThread>
+
+#include "headers.h"
+#include "coverageobject.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/headers.h>
+#include <Cutelyst/eventstream.h>
+#include <Cutelyst/enginerequest.h>
+
+#include <atomic>
+
+using namespace Cutelyst;
+
+// Reports as unsent whatever the test says the engine still has
+class BufferedRequest : public EngineRequest
+{
+public:
+    BufferedRequest(const QString &path)
+    {
+        method = QStringLiteral("GET");
+        setPath(path);
+        protocol = QStringLiteral("HTTP/1.1");
+        elapsed.start();
+    }
+
+    QByteArray output;
+    // Where each write came from, to tell shared buffers apart
+    QVector<const char *> writes;
+    qint64 buffered = 0;
+    bool finished = false;
+
+    virtual qint64 bytesToWrite() const override final {
+        return buffered;
+    }
+
+protected:
+    virtual qint64 doWrite(const char *data, qint64 len) override final {
+        output.append(data, int(len));
+        writes.append(data);
+        return len;
+    }
+
+    virtual bool writeHeaders(quint16 status, const Headers &headers) override final {
+        Q_UNUSED(status)
+        Q_UNUSED(headers)
+        return true;
+    }
+
+    virtual void processingFinished() override final {
+        finished = true;
+    }
+};
+
+// Publishes numbered events from its own thread
+class PublishThread : public QThread
+{
+public:
+    PublishThread(EventStreamChannel *channel, int count) : m_channel(channel), m_count(count) {}
+
+    std::atomic<int> published{0};
+
+protected:
+    virtual void run() override {
+        for (int i = 0; i < m_count; ++i) {
+            m_channel->publish(QByteArray::number(i));
+            ++published;
+        }
+    }
+
+private:
+    EventStreamChannel *m_channel;
+    int m_count;
+};
+
+class EventStreamController;
+
+class TestEventStream : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestEventStream(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testEncode_data();
+    void testEncode();
+
+    void testController_data();
+    void testController() {
+        doTest();
+    }
+
+    void testEngineBuffered();
+    void testPublishFromThread();
+
+    void cleanupTestCase();
+
+private:
+    TestEngine *m_engine;
+    EventStreamController *m_controller;
+
+    TestEngine* getEngine();
+
+    void doTest();
+};
+
+static EventStreamChannel *liveChannel()
+{
+    static EventStreamChannel channel(0);
+    return &channel;
+}
+
+static const int threadEvents = 2000;
+
+static EventStreamChannel *threadChannel()
+{
+    // Keeps every event alive so their buffers can be compared
+    static EventStreamChannel channel(threadEvents);
+    return &channel;
+}
+
+class EventStreamController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("eventstream")
+public:
+    explicit EventStreamController(QObject *parent) : Controller(parent) {}
+
+    EventStream *lastStream = nullptr;
+
+    C_ATTR(send, :Local :AutoArgs)
+    void send(Context *c) {
+        auto stream = new EventStream(c);
+        stream->setHeartbeat(0);
+        stream->setRetry(3000);
+        stream->send(QByteArrayLiteral("hello\nworld"), QStringLiteral("greeting"), QStringLiteral("1"));
+        stream->sendComment(QByteArrayLiteral("still here"));
+    }
+
+    C_ATTR(history, :Local :AutoArgs)
+    void history(Context *c) {
+        auto stream = new EventStream(c);
+        stream->setHeartbeat(0);
+        EventStreamChannel::channel(QStringLiteral("testeventstream"))->subscribe(stream);
+    }
+
+    C_ATTR(live, :Local :AutoArgs)
+    void live(Context *c) {
+        auto stream = new EventStream(c);
+        stream->setHeartbeat(0);
+        liveChannel()->subscribe(stream);
+        liveChannel()->publish(QByteArrayLiteral("live data"), QStringLiteral("update"));
+        // Delivery is queued to the thread of the stream
+        QCoreApplication::sendPostedEvents(stream, QEvent::MetaCall);
+    }
+
+    C_ATTR(slow, :Local :AutoArgs)
+    void slow(Context *c) {
+        auto stream = new EventStream(c);
+        stream->setHeartbeat(0);
+        stream->setMaxPendingBytes(64);
+        liveChannel()->subscribe(stream);
+        liveChannel()->publish(QByteArray(100, 'x'));
+        QCoreApplication::sendPostedEvents(stream, QEvent::MetaCall);
+        QVERIFY(stream->isClosed());
+        QCOMPARE(liveChannel()->subscribers(), 0);
+    }
+
+    C_ATTR(buffered, :Local :AutoArgs)
+    void buffered(Context *c) {
+        auto stream = new EventStream(c);
+        stream->setHeartbeat(0);
+        stream->setMaxPendingBytes(64);
+        EventStreamChannel::channel(QStringLiteral("testeventstream-buffered"))->subscribe(stream);
+        lastStream = stream;
+    }
+
+    C_ATTR(thread, :Local :AutoArgs)
+    void thread(Context *c) {
+        auto stream = new EventStream(c);
+        stream->setHeartbeat(0);
+        threadChannel()->subscribe(stream);
+        lastStream = stream;
+    }
+};
+
+void TestEventStream::initTestCase()
+{
+    m_engine = getEngine();
+    QVERIFY(m_engine);
+
+    EventStreamChannel *channel = EventStreamChannel::channel(QStringLiteral("testeventstream"));
+    QCOMPARE(channel->publish(QByteArrayLiteral("a")), QStringLiteral("1"));
+    QCOMPARE(channel->publish(QByteArrayLiteral("b")), QStringLiteral("2"));
+    QCOMPARE(channel->publish(QByteArrayLiteral("c"), QStringLiteral("letter"), QStringLiteral("three")), QStringLiteral("three"));
+}
+
+TestEngine* TestEventStream::getEngine()
+{
+    auto app = new TestApplication;
+    auto engine = new TestEngine(app, QVariantMap());
+    m_controller = new EventStreamController(app);
+    if (!engine->init()) {
+        return nullptr;
+    }
+    return engine;
+}
+
+void TestEventStream::cleanupTestCase()
+{
+    delete m_engine;
+}
+
+void TestEventStream::testEncode_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("event");
+    QTest::addColumn<QString>("id");
+    QTest::addColumn<QByteArray>("output");
+
+    QTest::newRow("encode-test00") << QByteArrayLiteral("foo") << QString() << QString() << QByteArrayLiteral("data: foo\n\n");
+    QTest::newRow("encode-test01") << QByteArray() << QString() << QString() << QByteArrayLiteral("data: \n\n");
+    QTest::newRow("encode-test02") << QByteArrayLiteral("foo\nbar") << QStringLiteral("ev") << QStringLiteral("7")
+                                   << QByteArrayLiteral("id: 7\nevent: ev\ndata: foo\ndata: bar\n\n");
+    QTest::newRow("encode-test03") << QByteArrayLiteral("a\r\nb\rc\n") << QString() << QString()
+                                   << QByteArrayLiteral("data: a\ndata: b\ndata: c\ndata: \n\n");
+    QTest::newRow("encode-test04") << QByteArrayLiteral("foo") << QStringLiteral("e\nv") << QStringLiteral("1\r\n2")
+                                   << QByteArrayLiteral("id: 12\nevent: ev\ndata: foo\n\n");
+    QTest::newRow("encode-test05") << QByteArrayLiteral("foo") << QString() << QStringLiteral("")
+                                   << QByteArrayLiteral("id: \ndata: foo\n\n");
+}
+
+void TestEventStream::testEncode()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, event);
+    QFETCH(QString, id);
+    QFETCH(QByteArray, output);
+
+    QCOMPARE(EventStream::encode(data, event, id), output);
+}
+
+void TestEventStream::doTest()
+{
+    QFETCH(QString, url);
+    QFETCH(Headers, headers);
+    QFETCH(QByteArray, output);
+
+    QUrl urlAux(url.mid(1));
+
+    QVariantMap result = m_engine->createRequest(QStringLiteral("GET"),
+                                                 urlAux.path(),
+                                                 urlAux.query(QUrl::FullyEncoded).toLatin1(),
+                                                 headers,
+                                                 nullptr);
+
+    const Headers responseHeaders = result.value(QStringLiteral("headers")).value<Headers>();
+    QCOMPARE(result.value(QStringLiteral("statusCode")).toInt(), 200);
+    QCOMPARE(responseHeaders.contentType(), QStringLiteral("text/event-stream"));
+    QCOMPARE(responseHeaders.header(QStringLiteral("Cache-Control")), QStringLiteral("no-cache"));
+    QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), output);
+}
+
+void TestEventStream::testController_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<Headers>("headers");
+    QTest::addColumn<QByteArray>("output");
+
+    Headers headers;
+
+    QTest::newRow("eventstream-test00") << QStringLiteral("/eventstream/send") << headers
+                                        << QByteArrayLiteral(":\n\nretry: 3000\n\nid: 1\nevent: greeting\ndata: hello\ndata: world\n\n: still here\n\n");
+
+    // History replay with Last-Event-ID
+    QTest::newRow("eventstream-test01") << QStringLiteral("/eventstream/history") << headers
+                                        << QByteArrayLiteral(":\n\n");
+    headers.setHeader(QStringLiteral("Last-Event-ID"), QStringLiteral("2"));
+    QTest::newRow("eventstream-test02") << QStringLiteral("/eventstream/history") << headers
+                                        << QByteArrayLiteral(":\n\nid: three\nevent: letter\ndata: c\n\n");
+    headers.setHeader(QStringLiteral("Last-Event-ID"), QStringLiteral("1"));
+    QTest::newRow("eventstream-test03") << QStringLiteral("/eventstream/history") << headers
+                                        << QByteArrayLiteral(":\n\nid: 2\ndata: b\n\nid: three\nevent: letter\ndata: c\n\n");
+    headers.setHeader(QStringLiteral("Last-Event-ID"), QStringLiteral("three"));
+    QTest::newRow("eventstream-test04") << QStringLiteral("/eventstream/history") << headers
+                                        << QByteArrayLiteral(":\n\n");
+    // Unknown ids get all the kept events
+    headers.setHeader(QStringLiteral("Last-Event-ID"), QStringLiteral("unknown"));
+    QTest::newRow("eventstream-test05") << QStringLiteral("/eventstream/history") << headers
+                                        << QByteArrayLiteral(":\n\nid: 1\ndata: a\n\nid: 2\ndata: b\n\nid: three\nevent: letter\ndata: c\n\n");
+
+    headers = Headers();
+    QTest::newRow("eventstream-test06") << QStringLiteral("/eventstream/live") << headers
+                                        << QByteArrayLiteral(":\n\nid: 1\nevent: update\ndata: live data\n\n");
+
+    // The event doesn't fit in the pending bytes, so the stream is closed
+    QTest::newRow("eventstream-test07") << QStringLiteral("/eventstream/slow") << headers
+                                        << QByteArrayLiteral(":\n\n");
+}
+
+void TestEventStream::testEngineBuffered()
+{
+    EventStreamChannel *channel = EventStreamChannel::channel(QStringLiteral("testeventstream-buffered"));
+
+    BufferedRequest request(QStringLiteral("eventstream/buffered"));
+    m_engine->processRequest(&request);
+    EventStream *stream = m_controller->lastStream;
+    QVERIFY(stream);
+    QCOMPARE(request.output, QByteArrayLiteral(":\n\n"));
+
+    // The event fits in the pending bytes, but not together with what the
+    // engine didn't send since the last write
+    request.buffered = 50;
+    channel->publish(QByteArray(20, 'x'));
+    QCoreApplication::sendPostedEvents(stream, QEvent::MetaCall);
+    QVERIFY(stream->isClosed());
+    QCOMPARE(channel->subscribers(), 0);
+    QCOMPARE(request.output, QByteArrayLiteral(":\n\n"));
+
+    QTRY_VERIFY(request.finished);
+}
+
+void TestEventStream::testPublishFromThread()
+{
+    EventStreamChannel *channel = threadChannel();
+
+    BufferedRequest first(QStringLiteral("eventstream/thread"));
+    m_engine->processRequest(&first);
+    BufferedRequest second(QStringLiteral("eventstream/thread"));
+    m_engine->processRequest(&second);
+    BufferedRequest doomed(QStringLiteral("eventstream/thread"));
+    m_engine->processRequest(&doomed);
+    EventStream *doomedStream = m_controller->lastStream;
+    QCOMPARE(channel->subscribers(), 3);
+
+    PublishThread thread(channel, threadEvents);
+    thread.start();
+
+    // Deleted while the other thread is still queueing events to it
+    QTRY_VERIFY(thread.published > 0);
+    delete doomedStream;
+    QVERIFY(thread.wait());
+    QCOMPARE(channel->subscribers(), 2);
+
+    QByteArray expected(":\n\n");
+    for (int i = 0; i < threadEvents; ++i) {
+        expected.append(EventStream::encode(QByteArray::number(i), QString(), QString::number(i + 1)));
+    }
+    QTRY_COMPARE(first.output, expected);
+    QTRY_COMPARE(second.output, expected);
+
+    // Every stream wrote the very same buffer for each event
+    QCOMPARE(first.writes.size(), threadEvents + 1);
+    QCOMPARE(second.writes.size(), threadEvents + 1);
+    for (int i = 1; i <= threadEvents; ++i) {
+        QVERIFY(first.writes[i] == second.writes[i]);
+    }
+    QVERIFY(first.writes[1] != first.writes[2]);
+}
+
+QTEST_MAIN(TestEventStream)
+
+#include "testeventstream.moc"
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef EXPECTCONTINUETEST_H
+#define EXPECTCONTINUETEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QBuffer>
+#include <QtNetwork/QNetworkCookie>
+
+#include "coverageobject.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/enginerequest.h>
+#include <Cutelyst/Plugins/CSRFProtection/CSRFProtection>
+
+using namespace Cutelyst;
+
+/**
+ * Behaves like an engine that got "Expect: 100-continue",
+ * the body is only sent after continueBody() was called
+ */
+class ContinueRequest : public EngineRequest
+{
+public:
+    ContinueRequest(const QString &path, const Headers &requestHeaders)
+    {
+        method = QStringLiteral("POST");
+        setPath(path);
+        protocol = QStringLiteral("HTTP/1.1");
+        serverAddress = QStringLiteral("127.0.0.1");
+        remoteAddress = QHostAddress(QStringLiteral("127.0.0.1"));
+        headers = requestHeaders;
+        headers.setContentType(QStringLiteral("application/x-www-form-urlencoded"));
+        auto buffer = new QBuffer;
+        buffer->open(QIODevice::ReadWrite);
+        body = buffer;
+        status |= EngineRequest::ExpectContinue;
+        elapsed.start();
+    }
+
+    void sendBody(const QByteArray &data) {
+        body->write(data);
+        body->seek(0);
+        Q_EMIT body->readChannelFinished();
+    }
+
+    QByteArray output;
+    quint16 statusCode = 0;
+    int continued = 0;
+    bool finished = false;
+
+protected:
+    virtual qint64 doWrite(const char *data, qint64 len) override final {
+        output.append(data, int(len));
+        return len;
+    }
+
+    virtual bool writeHeaders(quint16 status, const Headers &headers) override final {
+        Q_UNUSED(headers)
+        statusCode = status;
+        return true;
+    }
+
+    virtual void continueBody() override final {
+        ++continued;
+    }
+
+    virtual void processingFinished() override final {
+        finished = true;
+    }
+};
+
+class ContinueController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("expect")
+public:
+    explicit ContinueController(QObject *parent) : Controller(parent) {}
+
+    QStringList seen;
+
+    C_ATTR(token, :Local :AutoArgs)
+    void token(Context *c) {
+        c->response()->setBody(CSRFProtection::getToken(c));
+    }
+
+    C_ATTR(form, :Local :AutoArgs)
+    void form(Context *c) {
+        seen.append(QLatin1String("form:") + c->request()->bodyParam(QStringLiteral("name")));
+        c->response()->setBody(QByteArrayLiteral("allowed"));
+    }
+
+    C_ATTR(early, :Local :AutoArgs :ExpectContinue)
+    void early(Context *c) {
+        seen.append(QLatin1String("early:") + c->request()->bodyParam(QStringLiteral("name")));
+        c->response()->setBody(QByteArrayLiteral("allowed"));
+    }
+
+private:
+    C_ATTR(Begin,)
+    bool Begin(Context *c) {
+        seen.append(QLatin1String("Begin:") + c->request()->bodyParam(QStringLiteral("name")));
+        return true;
+    }
+
+    C_ATTR(Auto,)
+    bool Auto(Context *c) {
+        seen.append(QLatin1String("Auto:") + c->request()->bodyParam(QStringLiteral("name")));
+        if (!c->request()->header(QStringLiteral("X-Reject")).isEmpty()) {
+            c->response()->setStatus(Response::Forbidden);
+            return false;
+        }
+        return true;
+    }
+};
+
+class TestExpectContinue : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestExpectContinue(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testDeferredDispatch();
+    void testEarlyDispatch();
+    void testEarlyReject();
+
+    void cleanupTestCase();
+
+private:
+    TestEngine *m_engine = nullptr;
+    ContinueController *m_controller = nullptr;
+    Headers m_headers;
+    QByteArray m_token;
+    const QString m_cookieName = QStringLiteral("xsrftoken");
+    const QString m_fieldName = QStringLiteral("xsrfprotect");
+    const QString m_headerName = QStringLiteral("X-MY-CSRF");
+};
+
+void TestExpectContinue::initTestCase()
+{
+    auto app = new TestApplication;
+    m_engine = new TestEngine(app, QVariantMap());
+    auto csrf = new CSRFProtection(app);
+    csrf->setCookieName(m_cookieName);
+    csrf->setGenericErrorMessage(QStringLiteral("denied"));
+    csrf->setFormFieldName(m_fieldName);
+    csrf->setHeaderName(m_headerName);
+    m_controller = new ContinueController(app);
+    QVERIFY(m_engine->init());
+
+    QVariantMap result = m_engine->createRequest(QStringLiteral("GET"), QStringLiteral("expect/token"), QByteArray(), Headers(), nullptr);
+    const QList<QNetworkCookie> cookies = QNetworkCookie::parseCookies(result.value(QStringLiteral("headers")).value<Headers>().header(QStringLiteral("Set-Cookie")).toLatin1());
+    QNetworkCookie cookie;
+    for (const QNetworkCookie &c : cookies) {
+        if (c.name() == m_cookieName.toLatin1()) {
+            cookie = c;
+            break;
+        }
+    }
+    QVERIFY(!cookie.value().isEmpty());
+    m_headers.setHeader(QStringLiteral("Cookie"), QString::fromLatin1(cookie.toRawForm(QNetworkCookie::NameAndValueOnly)));
+
+    result = m_engine->createRequest(QStringLiteral("GET"), QStringLiteral("expect/token"), QByteArray(), m_headers, nullptr);
+    m_token = result.value(QStringLiteral("body")).toByteArray();
+    QVERIFY(!m_token.isEmpty());
+}
+
+void TestExpectContinue::testDeferredDispatch()
+{
+    m_controller->seen.clear();
+
+    ContinueRequest request(QStringLiteral("expect/form"), m_headers);
+
+    // Nothing is dispatched until the body is received
+    m_engine->processRequest(&request);
+    QCOMPARE(request.continued, 1);
+    QVERIFY(!(request.status & EngineRequest::ExpectContinue));
+    QVERIFY(m_controller->seen.isEmpty());
+    QVERIFY(!request.finished);
+
+    // CSRFProtection, Begin and Auto see the token and params in the body
+    request.sendBody(m_fieldName.toLatin1() + '=' + m_token + QByteArrayLiteral("&name=foo"));
+    QVERIFY(request.finished);
+    QCOMPARE(request.statusCode, quint16(200));
+    QCOMPARE(request.output, QByteArrayLiteral("allowed"));
+    QCOMPARE(m_controller->seen, QStringList({ QStringLiteral("Begin:foo"), QStringLiteral("Auto:foo"), QStringLiteral("form:foo") }));
+}
+
+void TestExpectContinue::testEarlyDispatch()
+{
+    m_controller->seen.clear();
+
+    // The body isn't there for CSRFProtection, the token goes in a header
+    Headers headers = m_headers;
+    headers.setHeader(m_headerName, QString::fromLatin1(m_token));
+    ContinueRequest request(QStringLiteral("expect/early"), headers);
+
+    m_engine->processRequest(&request);
+    QCOMPARE(request.continued, 1);
+    QCOMPARE(m_controller->seen, QStringList({ QStringLiteral("Begin:"), QStringLiteral("Auto:") }));
+    QVERIFY(!request.finished);
+
+    // What Begin and Auto parsed from the empty body is parsed again
+    request.sendBody(QByteArrayLiteral("name=bar"));
+    QVERIFY(request.finished);
+    QCOMPARE(request.statusCode, quint16(200));
+    QCOMPARE(request.output, QByteArrayLiteral("allowed"));
+    QCOMPARE(m_controller->seen, QStringList({ QStringLiteral("Begin:"), QStringLiteral("Auto:"), QStringLiteral("early:bar") }));
+}
+
+void TestExpectContinue::testEarlyReject()
+{
+    m_controller->seen.clear();
+
+    Headers headers = m_headers;
+    headers.setHeader(m_headerName, QString::fromLatin1(m_token));
+    headers.setHeader(QStringLiteral("X-Reject"), QStringLiteral("1"));
+    ContinueRequest request(QStringLiteral("expect/early"), headers);
+
+    // Auto refuses the request before the client sends the body
+    m_engine->processRequest(&request);
+    QCOMPARE(request.continued, 0);
+    QVERIFY(request.finished);
+    QCOMPARE(request.statusCode, quint16(403));
+    QCOMPARE(m_controller->seen, QStringList({ QStringLiteral("Begin:"), QStringLiteral("Auto:") }));
+}
+
+void TestExpectContinue::cleanupTestCase()
+{
+    delete m_engine;
+}
+
+QTEST_MAIN(TestExpectContinue)
+
+#include "testexpectcontinue.moc"
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef LOADSHEDDINGTEST_H
+#define LOADSHEDDINGTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+
+#include "headers.h"
+#include "coverageobject.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/headers.h>
+#include <Cutelyst/Plugins/LoadShedding/LoadShedding>
+
+using namespace Cutelyst;
+
+// Time only moves when the test says so
+class FakeClockLoadShedding : public LoadShedding
+{
+public:
+    explicit FakeClockLoadShedding(Application *parent) : LoadShedding(parent) {}
+
+    qint64 clock = 0;
+
+protected:
+    virtual qint64 now() const override {
+        return clock;
+    }
+
+    // How long the request waited comes from its "queued" query parameter
+    virtual qint64 queueTime(Context *c) const override {
+        return c->request()->queryParam(QStringLiteral("queued")).toLongLong();
+    }
+};
+
+class TestLoadShedding : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestLoadShedding(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testController_data();
+    void testController() {
+        doTest();
+    }
+
+    void testStats();
+
+    void cleanupTestCase();
+
+private:
+    TestEngine *m_engine;
+    FakeClockLoadShedding *m_loadShedding;
+
+    TestEngine* getEngine();
+
+    void doTest();
+};
+
+class LoadSheddingController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("loadshedding")
+public:
+    explicit LoadSheddingController(QObject *parent) : Controller(parent) {}
+
+    FakeClockLoadShedding *loadShedding = nullptr;
+
+    // Makes a second request to itself while the first one is in flight
+    C_ATTR(single, :Local :MaxInFlight(1) :AutoArgs)
+    void single(Context *c) {
+        if (!c->request()->queryParam(QStringLiteral("inner")).isEmpty()) {
+            c->response()->setBody(QByteArrayLiteral("Ok."));
+            return;
+        }
+
+        auto engine = static_cast<TestEngine *>(c->engine());
+        const QVariantMap inner = engine->createRequest(QStringLiteral("GET"),
+                                                        QStringLiteral("/loadshedding/single"),
+                                                        QByteArrayLiteral("inner=1"),
+                                                        Headers(),
+                                                        nullptr);
+        c->response()->setBody(QByteArrayLiteral("Inner ") + QByteArray::number(inner.value(QStringLiteral("statusCode")).toInt()));
+    }
+
+    C_ATTR(deadline, :Local :QueueDeadline(2) :AutoArgs)
+    void deadline(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+
+    C_ATTR(slow, :Local :TargetLatency(1) :AutoArgs)
+    void slow(Context *c) {
+        loadShedding->clock += 20 * 1000000;
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+
+    C_ATTR(unlimited, :Local :AutoArgs)
+    void unlimited(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+};
+
+void TestLoadShedding::initTestCase()
+{
+    m_engine = getEngine();
+    QVERIFY(m_engine);
+}
+
+TestEngine* TestLoadShedding::getEngine()
+{
+    auto app = new TestApplication;
+    auto engine = new TestEngine(app, QVariantMap());
+    auto controller = new LoadSheddingController(app);
+    m_loadShedding = new FakeClockLoadShedding(app);
+    m_loadShedding->setRetryAfter(5);
+    controller->loadShedding = m_loadShedding;
+    if (!engine->init()) {
+        return nullptr;
+    }
+    return engine;
+}
+
+void TestLoadShedding::cleanupTestCase()
+{
+    delete m_engine;
+}
+
+void TestLoadShedding::doTest()
+{
+    QFETCH(QString, url);
+    QFETCH(int, status);
+    QFETCH(QString, retryAfter);
+    QFETCH(QByteArray, output);
+
+    QUrl urlAux(url.mid(1));
+
+    QVariantMap result = m_engine->createRequest(QStringLiteral("GET"),
+                                                 urlAux.path(),
+                                                 urlAux.query(QUrl::FullyEncoded).toLatin1(),
+                                                 Headers(),
+                                                 nullptr);
+
+    QCOMPARE(result.value(QStringLiteral("statusCode")).toInt(), status);
+    QCOMPARE(result.value(QStringLiteral("headers")).value<Headers>().header(QStringLiteral("Retry-After")), retryAfter);
+    QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), output);
+}
+
+void TestLoadShedding::testController_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<int>("status");
+    QTest::addColumn<QString>("retryAfter");
+    QTest::addColumn<QByteArray>("output");
+
+    // Rows share the same counters so their order matters
+    const QByteArray ok = QByteArrayLiteral("Ok.");
+    const QByteArray unavailable = QByteArrayLiteral("Service Unavailable");
+
+    QTest::newRow("loadshedding-test00") << QStringLiteral("/loadshedding/single?inner=1") << 200 << QString() << ok;
+    QTest::newRow("loadshedding-test01") << QStringLiteral("/loadshedding/single") << 200 << QString() << QByteArrayLiteral("Inner 503");
+    QTest::newRow("loadshedding-test02") << QStringLiteral("/loadshedding/single?inner=1") << 200 << QString() << ok;
+
+    QTest::newRow("loadshedding-test03") << QStringLiteral("/loadshedding/deadline?queued=2") << 200 << QString() << ok;
+    QTest::newRow("loadshedding-test04") << QStringLiteral("/loadshedding/deadline?queued=3") << 503 << QStringLiteral("5") << unavailable;
+    QTest::newRow("loadshedding-test05") << QStringLiteral("/loadshedding/unlimited?queued=3") << 200 << QString() << ok;
+
+    // Each request takes 20ms, the first one sets the average latency way
+    // above the target, 19/20 of the requests after it are refused
+    QTest::newRow("loadshedding-test06") << QStringLiteral("/loadshedding/slow") << 200 << QString() << ok;
+    QTest::newRow("loadshedding-test07") << QStringLiteral("/loadshedding/slow") << 200 << QString() << ok;
+    QTest::newRow("loadshedding-test08") << QStringLiteral("/loadshedding/slow") << 503 << QStringLiteral("5") << unavailable;
+}
+
+void TestLoadShedding::testStats()
+{
+    const QVariantMap stats = m_loadShedding->stats();
+    QVERIFY(!stats.contains(QStringLiteral("loadshedding/unlimited")));
+
+    const QVariantMap single = stats.value(QStringLiteral("loadshedding/single")).toMap();
+    QCOMPARE(single.value(QStringLiteral("in_flight")).toInt(), 0);
+    QCOMPARE(single.value(QStringLiteral("accepted")).toULongLong(), Q_UINT64_C(3));
+    QCOMPARE(single.value(QStringLiteral("rejected_in_flight")).toULongLong(), Q_UINT64_C(1));
+
+    const QVariantMap deadline = stats.value(QStringLiteral("loadshedding/deadline")).toMap();
+    QCOMPARE(deadline.value(QStringLiteral("accepted")).toULongLong(), Q_UINT64_C(1));
+    QCOMPARE(deadline.value(QStringLiteral("rejected_deadline")).toULongLong(), Q_UINT64_C(1));
+
+    const QVariantMap slow = stats.value(QStringLiteral("loadshedding/slow")).toMap();
+    QCOMPARE(slow.value(QStringLiteral("accepted")).toULongLong(), Q_UINT64_C(2));
+    QCOMPARE(slow.value(QStringLiteral("rejected_latency")).toULongLong(), Q_UINT64_C(1));
+    QCOMPARE(slow.value(QStringLiteral("latency_ms")).toDouble(), 20.0);
+}
+
+QTEST_MAIN(TestLoadShedding)
+
+#include "testloadshedding.moc"
+
+#endif
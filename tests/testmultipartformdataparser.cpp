@@ -0,0 +1,158 @@
+#ifndef MULTIPARTFORMDATAPARSERTEST_H
+#define MULTIPARTFORMDATAPARSERTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QBuffer>
+#include <QtCore/QTemporaryFile>
+
+#include <Cutelyst/multipartformdataparser.h>
+#include "coverageobject.h"
+
+using namespace Cutelyst;
+
+class TestMultiPartFormDataParser : public CoverageObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testParse_data();
+    void testParse();
+
+    void benchmarkParse_data();
+    void benchmarkParse();
+
+private:
+    static QByteArray part(const QByteArray &boundary, const QByteArray &name, const QByteArray &data);
+};
+
+static const QByteArray boundary = QByteArrayLiteral("----WebKitFormBoundaryoPPQLwBBssFnOTVH");
+
+QByteArray TestMultiPartFormDataParser::part(const QByteArray &boundary, const QByteArray &name, const QByteArray &data)
+{
+    return "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"" + name + "\"\r\n"
+            "Content-Type:text/plain  \r\n"
+            "\r\n" + data + "\r\n";
+}
+
+void TestMultiPartFormDataParser::testParse_data()
+{
+    QTest::addColumn<int>("bufferSize");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<QByteArrayList>("names");
+    QTest::addColumn<QByteArrayList>("contents");
+
+    const QByteArray almostBoundary = "--" + boundary.left(boundary.size() - 1) + "X";
+    const QByteArray large(5000, 'a');
+
+    const QList<int> bufferSizes = { 1024, 4096 };
+    for (int bufferSize : bufferSizes) {
+        const QByteArray suffix = "-" + QByteArray::number(bufferSize);
+
+        QTest::newRow("single" + suffix) << bufferSize
+                                         << part(boundary, "foo", "bar") + "--" + boundary + "--\r\n"
+                                         << QByteArrayList{ "foo" }
+                                         << QByteArrayList{ "bar" };
+
+        QTest::newRow("empty" + suffix) << bufferSize
+                                        << part(boundary, "foo", QByteArray()) + "--" + boundary + "--\r\n"
+                                        << QByteArrayList{ "foo" }
+                                        << QByteArrayList{ QByteArray() };
+
+        QTest::newRow("almost-boundary" + suffix) << bufferSize
+                                                  << part(boundary, "foo", "a\r\n" + almostBoundary + "\r\n--")
+                                                     + part(boundary, "bar", "----")
+                                                     + "--" + boundary + "--\r\n"
+                                                  << QByteArrayList{ "foo", "bar" }
+                                                  << QByteArrayList{ "a\r\n" + almostBoundary + "\r\n--", "----" };
+
+        QTest::newRow("across-buffers" + suffix) << bufferSize
+                                                 << part(boundary, "foo", large)
+                                                    + part(boundary, "bar", large + "b")
+                                                    + part(boundary, "baz", "c")
+                                                    + "--" + boundary + "--\r\n"
+                                                 << QByteArrayList{ "foo", "bar", "baz" }
+                                                 << QByteArrayList{ large, large + "b", "c" };
+    }
+}
+
+void TestMultiPartFormDataParser::testParse()
+{
+    QFETCH(int, bufferSize);
+    QFETCH(QByteArray, body);
+    QFETCH(QByteArrayList, names);
+    QFETCH(QByteArrayList, contents);
+
+    QBuffer buffer(&body);
+    buffer.open(QBuffer::ReadOnly);
+
+    const Uploads uploads = MultiPartFormDataParser::parse(&buffer,
+                                                           QLatin1String("multipart/form-data; boundary=") + QString::fromLatin1(boundary),
+                                                           bufferSize);
+    QCOMPARE(uploads.size(), names.size());
+    for (int i = 0; i < uploads.size(); ++i) {
+        Upload *upload = uploads.at(i);
+        QCOMPARE(upload->name().toLatin1(), names.at(i));
+        QCOMPARE(upload->contentType(), QStringLiteral("text/plain"));
+        upload->open(QIODevice::ReadOnly);
+        QCOMPARE(upload->readAll(), contents.at(i));
+    }
+    qDeleteAll(uploads);
+}
+
+void TestMultiPartFormDataParser::benchmarkParse_data()
+{
+    QTest::addColumn<qint64>("size");
+
+    QTest::newRow("1KiB") << qint64(1024);
+    QTest::newRow("64KiB") << qint64(64 * 1024);
+    QTest::newRow("1MiB") << qint64(1024 * 1024);
+    QTest::newRow("64MiB") << qint64(64 * 1024 * 1024);
+    QTest::newRow("1GiB") << qint64(1024 * 1024 * 1024);
+}
+
+void TestMultiPartFormDataParser::benchmarkParse()
+{
+    QFETCH(qint64, size);
+
+    if (size >= 64 * 1024 * 1024 && qEnvironmentVariableIsEmpty("CUTELYST_BENCHMARK_LARGE")) {
+        QSKIP("Set CUTELYST_BENCHMARK_LARGE to run with large parts");
+    }
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write("--" + boundary + "\r\n"
+               "Content-Disposition: form-data; name=\"file\"; filename=\"file.bin\"\r\n"
+               "Content-Type: application/octet-stream\r\n"
+               "\r\n");
+
+    // Text with dashes and line breaks is the worst case for the boundary search
+    QByteArray chunk;
+    chunk.reserve(64 * 1024);
+    while (chunk.size() < 64 * 1024) {
+        chunk.append("--- lorem ipsum dolor sit amet\r\n");
+    }
+    qint64 written = 0;
+    while (written < size) {
+        const qint64 len = qMin(qint64(chunk.size()), size - written);
+        file.write(chunk.constData(), len);
+        written += len;
+    }
+    file.write("\r\n--" + boundary + "--\r\n");
+    QVERIFY(file.flush());
+
+    const QString contentType = QLatin1String("multipart/form-data; boundary=") + QString::fromLatin1(boundary);
+    QBENCHMARK {
+        file.seek(0);
+        const Uploads uploads = MultiPartFormDataParser::parse(&file, contentType, 64 * 1024);
+        QCOMPARE(uploads.size(), 1);
+        QCOMPARE(uploads.first()->size(), size);
+        qDeleteAll(uploads);
+    }
+}
+
+QTEST_MAIN(TestMultiPartFormDataParser)
+
+#include "testmultipartformdataparser.moc"
+
+#endif
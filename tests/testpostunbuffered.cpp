@@ -0,0 +1,249 @@
+#ifndef POSTUNBUFFEREDTEST_H
+#define POSTUNBUFFEREDTEST_H
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <QtCore/QObject>
+
+#include "coverageobject.h"
+#include "postunbuffered.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/enginerequest.h>
+
+using namespace Cutelyst;
+using namespace CWSGI;
+
+class StreamRequest : public EngineRequest
+{
+public:
+    StreamRequest(const QString &path, PostUnbuffered *body)
+    {
+        method = QStringLiteral("POST");
+        setPath(path);
+        protocol = QStringLiteral("HTTP/1.1");
+        serverAddress = QStringLiteral("127.0.0.1");
+        remoteAddress = QHostAddress(QStringLiteral("127.0.0.1"));
+        headers.setContentLength(body->size());
+        this->body = body;
+        // Dispatched right after the headers, like cutelyst-wsgi does with post buffering set to 0
+        status |= EngineRequest::BodyStreaming;
+        elapsed.start();
+    }
+
+    QByteArray output;
+    quint16 statusCode = 0;
+    bool finished = false;
+
+protected:
+    virtual qint64 doWrite(const char *data, qint64 len) override final {
+        output.append(data, int(len));
+        return len;
+    }
+
+    virtual bool writeHeaders(quint16 status, const Headers &headers) override final {
+        Q_UNUSED(headers)
+        statusCode = status;
+        return true;
+    }
+
+    virtual void processingFinished() override final {
+        finished = true;
+    }
+};
+
+class StreamController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("stream")
+public:
+    explicit StreamController(QObject *parent) : Controller(parent) {}
+
+    int dispatched = 0;
+
+    C_ATTR(streaming, :Local :AutoArgs :StreamingBody)
+    void streaming(Context *c) {
+        ++dispatched;
+        QIODevice *body = c->request()->body();
+        auto read = [c, body] {
+            c->response()->body().append(body->readAll());
+        };
+        read();
+
+        c->detachAsync();
+        connect(body, &QIODevice::readyRead, c, read);
+        connect(body, &QIODevice::readChannelFinished, c, [c, read] {
+            read();
+            c->attachAsync();
+        });
+    }
+
+    C_ATTR(buffered, :Local :AutoArgs)
+    void buffered(Context *c) {
+        ++dispatched;
+        c->response()->setBody(c->request()->body()->readAll());
+    }
+};
+
+class TestPostUnbuffered : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestPostUnbuffered(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testStreamingDispatch();
+    void testDeferredDispatch();
+    void testBackpressure();
+    void testComplete();
+    void testAbort();
+
+    void cleanupTestCase();
+
+private:
+    TestEngine *m_engine = nullptr;
+    StreamController *m_controller = nullptr;
+};
+
+void TestPostUnbuffered::initTestCase()
+{
+    auto app = new TestApplication;
+    m_engine = new TestEngine(app, QVariantMap());
+    m_controller = new StreamController(app);
+    QVERIFY(m_engine->init());
+}
+
+void TestPostUnbuffered::testStreamingDispatch()
+{
+    m_controller->dispatched = 0;
+
+    auto body = new PostUnbuffered(10);
+    body->append("0123", 4);
+    StreamRequest request(QStringLiteral("stream/streaming"), body);
+
+    // Runs before the body is complete and sees what arrived so far
+    m_engine->processRequest(&request);
+    QCOMPARE(m_controller->dispatched, 1);
+    QVERIFY(request.status & EngineRequest::BodyStreaming);
+    QVERIFY(!request.finished);
+
+    body->append("456", 3);
+    QVERIFY(!request.finished);
+
+    body->append("789", 3);
+    QVERIFY(request.finished);
+    QCOMPARE(request.statusCode, quint16(200));
+    QCOMPARE(request.output, QByteArrayLiteral("0123456789"));
+}
+
+void TestPostUnbuffered::testDeferredDispatch()
+{
+    m_controller->dispatched = 0;
+
+    auto body = new PostUnbuffered(10);
+    body->append("0123", 4);
+    StreamRequest request(QStringLiteral("stream/buffered"), body);
+
+    // Actions without :StreamingBody wait for the whole body
+    m_engine->processRequest(&request);
+    QCOMPARE(m_controller->dispatched, 0);
+    QVERIFY(!(request.status & EngineRequest::BodyStreaming));
+    QVERIFY(!request.finished);
+
+    body->append("456789", 6);
+    QCOMPARE(m_controller->dispatched, 1);
+    QVERIFY(request.finished);
+    QCOMPARE(request.output, QByteArrayLiteral("0123456789"));
+}
+
+void TestPostUnbuffered::testBackpressure()
+{
+    const qint64 highWaterMark = PostUnbuffered::HighWaterMark;
+    PostUnbuffered body(highWaterMark * 2);
+    body.discardConsumed = true;
+    QSignalSpy drained(&body, &PostUnbuffered::drained);
+
+    const QByteArray data(int(highWaterMark / 2), 'x');
+    body.append(data.constData(), data.size());
+    QVERIFY(!body.pause());
+
+    body.append(data.constData(), data.size());
+    QCOMPARE(body.bytesAvailable(), highWaterMark);
+    QVERIFY(body.pause());
+
+    // Reading resumes once less than half of the high water mark is unread
+    QCOMPARE(body.read(highWaterMark / 4).size(), int(highWaterMark / 4));
+    QCOMPARE(drained.count(), 0);
+    QCOMPARE(body.read(highWaterMark / 4).size(), int(highWaterMark / 4));
+    QCOMPARE(drained.count(), 0);
+    QCOMPARE(body.read(1).size(), 1);
+    QCOMPARE(drained.count(), 1);
+    QVERIFY(!body.pause());
+
+    // Consumed data was dropped
+    QVERIFY(!body.seek(0));
+    QCOMPARE(body.remaining(), highWaterMark);
+}
+
+void TestPostUnbuffered::testComplete()
+{
+    PostUnbuffered body(6);
+    QSignalSpy readyRead(&body, &QIODevice::readyRead);
+    QSignalSpy finished(&body, &QIODevice::readChannelFinished);
+    QSignalSpy aborted(&body, &PostUnbuffered::aborted);
+
+    body.append("abc", 3);
+    QCOMPARE(readyRead.count(), 1);
+    QCOMPARE(finished.count(), 0);
+    QVERIFY(!body.atEnd());
+
+    body.append("def", 3);
+    QCOMPARE(readyRead.count(), 2);
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(aborted.count(), 0);
+    QCOMPARE(body.readAll(), QByteArrayLiteral("abcdef"));
+    QVERIFY(body.atEnd());
+
+    // Not discarding, so the body can be read again
+    QVERIFY(body.seek(0));
+    QCOMPARE(body.readAll(), QByteArrayLiteral("abcdef"));
+}
+
+void TestPostUnbuffered::testAbort()
+{
+    PostUnbuffered body(10);
+    QSignalSpy readyRead(&body, &QIODevice::readyRead);
+    QSignalSpy finished(&body, &QIODevice::readChannelFinished);
+    QSignalSpy aborted(&body, &PostUnbuffered::aborted);
+
+    body.append("0123", 4);
+    QCOMPARE(body.read(4), QByteArrayLiteral("0123"));
+
+    body.abort();
+
+    // A truncated body must not look complete
+    QCOMPARE(finished.count(), 0);
+    QCOMPARE(aborted.count(), 1);
+    QCOMPARE(readyRead.count(), 2);
+    QVERIFY(body.isAborted());
+    QVERIFY(body.atEnd());
+    QVERIFY(body.pos() < body.size());
+
+    char buf[4];
+    QCOMPARE(body.read(buf, sizeof(buf)), qint64(-1));
+    QVERIFY(!body.errorString().isEmpty());
+}
+
+void TestPostUnbuffered::cleanupTestCase()
+{
+    delete m_engine;
+}
+
+QTEST_MAIN(TestPostUnbuffered)
+
+#include "testpostunbuffered.moc"
+
+#endif
@@ -0,0 +1,576 @@
+#ifndef PROTOCOLHTTPTEST_H
+#define PROTOCOLHTTPTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+#include "coverageobject.h"
+#include "cwsgiengine.h"
+#include "protocolhttp.h"
+#include "protocolhttp2.h"
+#include "socket.h"
+#include "wsgi.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+
+using namespace Cutelyst;
+using namespace CWSGI;
+
+/**
+ * Connection fed from memory, everything written to
+ * it is kept in output
+ */
+class FakeSocket : public QIODevice, public Socket
+{
+    Q_OBJECT
+public:
+    FakeSocket(Protocol *protocol, Engine *engine) : Socket(false, engine)
+    {
+        open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+        serverAddress = QStringLiteral("127.0.0.1");
+        remoteAddress = QHostAddress(QStringLiteral("127.0.0.1"));
+        proto = protocol;
+        protoData = proto->createData(this);
+        protoData->setupNewConnection(this);
+    }
+
+    void receive(const QByteArray &data) {
+        m_input.append(data);
+        proto->parse(this, this);
+    }
+
+    virtual bool isSequential() const override {
+        return true;
+    }
+
+    virtual qint64 bytesAvailable() const override {
+        return m_input.size() + QIODevice::bytesAvailable();
+    }
+
+    virtual void connectionClose() override {
+        closed = true;
+    }
+
+    virtual bool requestFinished() override {
+        --processing;
+        return !closed;
+    }
+
+    virtual bool flush() override {
+        return true;
+    }
+
+    virtual void setReadBufferLimit(qint64 size) override {
+        Q_UNUSED(size)
+    }
+
+    QByteArray output;
+    bool closed = false;
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen) override {
+        const int len = int(qMin(maxlen, qint64(m_input.size())));
+        memcpy(data, m_input.constData(), size_t(len));
+        m_input.remove(0, len);
+        return len;
+    }
+
+    virtual qint64 writeData(const char *data, qint64 len) override {
+        output.append(data, int(len));
+        return len;
+    }
+
+private:
+    QByteArray m_input;
+};
+
+class TestData : public ProtocolData
+{
+public:
+    TestData() : ProtocolData(nullptr, 0) {}
+
+    virtual void setupNewConnection(Socket *sock) override {
+        Q_UNUSED(sock)
+    }
+};
+
+class HttpController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("http")
+public:
+    explicit HttpController(QObject *parent) : Controller(parent) {}
+
+    int dispatched = 0;
+    qint64 liveBytes = 0;
+
+    C_ATTR(header, :Local :AutoArgs)
+    void header(Context *c) {
+        ++dispatched;
+        liveBytes = BufferPool::liveBytes();
+        c->response()->setBody(c->request()->header(QStringLiteral("X-Long")));
+    }
+
+    C_ATTR(body, :Local :AutoArgs)
+    void body(Context *c) {
+        ++dispatched;
+        c->response()->setBody(c->request()->body()->readAll());
+    }
+
+    FakeSocket *windowSocket = nullptr;
+    QByteArray windowUpdate;
+    qint64 blockedBytes = -1;
+
+    C_ATTR(stream, :Local :AutoArgs)
+    void stream(Context *c) {
+        ++dispatched;
+        // Runs from the loop the write waits in once the window is exhausted
+        QTimer::singleShot(0, this, [this, c] {
+            blockedBytes = c->response()->bytesToWrite();
+            windowSocket->receive(windowUpdate);
+        });
+        c->response()->write(QByteArray(70000, 's'));
+    }
+};
+
+struct H2TestFrame
+{
+    quint8 type = 0;
+    quint8 flags = 0;
+    quint32 streamId = 0;
+    QByteArray payload;
+};
+
+class TestProtocolHttp : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestProtocolHttp(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testBufferPool();
+    void testBufferPoolLimit();
+    void testReserveBuffer();
+
+    void testBufferGrowth();
+    void testHeadersAtLimit();
+    void testRejectUriTooLong();
+    void testRejectHeadersTooLarge();
+    void testContinueBody();
+
+    void testH2ContinueBody();
+    void testH2ResetStreams();
+    void testH2StreamedBody();
+
+    void cleanupTestCase();
+
+private:
+    enum {
+        FrameData = 0x0,
+        FrameHeaders = 0x1,
+        FrameRstStream = 0x3,
+        FrameSettings = 0x4,
+        FrameGoaway = 0x7,
+        FrameWindowUpdate = 0x8,
+        FlagEndStream = 0x1,
+        FlagEndHeaders = 0x4
+    };
+
+    static QByteArray headerRequest(const QByteArray &value);
+    static QByteArray h2Frame(quint8 type, quint8 flags, quint32 streamId, const QByteArray &payload = QByteArray());
+    static QByteArray h2Preface();
+    static QByteArray h2Header(const QByteArray &name, const QByteArray &value);
+    static QVector<H2TestFrame> h2Frames(const QByteArray &data, quint8 type);
+
+    WSGI *m_wsgi = nullptr;
+    WSGI *m_wsgiH2 = nullptr;
+    CWsgiEngine *m_engine = nullptr;
+    ProtocolHttp *m_protocol = nullptr;
+    ProtocolHttp2 *m_protocolH2 = nullptr;
+    HttpController *m_controller = nullptr;
+};
+
+QByteArray TestProtocolHttp::headerRequest(const QByteArray &value)
+{
+    return QByteArrayLiteral("GET /http/header HTTP/1.1\r\nX-Long: ") + value + QByteArrayLiteral("\r\n\r\n");
+}
+
+QByteArray TestProtocolHttp::h2Frame(quint8 type, quint8 flags, quint32 streamId, const QByteArray &payload)
+{
+    QByteArray frame;
+    frame.append(char(payload.size() >> 16));
+    frame.append(char(payload.size() >> 8));
+    frame.append(char(payload.size()));
+    frame.append(char(type));
+    frame.append(char(flags));
+    frame.append(char(streamId >> 24));
+    frame.append(char(streamId >> 16));
+    frame.append(char(streamId >> 8));
+    frame.append(char(streamId));
+    return frame + payload;
+}
+
+QByteArray TestProtocolHttp::h2Preface()
+{
+    return QByteArrayLiteral("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n") + h2Frame(FrameSettings, 0, 0);
+}
+
+QByteArray TestProtocolHttp::h2Header(const QByteArray &name, const QByteArray &value)
+{
+    // Literal without indexing, new name, no huffman
+    QByteArray header;
+    header.append(char(0x00));
+    header.append(char(name.size()));
+    header.append(name);
+    header.append(char(value.size()));
+    header.append(value);
+    return header;
+}
+
+QVector<H2TestFrame> TestProtocolHttp::h2Frames(const QByteArray &data, quint8 type)
+{
+    QVector<H2TestFrame> frames;
+    int pos = 0;
+    while (pos + 9 <= data.size()) {
+        auto ptr = reinterpret_cast<const quint8 *>(data.constData() + pos);
+        const int len = (ptr[0] << 16) | (ptr[1] << 8) | ptr[2];
+        if (ptr[3] == type) {
+            H2TestFrame frame;
+            frame.type = ptr[3];
+            frame.flags = ptr[4];
+            frame.streamId = quint32(((ptr[5] & 0x7f) << 24) | (ptr[6] << 16) | (ptr[7] << 8) | ptr[8]);
+            frame.payload = data.mid(pos + 9, len);
+            frames.append(frame);
+        }
+        pos += 9 + len;
+    }
+    return frames;
+}
+
+void TestProtocolHttp::initTestCase()
+{
+    // Keep the event loop QTest already created
+    qputenv("CUTELYST_QT_EVENT_LOOP", "1");
+    m_wsgi = new WSGI(this);
+    QCOMPARE(m_wsgi->bufferSize(), 4096);
+
+    auto app = new TestApplication;
+    m_controller = new HttpController(app);
+    m_engine = new CWsgiEngine(app, 0, QVariantMap(), m_wsgi);
+    QVERIFY(m_engine->init());
+
+    m_protocol = new ProtocolHttp(m_wsgi);
+
+    // HTTP/2 needs room for a whole frame
+    m_wsgiH2 = new WSGI(this);
+    m_wsgiH2->setBufferSize(16393);
+    m_protocolH2 = new ProtocolHttp2(m_wsgiH2);
+}
+
+void TestProtocolHttp::testBufferPool()
+{
+    const qint64 live = BufferPool::liveBytes();
+    const qint64 pooled = BufferPool::pooledBytes();
+
+    char *buffer = BufferPool::acquire(1000);
+    QCOMPARE(BufferPool::liveBytes(), live + 1000);
+
+    BufferPool::release(buffer, 1000);
+    QCOMPARE(BufferPool::liveBytes(), live);
+    QCOMPARE(BufferPool::pooledBytes(), pooled + 1000);
+
+    // Buffers are only reused for the same size
+    char *other = BufferPool::acquire(2000);
+    QVERIFY(other != buffer);
+    QCOMPARE(BufferPool::pooledBytes(), pooled + 1000);
+
+    char *reused = BufferPool::acquire(1000);
+    QCOMPARE(reused, buffer);
+    QCOMPARE(BufferPool::liveBytes(), live + 3000);
+    QCOMPARE(BufferPool::pooledBytes(), pooled);
+
+    BufferPool::release(other, 2000);
+    BufferPool::release(reused, 1000);
+    QCOMPARE(BufferPool::liveBytes(), live);
+    QCOMPARE(BufferPool::pooledBytes(), pooled + 3000);
+}
+
+void TestProtocolHttp::testBufferPoolLimit()
+{
+    const int size = 1024 * 1024;
+    QVector<char *> buffers;
+    for (int i = 0; i < 10; ++i) {
+        buffers.append(BufferPool::acquire(size));
+    }
+    for (char *buffer : buffers) {
+        BufferPool::release(buffer, size);
+    }
+
+    // Buffers past 8 MiB are freed instead of kept around
+    QVERIFY(BufferPool::pooledBytes() <= 8 * size);
+    QVERIFY(BufferPool::pooledBytes() > 8 * size - size);
+}
+
+void TestProtocolHttp::testReserveBuffer()
+{
+    const qint64 live = BufferPool::liveBytes();
+
+    TestData data;
+    QVERIFY(!data.buffer);
+    QCOMPARE(data.buffer_capacity, 0);
+
+    data.reserveBuffer(16);
+    QVERIFY(data.buffer);
+    QCOMPARE(data.buffer_capacity, 16);
+    QCOMPARE(BufferPool::liveBytes(), live + 16);
+
+    memcpy(data.buffer, "cutelyst", 8);
+    data.buf_size = 8;
+
+    // Smaller sizes fit in what is there
+    char *buffer = data.buffer;
+    data.reserveBuffer(8);
+    QCOMPARE(data.buffer, buffer);
+    QCOMPARE(data.buffer_capacity, 16);
+
+    // Growing keeps the buffered data
+    data.reserveBuffer(64);
+    QCOMPARE(data.buffer_capacity, 64);
+    QCOMPARE(QByteArray(data.buffer, data.buf_size), QByteArrayLiteral("cutelyst"));
+    QCOMPARE(BufferPool::liveBytes(), live + 64);
+
+    data.buf_size = 0;
+    const qint64 pooled = BufferPool::pooledBytes();
+    data.releaseBuffer();
+    QVERIFY(!data.buffer);
+    QCOMPARE(data.buffer_capacity, 0);
+    QCOMPARE(BufferPool::liveBytes(), live);
+    QCOMPARE(BufferPool::pooledBytes(), pooled + 64);
+}
+
+void TestProtocolHttp::testBufferGrowth()
+{
+    const qint64 live = BufferPool::liveBytes();
+    m_controller->dispatched = 0;
+
+    // The header line doesn't fit in the initial buffer
+    const QByteArray value(3000, 'a');
+    FakeSocket sock(m_protocol, m_engine);
+    QCOMPARE(sock.protoData->buffer_capacity, 0);
+    sock.receive(headerRequest(value));
+
+    QCOMPARE(m_controller->dispatched, 1);
+    QCOMPARE(m_controller->liveBytes, live + 4096);
+    QVERIFY(sock.output.startsWith(QByteArrayLiteral("HTTP/1.1 200 OK\r\n")));
+    QVERIFY(sock.output.endsWith(value));
+    QVERIFY(!sock.closed);
+
+    // The idle connection gave its buffer back
+    QVERIFY(!sock.protoData->buffer);
+    QCOMPARE(BufferPool::liveBytes(), live);
+
+    // And takes one again for the next request
+    sock.output.clear();
+    sock.receive(headerRequest(QByteArrayLiteral("short")));
+    QCOMPARE(m_controller->dispatched, 2);
+    QVERIFY(sock.output.endsWith(QByteArrayLiteral("short")));
+    QCOMPARE(BufferPool::liveBytes(), live);
+}
+
+void TestProtocolHttp::testHeadersAtLimit()
+{
+    m_controller->dispatched = 0;
+
+    // The request head takes exactly buffer-size bytes
+    const int overhead = headerRequest(QByteArray()).size();
+    const QByteArray value(m_wsgi->bufferSize() - overhead, 'b');
+    FakeSocket sock(m_protocol, m_engine);
+    sock.receive(headerRequest(value));
+
+    QCOMPARE(m_controller->dispatched, 1);
+    QVERIFY(sock.output.startsWith(QByteArrayLiteral("HTTP/1.1 200 OK\r\n")));
+    QVERIFY(sock.output.endsWith(value));
+    QVERIFY(!sock.closed);
+}
+
+void TestProtocolHttp::testRejectUriTooLong()
+{
+    m_controller->dispatched = 0;
+
+    FakeSocket sock(m_protocol, m_engine);
+    sock.receive(QByteArrayLiteral("GET /http/header?") + QByteArray(m_wsgi->bufferSize(), 'c') + QByteArrayLiteral(" HTTP/1.1\r\n\r\n"));
+
+    QCOMPARE(m_controller->dispatched, 0);
+    QVERIFY(sock.output.startsWith(QByteArrayLiteral("HTTP/1.1 414 Request-URI Too Long\r\n")));
+    QVERIFY(sock.output.contains(QByteArrayLiteral("\r\nConnection: close\r\n")));
+    QVERIFY(sock.closed);
+}
+
+void TestProtocolHttp::testRejectHeadersTooLarge()
+{
+    m_controller->dispatched = 0;
+
+    // One byte more than what fits
+    const int overhead = headerRequest(QByteArray()).size();
+    const QByteArray value(m_wsgi->bufferSize() - overhead + 1, 'd');
+    FakeSocket sock(m_protocol, m_engine);
+    sock.receive(headerRequest(value));
+
+    QCOMPARE(m_controller->dispatched, 0);
+    QVERIFY(sock.output.startsWith(QByteArrayLiteral("HTTP/1.1 431 Request Header Fields Too Large\r\n")));
+    QVERIFY(sock.output.contains(QByteArrayLiteral("\r\nConnection: close\r\n")));
+    QVERIFY(sock.closed);
+}
+
+void TestProtocolHttp::testContinueBody()
+{
+    m_controller->dispatched = 0;
+
+    FakeSocket sock(m_protocol, m_engine);
+    sock.receive(QByteArrayLiteral("POST /http/body HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 5\r\n\r\n"));
+
+    // Nothing is dispatched until the client sends the body
+    QCOMPARE(sock.output, QByteArrayLiteral("HTTP/1.1 100 Continue\r\n\r\n"));
+    QCOMPARE(m_controller->dispatched, 0);
+
+    sock.output.clear();
+    sock.receive(QByteArrayLiteral("hello"));
+    QCOMPARE(m_controller->dispatched, 1);
+    QVERIFY(sock.output.startsWith(QByteArrayLiteral("HTTP/1.1 200 OK\r\n")));
+    QVERIFY(sock.output.endsWith(QByteArrayLiteral("hello")));
+    QVERIFY(!sock.closed);
+}
+
+void TestProtocolHttp::testH2ContinueBody()
+{
+    m_controller->dispatched = 0;
+
+    FakeSocket sock(m_protocolH2, m_engine);
+    sock.receive(h2Preface() + h2Frame(FrameHeaders, FlagEndHeaders, 1,
+                                       h2Header(":method", "POST") +
+                                       h2Header(":scheme", "http") +
+                                       h2Header(":path", "/http/body") +
+                                       h2Header("content-length", "5") +
+                                       h2Header("expect", "100-continue")));
+
+    // Streams are dispatched from the event loop, the action asks for the body
+    QTRY_COMPARE(h2Frames(sock.output, FrameHeaders).size(), 1);
+    QVector<H2TestFrame> headers = h2Frames(sock.output, FrameHeaders);
+    QCOMPARE(headers[0].streamId, quint32(1));
+    QVERIFY(!(headers[0].flags & FlagEndStream));
+    QVERIFY(headers[0].payload.startsWith(QByteArrayLiteral("\x08\x03" "100")));
+    QCOMPARE(m_controller->dispatched, 0);
+
+    sock.output.clear();
+    sock.receive(h2Frame(FrameData, FlagEndStream, 1, "hello"));
+    QCOMPARE(m_controller->dispatched, 1);
+
+    headers = h2Frames(sock.output, FrameHeaders);
+    QCOMPARE(headers.size(), 1);
+    QCOMPARE(quint8(headers[0].payload.at(0)), quint8(0x88));
+
+    QByteArray body;
+    const QVector<H2TestFrame> data = h2Frames(sock.output, FrameData);
+    for (const H2TestFrame &frame : data) {
+        QCOMPARE(frame.streamId, quint32(1));
+        body.append(frame.payload);
+    }
+    QCOMPARE(body, QByteArrayLiteral("hello"));
+    QVERIFY(data.last().flags & FlagEndStream);
+
+    // The body was received, the stream isn't reset
+    QVERIFY(h2Frames(sock.output, FrameRstStream).isEmpty());
+    QVERIFY(!sock.closed);
+}
+
+void TestProtocolHttp::testH2ResetStreams()
+{
+    FakeSocket sock(m_protocolH2, m_engine);
+    sock.receive(h2Preface());
+    auto request = static_cast<ProtoRequestHttp2 *>(sock.protoData);
+
+    // The oldest streams are forgotten past the limit
+    const int maxResetStreams = ProtoRequestHttp2::MaxResetStreams;
+    for (quint32 streamId = 1; streamId <= quint32(maxResetStreams * 2 + 1); streamId += 2) {
+        request->addResetStream(streamId);
+    }
+    QCOMPARE(request->resetStreams.size(), maxResetStreams);
+    QVERIFY(!request->resetStreams.contains(1));
+    QVERIFY(request->resetStreams.contains(3));
+    QVERIFY(request->resetStreams.contains(quint32(maxResetStreams * 2 + 1)));
+
+    // DATA still in flight for a reset stream gives the connection window back
+    sock.output.clear();
+    sock.receive(h2Frame(FrameData, 0, 3, QByteArray(100, 'x')));
+    QVector<H2TestFrame> updates = h2Frames(sock.output, FrameWindowUpdate);
+    QCOMPARE(updates.size(), 1);
+    QCOMPARE(updates[0].streamId, quint32(0));
+    QCOMPARE(updates[0].payload, QByteArray("\0\0\0\x64", 4));
+    QVERIFY(request->resetStreams.contains(3));
+
+    sock.output.clear();
+    sock.receive(h2Frame(FrameData, FlagEndStream, 3, "xx"));
+    updates = h2Frames(sock.output, FrameWindowUpdate);
+    QCOMPARE(updates.size(), 1);
+    QCOMPARE(updates[0].payload, QByteArray("\0\0\0\x02", 4));
+    QVERIFY(!request->resetStreams.contains(3));
+    QVERIFY(!sock.closed);
+
+    // Frames of forgotten streams are connection errors
+    sock.output.clear();
+    sock.receive(h2Frame(FrameData, 0, 1, "x"));
+    QCOMPARE(h2Frames(sock.output, FrameGoaway).size(), 1);
+    QVERIFY(sock.closed);
+}
+
+void TestProtocolHttp::testH2StreamedBody()
+{
+    m_controller->dispatched = 0;
+    m_controller->blockedBytes = -1;
+
+    FakeSocket sock(m_protocolH2, m_engine);
+    const QByteArray increment("\0\0\xff\xff", 4);
+    m_controller->windowSocket = &sock;
+    m_controller->windowUpdate = h2Frame(FrameWindowUpdate, 0, 0, increment) + h2Frame(FrameWindowUpdate, 0, 1, increment);
+    sock.receive(h2Preface() + h2Frame(FrameHeaders, FlagEndHeaders | FlagEndStream, 1,
+                                       h2Header(":method", "GET") +
+                                       h2Header(":scheme", "http") +
+                                       h2Header(":path", "/http/stream")));
+    QTRY_COMPARE(m_controller->dispatched, 1);
+    m_controller->windowSocket = nullptr;
+
+    // What the window didn't let out yet counts as not sent
+    QCOMPARE(m_controller->blockedBytes, qint64(70000 - 65535));
+
+    QByteArray body;
+    const QVector<H2TestFrame> data = h2Frames(sock.output, FrameData);
+    for (int i = 0; i < data.size() - 1; ++i) {
+        QCOMPARE(data[i].streamId, quint32(1));
+        QVERIFY(!(data[i].flags & FlagEndStream));
+        body.append(data[i].payload);
+    }
+    QCOMPARE(body, QByteArray(70000, 's'));
+
+    // Written bodies are ended once the request is finished
+    QCOMPARE(data.last().streamId, quint32(1));
+    QVERIFY(data.last().flags & FlagEndStream);
+    QVERIFY(data.last().payload.isEmpty());
+    QVERIFY(!sock.closed);
+}
+
+void TestProtocolHttp::cleanupTestCase()
+{
+    delete m_protocolH2;
+    delete m_protocol;
+    delete m_engine;
+}
+
+QTEST_MAIN(TestProtocolHttp)
+
+#include "testprotocolhttp.moc"
+
+#endif
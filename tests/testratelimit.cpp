@@ -0,0 +1,254 @@
+#ifndef RATELIMITTEST_H
+#define RATELIMITTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+
+#include "headers.h"
+#include "coverageobject.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/headers.h>
+#include <Cutelyst/Plugins/RateLimit/RateLimit>
+
+#ifdef Q_OS_UNIX
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Cutelyst;
+
+class TestRateLimit : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestRateLimit(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testController_data();
+    void testController() {
+        doTest();
+    }
+
+#ifdef Q_OS_UNIX
+    void testContention();
+#endif
+    void testTableFull();
+
+    void cleanupTestCase();
+
+private:
+    TestEngine *m_engine;
+
+    TestEngine* getEngine();
+
+    void doTest();
+};
+
+class RateLimitController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("ratelimit")
+public:
+    explicit RateLimitController(QObject *parent) : Controller(parent) {}
+
+    C_ATTR(two, :Local :RateLimit(2/3600) :AutoArgs)
+    void two(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+
+    C_ATTR(burst, :Local :RateLimit(1/3600) :RateLimitBurst(3) :AutoArgs)
+    void burst(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+
+    C_ATTR(byKey, :Local :RateLimit(1/3600) :RateLimitKey('header:X-Api-Key') :AutoArgs)
+    void byKey(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+
+    C_ATTR(unlimited, :Local :AutoArgs)
+    void unlimited(Context *c) {
+        c->response()->setBody(QByteArrayLiteral("Ok."));
+    }
+
+    C_ATTR(take, :Local :AutoArgs)
+    void take(Context *c) {
+        auto rateLimit = c->app()->plugin<RateLimit *>();
+        const qint64 wait = rateLimit->take(c->request()->queryParam(QStringLiteral("key")), 1, 3600);
+        c->response()->setBody(wait ? QByteArrayLiteral("Wait.") : QByteArrayLiteral("Ok."));
+    }
+};
+
+void TestRateLimit::initTestCase()
+{
+    m_engine = getEngine();
+    QVERIFY(m_engine);
+}
+
+TestEngine* TestRateLimit::getEngine()
+{
+    auto app = new TestApplication;
+    auto engine = new TestEngine(app, QVariantMap());
+    new RateLimitController(app);
+    auto rateLimit = new RateLimit(app);
+    rateLimit->setTableSize(1024);
+    if (!engine->init()) {
+        return nullptr;
+    }
+    return engine;
+}
+
+void TestRateLimit::cleanupTestCase()
+{
+    delete m_engine;
+}
+
+void TestRateLimit::doTest()
+{
+    QFETCH(QString, url);
+    QFETCH(QString, apiKey);
+    QFETCH(int, status);
+    QFETCH(QString, retryAfter);
+    QFETCH(QByteArray, output);
+
+    QUrl urlAux(url.mid(1));
+
+    Headers headers;
+    if (!apiKey.isEmpty()) {
+        headers.setHeader(QStringLiteral("X-Api-Key"), apiKey);
+    }
+
+    QVariantMap result = m_engine->createRequest(QStringLiteral("GET"),
+                                                 urlAux.path(),
+                                                 urlAux.query(QUrl::FullyEncoded).toLatin1(),
+                                                 headers,
+                                                 nullptr);
+
+    QCOMPARE(result.value(QStringLiteral("statusCode")).toInt(), status);
+    QCOMPARE(result.value(QStringLiteral("headers")).value<Headers>().header(QStringLiteral("Retry-After")), retryAfter);
+    QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), output);
+}
+
+void TestRateLimit::testController_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("apiKey");
+    QTest::addColumn<int>("status");
+    QTest::addColumn<QString>("retryAfter");
+    QTest::addColumn<QByteArray>("output");
+
+    // Rows share the same buckets so their order matters
+    const QByteArray ok = QByteArrayLiteral("Ok.");
+    const QByteArray tooMany = QByteArrayLiteral("Too Many Requests");
+
+    QTest::newRow("ratelimit-test00") << QStringLiteral("/ratelimit/two") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test01") << QStringLiteral("/ratelimit/two") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test02") << QStringLiteral("/ratelimit/two") << QString() << 429 << QStringLiteral("1800") << tooMany;
+    QTest::newRow("ratelimit-test03") << QStringLiteral("/ratelimit/unlimited") << QString() << 200 << QString() << ok;
+
+    QTest::newRow("ratelimit-test04") << QStringLiteral("/ratelimit/burst") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test05") << QStringLiteral("/ratelimit/burst") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test06") << QStringLiteral("/ratelimit/burst") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test07") << QStringLiteral("/ratelimit/burst") << QString() << 429 << QStringLiteral("3600") << tooMany;
+
+    QTest::newRow("ratelimit-test08") << QStringLiteral("/ratelimit/byKey") << QStringLiteral("a") << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test09") << QStringLiteral("/ratelimit/byKey") << QStringLiteral("a") << 429 << QStringLiteral("3600") << tooMany;
+    QTest::newRow("ratelimit-test10") << QStringLiteral("/ratelimit/byKey") << QStringLiteral("b") << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test11") << QStringLiteral("/ratelimit/byKey") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test12") << QStringLiteral("/ratelimit/byKey") << QString() << 429 << QStringLiteral("3600") << tooMany;
+
+    QTest::newRow("ratelimit-test13") << QStringLiteral("/ratelimit/take?key=foo") << QString() << 200 << QString() << ok;
+    QTest::newRow("ratelimit-test14") << QStringLiteral("/ratelimit/take?key=foo") << QString() << 200 << QString() << QByteArrayLiteral("Wait.");
+    QTest::newRow("ratelimit-test15") << QStringLiteral("/ratelimit/take?key=bar") << QString() << 200 << QString() << ok;
+}
+
+#ifdef Q_OS_UNIX
+void TestRateLimit::testContention()
+{
+    auto rateLimit = m_engine->app()->plugin<RateLimit *>();
+    QVERIFY(rateLimit);
+
+    const int limit = 1000;
+    const int burst = 100;
+    const int processes = 8;
+    const qint64 window = 200;
+
+    // Shared with the forked children like the buckets are
+    void *mem = mmap(nullptr, sizeof(std::atomic<int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    QVERIFY(mem != MAP_FAILED);
+    auto allowed = new (mem) std::atomic<int>(0);
+
+    auto hammer = [=] {
+        QElapsedTimer timer;
+        timer.start();
+        while (!timer.hasExpired(window)) {
+            if (rateLimit->take(QStringLiteral("contention"), limit, 1, burst) == 0) {
+                allowed->fetch_add(1);
+            }
+        }
+    };
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < processes; ++i) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            hammer();
+            _exit(0);
+        }
+        QVERIFY(pid > 0);
+        children.push_back(pid);
+    }
+    hammer();
+
+    for (pid_t pid : children) {
+        int status;
+        QCOMPARE(waitpid(pid, &status, 0), pid);
+        QVERIFY(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    // The burst plus one request per interval, even when
+    // all processes take from the same bucket at once
+    const qint64 max = burst + (elapsed.elapsed() + 1) * limit / 1000;
+    const int result = allowed->load();
+    munmap(mem, sizeof(std::atomic<int>));
+
+    QVERIFY2(result >= burst, qPrintable(QString::number(result)));
+    QVERIFY2(result <= max, qPrintable(QString::number(result) + QLatin1String(" > ") + QString::number(max)));
+}
+#endif
+
+void TestRateLimit::testTableFull()
+{
+    auto rateLimit = m_engine->app()->plugin<RateLimit *>();
+    QCOMPARE(rateLimit->tableFull(), Q_UINT64_C(0));
+
+    // Buckets that are still refilling can't be reused, once
+    // there is no room left requests are allowed and counted
+    int allowed = 0;
+    for (int i = 0; i < rateLimit->tableSize() * 4; ++i) {
+        if (rateLimit->take(QLatin1String("full-") + QString::number(i), 1, 3600) == 0) {
+            ++allowed;
+        }
+    }
+    QVERIFY(rateLimit->tableFull() > 0);
+    QCOMPARE(quint64(allowed), quint64(rateLimit->tableSize() * 4));
+}
+
+QTEST_MAIN(TestRateLimit)
+
+#include "testratelimit.moc"
+
+#endif
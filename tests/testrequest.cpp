@@ -3,6 +3,7 @@
 
 #include <QTest>
 #include <QObject>
+#include <QCoreApplication>
 #include <QHostInfo>
 #include <QUuid>
 #include <QJsonArray>
@@ -17,9 +18,51 @@
 #include <Cutelyst/controller.h>
 #include <Cutelyst/headers.h>
 #include <Cutelyst/upload.h>
+#include <Cutelyst/enginerequest.h>
 
 using namespace Cutelyst;
 
+// Outlives TestEngine::createRequest() so async actions can finish
+class AsyncTestRequest : public EngineRequest
+{
+public:
+    explicit AsyncTestRequest(const QString &path)
+    {
+        method = QStringLiteral("GET");
+        setPath(path);
+        protocol = QStringLiteral("HTTP/1.1");
+        serverAddress = QStringLiteral("127.0.0.1");
+        remoteAddress = QHostAddress(QStringLiteral("127.0.0.1"));
+        remotePort = 3000;
+        elapsed.start();
+    }
+
+    QByteArray output;
+    bool finished = false;
+    // Like cutelyst-wsgi, which reuses the request for the next one
+    bool deleteContext = false;
+
+protected:
+    virtual qint64 doWrite(const char *data, qint64 len) override final {
+        output.append(data, int(len));
+        return len;
+    }
+
+    virtual bool writeHeaders(quint16 status, const Headers &headers) override final {
+        Q_UNUSED(status)
+        Q_UNUSED(headers)
+        return true;
+    }
+
+    virtual void processingFinished() override final {
+        finished = true;
+        if (deleteContext) {
+            delete context;
+            context = nullptr;
+        }
+    }
+};
+
 class TestRequest : public CoverageObject
 {
     Q_OBJECT
@@ -39,6 +82,18 @@ private Q_SLOTS:
         doTest();
     }
 
+    void testHostnameLookup_data();
+    void testHostnameLookup() {
+        Request::setHostnameLookup([] (const QHostAddress &address) {
+            return address.isLoopback() ? QStringLiteral("stub.localhost") : QString();
+        });
+        doTest();
+        Request::setHostnameLookup({});
+    }
+
+    void testHostnameLookupAsync();
+    void testHostnameLookupAsyncDelete();
+
     void cleanupTestCase();
 
 private:
@@ -75,6 +130,13 @@ public:
         c->response()->setBody(c->request()->hostname());
     }
 
+    C_ATTR(hostnameAsync, :Local :AutoArgs)
+    void hostnameAsync(Context *c) {
+        c->request()->hostnameAsync([=] (const QString &hostname) {
+            c->response()->setBody(hostname);
+        });
+    }
+
     C_ATTR(port, :Local :AutoArgs)
     void port(Context *c) {
         c->response()->setBody(QByteArray::number(c->request()->port()));
@@ -425,6 +487,77 @@ void TestRequest::doTest()
     QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), output);
 }
 
+void TestRequest::testHostnameLookup_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<Headers>("headers");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<QByteArray>("output");
+
+    QString get = QStringLiteral("GET");
+    Headers headers;
+
+    QTest::newRow("hostname-stub-test00") << get << QStringLiteral("/request/test/hostname") << headers << QByteArray()
+                                          << QByteArrayLiteral("stub.localhost");
+}
+
+void TestRequest::testHostnameLookupAsync()
+{
+    int lookups = 0;
+    Request::setHostnameLookup([&lookups] (const QHostAddress &address) {
+        ++lookups;
+        return address.isLoopback() ? QStringLiteral("stub.localhost") : QString();
+    });
+
+    AsyncTestRequest request(QStringLiteral("request/test/hostnameAsync"));
+    m_engine->processRequest(&request);
+
+    // The action is suspended until the lookup completes from the event loop
+    QCOMPARE(lookups, 0);
+    QVERIFY(request.status & EngineRequest::Async);
+    QVERIFY(!request.finished);
+    QVERIFY(request.output.isEmpty());
+
+    QTRY_VERIFY(request.finished);
+    QCOMPARE(lookups, 1);
+    QCOMPARE(request.output, QByteArrayLiteral("stub.localhost"));
+
+    // Cached now, so answered right away
+    QByteArray body;
+    const QVariantMap result = m_engine->createRequest(QStringLiteral("GET"),
+                                                       QStringLiteral("request/test/hostnameAsync"),
+                                                       QByteArray(),
+                                                       Headers(),
+                                                       &body);
+    QCOMPARE(result.value(QStringLiteral("body")).toByteArray(), QByteArrayLiteral("stub.localhost"));
+    QCOMPARE(lookups, 1);
+
+    Request::setHostnameLookup({});
+}
+
+void TestRequest::testHostnameLookupAsyncDelete()
+{
+    Request::setHostnameLookup([] (const QHostAddress &address) {
+        Q_UNUSED(address)
+        return QStringLiteral("stub.deleted");
+    });
+
+    AsyncTestRequest request(QStringLiteral("request/test/hostnameAsync"));
+    request.deleteContext = true;
+    m_engine->processRequest(&request);
+    QVERIFY(!request.finished);
+
+    // The Context and the lookup it owned are gone once
+    // the callback returns, nothing must touch them after
+    QTRY_VERIFY(request.finished);
+    QVERIFY(!request.context);
+    QCOMPARE(request.output, QByteArrayLiteral("stub.deleted"));
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+    Request::setHostnameLookup({});
+}
+
 void TestRequest::testController_data()
 {
     QTest::addColumn<QString>("method");
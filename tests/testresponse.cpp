@@ -174,6 +174,16 @@ public:
         c->response()->setBody(cookie.toRawForm());
     }
 
+    C_ATTR(write, :Local :AutoArgs)
+    void write(Context *c) {
+        const QString contentLength = c->request()->queryParam(QStringLiteral("length"));
+        if (!contentLength.isEmpty()) {
+            c->response()->setContentLength(contentLength.toLongLong());
+        }
+        c->response()->write(QByteArrayLiteral("ab"));
+        c->response()->write(QByteArrayLiteral("cd"));
+    }
+
 };
 
 void TestResponse::initTestCase()
@@ -494,6 +504,28 @@ void TestResponse::testController_data()
                                           << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("97")} }
                                           << QByteArrayLiteral("foo=baz; secure; HttpOnly; expires=Tue, 21-Jun-2016 10:08:15 GMT; domain=cutelyst.org; path=/path");
 
+    headers = Headers();
+    QTest::newRow("write-test00") << get << QStringLiteral("/response/test/write") << headers << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Connection"), QStringLiteral("close")} }
+                                  << QByteArrayLiteral("abcd");
+
+    QTest::newRow("write-test01") << get << QStringLiteral("/response/test/write?length=4") << headers << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Content-Length"), QStringLiteral("4")} }
+                                  << QByteArrayLiteral("abcd");
+
+    headers.setHeader(QStringLiteral("X-Test-Framing"), QStringLiteral("chunked"));
+    QTest::newRow("write-test02") << get << QStringLiteral("/response/test/write") << headers << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Transfer-Encoding"), QStringLiteral("chunked")} }
+                                  << QByteArrayLiteral("2\r\nab\r\n2\r\ncd\r\n0\r\n\r\n");
+
+    headers.setHeader(QStringLiteral("X-Test-Chunked-Min-Size"), QStringLiteral("16"));
+    QTest::newRow("write-test03") << get << QStringLiteral("/response/test/write") << headers << QByteArray()
+                                  << QByteArrayLiteral("200 OK")
+                                  << Headers{ {QStringLiteral("Transfer-Encoding"), QStringLiteral("chunked")} }
+                                  << QByteArrayLiteral("4\r\nabcd\r\n0\r\n\r\n");
 }
 
 QTEST_MAIN(TestResponse)
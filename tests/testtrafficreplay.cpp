@@ -0,0 +1,217 @@
+#ifndef TRAFFICREPLAYTEST_H
+#define TRAFFICREPLAYTEST_H
+
+#include <QtTest/QTest>
+#include <QtCore/QObject>
+#include <QtCore/QBuffer>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTimer>
+
+#include "coverageobject.h"
+#include "trafficcapture.h"
+#include "trafficreplay.h"
+
+#include <Cutelyst/application.h>
+#include <Cutelyst/controller.h>
+#include <Cutelyst/enginerequest.h>
+
+using namespace Cutelyst;
+using namespace CWSGI;
+
+class CaptureRequest : public EngineRequest
+{
+public:
+    CaptureRequest(const QString &method, const QString &path, const QByteArray &query = QByteArray())
+    {
+        this->method = method;
+        setPath(path);
+        this->query = query;
+        protocol = QStringLiteral("HTTP/1.1");
+    }
+
+protected:
+    virtual qint64 doWrite(const char *data, qint64 len) override final {
+        Q_UNUSED(data)
+        return len;
+    }
+
+    virtual bool writeHeaders(quint16 status, const Headers &headers) override final {
+        Q_UNUSED(status)
+        Q_UNUSED(headers)
+        return true;
+    }
+};
+
+class ReplayController : public Controller
+{
+    Q_OBJECT
+    C_NAMESPACE("replay")
+public:
+    explicit ReplayController(QObject *parent) : Controller(parent) {}
+
+    C_ATTR(sync, :Local :AutoArgs)
+    void sync(Context *c) {
+        c->response()->setBody(c->request()->body()->readAll());
+    }
+
+    C_ATTR(async, :Local :AutoArgs)
+    void async(Context *c) {
+        c->detachAsync();
+        QTimer::singleShot(50, c, [c] {
+            c->response()->setBody(QByteArrayLiteral("async"));
+            c->attachAsync();
+        });
+    }
+};
+
+class TestTrafficReplay : public CoverageObject
+{
+    Q_OBJECT
+public:
+    explicit TestTrafficReplay(QObject *parent = nullptr) : CoverageObject(parent) {}
+
+private Q_SLOTS:
+    void testCaptureRedaction();
+    void testCaptureSample();
+    void testReplay();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+void TestTrafficReplay::testCaptureRedaction()
+{
+    const QString fileName = m_dir.filePath(QStringLiteral("redaction.capture"));
+    {
+        TrafficCapture capture(1, { QStringLiteral("X-Api-Key"), QStringLiteral("?token") });
+        QVERIFY(capture.open(fileName));
+
+        CaptureRequest request(QStringLiteral("POST"), QStringLiteral("login"), QByteArrayLiteral("token=secret&page=2"));
+        request.headers.setHeader(QStringLiteral("Authorization"), QStringLiteral("Basic Zm9vOmJhcg=="));
+        request.headers.setHeader(QStringLiteral("Cookie"), QStringLiteral("session=1234"));
+        request.headers.setHeader(QStringLiteral("X-Api-Key"), QStringLiteral("abcd"));
+        request.headers.setHeader(QStringLiteral("X-Other"), QStringLiteral("kept"));
+        request.isSecure = true;
+
+        auto body = new QBuffer;
+        body->setData(QByteArrayLiteral("user=foo"));
+        body->open(QIODevice::ReadOnly);
+        body->read(2);
+        request.body = body;
+
+        capture.record(&request);
+        // The application must still see the body where it was
+        QCOMPARE(body->pos(), qint64(2));
+        delete body;
+        request.body = nullptr;
+
+        capture.close();
+        QCOMPARE(capture.dropped(), quint64(0));
+    }
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+    QDataStream in(&file);
+    QVERIFY(TrafficCapture::readHeader(in));
+
+    CapturedRequest captured;
+    QVERIFY(TrafficCapture::readRequest(in, &captured));
+    QCOMPARE(captured.method, QStringLiteral("POST"));
+    QCOMPARE(captured.path, QStringLiteral("login"));
+    QCOMPARE(captured.query, QByteArrayLiteral("token=REDACTED&page=2"));
+    QCOMPARE(captured.headers.value(QStringLiteral("AUTHORIZATION")), QStringLiteral("REDACTED"));
+    QCOMPARE(captured.headers.value(QStringLiteral("COOKIE")), QStringLiteral("REDACTED"));
+    QCOMPARE(captured.headers.value(QStringLiteral("X_API_KEY")), QStringLiteral("REDACTED"));
+    QCOMPARE(captured.headers.value(QStringLiteral("X_OTHER")), QStringLiteral("kept"));
+    QCOMPARE(captured.body, QByteArrayLiteral("user=foo"));
+    QCOMPARE(captured.flags, quint8(CapturedRequest::Secure));
+    QVERIFY(!TrafficCapture::readRequest(in, &captured));
+}
+
+void TestTrafficReplay::testCaptureSample()
+{
+    const QString fileName = m_dir.filePath(QStringLiteral("sample.capture"));
+    {
+        TrafficCapture capture(3, QStringList());
+        QVERIFY(capture.open(fileName));
+        for (int i = 0; i < 9; ++i) {
+            CaptureRequest request(QStringLiteral("GET"), QStringLiteral("item/") + QString::number(i));
+            capture.record(&request);
+        }
+    }
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+    QDataStream in(&file);
+    QVERIFY(TrafficCapture::readHeader(in));
+
+    QStringList paths;
+    CapturedRequest captured;
+    while (TrafficCapture::readRequest(in, &captured)) {
+        paths.append(captured.path);
+    }
+    QCOMPARE(paths, QStringList({ QStringLiteral("item/0"), QStringLiteral("item/3"), QStringLiteral("item/6") }));
+}
+
+void TestTrafficReplay::testReplay()
+{
+    const QString fileName = m_dir.filePath(QStringLiteral("replay.capture"));
+    {
+        TrafficCapture capture(1, QStringList());
+        QVERIFY(capture.open(fileName));
+
+        CaptureRequest post(QStringLiteral("POST"), QStringLiteral("replay/sync"));
+        auto body = new QBuffer;
+        body->setData(QByteArrayLiteral("hello"));
+        body->open(QIODevice::ReadOnly);
+        post.body = body;
+        capture.record(&post);
+        delete body;
+        post.body = nullptr;
+
+        CaptureRequest async(QStringLiteral("GET"), QStringLiteral("replay/async"));
+        capture.record(&async);
+        capture.record(&async);
+
+        CaptureRequest missing(QStringLiteral("GET"), QStringLiteral("replay/missing"));
+        capture.record(&missing);
+    }
+
+    auto app = new TestApplication;
+    auto engine = new ReplayEngine(app, QVariantMap());
+    new ReplayController(app);
+    QVERIFY(engine->init());
+
+    TrafficReplay replay(engine);
+    QVERIFY(replay.run(fileName, false));
+
+    const QJsonObject report = replay.report();
+    QCOMPARE(report.value(QStringLiteral("requests")).toInt(), 4);
+    QCOMPARE(report.value(QStringLiteral("truncated")).toInt(), 0);
+
+    const QJsonObject statusCodes = report.value(QStringLiteral("status_codes")).toObject();
+    QCOMPARE(statusCodes.value(QStringLiteral("200")).toInt(), 3);
+    QCOMPARE(statusCodes.value(QStringLiteral("404")).toInt(), 1);
+
+    const QJsonObject actions = report.value(QStringLiteral("actions")).toObject();
+    QCOMPARE(actions.value(QStringLiteral("/replay/sync")).toObject().value(QStringLiteral("count")).toInt(), 1);
+
+    // Async requests are measured until they finish, not until they detach
+    const QJsonObject async = actions.value(QStringLiteral("/replay/async")).toObject();
+    QCOMPARE(async.value(QStringLiteral("count")).toInt(), 2);
+    QVERIFY(async.value(QStringLiteral("p50_us")).toInt() >= 40000);
+
+    // A report compared to itself has no differences
+    const QByteArray comparison = replay.compare(report);
+    QVERIFY(comparison.contains("/replay/async"));
+    QVERIFY(comparison.contains("0.0%"));
+    QVERIFY(!comparison.contains("+0") && !comparison.contains("-0"));
+
+    delete engine;
+}
+
+QTEST_MAIN(TestTrafficReplay)
+
+#include "testtrafficreplay.moc"
+
+#endif
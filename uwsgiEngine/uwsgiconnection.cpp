@@ -23,10 +23,14 @@
 #include <uwsgi.h>
 
 #include <Cutelyst/Context>
+#include <Cutelyst/Response>
 
 #include <QFile>
+#include <QVarLengthArray>
 #include <QLoggingCategory>
 
+#include <arpa/inet.h>
+
 Q_LOGGING_CATEGORY(CUTELYST_UWSGI_CONN, "cutelyst.uwsgi.connection", QtWarningMsg)
 
 using namespace Cutelyst;
@@ -49,21 +53,100 @@ static inline quint16 questionMark(char *str, quint16 length) {
     return length;
 }
 
+// Most requests use one of a few values, returning a shared
+// string avoids allocating a new one for each request
+static inline QString methodString(const char *str, quint16 length)
+{
+    static const QString methods[] = {
+        QStringLiteral("GET"), QStringLiteral("POST"), QStringLiteral("HEAD"),
+        QStringLiteral("PUT"), QStringLiteral("DELETE"), QStringLiteral("PATCH"),
+        QStringLiteral("OPTIONS")
+    };
+    for (const QString &method : methods) {
+        if (method.size() == length && method == QLatin1String(str, length)) {
+            return method;
+        }
+    }
+    return QString::fromLatin1(str, length);
+}
+
+static inline QString protocolString(const char *str, quint16 length)
+{
+    static const QString http11 = QStringLiteral("HTTP/1.1");
+    static const QString http10 = QStringLiteral("HTTP/1.0");
+    if (length == 8 && http11 == QLatin1String(str, length)) {
+        return http11;
+    } else if (length == 8 && http10 == QLatin1String(str, length)) {
+        return http10;
+    }
+    return QString::fromLatin1(str, length);
+}
+
+static inline QString hostString(const char *str, quint16 length)
+{
+    // Requests handled by a thread usually target the same host
+    static thread_local QByteArray lastHost;
+    static thread_local QString lastHostString;
+    if (lastHost.size() != length || memcmp(lastHost.constData(), str, length) != 0) {
+        lastHost = QByteArray(str, length);
+        lastHostString = QString::fromLatin1(str, length);
+    }
+    return lastHostString;
+}
+
+static inline void setAddress(QHostAddress &address, const char *str, quint16 length)
+{
+    if (!length) {
+        return;
+    }
+
+    // Link-local IPv6 addresses carry a zone like fe80::1%eth0
+    // that inet_pton() doesn't accept, it becomes the scope id
+    const char *scope = static_cast<const char *>(memchr(str, '%', length));
+    const quint16 ipLength = scope ? quint16(scope - str) : length;
+
+    char ip[INET6_ADDRSTRLEN];
+    in_addr addr4;
+    in6_addr addr6;
+    if (ipLength < sizeof(ip)) {
+        memcpy(ip, str, ipLength);
+        ip[ipLength] = '\0';
+
+        if (!scope && inet_pton(AF_INET, ip, &addr4) == 1) {
+            address.setAddress(ntohl(addr4.s_addr));
+            return;
+        } else if (inet_pton(AF_INET6, ip, &addr6) == 1) {
+            address.setAddress(addr6.s6_addr);
+            if (scope) {
+                address.setScopeId(QString::fromLatin1(scope + 1, length - ipLength - 1));
+            }
+            return;
+        }
+    }
+
+    // Whatever else QHostAddress understands
+    address.setAddress(QString::fromLatin1(str, length));
+}
+
 uwsgiConnection::uwsgiConnection(wsgi_request *req)
   : request(req)
 {
     quint16 len = questionMark(req->uri, req->uri_len);
     quint16 pos = notSlash(req->uri, len);
-    QByteArray rawPath(req->uri + pos, len - pos);
+    // The uri is decoded in place but uWSGI still logs it
+    QVarLengthArray<char, 1024> rawPath(len - pos);
+    memcpy(rawPath.data(), req->uri + pos, size_t(len - pos));
     setPath(rawPath.data(), rawPath.size());
 
-    serverAddress = QString::fromLatin1(req->host, req->host_len);
+    serverAddress = hostString(req->host, req->host_len);
     query = QByteArray::fromRawData(req->query_string, req->query_string_len);
 
-    method = QString::fromLatin1(req->method, req->method_len);
-    protocol = QString::fromLatin1(req->protocol, req->protocol_len);
-    remoteAddress.setAddress(QString::fromLatin1(req->remote_addr, req->remote_addr_len));
-    remoteUser = QString::fromLatin1(req->remote_user, req->remote_user_len);
+    method = methodString(req->method, req->method_len);
+    protocol = protocolString(req->protocol, req->protocol_len);
+    setAddress(remoteAddress, req->remote_addr, req->remote_addr_len);
+    if (req->remote_user_len) {
+        remoteUser = QString::fromLatin1(req->remote_user, req->remote_user_len);
+    }
     isSecure = req->https_len;
     startOfRequest = req->start_of_request;
     elapsed.start();
@@ -123,18 +206,46 @@ bool uwsgiConnection::writeHeaders(quint16 status, const Headers &headers)
         return false;
     }
 
+    // Keys are camel cased and both converted to latin1 straight
+    // into a buffer that is reused by the following requests
+    static thread_local QByteArray buffer;
+
     const auto headersData = headers.data();
     auto it = headersData.constBegin();
     const auto endIt = headersData.constEnd();
     while (it != endIt) {
-        const QByteArray key = uWSGI::camelCaseHeader(it.key()).toLatin1();
-        const QByteArray value = it.value().toLatin1();
-
-        if (uwsgi_response_add_header(request,
-                                      const_cast<char*>(key.constData()),
-                                      key.size(),
-                                      const_cast<char*>(value.constData()),
-                                      value.size())) {
+        const QString &key = it.key();
+        const QString &value = it.value();
+        const int keySize = key.size();
+        const int valueSize = value.size();
+        if (buffer.size() < keySize + valueSize) {
+            buffer.resize(keySize + valueSize);
+        }
+        char *data = buffer.data();
+
+        const QChar *keyData = key.constData();
+        bool lastWasLetter = false;
+        for (int i = 0; i < keySize; ++i) {
+            char c = keyData[i].toLatin1();
+            if (c == '_') {
+                c = '-';
+                lastWasLetter = false;
+            } else if (lastWasLetter) {
+                if (c >= 'A' && c <= 'Z') {
+                    c += 'a' - 'A';
+                }
+            } else if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+                lastWasLetter = true;
+            }
+            data[i] = c;
+        }
+
+        const QChar *valueData = value.constData();
+        for (int i = 0; i < valueSize; ++i) {
+            data[keySize + i] = valueData[i].toLatin1();
+        }
+
+        if (uwsgi_response_add_header(request, data, quint16(keySize), data + keySize, quint16(valueSize))) {
             return false;
         }
 
@@ -144,6 +255,24 @@ bool uwsgiConnection::writeHeaders(quint16 status, const Headers &headers)
     return true;
 }
 
+void uwsgiConnection::finalizeBody()
+{
+    if (!(status & EngineRequest::Chunked)) {
+        auto file = qobject_cast<QFile *>(context->response()->bodyDevice());
+        if (file && file->handle() != -1) {
+            // uWSGI sends it from an offload thread when available,
+            // the descriptor is dup()ed as QFile will close it
+            const qint64 size = file->size();
+            if (uwsgi_response_sendfile_do_can_close(request, file->handle(), 0, size_t(size), 0) != UWSGI_OK) {
+                qCWarning(CUTELYST_UWSGI_CONN) << "Failed to send file body";
+            }
+            return;
+        }
+    }
+
+    EngineRequest::finalizeBody();
+}
+
 qint64 uwsgiConnection::doWrite(const char *data, qint64 len)
 {
     if (uwsgi_response_write_body_do(request,
@@ -36,6 +36,8 @@ public:
 
     virtual ~uwsgiConnection();
 
+    virtual void finalizeBody() final;
+
 protected:
     virtual qint64 doWrite(const char *data, qint64 len) final;
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <QtGlobal>
+
+#include <errno.h>
+#include <stddef.h>
+
+/*
+ * Interposes the glibc allocation functions on the executable
+ * so that allocations and allocated bytes can be counted per thread,
+ * this is only built when USE_ALLOCATION_STATS is enabled.
+ */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+static __thread quint64 allocCount = 0;
+static __thread quint64 allocBytes = 0;
+
+static inline void countAllocation(size_t size)
+{
+    ++allocCount;
+    allocBytes += size;
+}
+
+void cwsgiAllocationCount(quint64 *count, quint64 *bytes)
+{
+    *count = allocCount;
+    *bytes = allocBytes;
+}
+
+extern "C" {
+
+void *malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    countAllocation(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+
+    countAllocation(size);
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr && size) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+}
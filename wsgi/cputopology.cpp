@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cputopology.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QLoggingCategory>
+
+#include <algorithm>
+#include <set>
+
+Q_LOGGING_CATEGORY(CWSGI_TOPOLOGY, "cwsgi.topology", QtWarningMsg)
+
+using namespace CWSGI;
+
+CpuTopology::CpuTopology(const QString &root) : m_root(root)
+{
+    const QVector<int> online = parseCpuList(readFile(QStringLiteral("/sys/devices/system/cpu/online")));
+    if (online.isEmpty()) {
+        qCWarning(CWSGI_TOPOLOGY) << "Failed to read the online CPUs from" << m_root + QLatin1String("/sys/devices/system/cpu/online");
+        return;
+    }
+
+    QHash<int, int> nodeOfCpu;
+    const QVector<int> nodes = parseCpuList(readFile(QStringLiteral("/sys/devices/system/node/online")));
+    for (int node : nodes) {
+        const QVector<int> nodeCpus = parseCpuList(readFile(QLatin1String("/sys/devices/system/node/node") + QString::number(node) + QLatin1String("/cpulist")));
+        for (int cpu : nodeCpus) {
+            nodeOfCpu.insert(cpu, node);
+        }
+    }
+
+    m_cpus.reserve(size_t(online.size()));
+    for (int id : online) {
+        const QString topology = QLatin1String("/sys/devices/system/cpu/cpu") + QString::number(id) + QLatin1String("/topology/");
+
+        bool ok;
+        Cpu cpu;
+        cpu.id = id;
+        cpu.core = readFile(topology + QLatin1String("core_id")).trimmed().toInt(&ok);
+        if (!ok) {
+            cpu.core = id;
+        }
+        cpu.package = readFile(topology + QLatin1String("physical_package_id")).trimmed().toInt(&ok);
+        if (!ok || cpu.package < 0) {
+            cpu.package = 0;
+        }
+        cpu.node = nodeOfCpu.value(id, 0);
+        cpu.sibling = 0;
+        m_cpus.push_back(cpu);
+    }
+
+    // CPUs sharing a core are SMT siblings, the first one gets 0
+    QHash<QPair<int, int>, int> siblings;
+    for (Cpu &cpu : m_cpus) {
+        cpu.sibling = siblings[qMakePair(cpu.package, cpu.core)]++;
+    }
+}
+
+bool CpuTopology::isValid() const
+{
+    return !m_cpus.empty();
+}
+
+const std::vector<CpuTopology::Cpu> &CpuTopology::cpus() const
+{
+    return m_cpus;
+}
+
+int CpuTopology::nodeCount() const
+{
+    std::set<int> nodes;
+    for (const Cpu &cpu : m_cpus) {
+        nodes.insert(cpu.node);
+    }
+    return int(nodes.size());
+}
+
+int CpuTopology::packageCount() const
+{
+    std::set<int> packages;
+    for (const Cpu &cpu : m_cpus) {
+        packages.insert(cpu.package);
+    }
+    return int(packages.size());
+}
+
+int CpuTopology::coreCount() const
+{
+    int ret = 0;
+    for (const Cpu &cpu : m_cpus) {
+        if (cpu.sibling == 0) {
+            ++ret;
+        }
+    }
+    return ret;
+}
+
+int CpuTopology::interfaceNode(const QString &interface) const
+{
+    bool ok;
+    const int node = readFile(QLatin1String("/sys/class/net/") + interface + QLatin1String("/device/numa_node")).trimmed().toInt(&ok);
+    if (ok && node >= 0) {
+        return node;
+    }
+
+    // Firmware often doesn't tell, but the interrupts are
+    // usually routed to the node the device is attached to
+    QHash<int, int> votes;
+    const QVector<int> irqCpus = interfaceInterruptCpus(interface);
+    for (int id : irqCpus) {
+        auto it = std::find_if(m_cpus.cbegin(), m_cpus.cend(), [id] (const Cpu &cpu) {
+            return cpu.id == id;
+        });
+        if (it != m_cpus.cend()) {
+            ++votes[it->node];
+        }
+    }
+
+    int ret = -1;
+    int best = 0;
+    for (auto it = votes.constBegin(); it != votes.constEnd(); ++it) {
+        if (it.value() > best || (it.value() == best && it.key() < ret)) {
+            ret = it.key();
+            best = it.value();
+        }
+    }
+    return ret;
+}
+
+QVector<int> CpuTopology::interfaceInterruptCpus(const QString &interface) const
+{
+    std::set<int> cpus;
+
+    const QDir irqs(m_root + QLatin1String("/sys/class/net/") + interface + QLatin1String("/device/msi_irqs"));
+    const QStringList entries = irqs.entryList(QDir::Files | QDir::NoDotAndDotDot);
+    for (const QString &irq : entries) {
+        const QString path = QLatin1String("/proc/irq/") + irq;
+        QByteArray list = readFile(path + QLatin1String("/effective_affinity_list"));
+        if (list.trimmed().isEmpty()) {
+            list = readFile(path + QLatin1String("/smp_affinity_list"));
+        }
+
+        const QVector<int> irqCpus = parseCpuList(list);
+        // Interrupts allowed everywhere don't tell where the device is
+        if (irqCpus.size() < int(m_cpus.size())) {
+            cpus.insert(irqCpus.cbegin(), irqCpus.cend());
+        }
+    }
+
+    QVector<int> ret;
+    ret.reserve(int(cpus.size()));
+    for (int cpu : cpus) {
+        ret.append(cpu);
+    }
+    return ret;
+}
+
+static void appendInterleaved(QVector<int> &order, const std::vector<QVector<int>> &queues, int chunk)
+{
+    // Takes a chunk from each node in turn, so consecutive slots land on different nodes
+    std::vector<int> pos(queues.size(), 0);
+    bool added = true;
+    while (added) {
+        added = false;
+        for (size_t node = 0; node < queues.size(); ++node) {
+            const QVector<int> &queue = queues[node];
+            for (int i = 0; i < chunk && pos[node] < queue.size(); ++i) {
+                order.append(queue[pos[node]++]);
+                added = true;
+            }
+        }
+    }
+}
+
+std::vector<CpuTopology::Slot> CpuTopology::place(Placement placement, int slots, int cpusPerSlot, int node) const
+{
+    std::vector<Slot> ret;
+    if (m_cpus.empty() || slots <= 0) {
+        return ret;
+    }
+    cpusPerSlot = qBound(1, cpusPerSlot, int(m_cpus.size()));
+
+    // The order in which CPUs are handed to slots, consecutive
+    // CPUs of the order are given to the same slot
+    QVector<int> order;
+    if (placement == Index) {
+        for (const Cpu &cpu : m_cpus) {
+            order.append(cpu.id);
+        }
+    } else if (placement == Compact) {
+        // Fill all SMT siblings of a core and all cores of a node before moving on
+        const std::vector<QVector<int>> queues = nodeQueues(true, nullptr);
+        for (const QVector<int> &queue : queues) {
+            order.append(queue);
+        }
+    } else {
+        // Distinct physical cores first, SMT siblings only once all cores are taken
+        std::vector<int> nodes;
+        std::vector<QVector<int>> queues = nodeQueues(false, &nodes);
+        if (placement == Listener && node >= 0) {
+            auto local = std::find(nodes.begin(), nodes.end(), node);
+            if (local != nodes.end()) {
+                // Workers that don't fit on the local node spread over the others
+                const auto index = local - nodes.begin();
+                order = queues[size_t(index)];
+                queues.erase(queues.begin() + index);
+            } else {
+                qCWarning(CWSGI_TOPOLOGY) << "Listener NUMA node" << node << "has no online CPUs, spreading instead";
+            }
+        }
+        appendInterleaved(order, queues, cpusPerSlot);
+    }
+
+    QHash<int, int> nodeOfCpu;
+    for (const Cpu &cpu : m_cpus) {
+        nodeOfCpu.insert(cpu.id, cpu.node);
+    }
+
+    ret.reserve(size_t(slots));
+    for (int slot = 0; slot < slots; ++slot) {
+        Slot entry;
+        entry.node = -2;
+        for (int i = 0; i < cpusPerSlot; ++i) {
+            const int cpu = order[(slot * cpusPerSlot + i) % order.size()];
+            entry.cpus.append(cpu);
+
+            const int cpuNode = nodeOfCpu.value(cpu);
+            if (entry.node == -2) {
+                entry.node = cpuNode;
+            } else if (entry.node != cpuNode) {
+                entry.node = -1;
+            }
+        }
+        ret.push_back(entry);
+    }
+
+    return ret;
+}
+
+CpuTopology::Placement CpuTopology::placementFromString(const QString &name, bool *ok)
+{
+    bool valid = true;
+    Placement ret = Index;
+    if (name == QLatin1String("spread")) {
+        ret = Spread;
+    } else if (name == QLatin1String("compact")) {
+        ret = Compact;
+    } else if (name == QLatin1String("listener")) {
+        ret = Listener;
+    } else if (!name.isEmpty() && name != QLatin1String("index")) {
+        valid = false;
+    }
+
+    if (ok) {
+        *ok = valid;
+    }
+    return ret;
+}
+
+QVector<int> CpuTopology::parseCpuList(const QByteArray &list)
+{
+    QVector<int> ret;
+
+    // The kernel format, "0-3,8,10-11"
+    const QList<QByteArray> ranges = list.trimmed().split(',');
+    for (const QByteArray &range : ranges) {
+        if (range.isEmpty()) {
+            continue;
+        }
+
+        bool ok;
+        const int dash = range.indexOf('-');
+        if (dash == -1) {
+            const int cpu = range.toInt(&ok);
+            if (ok && cpu >= 0) {
+                ret.append(cpu);
+            }
+        } else {
+            bool okLast;
+            const int first = range.left(dash).toInt(&ok);
+            const int last = range.mid(dash + 1).toInt(&okLast);
+            if (ok && okLast && first >= 0 && last >= first) {
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    ret.append(cpu);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+QByteArray CpuTopology::readFile(const QString &path) const
+{
+    QFile file(m_root + path);
+    if (file.open(QIODevice::ReadOnly)) {
+        // sysfs files are small and don't report a size
+        return file.read(4096);
+    }
+    return QByteArray();
+}
+
+std::vector<QVector<int>> CpuTopology::nodeQueues(bool compact, std::vector<int> *nodes) const
+{
+    std::vector<Cpu> sorted = m_cpus;
+    std::sort(sorted.begin(), sorted.end(), [compact] (const Cpu &a, const Cpu &b) {
+        if (a.node != b.node) {
+            return a.node < b.node;
+        } else if (!compact && a.sibling != b.sibling) {
+            return a.sibling < b.sibling;
+        } else if (a.package != b.package) {
+            return a.package < b.package;
+        } else if (a.core != b.core) {
+            return a.core < b.core;
+        }
+        return a.id < b.id;
+    });
+
+    std::vector<QVector<int>> ret;
+    int node = -1;
+    for (const Cpu &cpu : sorted) {
+        if (ret.empty() || cpu.node != node) {
+            ret.emplace_back();
+            node = cpu.node;
+            if (nodes) {
+                nodes->push_back(node);
+            }
+        }
+        ret.back().append(cpu.id);
+    }
+    return ret;
+}
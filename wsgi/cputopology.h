@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+namespace CWSGI {
+
+/**
+ * Reads the CPU and NUMA topology from sysfs and places worker
+ * threads on it. All paths are read below a root directory so
+ * that a fake tree can be used to try placements on any machine.
+ */
+class CpuTopology
+{
+public:
+    enum Placement {
+        Index,
+        Spread,
+        Compact,
+        Listener,
+    };
+
+    struct Cpu {
+        int id;
+        int core;
+        int package;
+        int node;
+        // Position among the SMT siblings of the core
+        int sibling;
+    };
+
+    struct Slot {
+        QVector<int> cpus;
+        // -1 when the CPUs span more than one node
+        int node;
+    };
+
+    explicit CpuTopology(const QString &root = QString());
+
+    bool isValid() const;
+
+    const std::vector<Cpu> &cpus() const;
+    int nodeCount() const;
+    int packageCount() const;
+    int coreCount() const;
+
+    /**
+     * Returns the NUMA node of the network interface, from its PCI device or else from
+     * the CPUs its interrupts are routed to, or -1 if unknown.
+     */
+    int interfaceNode(const QString &interface) const;
+
+    /**
+     * Returns the CPUs that handle the interrupts of the network interface.
+     */
+    QVector<int> interfaceInterruptCpus(const QString &interface) const;
+
+    /**
+     * Returns @a slots groups of @a cpusPerSlot CPUs, @a node is the
+     * node preferred by the Listener placement.
+     */
+    std::vector<Slot> place(Placement placement, int slots, int cpusPerSlot, int node = -1) const;
+
+    static Placement placementFromString(const QString &name, bool *ok = nullptr);
+    static QVector<int> parseCpuList(const QByteArray &list);
+
+private:
+    QByteArray readFile(const QString &path) const;
+    std::vector<QVector<int>> nodeQueues(bool compact, std::vector<int> *nodes) const;
+
+    QString m_root;
+    std::vector<Cpu> m_cpus;
+};
+
+}
+
+#endif // CPUTOPOLOGY_H
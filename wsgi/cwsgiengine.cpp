@@ -26,6 +26,7 @@
 #include "wsgi.h"
 #include "staticmap.h"
 #include "socket.h"
+#include "trafficcapture.h"
 
 #include "protocolwebsocket.h"
 #include "protocolhttp.h"
@@ -43,12 +44,18 @@
 #include <Cutelyst/Response>
 #include <Cutelyst/Request>
 #include <Cutelyst/Application>
+#include <Cutelyst/ActionChain>
+#include <Cutelyst/enginerequest.h>
+#include <Cutelyst/utils.h>
 
 #include <QCoreApplication>
+#include <QThread>
+#include <QJsonArray>
 
 #include <QLoggingCategory>
 
 Q_LOGGING_CATEGORY(CWSGI_ENGINE, "cwsgi.engine", QtWarningMsg)
+Q_DECLARE_LOGGING_CATEGORY(CWSGI_WATCHDOG)
 
 using namespace CWSGI;
 using namespace Cutelyst;
@@ -80,7 +87,20 @@ CWsgiEngine::CWsgiEngine(Application *localApp, int workerCore, const QVariantMa
         m_socketTimeout->setInterval(m_wsgi->socketTimeout() * 1000);
     }
 
-    connect(this, &CWsgiEngine::shutdown, this, [localApp] {
+    for (auto &bucket : m_lagHistogram) {
+        bucket = 0;
+    }
+
+    m_watchdog = m_wsgi->blockingWatchdog() > 0;
+    if (m_watchdog) {
+        routeAsyncRequests();
+    }
+
+    connect(this, &CWsgiEngine::shutdown, this, [this, localApp] {
+        if (m_lagTimer && m_lagSamples) {
+            qCInfo(CWSGI_ENGINE).noquote() << "Event loop lag of worker" << m_workerId << "core" << workerCore()
+                                           << "\n" << lagReport();
+        }
         Q_EMIT localApp->shuttingDown(localApp);
     });
 }
@@ -152,11 +172,22 @@ void CWsgiEngine::setServers(const std::vector<QObject *> &servers)
 void CWsgiEngine::postFork(int workerId)
 {
     m_workerId = workerId;
+    m_nativeThread.store(QThread::currentThreadId(), std::memory_order_release);
 
 #ifdef Q_OS_UNIX
     UnixFork::setSched(m_wsgi, workerId, workerCore());
 #endif
 
+    const int lagInterval = m_wsgi->eventLoopLag();
+    if (lagInterval > 0) {
+        m_lagTimer = new QTimer(this);
+        m_lagTimer->setTimerType(Qt::PreciseTimer);
+        m_lagTimer->setInterval(lagInterval);
+        connect(m_lagTimer, &QTimer::timeout, this, &CWsgiEngine::lagProbe);
+        m_lagElapsed.start();
+        m_lagTimer->start();
+    }
+
     if (Q_LIKELY(postForkApplication())) {
         Q_EMIT started();
     } else {
@@ -204,10 +235,338 @@ Protocol *CWsgiEngine::getProtoFastCgi()
 bool CWsgiEngine::init()
 {
     if (Q_LIKELY(initApplication())) {
+        if (m_watchdog) {
+            // Connected after the application setup so that plugins
+            // skipping the request don't get it reported
+            connect(app(), &Application::beforeDispatch, this, &CWsgiEngine::watchdogDispatch, Qt::DirectConnection);
+        }
         return true;
     }
 
     return false;
 }
 
+bool CWsgiEngine::watchdogCheck(qint64 now, qint64 threshold)
+{
+    std::shared_ptr<const BusySnapshot> busy;
+    qint64 since;
+    {
+        QMutexLocker locker(&m_busyMutex);
+        if (!m_busy || m_busyReported || now - m_busySince < threshold) {
+            return false;
+        }
+        m_busyReported = true;
+        busy = m_busy;
+        since = m_busySince;
+    }
+
+    qCCritical(CWSGI_WATCHDOG).noquote() << "Worker" << m_workerId << "core" << workerCore()
+                                         << "blocked for" << (now - since) << "ms processing"
+                                         << busy->method << busy->path
+                                         << "action stack:" << busy->actions.join(QLatin1String(" -> "));
+    if (m_lagTimer) {
+        qCCritical(CWSGI_WATCHDOG).noquote() << lagReport();
+    }
+
+    return m_nativeThread.load(std::memory_order_acquire) != nullptr;
+}
+
+static const char *lagBucketNames[] = {
+    "le_1ms", "le_5ms", "le_10ms", "le_50ms", "le_100ms", "le_500ms", "le_1s", "gt_1s"
+};
+
+QVariantMap CWsgiEngine::lagHistogram() const
+{
+    QVariantMap buckets;
+    for (int i = 0; i < LagBuckets; ++i) {
+        buckets.insert(QLatin1String(lagBucketNames[i]), m_lagHistogram[i].load(std::memory_order_relaxed));
+    }
+
+    const quint64 samples = m_lagSamples.load(std::memory_order_relaxed);
+    return {
+        { QStringLiteral("interval_ms"), m_wsgi->eventLoopLag() },
+        { QStringLiteral("samples"), samples },
+        { QStringLiteral("max_us"), m_lagMax.load(std::memory_order_relaxed) },
+        { QStringLiteral("avg_us"), samples ? m_lagSum.load(std::memory_order_relaxed) / samples : 0 },
+        { QStringLiteral("buckets"), buckets },
+    };
+}
+
+QByteArray CWsgiEngine::lagReport() const
+{
+    const QVariantMap histogram = lagHistogram();
+
+    QVector<QStringList> table;
+    for (int i = 0; i < LagBuckets; ++i) {
+        table.append({ QLatin1String(lagBucketNames[i]), QString::number(m_lagHistogram[i].load(std::memory_order_relaxed)) });
+    }
+    table.append({ QStringLiteral("avg"), histogram.value(QStringLiteral("avg_us")).toString() + QLatin1String("us") });
+    table.append({ QStringLiteral("max"), histogram.value(QStringLiteral("max_us")).toString() + QLatin1String("us") });
+
+    return Utils::buildTable(table, { QStringLiteral("Lag"), QStringLiteral("Samples") });
+}
+
+static QJsonObject requestState(const EngineRequest *request)
+{
+    QJsonArray flags;
+    if (request->status & EngineRequest::FinalizedHeaders) {
+        flags.append(QStringLiteral("FinalizedHeaders"));
+    }
+    if (request->status & EngineRequest::IOWrite) {
+        flags.append(QStringLiteral("IOWrite"));
+    }
+    if (request->status & EngineRequest::Chunked) {
+        flags.append(QStringLiteral("Chunked"));
+    }
+    if (request->status & EngineRequest::ChunkedDone) {
+        flags.append(QStringLiteral("ChunkedDone"));
+    }
+    if (request->status & EngineRequest::Async) {
+        flags.append(QStringLiteral("Async"));
+    }
+    if (request->status & EngineRequest::Finalized) {
+        flags.append(QStringLiteral("Finalized"));
+    }
+
+    return {
+        { QStringLiteral("method"), request->method },
+        { QStringLiteral("path"), request->path },
+        { QStringLiteral("status"), flags },
+        { QStringLiteral("elapsed_ms"), request->elapsed.isValid() ? request->elapsed.elapsed() : qint64(-1) },
+    };
+}
+
+static QJsonObject socketState(Socket *sock, QJsonObject &totals)
+{
+    QJsonObject obj{
+        { QStringLiteral("remote_address"), sock->remoteAddress.toString() },
+        { QStringLiteral("remote_port"), sock->remotePort },
+        { QStringLiteral("secure"), sock->isSecure },
+        { QStringLiteral("processing"), sock->processing },
+    };
+
+    ProtocolData *data = sock->protoData;
+    if (!data) {
+        return obj;
+    }
+    obj.insert(QStringLiteral("buffer_used"), data->buf_size);
+    obj.insert(QStringLiteral("buffer_capacity"), data->buffer_capacity);
+
+    const auto addTotal = [&totals] (const QString &key, qint64 value) {
+        totals.insert(key, totals.value(key).toDouble() + value);
+    };
+
+    const Protocol::Type type = sock->proto ? sock->proto->type() : Protocol::Unknown;
+    if (type == Protocol::Http2) {
+        auto h2 = static_cast<ProtoRequestHttp2 *>(data);
+        QJsonArray streams;
+        auto it = h2->streams.constBegin();
+        while (it != h2->streams.constEnd()) {
+            QJsonObject stream = requestState(it.value());
+            stream.insert(QStringLiteral("stream_id"), qint64(it.key()));
+            stream.insert(QStringLiteral("window_size"), it.value()->windowSize);
+            streams.append(stream);
+            ++it;
+        }
+        obj.insert(QStringLiteral("protocol"), QStringLiteral("h2"));
+        obj.insert(QStringLiteral("window_size"), h2->windowSize);
+        obj.insert(QStringLiteral("streams"), streams);
+        addTotal(QStringLiteral("h2_streams"), streams.size());
+        addTotal(QStringLiteral("requests_in_flight"), h2->processing);
+    } else if (type == Protocol::FastCGI1) {
+        auto fcgi = static_cast<ProtoRequestFastCGI *>(data);
+        obj.insert(QStringLiteral("protocol"), QStringLiteral("fastcgi"));
+        if (sock->processing) {
+            obj.insert(QStringLiteral("request"), requestState(fcgi));
+            addTotal(QStringLiteral("requests_in_flight"), 1);
+        }
+    } else {
+        auto http = static_cast<ProtoRequestHttp *>(data);
+        if (http->websocketUpgraded) {
+            const qint64 buffers = http->websocket_message.capacity() + http->websocket_payload.capacity();
+            obj.insert(QStringLiteral("protocol"), QStringLiteral("websocket"));
+            obj.insert(QStringLiteral("websocket_message_size"), http->websocket_message.size());
+            obj.insert(QStringLiteral("websocket_payload_size"), http->websocket_payload.size());
+            obj.insert(QStringLiteral("websocket_buffers_capacity"), buffers);
+            addTotal(QStringLiteral("websockets"), 1);
+            addTotal(QStringLiteral("websocket_buffers_capacity"), buffers);
+        } else {
+            obj.insert(QStringLiteral("protocol"), QStringLiteral("http/1.1"));
+            if (sock->processing) {
+                obj.insert(QStringLiteral("request"), requestState(http));
+                addTotal(QStringLiteral("requests_in_flight"), 1);
+            }
+        }
+    }
+
+    return obj;
+}
+
+void CWsgiEngine::introspect(quint64 id)
+{
+    QJsonObject totals{
+        { QStringLiteral("connections"), 0 },
+        { QStringLiteral("requests_in_flight"), 0 },
+        { QStringLiteral("h2_streams"), 0 },
+        { QStringLiteral("websockets"), 0 },
+        { QStringLiteral("websocket_buffers_capacity"), 0 },
+    };
+
+    QJsonArray servers;
+    const auto childrenL = children();
+    for (QObject *child : childrenL) {
+        QString address;
+        if (auto server = qobject_cast<TcpServer *>(child)) {
+            address = server->m_serverAddress;
+        } else if (auto server = qobject_cast<LocalServer *>(child)) {
+            address = server->fullServerName();
+        } else {
+            continue;
+        }
+
+        QJsonArray connections;
+        const auto sockets = child->children();
+        for (QObject *obj : sockets) {
+            // Sockets already disconnected are either waiting for
+            // deletion or idle local sockets kept for reuse
+            Socket *sock = nullptr;
+            if (auto tcp = qobject_cast<TcpSocket *>(obj)) {
+                if (tcp->state() != QAbstractSocket::UnconnectedState) {
+                    sock = tcp;
+                }
+#ifndef QT_NO_SSL
+            } else if (auto ssl = qobject_cast<SslSocket *>(obj)) {
+                if (ssl->state() != QAbstractSocket::UnconnectedState) {
+                    sock = ssl;
+                }
+#endif
+            } else if (auto local = qobject_cast<LocalSocket *>(obj)) {
+                if (local->state() != QLocalSocket::UnconnectedState) {
+                    sock = local;
+                }
+            }
+
+            if (sock) {
+                connections.append(socketState(sock, totals));
+            }
+        }
+        totals.insert(QStringLiteral("connections"), totals.value(QStringLiteral("connections")).toInt() + connections.size());
+
+        servers.append(QJsonObject{
+                           { QStringLiteral("address"), address },
+                           { QStringLiteral("connections"), connections },
+                       });
+    }
+
+    QJsonObject state{
+        { QStringLiteral("worker_id"), m_workerId },
+        { QStringLiteral("worker_core"), workerCore() },
+        { QStringLiteral("totals"), totals },
+        { QStringLiteral("servers"), servers },
+        { QStringLiteral("buffers_live_bytes"), BufferPool::liveBytes() },
+        { QStringLiteral("buffers_pooled_bytes"), BufferPool::pooledBytes() },
+    };
+    if (m_lagTimer) {
+        state.insert(QStringLiteral("event_loop_lag"), QJsonObject::fromVariantMap(lagHistogram()));
+    }
+
+    Q_EMIT introspected(id, state);
+}
+
+void CWsgiEngine::setTrafficCapture(TrafficCapture *capture)
+{
+    if (!m_capture && !m_watchdog) {
+        routeAsyncRequests();
+    }
+    m_capture = capture;
+}
+
+void CWsgiEngine::routeAsyncRequests()
+{
+    // HTTP/2 streams are dispatched through a queued signal
+    disconnect(this, &Engine::processRequestAsync, this, &Engine::processRequest);
+    connect(this, &Engine::processRequestAsync, this, &CWsgiEngine::processSocketRequest, Qt::QueuedConnection);
+}
+
+void CWsgiEngine::captureRequest(EngineRequest *request)
+{
+    m_capture->record(request);
+}
+
+void CWsgiEngine::watchdogBegin(EngineRequest *request)
+{
+    auto busy = std::make_shared<BusySnapshot>();
+    busy->method = request->method;
+    busy->path = request->path;
+    const qint64 now = QElapsedTimer::msecsSinceReference();
+
+    QMutexLocker locker(&m_busyMutex);
+    m_busy = std::move(busy);
+    m_busySince = now;
+    m_busyReported = false;
+}
+
+void CWsgiEngine::watchdogDispatch(Context *c)
+{
+    Action *action = c->action();
+    if (!action) {
+        return;
+    }
+
+    // Copied here on the engine thread, which is the only one allowed
+    // to look at the context while the request is being processed
+    std::shared_ptr<const BusySnapshot> current;
+    {
+        QMutexLocker locker(&m_busyMutex);
+        current = m_busy;
+    }
+    if (!current) {
+        return;
+    }
+
+    auto busy = std::make_shared<BusySnapshot>(*current);
+    auto chain = qobject_cast<ActionChain *>(action);
+    if (chain) {
+        const ActionList actions = chain->chain();
+        for (Action *chained : actions) {
+            busy->actions.append(chained->reverse());
+        }
+    } else {
+        busy->actions.append(action->reverse());
+    }
+
+    QMutexLocker locker(&m_busyMutex);
+    m_busy = std::move(busy);
+}
+
+void CWsgiEngine::watchdogEnd()
+{
+    QMutexLocker locker(&m_busyMutex);
+    m_busy.reset();
+}
+
+void CWsgiEngine::lagProbe()
+{
+    static const quint64 bucketLimits[LagBuckets - 1] = {
+        1000, 5000, 10000, 50000, 100000, 500000, 1000000
+    };
+
+    const qint64 elapsed = m_lagElapsed.nsecsElapsed() / 1000;
+    m_lagElapsed.restart();
+
+    const quint64 lag = quint64(qMax(Q_INT64_C(0), elapsed - m_lagTimer->interval() * Q_INT64_C(1000)));
+    int bucket = 0;
+    while (bucket < LagBuckets - 1 && lag > bucketLimits[bucket]) {
+        ++bucket;
+    }
+
+    // Only this thread writes, relaxed ordering is enough for readers
+    m_lagHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_lagSamples.fetch_add(1, std::memory_order_relaxed);
+    m_lagSum.fetch_add(lag, std::memory_order_relaxed);
+    if (lag > m_lagMax.load(std::memory_order_relaxed)) {
+        m_lagMax.store(lag, std::memory_order_relaxed);
+    }
+}
+
 #include "moc_cwsgiengine.cpp"
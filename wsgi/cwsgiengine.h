@@ -19,13 +19,24 @@
 #define CWSGI_ENGINE_H
 
 #include <QObject>
+#include <QJsonObject>
 #include <QElapsedTimer>
 #include <QTimer>
+#include <QMutex>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
 
 #include <Cutelyst/Engine>
 
 class QTcpServer;
 
+namespace Cutelyst {
+class Context;
+class EngineRequest;
+}
+
 namespace CWSGI {
 
 class TcpServer;
@@ -34,6 +45,8 @@ class ProtocolFastCGI;
 class ProtocolHttp;
 class ProtocolHttp2;
 class WSGI;
+class EngineWatchdog;
+class TrafficCapture;
 class CWsgiEngine final : public Cutelyst::Engine
 {
     Q_OBJECT
@@ -59,10 +72,62 @@ public:
         return m_lastDate;
     }
 
+    /**
+     * Processes \a request keeping track of the time spent on it
+     * when the blocking watchdog is enabled, and recording it
+     * when traffic capture is enabled.
+     */
+    inline void processSocketRequest(Cutelyst::EngineRequest *request) {
+        if (m_capture) {
+            captureRequest(request);
+        }
+
+        if (m_watchdog) {
+            watchdogBegin(request);
+            processRequest(request);
+            watchdogEnd();
+        } else {
+            processRequest(request);
+        }
+    }
+
+    /**
+     * Called from the watchdog thread, returns true if this engine
+     * got blocked for more than \a threshold milliseconds on the same
+     * request, the request is only reported once.
+     */
+    bool watchdogCheck(qint64 now, qint64 threshold);
+
+    inline Qt::HANDLE nativeThread() const { return m_nativeThread.load(std::memory_order_acquire); }
+
+    /**
+     * Returns the event loop lag histogram, thread safe.
+     */
+    QVariantMap lagHistogram() const;
+
+    /**
+     * Returns a text table with the event loop lag histogram.
+     */
+    QByteArray lagReport() const;
+
+    /**
+     * Collects the state of the servers, connections and in flight
+     * requests of this engine, emitting introspected() with \a id.
+     * Must be invoked on the engine thread.
+     */
+    void introspect(quint64 id);
+
+    /**
+     * Records sampled requests on \a capture, must be called
+     * before the engine thread starts.
+     */
+    void setTrafficCapture(TrafficCapture *capture);
+
 Q_SIGNALS:
     void started();
     void shutdown();
     void shutdownCompleted(CWsgiEngine *engine);
+    void introspected(quint64 id, const QJsonObject &state);
 
 protected:
     inline void startSocketTimeout() {
@@ -86,6 +151,13 @@ protected:
     static QByteArray dateHeader();
 
 private:
+    void routeAsyncRequests();
+    void captureRequest(Cutelyst::EngineRequest *request);
+    void watchdogBegin(Cutelyst::EngineRequest *request);
+    void watchdogDispatch(Cutelyst::Context *c);
+    void watchdogEnd();
+    void lagProbe();
+
     friend class ProtocolHttp;
     friend class ProtocolFastCGI;
     friend class LocalServer;
@@ -93,6 +165,7 @@ private:
     friend class TcpSslServer;
     friend class Connection;
     friend class Socket;
+    friend class EngineWatchdog;
 
     Protocol *getProtoHttp();
     ProtocolHttp2 *getProtoHttp2();
@@ -108,6 +181,32 @@ private:
     ProtocolFastCGI *m_protoFcgi = nullptr;
     int m_runningServers = 0;
     int m_serversTimeout = 0;
+
+    // Blocking watchdog, the busy fields are guarded by m_busyMutex,
+    // the snapshot is never modified once published so the watchdog
+    // thread doesn't touch the request or context being processed
+    struct BusySnapshot {
+        QString method;
+        QString path;
+        QStringList actions;
+    };
+    QMutex m_busyMutex;
+    std::shared_ptr<const BusySnapshot> m_busy;
+    qint64 m_busySince = 0;
+    // Set by postFork() and read by the watchdog thread
+    std::atomic<Qt::HANDLE> m_nativeThread{nullptr};
+    bool m_busyReported = false;
+    bool m_watchdog = false;
+    TrafficCapture *m_capture = nullptr;
+
+    // Event loop lag probe, buckets in microseconds
+    static constexpr int LagBuckets = 8;
+    QTimer *m_lagTimer = nullptr;
+    QElapsedTimer m_lagElapsed;
+    std::atomic<quint64> m_lagHistogram[LagBuckets];
+    std::atomic<quint64> m_lagSamples{0};
+    std::atomic<quint64> m_lagSum{0};
+    std::atomic<quint64> m_lagMax{0};
 };
 
 }
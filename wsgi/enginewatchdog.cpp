@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "enginewatchdog.h"
+
+#include "cwsgiengine.h"
+
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+#include <algorithm>
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+#define WATCHDOG_BACKTRACE
+#endif
+
+Q_LOGGING_CATEGORY(CWSGI_WATCHDOG, "cwsgi.watchdog", QtWarningMsg)
+
+using namespace CWSGI;
+
+#ifdef WATCHDOG_BACKTRACE
+static void backtraceSignalHandler(int)
+{
+    // Runs on the blocked engine thread, only async-signal-safe calls here
+    static const char header[] = "--- Cutelyst-WSGI blocked worker thread backtrace ---\n";
+    static const char footer[] = "--- end of backtrace ---\n";
+    void *frames[64];
+
+    int ret = ::write(STDERR_FILENO, header, sizeof(header) - 1);
+    const int size = backtrace(frames, 64);
+    backtrace_symbols_fd(frames, size, STDERR_FILENO);
+    ret = ::write(STDERR_FILENO, footer, sizeof(footer) - 1);
+    Q_UNUSED(ret)
+}
+#endif
+
+EngineWatchdog::EngineWatchdog(qint64 threshold, int backtraceSignal, QObject *parent) : QThread(parent)
+  , m_threshold(threshold)
+  , m_backtraceSignal(backtraceSignal)
+{
+    setObjectName(QStringLiteral("watchdog"));
+}
+
+EngineWatchdog::~EngineWatchdog()
+{
+    stop();
+    wait();
+}
+
+void EngineWatchdog::addEngine(CWsgiEngine *engine)
+{
+    QMutexLocker locker(&m_mutex);
+    m_engines.push_back(engine);
+}
+
+void EngineWatchdog::removeEngine(CWsgiEngine *engine)
+{
+    QMutexLocker locker(&m_mutex);
+    m_engines.erase(std::remove(m_engines.begin(), m_engines.end(), engine), m_engines.end());
+}
+
+void EngineWatchdog::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_running = false;
+    m_wait.wakeAll();
+}
+
+int EngineWatchdog::installBacktraceHandler(int offset)
+{
+#ifdef WATCHDOG_BACKTRACE
+    // A real-time signal so that SIGURG stays available for out-of-band data
+    const int signal = SIGRTMIN + offset;
+    if (offset < 0 || signal > SIGRTMAX) {
+        qCWarning(CWSGI_WATCHDOG) << "Invalid backtrace signal SIGRTMIN +" << offset
+                                  << "the maximum offset is" << (SIGRTMAX - SIGRTMIN);
+        return 0;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigaction(signal, nullptr, &sa);
+    if (sa.sa_handler != SIG_DFL && sa.sa_handler != backtraceSignalHandler) {
+        qCWarning(CWSGI_WATCHDOG) << "Signal SIGRTMIN +" << offset
+                                  << "already has a handler, not dumping backtraces";
+        return 0;
+    }
+
+    // backtrace() lazy loads libgcc on its first call which
+    // is not safe to happen inside a signal handler
+    void *frames[2];
+    backtrace(frames, 2);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = backtraceSignalHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(signal, &sa, nullptr);
+    return signal;
+#else
+    Q_UNUSED(offset)
+    qCWarning(CWSGI_WATCHDOG) << "Native backtraces are not supported on this platform";
+    return 0;
+#endif
+}
+
+void EngineWatchdog::run()
+{
+    // Check often enough to report a blocked engine close to the threshold
+    const unsigned long interval = qBound(10UL, static_cast<unsigned long>(m_threshold / 4), 1000UL);
+
+    QMutexLocker locker(&m_mutex);
+    while (m_running) {
+        m_wait.wait(&m_mutex, interval);
+        if (!m_running) {
+            break;
+        }
+
+        const qint64 now = QElapsedTimer::msecsSinceReference();
+        for (CWsgiEngine *engine : m_engines) {
+            if (engine->watchdogCheck(now, m_threshold) && m_backtraceSignal) {
+#ifdef WATCHDOG_BACKTRACE
+                pthread_kill(static_cast<pthread_t>(reinterpret_cast<quintptr>(engine->nativeThread())), m_backtraceSignal);
+#endif
+            }
+        }
+    }
+}
+
+#include "moc_enginewatchdog.cpp"
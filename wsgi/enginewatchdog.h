@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef ENGINEWATCHDOG_H
+#define ENGINEWATCHDOG_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <vector>
+
+namespace CWSGI {
+
+class CWsgiEngine;
+class EngineWatchdog final : public QThread
+{
+    Q_OBJECT
+public:
+    /**
+     * Creates a watchdog that reports engines which spent more than
+     * \p threshold milliseconds processing a single request without
+     * returning to their event loop, when \p backtraceSignal is not zero
+     * it's sent to the blocked thread to dump its native backtrace.
+     */
+    explicit EngineWatchdog(qint64 threshold, int backtraceSignal = 0, QObject *parent = nullptr);
+    ~EngineWatchdog() override;
+
+    void addEngine(CWsgiEngine *engine);
+    void removeEngine(CWsgiEngine *engine);
+
+    void stop();
+
+    /**
+     * Installs the handler of the real-time signal SIGRTMIN + \p offset used
+     * to dump the native backtrace of a blocked engine thread, must be called
+     * before the engine threads are started. Returns the signal number or
+     * zero if it couldn't be installed.
+     */
+    static int installBacktraceHandler(int offset);
+
+protected:
+    void run() override;
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_wait;
+    std::vector<CWsgiEngine *> m_engines;
+    qint64 m_threshold;
+    int m_backtraceSignal;
+    bool m_running = true;
+};
+
+}
+
+#endif // ENGINEWATCHDOG_H
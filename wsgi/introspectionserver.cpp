@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "introspectionserver.h"
+#include "cwsgiengine.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QLoggingCategory>
+#include <QTimer>
+
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(CWSGI_INTROSPECTION, "cwsgi.introspection", QtWarningMsg)
+
+using namespace CWSGI;
+
+IntrospectionServer::IntrospectionServer(QObject *parent) : QObject(parent)
+  , m_server(new QLocalServer(this))
+{
+    connect(m_server, &QLocalServer::newConnection, this, &IntrospectionServer::newConnection);
+}
+
+IntrospectionServer::~IntrospectionServer()
+{
+}
+
+bool IntrospectionServer::listen(const QString &name)
+{
+    QLocalServer::removeServer(name);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!m_server->listen(name)) {
+        qCCritical(CWSGI_INTROSPECTION) << "Failed to listen on introspection socket" << name << m_server->errorString();
+        return false;
+    }
+    qCInfo(CWSGI_INTROSPECTION) << "Introspection socket listening on" << m_server->fullServerName();
+    return true;
+}
+
+void IntrospectionServer::addEngine(CWsgiEngine *engine)
+{
+    m_engines.push_back(engine);
+    // Queued both ways so the state is computed on the engine thread
+    // and the reply is assembled on ours, never blocking request processing
+    connect(this, &IntrospectionServer::collect, engine, &CWsgiEngine::introspect, Qt::QueuedConnection);
+    connect(engine, &CWsgiEngine::introspected, this, &IntrospectionServer::engineState, Qt::QueuedConnection);
+}
+
+void IntrospectionServer::removeEngine(CWsgiEngine *engine)
+{
+    m_engines.erase(std::remove(m_engines.begin(), m_engines.end(), engine), m_engines.end());
+    disconnect(this, &IntrospectionServer::collect, engine, &CWsgiEngine::introspect);
+    disconnect(engine, &CWsgiEngine::introspected, this, &IntrospectionServer::engineState);
+}
+
+void IntrospectionServer::newConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+
+        const quint64 id = ++m_lastId;
+        Pending &pending = m_pending[id];
+        pending.socket = socket;
+        pending.remaining = int(m_engines.size());
+
+        if (pending.remaining == 0) {
+            finish(id, true);
+            continue;
+        }
+
+        // A blocked engine thread will never reply, so send what we have
+        QTimer::singleShot(5 * 1000, this, [this, id] {
+            finish(id, false);
+        });
+
+        Q_EMIT collect(id);
+    }
+}
+
+void IntrospectionServer::engineState(quint64 id, const QJsonObject &state)
+{
+    auto it = m_pending.find(id);
+    if (it == m_pending.end()) {
+        return;
+    }
+
+    it->engines.append(state);
+    if (--it->remaining == 0) {
+        finish(id, true);
+    }
+}
+
+void IntrospectionServer::finish(quint64 id, bool complete)
+{
+    auto it = m_pending.find(id);
+    if (it == m_pending.end()) {
+        return;
+    }
+
+    QLocalSocket *socket = it->socket.data();
+    if (socket) {
+        const QJsonObject obj{
+            {QStringLiteral("pid"), QCoreApplication::applicationPid()},
+            {QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+            {QStringLiteral("complete"), complete},
+            {QStringLiteral("memory"), memoryUsage()},
+            {QStringLiteral("engines"), it->engines},
+        };
+        socket->write(QJsonDocument(obj).toJson(QJsonDocument::Indented));
+        socket->disconnectFromServer();
+    }
+    m_pending.erase(it);
+}
+
+QJsonObject IntrospectionServer::memoryUsage()
+{
+    QJsonObject ret;
+
+    // smaps_rollup needs Linux 4.14, smaps has the same fields once per mapping
+    QFile file(QStringLiteral("/proc/self/smaps_rollup"));
+    if (!file.open(QFile::ReadOnly)) {
+        file.setFileName(QStringLiteral("/proc/self/smaps"));
+        if (!file.open(QFile::ReadOnly)) {
+            return ret;
+        }
+    }
+
+    static const QByteArrayList fields = {
+        QByteArrayLiteral("Rss"),
+        QByteArrayLiteral("Pss"),
+        QByteArrayLiteral("Shared_Clean"),
+        QByteArrayLiteral("Shared_Dirty"),
+        QByteArrayLiteral("Private_Clean"),
+        QByteArrayLiteral("Private_Dirty"),
+        QByteArrayLiteral("Swap"),
+    };
+    qint64 values[7] = {};
+
+    // Lines look like "Shared_Dirty:       1234 kB"
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        const int colon = line.indexOf(':');
+        if (colon == -1) {
+            continue;
+        }
+
+        const int index = fields.indexOf(line.left(colon));
+        if (index != -1) {
+            values[index] += line.mid(colon + 1).simplified().split(' ').first().toLongLong();
+        }
+    }
+
+    for (int i = 0; i < fields.size(); ++i) {
+        ret.insert(QString::fromLatin1(fields.at(i).toLower()) + QLatin1String("_kb"), values[i]);
+    }
+    ret.insert(QStringLiteral("shared_kb"), values[2] + values[3]);
+    ret.insert(QStringLiteral("private_kb"), values[4] + values[5]);
+
+    return ret;
+}
+
+#include "moc_introspectionserver.cpp"
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef INTROSPECTIONSERVER_H
+#define INTROSPECTIONSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonArray>
+#include <QPointer>
+
+#include <vector>
+
+class QLocalServer;
+class QLocalSocket;
+
+namespace CWSGI {
+
+class CWsgiEngine;
+class IntrospectionServer final : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IntrospectionServer(QObject *parent = nullptr);
+    ~IntrospectionServer() override;
+
+    bool listen(const QString &name);
+
+    void addEngine(CWsgiEngine *engine);
+    void removeEngine(CWsgiEngine *engine);
+
+    // Shared versus private memory of this process in KiB
+    static QJsonObject memoryUsage();
+
+Q_SIGNALS:
+    void collect(quint64 id);
+
+private:
+    struct Pending {
+        QPointer<QLocalSocket> socket;
+        QJsonArray engines;
+        int remaining = 0;
+    };
+
+    void newConnection();
+    void engineState(quint64 id, const QJsonObject &state);
+    void finish(quint64 id, bool complete);
+
+    QHash<quint64, Pending> m_pending;
+    std::vector<CWsgiEngine *> m_engines;
+    QLocalServer *m_server;
+    quint64 m_lastId = 0;
+};
+
+}
+
+#endif // INTROSPECTIONSERVER_H
@@ -24,6 +24,12 @@
 #include "wsgi.h"
 #include "config.h"
 
+#ifdef ALLOCATION_STATS
+#include <Cutelyst/stats.h>
+
+void cwsgiAllocationCount(quint64 *count, quint64 *bytes);
+#endif
+
 int main(int argc, char *argv[])
 {
     QCoreApplication::setOrganizationName(QStringLiteral("Cutelyst"));
@@ -31,6 +37,10 @@ int main(int argc, char *argv[])
     QCoreApplication::setApplicationName(QStringLiteral("cutelyst-wsgi"));
     QCoreApplication::setApplicationVersion(QStringLiteral(VERSION));
 
+#ifdef ALLOCATION_STATS
+    Cutelyst::Stats::setAllocationCounter(cwsgiAllocationCount);
+#endif
+
     CWSGI::WSGI wsgi;
 
     QCoreApplication app(argc, argv);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2016-2017 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2016-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -17,9 +17,93 @@
  */
 #include "postunbuffered.h"
 
-PostUnbuffered::PostUnbuffered(QObject *parent) : QIODevice(parent)
+using namespace CWSGI;
+
+PostUnbuffered::PostUnbuffered(qint64 contentLength, QObject *parent) : QIODevice(parent)
+  , m_contentLength(contentLength)
 {
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+qint64 PostUnbuffered::size() const
+{
+    return m_contentLength;
+}
+
+qint64 PostUnbuffered::bytesAvailable() const
+{
+    return m_received - pos();
+}
+
+bool PostUnbuffered::atEnd() const
+{
+    return pos() == m_received && (m_received == m_contentLength || m_aborted);
+}
+
+bool PostUnbuffered::seek(qint64 pos)
+{
+    if (pos < m_offset || pos > m_received) {
+        return false;
+    }
+    return QIODevice::seek(pos);
+}
+
+void PostUnbuffered::append(const char *data, qint64 len)
+{
+    m_buffer.append(data, int(len));
+    m_received += len;
+
+    Q_EMIT readyRead();
 
+    if (m_received == m_contentLength) {
+        Q_EMIT readChannelFinished();
+    }
+}
+
+void PostUnbuffered::abort()
+{
+    m_aborted = true;
+    setErrorString(QStringLiteral("Connection closed before the body was received"));
+
+    Q_EMIT aborted();
+    // Wakes up readers waiting for more data, they will find the error
+    Q_EMIT readyRead();
+}
+
+bool PostUnbuffered::pause()
+{
+    m_paused = bytesAvailable() >= HighWaterMark;
+    return m_paused;
+}
+
+qint64 PostUnbuffered::readData(char *data, qint64 maxlen)
+{
+    const int start = int(pos() - m_offset);
+    const qint64 len = qMin(maxlen, qint64(m_buffer.size() - start));
+    if (len <= 0) {
+        return m_aborted ? -1 : 0;
+    }
+    memcpy(data, m_buffer.constData() + start, size_t(len));
+
+    const int consumed = start + int(len);
+    if (discardConsumed && (consumed == m_buffer.size() || consumed >= HighWaterMark / 4)) {
+        m_buffer.remove(0, consumed);
+        m_offset += consumed;
+    }
+
+    if (m_paused && m_received - (pos() + len) < HighWaterMark / 2) {
+        m_paused = false;
+        Q_EMIT drained();
+    }
+
+    return len;
+}
+
+qint64 PostUnbuffered::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(len)
+    return -1;
 }
 
 #include "moc_postunbuffered.cpp"
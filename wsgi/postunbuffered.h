@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2016-2019 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2016-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -20,13 +20,96 @@
 
 #include <QIODevice>
 
+namespace CWSGI {
+
+/*!
+ * Request body device filled as the body arrives from the
+ * connection, used when the action is dispatched as soon
+ * as the request headers are parsed.
+ *
+ * readyRead() is emitted for each received piece and
+ * readChannelFinished() once the whole body arrived.
+ *
+ * If the connection closes before that, readChannelFinished()
+ * is never emitted, aborted() and readyRead() are emitted
+ * instead, isAborted() returns true and reads past the received
+ * data fail with errorString() set.
+ */
 class PostUnbuffered : public QIODevice
 {
     Q_OBJECT
 public:
-    explicit PostUnbuffered(QObject *parent = nullptr);
+    explicit PostUnbuffered(qint64 contentLength, QObject *parent = nullptr);
+
+    /*!
+     * Amount of unread bytes after which the
+     * connection stops reading the body
+     */
+    static constexpr qint64 HighWaterMark = 64 * 1024;
+
+    virtual qint64 size() const override;
+
+    virtual qint64 bytesAvailable() const override;
+
+    virtual bool atEnd() const override;
+
+    virtual bool seek(qint64 pos) override;
+
+    /*!
+     * Appends body data read from the connection
+     */
+    void append(const char *data, qint64 len);
 
-    qint64 m_contentLength = 0;
+    /*!
+     * Called when the connection was closed before
+     * the whole body was received
+     */
+    void abort();
+
+    /*!
+     * Returns true if the body is incomplete
+     * because the connection was closed
+     */
+    inline bool isAborted() const {
+        return m_aborted;
+    }
+
+    /*!
+     * Returns true if the reader is too far behind, in which
+     * case drained() is emitted once it catches up
+     */
+    bool pause();
+
+    inline qint64 remaining() const {
+        return m_contentLength - m_received;
+    }
+
+    /*! When set data already read is dropped, so it can't be seeked back */
+    bool discardConsumed = false;
+
+Q_SIGNALS:
+    void drained();
+
+    /*!
+     * Emitted when the connection was closed
+     * before the whole body was received
+     */
+    void aborted();
+
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen) override;
+
+    virtual qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    QByteArray m_buffer;
+    qint64 m_contentLength;
+    qint64 m_received = 0;
+    qint64 m_offset = 0;
+    bool m_paused = false;
+    bool m_aborted = false;
 };
 
+}
+
 #endif // POSTUNBUFFERED_H
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2016-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2016-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -22,6 +22,8 @@
 
 #include <QTemporaryFile>
 #include <QBuffer>
+#include <QHash>
+#include <QVector>
 
 #include <QLoggingCategory>
 
@@ -29,15 +31,100 @@ Q_LOGGING_CATEGORY(CWSGI_PROTO, "cwsgi.proto", QtWarningMsg)
 
 using namespace CWSGI;
 
+struct BufferPoolData
+{
+    ~BufferPoolData() {
+        for (const QVector<char *> &buffers : free) {
+            for (char *buffer : buffers) {
+                delete [] buffer;
+            }
+        }
+    }
+
+    QHash<int, QVector<char *>> free;
+    qint64 live = 0;
+    qint64 pooled = 0;
+};
+
+// Don't keep more than this per thread around after a burst of connections
+static const qint64 MaxPooledBytes = 8 * 1024 * 1024;
+
+static thread_local BufferPoolData bufferPool;
+
+char *BufferPool::acquire(int size)
+{
+    bufferPool.live += size;
+
+    auto it = bufferPool.free.find(size);
+    if (it != bufferPool.free.end() && !it->isEmpty()) {
+        bufferPool.pooled -= size;
+        char *buffer = it->last();
+        it->removeLast();
+        return buffer;
+    }
+    return new char[size];
+}
+
+void BufferPool::release(char *buffer, int size)
+{
+    bufferPool.live -= size;
+
+    if (bufferPool.pooled + size > MaxPooledBytes) {
+        delete [] buffer;
+        return;
+    }
+    bufferPool.pooled += size;
+    bufferPool.free[size].append(buffer);
+}
+
+qint64 BufferPool::liveBytes()
+{
+    return bufferPool.live;
+}
+
+qint64 BufferPool::pooledBytes()
+{
+    return bufferPool.pooled;
+}
+
 ProtocolData::ProtocolData(Socket *_sock, int bufferSize) : sock(_sock)
     , io(dynamic_cast<QIODevice *>(_sock))
-    , buffer(new char[bufferSize])
 {
+    if (bufferSize) {
+        buffer = BufferPool::acquire(bufferSize);
+        buffer_capacity = bufferSize;
+    }
 }
 
 ProtocolData::~ProtocolData()
 {
-    delete [] buffer;
+    if (buffer) {
+        BufferPool::release(buffer, buffer_capacity);
+    }
+}
+
+void ProtocolData::reserveBuffer(int size)
+{
+    if (size <= buffer_capacity) {
+        return;
+    }
+
+    char *newBuffer = BufferPool::acquire(size);
+    if (buffer) {
+        memcpy(newBuffer, buffer, size_t(buf_size));
+        BufferPool::release(buffer, buffer_capacity);
+    }
+    buffer = newBuffer;
+    buffer_capacity = size;
+}
+
+void ProtocolData::releaseBuffer()
+{
+    if (buffer) {
+        BufferPool::release(buffer, buffer_capacity);
+        buffer = nullptr;
+        buffer_capacity = 0;
+    }
 }
 
 Protocol::Protocol(WSGI *wsgi)
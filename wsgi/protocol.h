@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2016-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2016-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -28,10 +28,27 @@ namespace CWSGI {
 class WSGI;
 class Socket;
 class Protocol;
+
+/**
+ * Per thread pool of parser buffers, idle connections give
+ * their buffers back so that memory is only held by
+ * connections that are actually receiving data
+ */
+class BufferPool
+{
+public:
+    static char *acquire(int size);
+    static void release(char *buffer, int size);
+
+    static qint64 liveBytes();
+    static qint64 pooledBytes();
+};
+
 class ProtocolData
 {
     Q_GADGET
 public:
+    // When bufferSize is 0 the buffer is only allocated by reserveBuffer()
     ProtocolData(Socket *sock, int bufferSize);
     virtual ~ProtocolData();
 
@@ -61,6 +78,11 @@ public:
         X_Forwarded_Proto = false;
     }
 
+    // Makes room for at least size bytes, keeping the buffered data
+    void reserveBuffer(int size);
+    // Gives the buffer back to the pool, must only be called when empty
+    void releaseBuffer();
+
     virtual void socketDisconnected() {}
     virtual void setupNewConnection(Socket *sock) = 0;
 
@@ -69,9 +91,10 @@ public:
     QIODevice *io;
     ProtocolData *upgradedFrom = nullptr;
     int buf_size = 0;
+    int buffer_capacity = 0;
     ParserState connState = MethodLine;
     HeaderConnection headerConnection = HeaderConnectionNotSet;
-    char *buffer;
+    char *buffer = nullptr;
     bool headerHost = false;
     bool X_Forwarded_For = false;
     bool X_Forwarded_Host = false;
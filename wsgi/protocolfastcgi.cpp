@@ -393,7 +393,7 @@ void ProtocolFastCGI::parse(Socket *sock, QIODevice *io) const
                 if (request->body) {
                     request->body->seek(0);
                 }
-                sock->engine->processRequest(request);
+                static_cast<CWsgiEngine *>(sock->engine)->processSocketRequest(request);
                 if (request->status & Cutelyst::EngineRequest::Async) {
                     return; // We are in async mode
                 }
@@ -535,6 +535,17 @@ qint64 ProtoRequestFastCGI::doWrite(const char *data, qint64 len)
 
 #define FCGI_END_REQUEST_DATA "\1\x06\0\1\0\0\0\0\1\3\0\1\0\x08\0\0\0\0\0\0\0\0\0\0"
 
+Cutelyst::EngineRequest::StreamingFraming ProtoRequestFastCGI::streamingFraming() const
+{
+    // FCGI_STDOUT records are delimited by FCGI_END_REQUEST
+    return NativeFraming;
+}
+
+qint64 ProtoRequestFastCGI::bytesToWrite() const
+{
+    return io->bytesToWrite();
+}
+
 void ProtoRequestFastCGI::processingFinished()
 {
     char end_request[] = FCGI_END_REQUEST_DATA;
@@ -46,6 +46,10 @@ public:
 
     virtual void processingFinished() override final;
 
+    virtual StreamingFraming streamingFraming() const override final;
+
+    virtual qint64 bytesToWrite() const override final;
+
     inline virtual void resetData() override final {
         ProtocolData::resetData();
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2016-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2016-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -20,6 +20,7 @@
 #include "protocolwebsocket.h"
 #include "wsgi.h"
 #include "protocolhttp2.h"
+#include "postunbuffered.h"
 
 #include <Cutelyst/Headers>
 #include <Cutelyst/Context>
@@ -46,6 +47,7 @@ ProtocolHttp::ProtocolHttp(WSGI *wsgi, ProtocolHttp2 *upgradeH2c) : Protocol(wsg
   , m_upgradeH2c(upgradeH2c)
 {
     usingFrontendProxy = wsgi->usingFrontendProxy();
+    m_chunkedMinimumSize = wsgi->chunkedMinSize();
 }
 
 ProtocolHttp::~ProtocolHttp()
@@ -83,7 +85,39 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
 {
     // Post buffering
     auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
-    if (protoRequest->status & Cutelyst::EngineRequest::Async) {
+    if (protoRequest->bodyStream) {
+        // The action is already running and consuming the body
+        PostUnbuffered *stream = protoRequest->bodyStream;
+        const bool streaming = protoRequest->status & Cutelyst::EngineRequest::BodyStreaming;
+        stream->discardConsumed = streaming;
+
+        // Stop reading while the action is behind, the socket read
+        // buffer is limited so the kernel will make the client wait
+        while (stream->remaining() && !(streaming && stream->pause())) {
+            qint64 len = io->read(m_postBuffer, qMin(m_postBufferSize, stream->remaining()));
+            if (len == -1) {
+                qCWarning(CWSGI_HTTP) << "error while reading body" << len << protoRequest->headers;
+                sock->connectionClose();
+                return;
+            } else if (len == 0) {
+                break;
+            }
+
+            if (len == stream->remaining()) {
+                // Pipelined requests are parsed once this one is finished
+                protoRequest->bodyStream = nullptr;
+                sock->setReadBufferLimit(0);
+            }
+            stream->append(m_postBuffer, len);
+
+            if (protoRequest->bodyStream != stream) {
+                break;
+            }
+        }
+        return;
+    }
+
+    if (protoRequest->status & Cutelyst::EngineRequest::Async && !protoRequest->bodyRequested) {
         return;
     }
 
@@ -93,8 +127,11 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
         qint64 remaining;
 
         QIODevice *body = protoRequest->body;
+        const bool requested = protoRequest->bodyRequested;
+        // Only requests that asked for 100 Continue get here unbuffered
+        auto stream = m_postBuffering == 0 ? static_cast<PostUnbuffered *>(body) : nullptr;
         do {
-            remaining = protoRequest->contentLength - body->size();
+            remaining = stream ? stream->remaining() : protoRequest->contentLength - body->size();
             len = io->read(m_postBuffer, qMin(m_postBufferSize, remaining));
             if (len == -1) {
                 qCWarning(CWSGI_HTTP) << "error while reading body" << len << protoRequest->headers;
@@ -103,17 +140,38 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
             }
             bytesAvailable -= len;
 //            qCDebug(CWSGI_HTTP) << "WRITE body" << protoRequest->contentLength << remaining << len << (remaining == len) << io->bytesAvailable();
-            body->write(m_postBuffer, len);
-        } while (bytesAvailable);
-
-        if (remaining == len) {
-            processRequest(sock, io);
+            if (stream) {
+                if (remaining == len) {
+                    // The last piece emits readChannelFinished(),
+                    // which might finish the request right away
+                    protoRequest->bodyRequested = false;
+                }
+                stream->append(m_postBuffer, len);
+            } else {
+                body->write(m_postBuffer, len);
+            }
+        } while (bytesAvailable && remaining != len);
+
+        if (remaining == len && !stream) {
+            if (requested) {
+                // The context waits for the body asked with continueBody()
+                protoRequest->bodyRequested = false;
+                body->seek(0);
+                Q_EMIT body->readChannelFinished();
+            } else {
+                processRequest(sock, io);
+            }
         }
 
         return;
     }
 
-    qint64 len = io->read(protoRequest->buffer + protoRequest->buf_size, m_bufferSize - protoRequest->buf_size);
+    if (protoRequest->buf_size == protoRequest->buffer_capacity) {
+        // Start small and grow on demand up to buffer-size
+        protoRequest->reserveBuffer(qMin(m_bufferSize, qMax(int(InitialBufferSize), protoRequest->buffer_capacity * 2)));
+    }
+
+    qint64 len = io->read(protoRequest->buffer + protoRequest->buf_size, protoRequest->buffer_capacity - protoRequest->buf_size);
     if (len == -1) {
         qCWarning(CWSGI_HTTP) << "Failed to read from socket" << io->errorString();
         return;
@@ -145,22 +203,56 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
                 } else {
                     if (protoRequest->contentLength > 0) {
                         protoRequest->connState = ProtoRequestHttp::ContentBody;
-                        protoRequest->body = createBody(protoRequest->contentLength);
-                        if (!protoRequest->body) {
-                            qCWarning(CWSGI_HTTP) << "error while creating body, closing socket";
-                            sock->connectionClose();
-                            return;
+                        if (m_postBuffering == 0) {
+                            protoRequest->body = new PostUnbuffered(protoRequest->contentLength);
+                        } else {
+                            protoRequest->body = createBody(protoRequest->contentLength);
+                            if (!protoRequest->body) {
+                                qCWarning(CWSGI_HTTP) << "error while creating body, closing socket";
+                                sock->connectionClose();
+                                return;
+                            }
                         }
 
                         ptr += 2;
                         len = qMin(protoRequest->contentLength, static_cast<qint64>(protoRequest->buf_size - protoRequest->last));
+
+                        if (!len && protoRequest->protocol == QLatin1String("HTTP/1.1") &&
+                                protoRequest->headers.header(QStringLiteral("EXPECT")).compare(QLatin1String("100-continue"), Qt::CaseInsensitive) == 0) {
+                            // Dispatch now so that Begin and Auto actions can reject
+                            // the request before the client sends the body
+                            protoRequest->status |= Cutelyst::EngineRequest::ExpectContinue;
+                            processRequest(sock, io);
+                            return;
+                        }
 //                        qCDebug(CWSGI_HTTP) << "WRITE" << protoRequest->contentLength << len;
                         if (len) {
-                            protoRequest->body->write(ptr, len);
+                            if (m_postBuffering == 0) {
+                                static_cast<PostUnbuffered *>(protoRequest->body)->append(ptr, len);
+                            } else {
+                                protoRequest->body->write(ptr, len);
+                            }
                         }
                         protoRequest->last += len;
 
-                        if (protoRequest->contentLength > len) {
+                        if (protoRequest->contentLength > len && m_postBuffering == 0) {
+                            // Unbuffered, dispatch now and feed the body as it arrives
+                            auto stream = static_cast<PostUnbuffered *>(protoRequest->body);
+                            protoRequest->bodyStream = stream;
+                            protoRequest->status |= Cutelyst::EngineRequest::BodyStreaming;
+                            sock->setReadBufferLimit(PostUnbuffered::HighWaterMark);
+                            QObject::connect(stream, &PostUnbuffered::drained, stream, [this, sock, io, stream] {
+                                if (static_cast<ProtoRequestHttp *>(sock->protoData)->bodyStream == stream) {
+                                    parse(sock, io);
+                                }
+                            }, Qt::QueuedConnection);
+
+                            processRequest(sock, io);
+                            if (protoRequest->bodyStream && io->bytesAvailable()) {
+                                parse(sock, io);
+                            }
+                            return;
+                        } else if (protoRequest->contentLength > len) {
 //                            qCDebug(CWSGI_HTTP) << "WRITE more..." << protoRequest->contentLength << len;
                             // body is not completed yet
                             if (io->bytesAvailable()) {
@@ -185,14 +277,26 @@ void ProtocolHttp::parse(Socket *sock, QIODevice *io) const
         }
     }
 
-    if (protoRequest->buf_size == m_bufferSize) {
-        // 414 Request-URI Too Long
+    if (protoRequest->buf_size == protoRequest->buffer_capacity
+            && protoRequest->connState != ProtoRequestHttp::ContentBody
+            && !(protoRequest->status & Cutelyst::EngineRequest::Async)) {
+        if (protoRequest->buffer_capacity < m_bufferSize) {
+            if (io->bytesAvailable()) {
+                parse(sock, io);
+            }
+        } else {
+            // The request line or headers don't fit in buffer-size
+            rejectRequest(sock, io, protoRequest->connState == ProtoRequestHttp::MethodLine);
+        }
     }
 }
 
 ProtocolData *ProtocolHttp::createData(Socket *sock) const
 {
-    return new ProtoRequestHttp(sock, m_bufferSize);
+    // The buffer is allocated once data arrives
+    auto data = new ProtoRequestHttp(sock, 0);
+    data->chunkedMinimumSize = m_chunkedMinimumSize;
+    return data;
 }
 
 bool ProtocolHttp::processRequest(Socket *sock, QIODevice *io) const
@@ -209,7 +313,7 @@ bool ProtocolHttp::processRequest(Socket *sock, QIODevice *io) const
     }
 
     ++sock->processing;
-    sock->engine->processRequest(request);
+    static_cast<CWsgiEngine *>(sock->engine)->processSocketRequest(request);
 
     if (request->websocketUpgraded) {
         return false; // Must read remaining data
@@ -222,6 +326,20 @@ bool ProtocolHttp::processRequest(Socket *sock, QIODevice *io) const
     return true;
 }
 
+void ProtocolHttp::rejectRequest(Socket *sock, QIODevice *io, bool uriTooLong) const
+{
+    qCWarning(CWSGI_HTTP) << "Request" << (uriTooLong ? "line" : "headers") << "larger than buffer-size" << m_bufferSize;
+
+    if (uriTooLong) {
+        io->write(QByteArrayLiteral("HTTP/1.1 414 Request-URI Too Long\r\n"
+                                    "Connection: close\r\nContent-Length: 0\r\n\r\n"));
+    } else {
+        io->write(QByteArrayLiteral("HTTP/1.1 431 Request Header Fields Too Large\r\n"
+                                    "Connection: close\r\nContent-Length: 0\r\n\r\n"));
+    }
+    sock->connectionClose();
+}
+
 void ProtocolHttp::parseMethod(const char *ptr, const char *end, Socket *sock) const
 {
     auto protoRequest = static_cast<ProtoRequestHttp *>(sock->protoData);
@@ -392,6 +510,11 @@ bool ProtoRequestHttp::writeHeaders(quint16 status, const Cutelyst::Headers &hea
         ++it;
     }
 
+    if (this->status & EngineRequest::ExpectContinue) {
+        // The body wasn't asked for, the connection is closed afterwards
+        fallbackConnection = ProtoRequestHttp::HeaderConnectionClose;
+    }
+
     if (headerConnection == ProtoRequestHttp::HeaderConnectionNotSet) {
         if (fallbackConnection == ProtoRequestHttp::HeaderConnectionKeep
                 || (fallbackConnection != ProtoRequestHttp::HeaderConnectionClose && protocol == QLatin1String("HTTP/1.1"))) {
@@ -416,6 +539,34 @@ qint64 ProtoRequestHttp::doWrite(const char *data, qint64 len)
     return io->write(data, len);
 }
 
+void ProtoRequestHttp::continueBody()
+{
+    bodyRequested = true;
+    io->write("HTTP/1.1 100 Continue\r\n\r\n", 25);
+
+    // The client might not have waited, and as this can't attach
+    // the context right away read what is available later
+    QTimer::singleShot(0, io, [this] {
+        if (bodyRequested) {
+            sock->proto->parse(sock, io);
+        }
+    });
+}
+
+Cutelyst::EngineRequest::StreamingFraming ProtoRequestHttp::streamingFraming() const
+{
+    // HTTP/1.0 clients only know the body ended when the connection closes
+    if (protocol == QLatin1String("HTTP/1.1")) {
+        return ChunkedEncoding;
+    }
+    return CloseConnection;
+}
+
+qint64 ProtoRequestHttp::bytesToWrite() const
+{
+    return io->bytesToWrite();
+}
+
 void ProtoRequestHttp::processingFinished()
 {
     if (websocketUpgraded) {
@@ -423,6 +574,8 @@ void ProtoRequestHttp::processingFinished()
         websocket_need = 2;
         websocket_phase = ProtoRequestHttp::WebSocketPhaseHeaders;
         buf_size = 0;
+        // Websocket frames are read into the shared protocol buffer
+        releaseBuffer();
         return;
     }
 
@@ -431,11 +584,29 @@ void ProtoRequestHttp::processingFinished()
         return;
     }
 
+    if (bodyStream) {
+        // The action finished before the whole body was received,
+        // what is left of it can't be told apart from a new request
+        bodyStream = nullptr;
+        sock->connectionClose();
+        return;
+    }
+
+    if (status & EngineRequest::ExpectContinue || bodyRequested) {
+        // The body was rejected or not fully received and
+        // the client might still send it
+        bodyRequested = false;
+        sock->connectionClose();
+        return;
+    }
+
     if (headerConnection == ProtoRequestHttp::HeaderConnectionClose) {
         sock->connectionClose();
         return;
     }
 
+    // resetData() clears the status
+    const bool wasAsync = status & EngineRequest::Async;
     if (last < buf_size) {
         // move pipelined request to 0
         int remaining = buf_size - last;
@@ -443,11 +614,18 @@ void ProtoRequestHttp::processingFinished()
         resetData();
         buf_size = remaining;
 
-        if (status & EngineRequest::Async) {
+        if (wasAsync) {
             sock->proto->parse(sock, io);
         }
     } else {
         resetData();
+        releaseBuffer();
+
+        // Edge triggered sockets are not notified again about data
+        // that arrived while the request was processed asynchronously
+        if (wasAsync && io->bytesAvailable()) {
+            sock->proto->parse(sock, io);
+        }
     }
 }
 
@@ -498,6 +676,20 @@ bool ProtoRequestHttp::webSocketClose(quint16 code, const QString &reason)
 
 void ProtoRequestHttp::socketDisconnected()
 {
+    if (bodyStream) {
+        PostUnbuffered *stream = bodyStream;
+        bodyStream = nullptr;
+        // Application clears BodyStreaming when it defers the dispatch
+        // until the body is complete, that will never happen now
+        const bool deferred = !(status & Cutelyst::EngineRequest::BodyStreaming);
+        stream->abort();
+
+        if (deferred && context && !(status & Cutelyst::EngineRequest::Finalized)) {
+            context->response()->setStatus(Cutelyst::Response::BadRequest);
+            context->attachAsync();
+        }
+    }
+
     if (websocketUpgraded) {
         if (websocket_finn_opcode != 0x88) {
             Q_EMIT context->request()->webSocketClosed(1005, QString());
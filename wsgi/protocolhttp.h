@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2016-2018 Daniel Nicoletti <dantti12@gmail.com>
+ * Copyright (C) 2016-2020 Daniel Nicoletti <dantti12@gmail.com>
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -78,6 +78,12 @@ public:
 
     virtual void processingFinished() override final;
 
+    virtual void continueBody() override final;
+
+    virtual StreamingFraming streamingFraming() const override final;
+
+    virtual qint64 bytesToWrite() const override final;
+
     virtual bool webSocketSendTextMessage(const QString &message) override final;
 
     virtual bool webSocketSendBinaryMessage(const QByteArray &message) override final;
@@ -102,6 +108,8 @@ public:
         status = InitialState;
 
         websocketUpgraded = false;
+        bodyStream = nullptr;
+        bodyRequested = false;
         last = 0;
         beginLine = 0;
 
@@ -113,6 +121,8 @@ public:
 
     virtual void socketDisconnected() override final;
 
+    // Body still being received while the action runs
+    PostUnbuffered *bodyStream = nullptr;
     QByteArray websocket_message;
     QByteArray websocket_payload;
     quint64 websocket_payload_size = 0;
@@ -125,6 +135,8 @@ public:
     quint8 websocket_continue_opcode = 0;
     quint8 websocket_finn_opcode = 0;
     bool websocketUpgraded = false;
+    // 100 Continue was sent and the context waits for the body
+    bool bodyRequested = false;
 
 protected:
     virtual bool webSocketHandshakeDo(const QString &key, const QString &origin, const QString &protocol) override final;
@@ -144,16 +156,20 @@ public:
 
     virtual ProtocolData *createData(Socket *sock) const override final;
 
+    enum { InitialBufferSize = 1024 };
+
 private:
     inline bool processRequest(Socket *sock, QIODevice *io) const;
     inline void parseMethod(const char *ptr, const char *end, Socket *sock) const;
     inline void parseHeader(const char *ptr, const char *end, Socket *sock) const;
+    void rejectRequest(Socket *sock, QIODevice *io, bool uriTooLong) const;
 
 protected:
     friend class ProtoRequestHttp;
 
     ProtocolWebSocket *m_websocketProto;
     ProtocolHttp2 *m_upgradeH2c;
+    int m_chunkedMinimumSize;
     bool usingFrontendProxy;
 };
 
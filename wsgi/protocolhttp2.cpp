@@ -351,6 +351,16 @@ int ProtocolHttp2::parseData(ProtoRequestHttp2 *request, QIODevice *io, const H2
                    stream->state == H2Stream::Closed) {
             return sendGoAway(io, request->maxStreamId, ErrorStreamClosed);
         }
+    } else if (request->resetStreams.contains(fr.streamId)) {
+        // Data sent before the client got our RST_STREAM, it still
+        // counts against the connection window so give it back
+        if (fr.flags & FlagDataEndStream) {
+            request->resetStreams.remove(fr.streamId);
+        }
+        if (fr.len) {
+            return sendWindowUpdate(io, 0, fr.len);
+        }
+        return ErrorNoError;
     } else {
        return sendGoAway(io, request->maxStreamId, ErrorStreamClosed);
     }
@@ -374,7 +384,7 @@ int ProtocolHttp2::parseData(ProtoRequestHttp2 *request, QIODevice *io, const H2
     }
 
     if (fr.flags & FlagDataEndStream) {
-        queueStream(request->sock, stream);
+        streamBodyReceived(request->sock, stream);
     }
 
     return ErrorNoError;
@@ -493,6 +503,17 @@ int ProtocolHttp2::parseHeaders(ProtoRequestHttp2 *request, QIODevice *io, const
             && request->streamForContinuation == 0) {
 
         // Process request
+        streamBodyReceived(request->sock, stream);
+    } else if (request->streamForContinuation == 0 && !stream->earlyDispatch &&
+               stream->headers.header(QStringLiteral("EXPECT")).compare(QLatin1String("100-continue"), Qt::CaseInsensitive) == 0) {
+        // Dispatch now so that Begin and Auto actions can reject
+        // the request before the client sends the body
+        stream->body = createBody(request->contentLength);
+        if (!stream->body) {
+            return sendGoAway(io, request->maxStreamId, ErrorInternalError);
+        }
+        stream->earlyDispatch = true;
+        stream->status |= Cutelyst::EngineRequest::ExpectContinue;
         queueStream(request->sock, stream);
     }
 
@@ -564,6 +585,9 @@ int ProtocolHttp2::parseRstStream(ProtoRequestHttp2 *request, QIODevice *io, con
             return sendGoAway(io, request->maxStreamId, ErrorProtocolError);
         }
 
+    } else if (request->resetStreams.remove(fr.streamId)) {
+        // Both sides reset the stream
+        return 0;
     } else {
         return sendGoAway(io, request->maxStreamId, ErrorStreamClosed);
     }
@@ -688,6 +712,16 @@ int ProtocolHttp2::sendPing(QIODevice *io, quint8 flags, const char *data, qint3
     return sendFrame(io, FramePing, flags, 0, data, dataLen);
 }
 
+int ProtocolHttp2::sendWindowUpdate(QIODevice *io, quint32 streamId, quint32 windowSizeIncrement) const
+{
+    QByteArray data;
+    data.append(char(windowSizeIncrement >> 24));
+    data.append(char(windowSizeIncrement >> 16));
+    data.append(char(windowSizeIncrement >> 8));
+    data.append(char(windowSizeIncrement));
+    return sendFrame(io, FrameWindowUpdate, 0, streamId, data.constData(), 4);
+}
+
 int ProtocolHttp2::sendData(QIODevice *io, quint32 streamId, qint32 windowSize, const char *data, qint32 dataLen) const
 {
     if (windowSize < 1) {
@@ -753,6 +787,22 @@ void ProtocolHttp2::queueStream(Socket *socket, H2Stream *stream) const
     Q_EMIT socket->engine->processRequestAsync(stream);
 }
 
+void ProtocolHttp2::streamBodyReceived(Socket *socket, H2Stream *stream) const
+{
+    if (!stream->earlyDispatch) {
+        queueStream(socket, stream);
+        return;
+    }
+
+    stream->bodyReceived = true;
+    if (stream->bodyRequested) {
+        // The context waits for the body asked with continueBody()
+        stream->bodyRequested = false;
+        stream->body->seek(0);
+        Q_EMIT stream->body->readChannelFinished();
+    }
+}
+
 bool ProtocolHttp2::upgradeH2C(Socket *socket, QIODevice *io, const Cutelyst::EngineRequest &request)
 {
     const Cutelyst::Headers &headers = request.headers;
@@ -851,7 +901,9 @@ qint64 H2Stream::doWrite(const char *data, qint64 len)
             if (!loop) {
                 loop = new QEventLoop;
             }
+            blockedBytes = remainingData;
             if (loop->exec() == 0) {
+                blockedBytes = 0;
                 continue;
             }
             return -1;
@@ -861,11 +913,13 @@ qint64 H2Stream::doWrite(const char *data, qint64 len)
 //                          << "remaining data" << remainingData;
 
         if (availableWindowSize > remainingData) {
-            ret = parser->sendFrame(protoRequest->io, FrameData, FlagDataEndStream, streamId, data + sent, qint32(remainingData));
-            remainingData = 0;
+            // Streamed bodies are ended by processingFinished()
+            const quint8 flags = status & EngineRequest::IOWrite ? 0x0 : FlagDataEndStream;
+            ret = parser->sendFrame(protoRequest->io, FrameData, flags, streamId, data + sent, qint32(remainingData));
             protoRequest->windowSize -= remainingData;
             windowSize -= remainingData;
             sent += remainingData;
+            remainingData = 0;
         } else {
             ret = parser->sendFrame(protoRequest->io, FrameData, 0x0, streamId, data + sent, qint32(availableWindowSize));
             remainingData -= availableWindowSize;
@@ -894,12 +948,52 @@ bool H2Stream::writeHeaders(quint16 status, const Cutelyst::Headers &headers)
 
 void H2Stream::processingFinished()
 {
+    if (earlyDispatch && !bodyReceived) {
+        // The body was rejected or not fully received, stop the client
+        auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+        parser->sendRstStream(protoRequest->io, streamId, ErrorNoError);
+        protoRequest->addResetStream(streamId);
+    } else if (status & EngineRequest::IOWrite && state != Closed) {
+        auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+        parser->sendFrame(protoRequest->io, FrameData, FlagDataEndStream, streamId, nullptr, 0);
+    }
+
     state = Closed;
     protoRequest->streams.remove(streamId);
     protoRequest->sock->requestFinished();
     delete this;
 }
 
+void H2Stream::continueBody()
+{
+    if (bodyReceived) {
+        // The client didn't wait
+        body->seek(0);
+        EngineRequest::continueBody();
+        return;
+    }
+
+    QByteArray buf;
+    protoRequest->hpack->encodeHeaders(100, QHash<QString, QString>(), buf, static_cast<CWsgiEngine *>(protoRequest->sock->engine));
+
+    auto parser = dynamic_cast<ProtocolHttp2 *>(protoRequest->sock->proto);
+    parser->sendFrame(protoRequest->io, FrameHeaders, FlagHeadersEndHeaders, streamId, buf.constData(), buf.size());
+    bodyRequested = true;
+}
+
+Cutelyst::EngineRequest::StreamingFraming H2Stream::streamingFraming() const
+{
+    // DATA frames and END_STREAM delimit the body
+    return NativeFraming;
+}
+
+qint64 H2Stream::bytesToWrite() const
+{
+    // The connection is shared by all streams, and what doWrite()
+    // holds while the flow control window is exhausted isn't there yet
+    return protoRequest->io->bytesToWrite() + blockedBytes;
+}
+
 void H2Stream::windowUpdated()
 {
 //    qDebug() << "WINDOW_UPDATED" << protoRequest->windowSize << windowSize << loop << (loop && loop->isRunning()) << this << protoRequest;
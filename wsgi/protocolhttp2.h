@@ -19,6 +19,9 @@
 #define PROTOCOLHTTP2_H
 
 #include <QObject>
+#include <QSet>
+
+#include <algorithm>
 
 #include <enginerequest.h>
 #include <context.h>
@@ -62,6 +65,12 @@ public:
 
     virtual void processingFinished() override final;
 
+    virtual StreamingFraming streamingFraming() const override final;
+
+    virtual qint64 bytesToWrite() const override final;
+
+    virtual void continueBody() override final;
+
     void windowUpdated();
 
     QEventLoop *loop = nullptr;
@@ -72,8 +81,14 @@ public:
     qint64 contentLength = -1;
     qint32 dataSent = 0;
     qint64 consumedData = 0;
+    // Waiting for a WINDOW_UPDATE in doWrite()
+    qint64 blockedBytes = 0;
     quint8 state = Idle;
     bool gotPath = false;
+    // Dispatched before the body because of "Expect: 100-continue"
+    bool earlyDispatch = false;
+    bool bodyRequested = false;
+    bool bodyReceived = false;
 };
 
 class ProtoRequestHttp2 final : public ProtocolData
@@ -103,6 +118,7 @@ public:
             ++it;
         }
         streams.clear();
+        resetStreams.clear();
 
         headersBuffer.clear();
         maxStreamId = 0;
@@ -127,7 +143,19 @@ public:
     quint8 processing = 0;
     bool canPush = true;
 
+    // Remembers a stream we reset whose DATA frames might still arrive,
+    // they are forgotten once the client ends or resets it too, or the
+    // oldest ones when there are too many, their frames are then errors
+    inline void addResetStream(quint32 streamId) {
+        if (resetStreams.size() >= MaxResetStreams) {
+            resetStreams.erase(std::min_element(resetStreams.begin(), resetStreams.end()));
+        }
+        resetStreams.insert(streamId);
+    }
+
     QHash<quint32, H2Stream *> streams;
+    QSet<quint32> resetStreams;
+    static constexpr int MaxResetStreams = 128;
 };
 
 class ProtocolHttp2 final : public Protocol
@@ -155,10 +183,12 @@ public:
     int sendSettings(QIODevice *io, const std::vector<std::pair<quint16, quint32> > &settings) const;
     int sendSettingsAck(QIODevice *io) const;
     int sendPing(QIODevice *io, quint8 flags, const char *data = nullptr, qint32 dataLen = 0) const;
+    int sendWindowUpdate(QIODevice *io, quint32 streamId, quint32 windowSizeIncrement) const;
     int sendData(QIODevice *io, quint32 streamId, qint32 flags, const char *data, qint32 dataLen) const;
     int sendFrame(QIODevice *io, quint8 type, quint8 flags = 0, quint32 streamId = 0, const char *data = nullptr, qint32 dataLen = 0) const;
 
     void queueStream(Socket *socket, H2Stream *stream) const;
+    void streamBodyReceived(Socket *socket, H2Stream *stream) const;
 
     bool upgradeH2C(Socket *socket, QIODevice *io, const Cutelyst::EngineRequest &request);
 
@@ -60,6 +60,11 @@ bool TcpSocket::flush()
     return QTcpSocket::flush();
 }
 
+void TcpSocket::setReadBufferLimit(qint64 size)
+{
+    setReadBufferSize(size);
+}
+
 void TcpSocket::socketDisconnected()
 {
     if (!processing) {
@@ -94,6 +99,11 @@ bool LocalSocket::flush()
     return QLocalSocket::flush();
 }
 
+void LocalSocket::setReadBufferLimit(qint64 size)
+{
+    setReadBufferSize(size);
+}
+
 void LocalSocket::socketDisconnected()
 {
     if (!processing) {
@@ -130,6 +140,11 @@ bool SslSocket::flush()
     return QSslSocket::flush();
 }
 
+void SslSocket::setReadBufferLimit(qint64 size)
+{
+    setReadBufferSize(size);
+}
+
 void SslSocket::socketDisconnected()
 {
     if (!processing) {
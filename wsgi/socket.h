@@ -51,6 +51,9 @@ public:
     virtual bool requestFinished() = 0;
     virtual bool flush() = 0;
 
+    // Limits how much is read ahead from the kernel, 0 means unlimited
+    virtual void setReadBufferLimit(qint64 size) = 0;
+
     inline void resetSocket() {
         if (protoData->upgradedFrom) {
             ProtocolData *data = protoData->upgradedFrom;
@@ -82,6 +85,7 @@ public:
     virtual void connectionClose() override final;
     virtual bool requestFinished() override final;
     virtual bool flush() override final;
+    virtual void setReadBufferLimit(qint64 size) override final;
     void socketDisconnected();
 
 Q_SIGNALS:
@@ -102,6 +106,7 @@ public:
     virtual void connectionClose() override final;
     virtual bool requestFinished() override final;
     virtual bool flush() override final;
+    virtual void setReadBufferLimit(qint64 size) override final;
     void socketDisconnected();
 
 Q_SIGNALS:
@@ -120,6 +125,7 @@ public:
     virtual void connectionClose() override final;
     virtual bool requestFinished() override final;
     virtual bool flush() override final;
+    virtual void setReadBufferLimit(qint64 size) override final;
     void socketDisconnected();
 
 Q_SIGNALS:
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "sslhandshakepool.h"
+
+#ifndef QT_NO_SSL
+
+#include "socket.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(CWSGI_SSL_HANDSHAKE, "cwsgi.ssl_handshake", QtWarningMsg)
+
+using namespace CWSGI;
+
+static SslHandshakePool *s_pool = nullptr;
+
+static void stopHandshakePool()
+{
+    delete s_pool;
+    s_pool = nullptr;
+}
+
+SslHandshakePool *SslHandshakePool::instance(int threads, int timeout)
+{
+    static SslHandshakePool *pool = [threads, timeout] {
+        s_pool = new SslHandshakePool(threads, timeout);
+        qAddPostRoutine(stopHandshakePool);
+        return s_pool;
+    }();
+    return pool;
+}
+
+SslHandshakePool::SslHandshakePool(int threads, int timeout) : m_timeout(timeout)
+{
+    for (int i = 0; i < threads; ++i) {
+        auto thread = new QThread;
+        thread->setObjectName(QLatin1String("cwsgi-tls-") + QString::number(i));
+        thread->start();
+        m_threads.push_back(thread);
+    }
+    qCDebug(CWSGI_SSL_HANDSHAKE) << "Started TLS handshake threads" << threads;
+}
+
+SslHandshakePool::~SslHandshakePool()
+{
+    for (QThread *thread : m_threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+}
+
+void SslHandshakePool::handshake(SslSocket *sock, QObject *receiver, const std::function<void (bool, const QByteArray &)> &done)
+{
+    QThread *thread = m_threads[uint(m_next.fetchAndAddRelaxed(1)) % m_threads.size()];
+    QThread *target = receiver->thread();
+    const int timeout = m_timeout;
+
+    sock->moveToThread(thread);
+
+    // Runs on the pool thread as sock now lives there
+    QTimer::singleShot(0, sock, [sock, receiver, target, done, timeout] {
+        auto guard = new QTimer;
+        auto finish = [sock, receiver, target, done, guard] (bool encrypted) {
+            QObject::disconnect(sock, nullptr, guard, nullptr);
+            guard->stop();
+            guard->deleteLater();
+
+            if (!encrypted) {
+                qCDebug(CWSGI_SSL_HANDSHAKE) << "TLS handshake failed" << sock->peerAddress() << sock->errorString();
+                sock->abort();
+                sock->deleteLater();
+                QTimer::singleShot(0, receiver, [done] { done(false, QByteArray()); });
+                return;
+            }
+
+            const QByteArray protocol = sock->sslConfiguration().nextNegotiatedProtocol();
+
+            // Move once QSslSocket is done emitting encrypted()
+            QTimer::singleShot(0, sock, [sock, receiver, target, done, protocol] {
+                sock->moveToThread(target);
+                QTimer::singleShot(0, receiver, [done, protocol] { done(true, protocol); });
+            });
+        };
+
+        QObject::connect(sock, &SslSocket::encrypted, guard, [finish] { finish(true); });
+        QObject::connect(sock, &SslSocket::disconnected, guard, [finish] { finish(false); });
+        if (timeout) {
+            guard->setSingleShot(true);
+            QObject::connect(guard, &QTimer::timeout, [finish] { finish(false); });
+            guard->start(timeout * 1000);
+        }
+
+        sock->startServerEncryption();
+    });
+}
+
+#endif // QT_NO_SSL
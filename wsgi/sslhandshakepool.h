@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SSLHANDSHAKEPOOL_H
+#define SSLHANDSHAKEPOOL_H
+
+#include <QtNetwork>
+
+#ifndef QT_NO_SSL
+
+#include <functional>
+#include <vector>
+
+class QThread;
+
+namespace CWSGI {
+
+class SslSocket;
+class SslHandshakePool
+{
+public:
+    /*!
+     * Returns the pool of the current process, threads
+     * are created on the first call so it must happen
+     * after forking
+     */
+    static SslHandshakePool *instance(int threads, int timeout);
+
+    ~SslHandshakePool();
+
+    /*!
+     * Moves \p sock to a pool thread and completes the TLS handshake
+     * there, \p done is called on the thread of \p receiver with the
+     * ALPN negotiated protocol once the socket is back on it.
+     * On failure the socket is deleted and \p done gets false.
+     */
+    void handshake(SslSocket *sock, QObject *receiver, const std::function<void (bool encrypted, const QByteArray &protocol)> &done);
+
+private:
+    SslHandshakePool(int threads, int timeout);
+
+    std::vector<QThread *> m_threads;
+    QAtomicInt m_next;
+    int m_timeout;
+};
+
+}
+
+#endif // QT_NO_SSL
+
+#endif // SSLHANDSHAKEPOOL_H
@@ -24,6 +24,17 @@
 #include <QDateTime>
 #include <QLoggingCategory>
 
+#ifdef Q_OS_LINUX
+#include "../EventLoopEPoll/eventdispatcher_epoll.h"
+
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#endif
+
 Q_LOGGING_CATEGORY(CWSGI_TCPSERVER, "cwsgi.tcpserver", QtWarningMsg)
 
 using namespace CWSGI;
@@ -47,6 +58,10 @@ TcpServer::TcpServer(const QString &serverAddress, Protocol *protocol, WSGI *wsg
     if (m_wsgi->socketRcvbuf() != -1) {
         m_socketOptions.push_back({ QAbstractSocket::ReceiveBufferSizeSocketOption, m_wsgi->socketRcvbuf() });
     }
+#ifdef Q_OS_LINUX
+    m_edgeTriggered = m_wsgi->edgeTriggered();
+    m_acceptBatch = m_wsgi->acceptBatch();
+#endif
 }
 
 void TcpServer::incomingConnection(qintptr handle)
@@ -55,10 +70,37 @@ void TcpServer::incomingConnection(qintptr handle)
     sock->serverAddress = m_serverAddress;
     sock->protoData = m_protocol->createData(sock);
 
-    connect(sock, &QIODevice::readyRead, [sock] {
-        sock->timeout = false;
-        sock->proto->parse(sock, sock);
-    });
+#ifdef Q_OS_LINUX
+    EventDispatcherEPoll *dispatcher = nullptr;
+    if (m_edgeTriggered) {
+        dispatcher = qobject_cast<EventDispatcherEPoll *>(QAbstractEventDispatcher::instance());
+    }
+
+    if (dispatcher) {
+        connect(sock, &QIODevice::readyRead, [sock] {
+            sock->timeout = false;
+
+            // No new notification arrives while data is left
+            // on the socket, so parse until it stops consuming
+            qint64 available = 0;
+            Q_FOREVER {
+                sock->proto->parse(sock, sock);
+                const qint64 left = sock->bytesAvailable();
+                if (left <= 0 || left == available) {
+                    break;
+                }
+                available = left;
+            }
+        });
+    } else {
+#endif
+        connect(sock, &QIODevice::readyRead, [sock] {
+            sock->timeout = false;
+            sock->proto->parse(sock, sock);
+        });
+#ifdef Q_OS_LINUX
+    }
+#endif
     connect(sock, &TcpSocket::finished, this, [this, sock] {
         sock->resetSocket();
         sock->deleteLater();
@@ -76,6 +118,12 @@ void TcpServer::incomingConnection(qintptr handle)
             sock->setSocketOption(opt.first, opt.second);
         }
 
+#ifdef Q_OS_LINUX
+        if (dispatcher) {
+            dispatcher->setEdgeTriggered(handle);
+        }
+#endif
+
         if (++m_processing) {
             m_engine->startSocketTimeout();
         }
@@ -84,11 +132,104 @@ void TcpServer::incomingConnection(qintptr handle)
     }
 }
 
-void TcpServer::shutdown()
+bool TcpServer::setListenSocket(qintptr socket)
+{
+#ifdef Q_OS_LINUX
+    // QTcpServer still owns the socket so that isListening() and
+    // serverAddress() work, but its own notifier is kept disabled
+    if (!setSocketDescriptor(socket)) {
+        return false;
+    }
+    QTcpServer::pauseAccepting();
+
+    m_socket = socket;
+    m_socketNotifier = new QSocketNotifier(socket, QSocketNotifier::Read, this);
+    m_socketNotifier->setEnabled(false);
+    connect(m_socketNotifier, &QSocketNotifier::activated, this, &TcpServer::socketNotifierActivated);
+    return true;
+#else
+    return setSocketDescriptor(socket);
+#endif
+}
+
+void TcpServer::pauseListenSocket()
 {
+    m_paused = true;
+
+#ifdef Q_OS_LINUX
+    if (m_socketNotifier) {
+        m_socketNotifier->setEnabled(false);
+        return;
+    }
+#endif
+
     if (isListening()) {
         pauseAccepting();
     }
+}
+
+void TcpServer::resumeListenSocket()
+{
+    m_paused = false;
+
+#ifdef Q_OS_LINUX
+    if (m_socketNotifier) {
+        enableListenSocket();
+        return;
+    }
+#endif
+
+    resumeAccepting();
+}
+
+#ifdef Q_OS_LINUX
+void TcpServer::enableListenSocket()
+{
+    m_socketNotifier->setEnabled(true);
+
+    if (!m_wsgi->reusePort()) {
+        // The socket is shared by all workers, wake only one of them
+        auto dispatcher = qobject_cast<EventDispatcherEPoll *>(QAbstractEventDispatcher::instance(thread()));
+        if (dispatcher) {
+            dispatcher->setExclusive(int(m_socket));
+        }
+    }
+}
+
+void TcpServer::socketNotifierActivated()
+{
+    // A single notification might stand for many connections, the
+    // batch is limited so other sockets on this thread aren't starved,
+    // the notifier is level triggered and fires again if more are left
+    for (int accepted = 0; accepted < m_acceptBatch && m_socketNotifier->isEnabled(); ++accepted) {
+        int fd = ::accept4(int(m_socket), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            } else if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // The connection stays in the backlog and the socket readable,
+                // stop watching it for a while instead of spinning
+                qCWarning(CWSGI_TCPSERVER) << "Failed to accept connection, retrying in 100ms" << qt_error_string(errno);
+                m_socketNotifier->setEnabled(false);
+                QTimer::singleShot(100, this, [this] {
+                    if (!m_paused) {
+                        enableListenSocket();
+                    }
+                });
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qCWarning(CWSGI_TCPSERVER) << "Failed to accept connection" << qt_error_string(errno);
+            }
+            break;
+        }
+
+        incomingConnection(fd);
+    }
+}
+#endif
+
+void TcpServer::shutdown()
+{
+    pauseListenSocket();
 
     if (m_processing == 0) {
         m_engine->serverShutdown();
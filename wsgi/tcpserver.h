@@ -20,6 +20,7 @@
 
 #include <QTcpServer>
 
+class QSocketNotifier;
 namespace CWSGI {
 
 class WSGI;
@@ -35,6 +36,19 @@ public:
     Q_INVOKABLE
     virtual void incomingConnection(qintptr handle) override;
 
+    /*!
+     * Accepts connections from the listening \p socket, on Linux
+     * they are accepted with accept4() in batches of accept_batch
+     */
+    bool setListenSocket(qintptr socket);
+
+    /*!
+     * Stops and resumes accepting connections, QTcpServer::pauseAccepting()
+     * is not virtual and doesn't know about the accept4() notifier
+     */
+    void pauseListenSocket();
+    void resumeListenSocket();
+
     virtual void shutdown();
     virtual void timeoutConnections();
 
@@ -46,6 +60,7 @@ Q_SIGNALS:
 
 protected:
     friend class TcpServerBalancer;
+    friend class CWsgiEngine;
 
     QString m_serverAddress;
     CWsgiEngine *m_engine;
@@ -53,7 +68,20 @@ protected:
 
     std::vector<std::pair<QAbstractSocket::SocketOption, QVariant> > m_socketOptions;
     Protocol *m_protocol;
+#ifdef Q_OS_LINUX
+    QSocketNotifier *m_socketNotifier = nullptr;
+    qintptr m_socket = -1;
+    int m_acceptBatch = 64;
+#endif
     int m_processing = 0;
+    bool m_edgeTriggered = false;
+    bool m_paused = true;
+
+private:
+#ifdef Q_OS_LINUX
+    void enableListenSocket();
+    void socketNotifierActivated();
+#endif
 };
 
 }
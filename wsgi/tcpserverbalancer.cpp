@@ -33,6 +33,8 @@
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 #endif
 
@@ -42,7 +44,7 @@ Q_LOGGING_CATEGORY(CWSGI_BALANCER, "wsgi.tcp_server_balancer", QtWarningMsg)
 using namespace CWSGI;
 
 #ifdef Q_OS_LINUX
-int listenReuse(const QHostAddress &address, int listenQueue, quint16 port, bool reusePort, bool startListening);
+int listenReuse(const QHostAddress &address, int listenQueue, quint16 port, bool reusePort, bool startListening, int deferAccept, int fastOpen);
 #endif
 
 TcpServerBalancer::TcpServerBalancer(WSGI *wsgi) : QTcpServer(wsgi)
@@ -138,7 +140,8 @@ bool TcpServerBalancer::listen(const QString &line, Protocol *protocol, bool sec
     m_port = port;
 
 #ifdef Q_OS_LINUX
-    int socket = listenReuse(address, m_wsgi->listenQueue(), port, m_wsgi->reusePort(), !m_wsgi->reusePort());
+    int socket = listenReuse(address, m_wsgi->listenQueue(), port, m_wsgi->reusePort(), !m_wsgi->reusePort(),
+                             m_wsgi->tcpDeferAccept(), m_wsgi->tcpFastOpen());
     if (socket > 0 && setSocketDescriptor(socket)) {
         pauseAccepting();
     } else {
@@ -350,7 +353,7 @@ bool nativeBind(int socketDescriptor, const QHostAddress &address, quint16 port)
     return true;
 }
 
-int listenReuse(const QHostAddress &address, int listenQueue, quint16 port, bool reusePort, bool startListening)
+int listenReuse(const QHostAddress &address, int listenQueue, quint16 port, bool reusePort, bool startListening, int deferAccept, int fastOpen)
 {
     QAbstractSocket::NetworkLayerProtocol proto = address.protocol();
 
@@ -373,6 +376,14 @@ int listenReuse(const QHostAddress &address, int listenQueue, quint16 port, bool
         return -1;
     }
 
+    if (deferAccept && ::setsockopt(socket, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAccept, sizeof(deferAccept))) {
+        qCWarning(CWSGI_BALANCER) << "Failed to set TCP_DEFER_ACCEPT on socket" << socket;
+    }
+
+    if (fastOpen && ::setsockopt(socket, IPPROTO_TCP, TCP_FASTOPEN, &fastOpen, sizeof(fastOpen))) {
+        qCWarning(CWSGI_BALANCER) << "Failed to set TCP_FASTOPEN on socket" << socket;
+    }
+
     if (startListening && ::listen(socket, listenQueue) < 0) {
         qCCritical(CWSGI_BALANCER) << "Failed to listen to socket" << socket;
         return -1;
@@ -419,18 +430,20 @@ TcpServer *TcpServerBalancer::createServer(CWsgiEngine *engine)
 #ifdef Q_OS_LINUX
         if (m_wsgi->reusePort()) {
             connect(engine, &CWsgiEngine::started, this, [=] () {
-                int socket = listenReuse(m_address, m_wsgi->listenQueue(), m_port, m_wsgi->reusePort(), true);
-                if (!server->setSocketDescriptor(socket)) {
+                int socket = listenReuse(m_address, m_wsgi->listenQueue(), m_port, m_wsgi->reusePort(), true,
+                                         m_wsgi->tcpDeferAccept(), m_wsgi->tcpFastOpen());
+                if (!server->setListenSocket(socket)) {
                     qFatal("Failed to set server socket descriptor, reuse-port");
                 }
+                server->resumeListenSocket();
             }, Qt::DirectConnection);
             return server;
         }
 #endif
 
-        if (server->setSocketDescriptor(socketDescriptor())) {
-            server->pauseAccepting();
-            connect(engine, &CWsgiEngine::started, server, &TcpServer::resumeAccepting, Qt::DirectConnection);
+        if (server->setListenSocket(socketDescriptor())) {
+            server->pauseListenSocket();
+            connect(engine, &CWsgiEngine::started, server, &TcpServer::resumeListenSocket, Qt::DirectConnection);
         } else {
             qFatal("Failed to set server socket descriptor");
         }
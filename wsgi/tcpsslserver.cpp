@@ -20,6 +20,7 @@
 #include "protocol.h"
 #include "socket.h"
 #include "wsgi.h"
+#include "sslhandshakepool.h"
 
 #ifndef QT_NO_SSL
 
@@ -30,31 +31,24 @@ using namespace CWSGI;
 TcpSslServer::TcpSslServer(const QString &serverAddress, CWSGI::Protocol *protocol, CWSGI::WSGI *wsgi, QObject *parent)
     : TcpServer(serverAddress, protocol, wsgi, parent)
 {
-
+    m_handshakeThreads = wsgi->sslHandshakeThreads();
 }
 
 void TcpSslServer::incomingConnection(qintptr handle)
 {
-    auto sock = new SslSocket(m_engine, this);
-    sock->protoData = m_protocol->createData(sock);
-    sock->setSslConfiguration(m_sslConfiguration);
+    if (m_handshakeThreads && !m_handshakePool) {
+        // Created on the first connection, after forking
+        m_handshakePool = SslHandshakePool::instance(m_handshakeThreads, m_wsgi->socketTimeout());
+    }
 
-    connect(sock, &QIODevice::readyRead, this, [sock] () {
-        sock->timeout = false;
-        sock->proto->parse(sock, sock);
-    });
-    connect(sock, &SslSocket::finished, this, [this, sock] () {
-        sock->deleteLater();
-        --m_processing;
-    });
+    // Sockets with a parent can't be moved to the handshake threads
+    auto sock = new SslSocket(m_engine, m_handshakePool ? nullptr : this);
+    sock->setSslConfiguration(m_sslConfiguration);
 
     if (Q_LIKELY(sock->setSocketDescriptor(handle, QTcpSocket::ConnectedState, QTcpSocket::ReadWrite | QTcpSocket::Unbuffered))) {
-        sock->proto = m_protocol;
-
         sock->serverAddress = m_serverAddress;
         sock->remoteAddress = sock->peerAddress();
         sock->remotePort = sock->peerPort();
-        sock->protoData->setupNewConnection(sock);
 
         for (const auto &opt : m_socketOptions) {
             sock->setSocketOption(opt.first, opt.second);
@@ -64,6 +58,33 @@ void TcpSslServer::incomingConnection(qintptr handle)
             m_engine->startSocketTimeout();
         }
 
+        if (m_handshakePool) {
+            m_handshakePool->handshake(sock, this, [this, sock] (bool encrypted, const QByteArray &protocol) {
+                if (!encrypted) {
+                    --m_processing;
+                    return;
+                }
+
+                sock->setParent(this);
+                if (m_http2Protocol && protocol == "h2") {
+                    setupSocket(sock, m_http2Protocol);
+                } else {
+                    setupSocket(sock, m_protocol);
+                }
+
+                if (sock->state() != QAbstractSocket::ConnectedState) {
+                    // Disconnected while moving back
+                    sock->deleteLater();
+                    --m_processing;
+                } else if (sock->bytesAvailable()) {
+                    sock->proto->parse(sock, sock);
+                }
+            });
+            return;
+        }
+
+        setupSocket(sock, m_protocol);
+
         sock->startServerEncryption();
         if (m_http2Protocol) {
             connect(sock, &SslSocket::encrypted, this, [this, sock] () {
@@ -78,9 +99,25 @@ void TcpSslServer::incomingConnection(qintptr handle)
     }
 }
 
+void TcpSslServer::setupSocket(SslSocket *sock, Protocol *protocol)
+{
+    sock->proto = protocol;
+    sock->protoData = protocol->createData(sock);
+    sock->protoData->setupNewConnection(sock);
+
+    connect(sock, &QIODevice::readyRead, this, [sock] () {
+        sock->timeout = false;
+        sock->proto->parse(sock, sock);
+    });
+    connect(sock, &SslSocket::finished, this, [this, sock] () {
+        sock->deleteLater();
+        --m_processing;
+    });
+}
+
 void TcpSslServer::shutdown()
 {
-    pauseAccepting();
+    pauseListenSocket();
 
     if (m_processing == 0) {
         m_engine->serverShutdown();
@@ -32,6 +32,7 @@ class WSGI;
 class Protocol;
 class SslSocket;
 class CWsgiEngine;
+class SslHandshakePool;
 class TcpSslServer final : public TcpServer
 {
     Q_OBJECT
@@ -48,8 +49,12 @@ public:
     void setHttp2Protocol(Protocol *protocol);
 
 private:
+    void setupSocket(SslSocket *sock, Protocol *protocol);
+
     Protocol *m_http2Protocol = nullptr;
+    SslHandshakePool *m_handshakePool = nullptr;
     QSslConfiguration m_sslConfiguration;
+    int m_handshakeThreads = 0;
 };
 
 }
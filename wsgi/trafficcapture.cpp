@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "trafficcapture.h"
+
+#include <Cutelyst/enginerequest.h>
+
+#include <QBuffer>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(CWSGI_CAPTURE, "cwsgi.capture", QtWarningMsg)
+
+using namespace CWSGI;
+using namespace Cutelyst;
+
+static QString normalizeHeaderKey(const QString &key)
+{
+    QString ret = key.toUpper();
+    ret.replace(QLatin1Char('-'), QLatin1Char('_'));
+    return ret;
+}
+
+TrafficCapture::TrafficCapture(int sample, const QStringList &redact, QObject *parent) : QThread(parent)
+  , m_sample(quint64(qMax(sample, 1)))
+{
+    setObjectName(QStringLiteral("capture"));
+
+    // Credentials never make it into a capture file
+    m_redactHeaders = {
+        QStringLiteral("AUTHORIZATION"),
+        QStringLiteral("PROXY_AUTHORIZATION"),
+        QStringLiteral("COOKIE"),
+    };
+
+    for (const QString &rule : redact) {
+        if (rule.startsWith(QLatin1Char('?'))) {
+            m_redactQuery.insert(rule.mid(1).toLatin1());
+        } else {
+            m_redactHeaders.insert(normalizeHeaderKey(rule));
+        }
+    }
+}
+
+TrafficCapture::~TrafficCapture()
+{
+    close();
+}
+
+bool TrafficCapture::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qCCritical(CWSGI_CAPTURE) << "Failed to open capture file" << fileName << m_file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&m_file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << Magic << Version;
+    m_elapsed.start();
+
+    m_running = true;
+    start(QThread::LowPriority);
+
+    qCInfo(CWSGI_CAPTURE) << "Capturing one of every" << m_sample << "requests to" << fileName;
+    return true;
+}
+
+void TrafficCapture::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_running = false;
+        m_wait.wakeAll();
+    }
+    wait();
+
+    if (m_file.isOpen()) {
+        m_file.close();
+        if (m_dropped) {
+            qCWarning(CWSGI_CAPTURE) << "Dropped" << m_dropped.load() << "sampled requests, the capture file could not keep up";
+        }
+    }
+}
+
+void TrafficCapture::record(EngineRequest *request)
+{
+    if (m_counter.fetch_add(1, std::memory_order_relaxed) % m_sample) {
+        return;
+    }
+
+    CapturedRequest captured;
+    captured.offset = m_elapsed.elapsed();
+    captured.method = request->method;
+    captured.path = request->path;
+    captured.query = m_redactQuery.isEmpty() ? request->query : redactQuery(request->query);
+    captured.protocol = request->protocol;
+    captured.headers = request->headers.data();
+    if (request->isSecure) {
+        captured.flags |= CapturedRequest::Secure;
+    }
+
+    auto it = captured.headers.begin();
+    while (it != captured.headers.end()) {
+        if (m_redactHeaders.contains(it.key())) {
+            it.value() = QStringLiteral("REDACTED");
+        }
+        ++it;
+    }
+
+    QIODevice *body = request->body;
+    if (body) {
+        if (body->isSequential()) {
+            // Reading would consume it before the application does
+            captured.flags |= CapturedRequest::Truncated;
+        } else {
+            const qint64 pos = body->pos();
+            body->seek(0);
+            captured.body = body->read(MaxBodySize);
+            if (!body->atEnd()) {
+                captured.flags |= CapturedRequest::Truncated;
+            }
+            body->seek(pos);
+        }
+    }
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream stream(&buffer);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << captured.offset << captured.method << captured.path << captured.query
+           << captured.protocol << captured.headers << captured.body << captured.flags;
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_running || m_queuedBytes + data.size() > MaxQueuedBytes) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_queuedBytes += data.size();
+    m_queue.push_back(data);
+    m_wait.wakeOne();
+}
+
+quint64 TrafficCapture::dropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void TrafficCapture::run()
+{
+    std::vector<QByteArray> batch;
+
+    QMutexLocker locker(&m_mutex);
+    Q_FOREVER {
+        while (m_queue.empty() && m_running) {
+            m_wait.wait(&m_mutex);
+        }
+
+        if (m_queue.empty()) {
+            break;
+        }
+
+        batch.swap(m_queue);
+        m_queuedBytes = 0;
+        locker.unlock();
+
+        for (const QByteArray &data : batch) {
+            if (m_file.write(data) != data.size()) {
+                qCWarning(CWSGI_CAPTURE) << "Failed to write to capture file" << m_file.errorString();
+            }
+        }
+        m_file.flush();
+        batch.clear();
+
+        locker.relock();
+    }
+}
+
+bool TrafficCapture::readHeader(QDataStream &in)
+{
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    return magic == Magic && version == Version && in.status() == QDataStream::Ok;
+}
+
+bool TrafficCapture::readRequest(QDataStream &in, CapturedRequest *request)
+{
+    if (in.atEnd()) {
+        return false;
+    }
+
+    in >> request->offset >> request->method >> request->path >> request->query
+       >> request->protocol >> request->headers >> request->body >> request->flags;
+    return in.status() == QDataStream::Ok;
+}
+
+QByteArray TrafficCapture::redactQuery(const QByteArray &query) const
+{
+    QList<QByteArray> parts = query.split('&');
+    for (QByteArray &part : parts) {
+        const int eq = part.indexOf('=');
+        if (eq != -1 && m_redactQuery.contains(part.left(eq))) {
+            part = part.left(eq + 1) + "REDACTED";
+        }
+    }
+    return parts.join('&');
+}
+
+#include "moc_trafficcapture.cpp"
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef TRAFFICCAPTURE_H
+#define TRAFFICCAPTURE_H
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDataStream>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <vector>
+
+namespace Cutelyst {
+class EngineRequest;
+}
+
+namespace CWSGI {
+
+struct CapturedRequest {
+    enum Flag {
+        Truncated = 0x01,
+        Secure = 0x02,
+    };
+
+    qint64 offset = 0;
+    QString method;
+    QString path;
+    QByteArray query;
+    QString protocol;
+    QHash<QString, QString> headers;
+    QByteArray body;
+    quint8 flags = 0;
+};
+
+/**
+ * Records sampled requests into a compact binary file
+ * that can be fed back with TrafficReplay, it's thread safe.
+ *
+ * Requests are serialized on the calling thread and written
+ * by a separate thread so that workers never block on disk IO.
+ */
+class TrafficCapture final : public QThread
+{
+    Q_OBJECT
+public:
+    TrafficCapture(int sample, const QStringList &redact, QObject *parent = nullptr);
+    ~TrafficCapture() override;
+
+    /**
+     * Opens \a fileName and starts the writer thread.
+     */
+    bool open(const QString &fileName);
+
+    /**
+     * Writes the queued requests and stops the writer thread.
+     */
+    void close();
+
+    void record(Cutelyst::EngineRequest *request);
+
+    /**
+     * Returns the number of sampled requests dropped because
+     * the writer could not keep up with them.
+     */
+    quint64 dropped() const;
+
+    static bool readHeader(QDataStream &in);
+
+    static bool readRequest(QDataStream &in, CapturedRequest *request);
+
+    static const quint32 Magic = 0x43575243; // CWRC
+    static const quint32 Version = 1;
+    static const qint64 MaxBodySize = 1024 * 1024;
+    static const qint64 MaxQueuedBytes = 64 * 1024 * 1024;
+
+protected:
+    void run() override;
+
+private:
+    QByteArray redactQuery(const QByteArray &query) const;
+
+    QMutex m_mutex;
+    QWaitCondition m_wait;
+    std::vector<QByteArray> m_queue;
+    qint64 m_queuedBytes = 0;
+    QFile m_file;
+    QElapsedTimer m_elapsed;
+    QSet<QString> m_redactHeaders;
+    QSet<QByteArray> m_redactQuery;
+    std::atomic<quint64> m_counter{0};
+    std::atomic<quint64> m_dropped{0};
+    quint64 m_sample;
+    bool m_running = false;
+};
+
+}
+
+#endif // TRAFFICCAPTURE_H
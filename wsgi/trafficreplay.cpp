@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "trafficreplay.h"
+#include "trafficcapture.h"
+
+#include <Cutelyst/Application>
+#include <Cutelyst/Context>
+#include <Cutelyst/Action>
+#include <Cutelyst/Response>
+#include <Cutelyst/enginerequest.h>
+#include <Cutelyst/stats.h>
+#include <Cutelyst/utils.h>
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QLoggingCategory>
+#include <QTimer>
+
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(CWSGI_REPLAY, "cwsgi.replay", QtWarningMsg)
+
+using namespace CWSGI;
+using namespace Cutelyst;
+
+namespace CWSGI {
+
+class ReplayRequest final : public EngineRequest
+{
+public:
+    explicit ReplayRequest(TrafficReplay *replay) : stats(this), m_replay(replay) {}
+
+    virtual qint64 doWrite(const char *data, qint64 len) override final {
+        Q_UNUSED(data)
+        responseSize += len;
+        return len;
+    }
+
+    virtual bool writeHeaders(quint16 status, const Headers &headers) override final {
+        Q_UNUSED(headers)
+        statusCode = status;
+        return true;
+    }
+
+    virtual void processingFinished() override final {
+        // Async requests finish long after handleRequest() returned
+        latency = elapsed.nsecsElapsed();
+        m_replay->requestFinished(this);
+    }
+
+    Stats stats;
+    qint64 responseSize = 0;
+    qint64 latency = 0;
+    quint16 statusCode = 0;
+
+private:
+    TrafficReplay *m_replay;
+};
+
+}
+
+ReplayEngine::ReplayEngine(Application *app, const QVariantMap &opts) : Engine(app, 0, opts)
+{
+}
+
+int ReplayEngine::workerId() const
+{
+    return 0;
+}
+
+bool ReplayEngine::init()
+{
+    return initApplication() && postForkApplication();
+}
+
+TrafficReplay::TrafficReplay(ReplayEngine *engine) : m_engine(engine)
+{
+}
+
+TrafficReplay::~TrafficReplay()
+{
+    finishPending();
+}
+
+bool TrafficReplay::run(const QString &fileName, bool paced)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        qCCritical(CWSGI_REPLAY) << "Failed to open capture file" << fileName << file.errorString();
+        return false;
+    }
+
+    QDataStream in(&file);
+    if (!TrafficCapture::readHeader(in)) {
+        qCCritical(CWSGI_REPLAY) << "Not a capture file or unsupported version" << fileName;
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    CapturedRequest captured;
+    while (TrafficCapture::readRequest(in, &captured)) {
+        if (paced) {
+            const qint64 wait = captured.offset - timer.elapsed();
+            if (wait > 0) {
+                processEvents(wait);
+            }
+        } else if (!m_pending.isEmpty()) {
+            // Lets async requests make progress
+            QCoreApplication::processEvents();
+            deleteFinished();
+        }
+
+        auto request = new ReplayRequest(this);
+        request->method = captured.method;
+        request->setPath(captured.path);
+        request->query = captured.query;
+        request->protocol = captured.protocol;
+        request->isSecure = captured.flags & CapturedRequest::Secure;
+        request->serverAddress = QStringLiteral("127.0.0.1");
+        request->remoteAddress = QHostAddress(QHostAddress::LocalHost);
+        auto it = captured.headers.constBegin();
+        while (it != captured.headers.constEnd()) {
+            request->headers.setHeader(it.key(), it.value());
+            ++it;
+        }
+        if (!captured.body.isEmpty()) {
+            // Owned by Cutelyst::Request
+            auto body = new QBuffer;
+            body->setData(captured.body);
+            body->open(QIODevice::ReadOnly);
+            request->body = body;
+        }
+        if (captured.flags & CapturedRequest::Truncated) {
+            ++m_truncated;
+        }
+
+        m_pending.insert(request);
+        request->elapsed.start();
+        m_engine->processRequest(request);
+        deleteFinished();
+    }
+
+    if (!m_pending.isEmpty() && !waitPending(PendingTimeout)) {
+        qCWarning(CWSGI_REPLAY) << m_pending.size() << "async requests did not finish after" << PendingTimeout << "ms";
+        finishPending();
+    }
+    m_elapsed = timer.nsecsElapsed();
+
+    return in.status() == QDataStream::Ok || in.atEnd();
+}
+
+void TrafficReplay::requestFinished(ReplayRequest *request)
+{
+    QString actionName = QStringLiteral("(none)");
+    if (request->context && request->context->action()) {
+        actionName = QLatin1Char('/') + request->context->action()->reverse();
+    }
+
+    ActionTotal &total = m_actions[actionName];
+    total.latencies.push_back(request->latency);
+    total.cpu += request->stats.cpuTime();
+    total.allocations += request->stats.allocations();
+    total.bytes += request->stats.allocatedBytes();
+    ++m_statusCodes[request->statusCode];
+    ++m_requests;
+    m_pending.remove(request);
+    if (m_pending.isEmpty() && m_pendingLoop) {
+        m_pendingLoop->quit();
+    }
+
+    // Still in use by the context that is finalizing it
+    m_finished.push_back(request);
+}
+
+void TrafficReplay::deleteFinished()
+{
+    for (ReplayRequest *request : m_finished) {
+        delete request;
+    }
+    m_finished.clear();
+}
+
+void TrafficReplay::finishPending()
+{
+    // Their contexts might still be waiting on timers or replies, they are
+    // finalized so that nothing resumes them once the requests are deleted
+    const QSet<ReplayRequest *> pending = m_pending;
+    for (ReplayRequest *request : pending) {
+        Context *c = request->context;
+        if (c && !(request->status & EngineRequest::Finalized)) {
+            c->response()->setStatus(Response::GatewayTimeout);
+            c->finalize();
+        }
+    }
+    deleteFinished();
+
+    // Never got a context
+    qDeleteAll(m_pending);
+    m_pending.clear();
+}
+
+void TrafficReplay::processEvents(qint64 msecs)
+{
+    QEventLoop loop;
+    QTimer::singleShot(int(msecs), &loop, &QEventLoop::quit);
+    loop.exec();
+    deleteFinished();
+}
+
+bool TrafficReplay::waitPending(qint64 msecs)
+{
+    QEventLoop loop;
+    QTimer::singleShot(int(msecs), &loop, &QEventLoop::quit);
+    m_pendingLoop = &loop;
+    loop.exec();
+    m_pendingLoop = nullptr;
+    deleteFinished();
+    return m_pending.isEmpty();
+}
+
+static qint64 percentile(const std::vector<qint64> &sorted, int percent)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    const size_t index = (sorted.size() - 1) * size_t(percent) / 100;
+    return sorted[index];
+}
+
+QJsonObject TrafficReplay::report() const
+{
+    QJsonObject actions;
+    auto it = m_actions.constBegin();
+    while (it != m_actions.constEnd()) {
+        std::vector<qint64> sorted = it.value().latencies;
+        std::sort(sorted.begin(), sorted.end());
+
+        qint64 sum = 0;
+        for (qint64 latency : sorted) {
+            sum += latency;
+        }
+        const qint64 count = qint64(sorted.size());
+
+        actions.insert(it.key(), QJsonObject{
+                           { QStringLiteral("count"), count },
+                           { QStringLiteral("avg_us"), sum / count / 1000 },
+                           { QStringLiteral("p50_us"), percentile(sorted, 50) / 1000 },
+                           { QStringLiteral("p99_us"), percentile(sorted, 99) / 1000 },
+                           { QStringLiteral("cpu_us"), it.value().cpu / count / 1000 },
+                           { QStringLiteral("allocations"), double(it.value().allocations) / count },
+                           { QStringLiteral("bytes"), double(it.value().bytes) / count },
+                       });
+        ++it;
+    }
+
+    QJsonObject statusCodes;
+    auto statusIt = m_statusCodes.constBegin();
+    while (statusIt != m_statusCodes.constEnd()) {
+        statusCodes.insert(QString::number(statusIt.key()), double(statusIt.value()));
+        ++statusIt;
+    }
+
+    return {
+        { QStringLiteral("requests"), double(m_requests) },
+        { QStringLiteral("truncated"), double(m_truncated) },
+        { QStringLiteral("elapsed_ms"), m_elapsed / 1000000 },
+        { QStringLiteral("throughput"), m_elapsed ? m_requests / (m_elapsed / 1000000000.0) : 0.0 },
+        { QStringLiteral("status_codes"), statusCodes },
+        { QStringLiteral("actions"), actions },
+    };
+}
+
+QByteArray TrafficReplay::summary() const
+{
+    const QJsonObject obj = report();
+    const QJsonObject actions = obj.value(QStringLiteral("actions")).toObject();
+
+    QVector<QStringList> table;
+    auto it = actions.constBegin();
+    while (it != actions.constEnd()) {
+        const QJsonObject action = it.value().toObject();
+        table.append({ it.key(),
+                       QString::number(action.value(QStringLiteral("count")).toInt()),
+                       QString::number(action.value(QStringLiteral("avg_us")).toInt()) + QLatin1String("us"),
+                       QString::number(action.value(QStringLiteral("p50_us")).toInt()) + QLatin1String("us"),
+                       QString::number(action.value(QStringLiteral("p99_us")).toInt()) + QLatin1String("us"),
+                       QString::number(action.value(QStringLiteral("cpu_us")).toInt()) + QLatin1String("us"),
+                       QString::number(action.value(QStringLiteral("allocations")).toDouble(), 'f', 1),
+                       QString::number(action.value(QStringLiteral("bytes")).toDouble(), 'f', 0) });
+        ++it;
+    }
+
+    return Utils::buildTable(table, {
+                                 QStringLiteral("Action"), QStringLiteral("Count"), QStringLiteral("Avg"),
+                                 QStringLiteral("P50"), QStringLiteral("P99"), QStringLiteral("CPU"),
+                                 QStringLiteral("Allocs"), QStringLiteral("Bytes")
+                             },
+                             QStringLiteral("Replayed %1 requests in %2ms (%3/s):")
+                             .arg(QString::number(m_requests),
+                                  QString::number(m_elapsed / 1000000),
+                                  QString::number(obj.value(QStringLiteral("throughput")).toDouble(), 'f', 1)));
+}
+
+static QString delta(double before, double after)
+{
+    if (before == 0.0) {
+        return QStringLiteral("n/a");
+    }
+    const double percent = (after - before) * 100.0 / before;
+    return (percent > 0 ? QStringLiteral("+") : QString()) + QString::number(percent, 'f', 1) + QLatin1Char('%');
+}
+
+QByteArray TrafficReplay::compare(const QJsonObject &baseline) const
+{
+    const QJsonObject current = report();
+    const QJsonObject baseActions = baseline.value(QStringLiteral("actions")).toObject();
+    const QJsonObject actions = current.value(QStringLiteral("actions")).toObject();
+
+    QVector<QStringList> table;
+    auto it = actions.constBegin();
+    while (it != actions.constEnd()) {
+        const QJsonObject action = it.value().toObject();
+        const QJsonObject base = baseActions.value(it.key()).toObject();
+        if (!base.isEmpty()) {
+            table.append({ it.key(),
+                           delta(base.value(QStringLiteral("avg_us")).toDouble(), action.value(QStringLiteral("avg_us")).toDouble()),
+                           delta(base.value(QStringLiteral("p99_us")).toDouble(), action.value(QStringLiteral("p99_us")).toDouble()),
+                           delta(base.value(QStringLiteral("cpu_us")).toDouble(), action.value(QStringLiteral("cpu_us")).toDouble()),
+                           delta(base.value(QStringLiteral("allocations")).toDouble(), action.value(QStringLiteral("allocations")).toDouble()),
+                           delta(base.value(QStringLiteral("bytes")).toDouble(), action.value(QStringLiteral("bytes")).toDouble()) });
+        }
+        ++it;
+    }
+
+    return Utils::buildTable(table, {
+                                 QStringLiteral("Action"), QStringLiteral("Avg"), QStringLiteral("P99"),
+                                 QStringLiteral("CPU"), QStringLiteral("Allocs"), QStringLiteral("Bytes")
+                             },
+                             QStringLiteral("Compared to baseline, throughput %1:")
+                             .arg(delta(baseline.value(QStringLiteral("throughput")).toDouble(),
+                                        current.value(QStringLiteral("throughput")).toDouble())));
+}
+
+#include "moc_trafficreplay.cpp"
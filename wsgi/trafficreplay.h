@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2020 Daniel Nicoletti <dantti12@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef TRAFFICREPLAY_H
+#define TRAFFICREPLAY_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+#include <QEventLoop>
+
+#include <vector>
+
+#include <Cutelyst/Engine>
+
+namespace CWSGI {
+
+class ReplayRequest;
+class ReplayEngine final : public Cutelyst::Engine
+{
+    Q_OBJECT
+public:
+    ReplayEngine(Cutelyst::Application *app, const QVariantMap &opts);
+
+    virtual int workerId() const override;
+
+    virtual bool init() override;
+};
+
+/**
+ * Feeds a file recorded by TrafficCapture into an in-process engine,
+ * either at full speed or at the original pacing, and reports throughput
+ * and per action latency, CPU and allocation figures.
+ */
+class TrafficReplay
+{
+public:
+    explicit TrafficReplay(ReplayEngine *engine);
+    ~TrafficReplay();
+
+    bool run(const QString &fileName, bool paced);
+
+    /**
+     * Returns the report of the last run, suitable to be
+     * saved and later given to compare().
+     */
+    QJsonObject report() const;
+
+    /**
+     * Returns a text table with the per action differences between
+     * \a baseline and the last run.
+     */
+    QByteArray compare(const QJsonObject &baseline) const;
+
+    QByteArray summary() const;
+
+private:
+    friend class ReplayRequest;
+    void requestFinished(ReplayRequest *request);
+    void deleteFinished();
+    void finishPending();
+    void processEvents(qint64 msecs);
+    bool waitPending(qint64 msecs);
+
+    // How long to wait for async requests once the file was read
+    static const int PendingTimeout = 30000;
+
+    struct ActionTotal {
+        std::vector<qint64> latencies;
+        qint64 cpu = 0;
+        quint64 allocations = 0;
+        quint64 bytes = 0;
+    };
+
+    QHash<QString, ActionTotal> m_actions;
+    QHash<quint16, quint64> m_statusCodes;
+    QSet<ReplayRequest *> m_pending;
+    std::vector<ReplayRequest *> m_finished;
+    QEventLoop *m_pendingLoop = nullptr;
+    ReplayEngine *m_engine;
+    qint64 m_elapsed = 0;
+    quint64 m_requests = 0;
+    quint64 m_truncated = 0;
+};
+
+}
+
+#endif // TRAFFICREPLAY_H
@@ -18,6 +18,7 @@
 #include "unixfork.h"
 
 #include "wsgi.h"
+#include "cputopology.h"
 #include "EventLoopEPoll/eventdispatcher_epoll.h"
 
 #include <unistd.h>
@@ -40,7 +41,13 @@
 #include <signal.h>
 #include <unistd.h>
 
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#include <string.h>
+#endif
+
 #include <iostream>
+#include <algorithm>
 
 #include <QCoreApplication>
 #include <QSocketNotifier>
@@ -49,6 +56,7 @@
 #include <QMutex>
 #include <QThread>
 #include <QFile>
+#include <QNetworkInterface>
 #include <QLoggingCategory>
 
 Q_LOGGING_CATEGORY(WSGI_UNIX, "wsgi.unix", QtWarningMsg)
@@ -58,6 +66,15 @@ Q_LOGGING_CATEGORY(WSGI_UNIX, "wsgi.unix", QtWarningMsg)
 
 static int signalsFd[2];
 
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+// Computed before forking, so all workers share the same map
+static std::vector<CWSGI::CpuTopology::Slot> cpuPlacementSlots;
+static int cpuPlacementThreads = 1;
+static bool cpuPlacementMemory = false;
+
 UnixFork::UnixFork(int process, int threads, bool setupSignals, QObject *parent) : AbstractFork(parent)
   , m_threads(threads)
   , m_processes(process)
@@ -550,6 +567,36 @@ void UnixFork::handleSigChld()
 
 void UnixFork::setSched(CWSGI::WSGI *wsgi, int workerId, int workerCore)
 {
+#ifdef Q_OS_LINUX
+    if (!cpuPlacementSlots.empty()) {
+        const auto &slot = cpuPlacementSlots[size_t(workerId * cpuPlacementThreads + workerCore) % cpuPlacementSlots.size()];
+
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (int cpu : slot.cpus) {
+            CPU_SET(cpu, &cpuset);
+        }
+        if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset)) {
+            qFatal("failed to sched_setaffinity()");
+        }
+
+        // The policy is per thread, which is what keeps the arenas
+        // of each worker thread heap on the node it runs on
+        if (cpuPlacementMemory && slot.node >= 0) {
+            unsigned long nodemask[16] = {};
+            const size_t bits = sizeof(unsigned long) * 8;
+            if (size_t(slot.node) < sizeof(nodemask) * 8) {
+                nodemask[size_t(slot.node) / bits] |= 1UL << (size_t(slot.node) % bits);
+                // The kernel expects one more than the number of bits
+                if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask, sizeof(nodemask) * 8 + 1)) {
+                    qCWarning(WSGI_UNIX) << "failed to set_mempolicy() for NUMA node" << slot.node << strerror(errno);
+                }
+            }
+        }
+        return;
+    }
+#endif
+
     int cpu_affinity = wsgi->cpuAffinity();
     if (cpu_affinity) {
         char buf[4096];
@@ -612,6 +659,93 @@ void UnixFork::setSched(CWSGI::WSGI *wsgi, int workerId, int workerCore)
     }
 }
 
+void UnixFork::setupCpuPlacement(CWSGI::WSGI *wsgi, int processes, int threads, const QVector<QHostAddress> &addresses)
+{
+    const CWSGI::CpuTopology::Placement placement = CWSGI::CpuTopology::placementFromString(wsgi->cpuPlacement());
+    if (placement == CWSGI::CpuTopology::Index) {
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    // Lets the placement be tried with a copy of another machine's sysfs
+    const CWSGI::CpuTopology topology(QString::fromLocal8Bit(qgetenv("CUTELYST_WSGI_TOPOLOGY_ROOT")));
+    if (!topology.isValid()) {
+        qCWarning(WSGI_UNIX) << "CPU topology not available, using the index CPU placement";
+        return;
+    }
+
+    std::cout << "CPU topology: " << topology.nodeCount() << " NUMA nodes, " << topology.packageCount() << " packages, "
+              << topology.coreCount() << " cores, " << topology.cpus().size() << " CPUs" << std::endl;
+
+    int node = -1;
+    if (placement == CWSGI::CpuTopology::Listener) {
+        QStringList interfaces;
+        if (!wsgi->cpuPlacementInterface().isEmpty()) {
+            interfaces.append(wsgi->cpuPlacementInterface());
+        } else {
+            // The interfaces with the addresses being listened on, or all of them for wildcard addresses
+            const auto allInterfaces = QNetworkInterface::allInterfaces();
+            for (const QNetworkInterface &interface : allInterfaces) {
+                if (interface.flags() & QNetworkInterface::IsLoopBack || !(interface.flags() & QNetworkInterface::IsUp)) {
+                    continue;
+                }
+
+                const auto entries = interface.addressEntries();
+                for (const QHostAddress &address : addresses) {
+                    const bool wildcard = address == QHostAddress::Any || address == QHostAddress::AnyIPv4 || address == QHostAddress::AnyIPv6;
+                    if (wildcard || std::any_of(entries.cbegin(), entries.cend(), [&address] (const QNetworkAddressEntry &entry) {
+                        return entry.ip().isEqual(address, QHostAddress::TolerantConversion);
+                    })) {
+                        interfaces.append(interface.name());
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (const QString &interface : interfaces) {
+            const int interfaceNode = topology.interfaceNode(interface);
+            if (interfaceNode == -1) {
+                continue;
+            } else if (node == -1) {
+                node = interfaceNode;
+            } else if (node != interfaceNode) {
+                qCWarning(WSGI_UNIX) << "Listening on interfaces of different NUMA nodes" << interfaces;
+                node = -1;
+                break;
+            }
+        }
+
+        if (node == -1) {
+            qCWarning(WSGI_UNIX) << "Could not find the NUMA node of the listening interfaces" << interfaces << "spreading workers instead";
+        } else {
+            std::cout << "CPU placement listener on NUMA node " << node << " of " << qPrintable(interfaces.join(QLatin1Char(' '))) << std::endl;
+        }
+    }
+
+    cpuPlacementThreads = qMax(1, threads);
+    cpuPlacementMemory = wsgi->numaBindMemory();
+    cpuPlacementSlots = topology.place(placement, qMax(1, processes) * cpuPlacementThreads, wsgi->cpuAffinity(), node);
+
+    for (size_t i = 0; i < cpuPlacementSlots.size(); ++i) {
+        const auto &slot = cpuPlacementSlots[i];
+        std::cout << "mapping worker " << i / size_t(cpuPlacementThreads) + 1 << " core " << i % size_t(cpuPlacementThreads) + 1 << " to CPUs:";
+        for (int cpu : slot.cpus) {
+            std::cout << " " << cpu;
+        }
+        if (slot.node >= 0) {
+            std::cout << " on NUMA node " << slot.node << (cpuPlacementMemory ? " with memory bound" : "");
+        }
+        std::cout << std::endl;
+    }
+#else
+    Q_UNUSED(processes)
+    Q_UNUSED(threads)
+    Q_UNUSED(addresses)
+    qCWarning(WSGI_UNIX) << "CPU placement" << wsgi->cpuPlacement() << "is only supported on Linux";
+#endif
+}
+
 int UnixFork::setupUnixSignalHandlers()
 {
     setupSocketPair(false, true);
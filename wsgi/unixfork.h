@@ -21,6 +21,7 @@
 #include <QObject>
 #include <QHash>
 #include <QVector>
+#include <QHostAddress>
 
 #include "abstractfork.h"
 
@@ -77,6 +78,12 @@ public:
 
     static void setSched(CWSGI::WSGI *wsgi, int workerId, int workerCore);
 
+    /**
+     * Computes where each worker thread runs for the topology aware CPU placements,
+     * must be called before forking, @a addresses are the ones being listened on.
+     */
+    static void setupCpuPlacement(CWSGI::WSGI *wsgi, int processes, int threads, const QVector<QHostAddress> &addresses);
+
 private:
     int setupUnixSignalHandlers();
     void setupSocketPair(bool closeSignalsFD, bool createPair);
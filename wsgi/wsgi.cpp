@@ -25,15 +25,23 @@
 #include "socket.h"
 #include "tcpserverbalancer.h"
 #include "localserver.h"
+#include "enginewatchdog.h"
+#include "introspectionserver.h"
+#include "trafficcapture.h"
+#include "trafficreplay.h"
 
 #ifdef Q_OS_UNIX
 #include "unixfork.h"
+#include "cputopology.h"
 #else
 #include "windowsfork.h"
 #endif
 
 #ifdef Q_OS_LINUX
 #include "../EventLoopEPoll/eventdispatcher_epoll.h"
+#ifdef HAVE_IO_URING
+#include "../EventLoopEPoll/eventdispatcher_uring.h"
+#endif
 #include "systemdnotify.h"
 #endif
 
@@ -48,10 +56,17 @@
 #include <QMetaProperty>
 #include <QTimer>
 #include <QDir>
+#include <QFile>
 #include <QMutex>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include <iostream>
 
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
 Q_LOGGING_CATEGORY(CUTELYST_WSGI, "wsgi", QtWarningMsg)
 
 using namespace CWSGI;
@@ -68,6 +83,13 @@ WSGI::WSGI(QObject *parent) : QObject(parent),
 
 #ifdef Q_OS_LINUX
     if (!qEnvironmentVariableIsSet("CUTELYST_QT_EVENT_LOOP")) {
+#ifdef HAVE_IO_URING
+        if (qEnvironmentVariableIsSet("CUTELYST_URING_EVENT_LOOP")) {
+            std::cout << "Installing io_uring event loop" << std::endl;
+            QCoreApplication::setEventDispatcher(new EventDispatcherURing);
+            return;
+        }
+#endif
         std::cout << "Installing EPoll event loop" << std::endl;
         QCoreApplication::setEventDispatcher(new EventDispatcherEPoll);
     }
@@ -154,6 +176,11 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                             QCoreApplication::translate("main", "bytes"));
     parser.addOption(postBufferingBufsize);
 
+    QCommandLineOption chunkedMinSizeOpt(QStringLiteral("chunked-min-size"),
+                                         QCoreApplication::translate("main", "set the minimum size of chunks of streamed HTTP/1.1 responses"),
+                                         QCoreApplication::translate("main", "bytes"));
+    parser.addOption(chunkedMinSizeOpt);
+
     QCommandLineOption httpSocketOpt({ QStringLiteral("http-socket"), QStringLiteral("h1") },
                                      QCoreApplication::translate("main", "bind to the specified TCP socket using HTTP protocol"),
                                      QCoreApplication::translate("main", "address"));
@@ -182,6 +209,11 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                       QCoreApplication::translate("main", "address"));
     parser.addOption(httpsSocketOpt);
 
+    QCommandLineOption sslHandshakeThreadsOpt(QStringLiteral("ssl-handshake-threads"),
+                                              QCoreApplication::translate("main", "number of threads used to complete TLS handshakes"),
+                                              QCoreApplication::translate("main", "threads"));
+    parser.addOption(sslHandshakeThreadsOpt);
+
     QCommandLineOption fastcgiSocketOpt(QStringLiteral("fastcgi-socket"),
                                         QCoreApplication::translate("main", "bind to the specified UNIX/TCP socket using FastCGI protocol"),
                                         QCoreApplication::translate("main", "address"));
@@ -224,6 +256,10 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                    QCoreApplication::translate("main", "enable TCP KEEPALIVEs"));
     parser.addOption(soKeepAlive);
 
+    QCommandLineOption edgeTriggeredOpt(QStringLiteral("edge-triggered"),
+                                        QCoreApplication::translate("main", "use edge triggered epoll notifications for TCP connections"));
+    parser.addOption(edgeTriggeredOpt);
+
     QCommandLineOption socketSndbuf(QStringLiteral("socket-sndbuf"),
                                     QCoreApplication::translate("main", "set SO_SNDBUF"),
                                     QCoreApplication::translate("main", "bytes"));
@@ -289,6 +325,35 @@ void WSGI::parseCommandLine(const QStringList &arguments)
     QCommandLineOption reusePortOption(QStringLiteral("reuse-port"),
                                        QCoreApplication::translate("main", "enable SO_REUSEPORT flag on socket (Linux 3.9+)"));
     parser.addOption(reusePortOption);
+
+    QCommandLineOption cpuPlacementOption(QStringLiteral("cpu-placement"),
+                                          QCoreApplication::translate("main", "place worker cores on CPUs following the topology: index, spread, compact or listener"),
+                                          QCoreApplication::translate("main", "policy"));
+    parser.addOption(cpuPlacementOption);
+
+    QCommandLineOption cpuPlacementInterfaceOption(QStringLiteral("cpu-placement-interface"),
+                                                   QCoreApplication::translate("main", "network interface whose NUMA node is used by the listener CPU placement"),
+                                                   QCoreApplication::translate("main", "interface"));
+    parser.addOption(cpuPlacementInterfaceOption);
+
+    QCommandLineOption numaBindMemoryOption(QStringLiteral("numa-bind-memory"),
+                                            QCoreApplication::translate("main", "prefer allocating memory on the NUMA node of the worker core CPUs"));
+    parser.addOption(numaBindMemoryOption);
+
+    QCommandLineOption tcpDeferAcceptOption(QStringLiteral("tcp-defer-accept"),
+                                            QCoreApplication::translate("main", "only accept TCP connections once data arrives (Linux only)"),
+                                            QCoreApplication::translate("main", "seconds"));
+    parser.addOption(tcpDeferAcceptOption);
+
+    QCommandLineOption tcpFastOpenOption(QStringLiteral("tcp-fastopen"),
+                                         QCoreApplication::translate("main", "enable TCP_FASTOPEN on TCP sockets (Linux only)"),
+                                         QCoreApplication::translate("main", "queue"));
+    parser.addOption(tcpFastOpenOption);
+
+    QCommandLineOption acceptBatchOption(QStringLiteral("accept-batch"),
+                                         QCoreApplication::translate("main", "maximum connections accepted per wake up, defaults to 64 (Linux only)"),
+                                         QCoreApplication::translate("main", "count"));
+    parser.addOption(acceptBatchOption);
 #endif
 
     QCommandLineOption threadBalancerOpt(QStringLiteral("experimental-thread-balancer"),
@@ -299,6 +364,70 @@ void WSGI::parseCommandLine(const QStringList &arguments)
                                      QCoreApplication::translate("main", "Enable frontend (reverse-)proxy support"));
     parser.addOption(frontendProxy);
 
+    QCommandLineOption eventLoopLagOpt(QStringLiteral("event-loop-lag"),
+                                       QCoreApplication::translate("main", "probe the event loop lag of each worker thread every N milliseconds"),
+                                       QCoreApplication::translate("main", "milliseconds"));
+    parser.addOption(eventLoopLagOpt);
+
+    QCommandLineOption blockingWatchdogOpt(QStringLiteral("blocking-watchdog"),
+                                           QCoreApplication::translate("main", "report worker threads blocked on a single request for more than N milliseconds"),
+                                           QCoreApplication::translate("main", "milliseconds"));
+    parser.addOption(blockingWatchdogOpt);
+
+#ifdef Q_OS_LINUX
+    QCommandLineOption blockingWatchdogBacktraceOpt(QStringLiteral("blocking-watchdog-backtrace"),
+                                                    QCoreApplication::translate("main", "dump the native backtrace of blocked worker threads"));
+    parser.addOption(blockingWatchdogBacktraceOpt);
+
+    QCommandLineOption blockingWatchdogSignalOpt(QStringLiteral("blocking-watchdog-signal"),
+                                                 QCoreApplication::translate("main", "real-time signal used to dump backtraces, as an offset from SIGRTMIN (default 0)"),
+                                                 QCoreApplication::translate("main", "offset"));
+    parser.addOption(blockingWatchdogSignalOpt);
+#endif
+
+    QCommandLineOption introspectionSocketOpt(QStringLiteral("introspection-socket"),
+                                              QCoreApplication::translate("main", "dump the worker state as JSON on the local socket name"),
+                                              QCoreApplication::translate("main", "name"));
+    parser.addOption(introspectionSocketOpt);
+
+    QCommandLineOption captureFileOpt(QStringLiteral("capture-file"),
+                                      QCoreApplication::translate("main", "record sampled requests to file to be replayed later"),
+                                      QCoreApplication::translate("main", "file"));
+    parser.addOption(captureFileOpt);
+
+    QCommandLineOption captureSampleOpt(QStringLiteral("capture-sample"),
+                                        QCoreApplication::translate("main", "record one of every N requests"),
+                                        QCoreApplication::translate("main", "N"));
+    parser.addOption(captureSampleOpt);
+
+    QCommandLineOption captureRedactOpt(QStringLiteral("capture-redact"),
+                                        QCoreApplication::translate("main", "redact the header value (or query parameter when prefixed with '?') on captured requests"),
+                                        QCoreApplication::translate("main", "name"));
+    parser.addOption(captureRedactOpt);
+
+    QCommandLineOption replayOpt(QStringLiteral("replay"),
+                                 QCoreApplication::translate("main", "replay a capture file on an in-process engine and print a summary"),
+                                 QCoreApplication::translate("main", "file"));
+    parser.addOption(replayOpt);
+
+    QCommandLineOption replayPacedOpt(QStringLiteral("replay-paced"),
+                                      QCoreApplication::translate("main", "replay requests respecting the original pacing"));
+    parser.addOption(replayPacedOpt);
+
+    QCommandLineOption replayReportOpt(QStringLiteral("replay-report"),
+                                       QCoreApplication::translate("main", "save the replay report as JSON to file"),
+                                       QCoreApplication::translate("main", "file"));
+    parser.addOption(replayReportOpt);
+
+    QCommandLineOption replayCompareOpt(QStringLiteral("replay-compare"),
+                                        QCoreApplication::translate("main", "compare the replay with a JSON report from a previous run"),
+                                        QCoreApplication::translate("main", "file"));
+    parser.addOption(replayCompareOpt);
+
+    QCommandLineOption parallelInitOpt(QStringLiteral("parallel-init"),
+                                       QCoreApplication::translate("main", "initialize the application of each thread in parallel"));
+    parser.addOption(parallelInitOpt);
+
 
     // Process the actual command line arguments given by the user
     parser.process(arguments);
@@ -383,6 +512,51 @@ void WSGI::parseCommandLine(const QStringList &arguments)
     if (parser.isSet(reusePortOption)) {
         setReusePort(true);
     }
+
+    if (parser.isSet(cpuPlacementOption)) {
+        bool ok;
+        const QString placement = parser.value(cpuPlacementOption);
+        CpuTopology::placementFromString(placement, &ok);
+        setCpuPlacement(placement);
+        if (!ok) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(cpuPlacementInterfaceOption)) {
+        setCpuPlacementInterface(parser.value(cpuPlacementInterfaceOption));
+    }
+
+    if (parser.isSet(numaBindMemoryOption)) {
+        setNumaBindMemory(true);
+    }
+
+    if (parser.isSet(tcpDeferAcceptOption)) {
+        bool ok;
+        auto seconds = parser.value(tcpDeferAcceptOption).toInt(&ok);
+        setTcpDeferAccept(seconds);
+        if (!ok || seconds < 0) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(tcpFastOpenOption)) {
+        bool ok;
+        auto queue = parser.value(tcpFastOpenOption).toInt(&ok);
+        setTcpFastOpen(queue);
+        if (!ok || queue < 0) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(acceptBatchOption)) {
+        bool ok;
+        auto count = parser.value(acceptBatchOption).toInt(&ok);
+        setAcceptBatch(count);
+        if (!ok || count < 1) {
+            parser.showHelp(1);
+        }
+    }
 #endif
 
     if (parser.isSet(lazyOption)) {
@@ -425,6 +599,24 @@ void WSGI::parseCommandLine(const QStringList &arguments)
         }
     }
 
+    if (parser.isSet(chunkedMinSizeOpt)) {
+        bool ok;
+        auto size = parser.value(chunkedMinSizeOpt).toInt(&ok);
+        setChunkedMinSize(size);
+        if (!ok || size < 0) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(sslHandshakeThreadsOpt)) {
+        bool ok;
+        auto threads = parser.value(sslHandshakeThreadsOpt).toInt(&ok);
+        setSslHandshakeThreads(threads);
+        if (!ok || threads < 0) {
+            parser.showHelp(1);
+        }
+    }
+
     if (parser.isSet(application)) {
         setApplication(parser.value(application));
     }
@@ -445,6 +637,10 @@ void WSGI::parseCommandLine(const QStringList &arguments)
         setSoKeepalive(true);
     }
 
+    if (parser.isSet(edgeTriggeredOpt)) {
+        setEdgeTriggered(true);
+    }
+
     if (parser.isSet(upgradeH2cOpt)) {
         setUpgradeH2c(true);
     }
@@ -493,6 +689,78 @@ void WSGI::parseCommandLine(const QStringList &arguments)
         setUsingFrontendProxy(true);
     }
 
+    if (parser.isSet(eventLoopLagOpt)) {
+        bool ok;
+        auto value = parser.value(eventLoopLagOpt).toInt(&ok);
+        setEventLoopLag(value);
+        if (!ok || value < 1) {
+            parser.showHelp(1);
+        }
+    }
+
+    if (parser.isSet(blockingWatchdogOpt)) {
+        bool ok;
+        auto value = parser.value(blockingWatchdogOpt).toInt(&ok);
+        setBlockingWatchdog(value);
+        if (!ok || value < 1) {
+            parser.showHelp(1);
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    if (parser.isSet(blockingWatchdogBacktraceOpt)) {
+        setBlockingWatchdogBacktrace(true);
+    }
+
+    if (parser.isSet(blockingWatchdogSignalOpt)) {
+        bool ok;
+        auto value = parser.value(blockingWatchdogSignalOpt).toInt(&ok);
+        setBlockingWatchdogSignal(value);
+        if (!ok || value < 0) {
+            parser.showHelp(1);
+        }
+    }
+#endif
+
+    if (parser.isSet(introspectionSocketOpt)) {
+        setIntrospectionSocket(parser.value(introspectionSocketOpt));
+    }
+
+    if (parser.isSet(captureFileOpt)) {
+        setCaptureFile(parser.value(captureFileOpt));
+    }
+
+    if (parser.isSet(captureSampleOpt)) {
+        bool ok;
+        auto value = parser.value(captureSampleOpt).toInt(&ok);
+        setCaptureSample(value);
+        if (!ok || value < 1) {
+            parser.showHelp(1);
+        }
+    }
+
+    setCaptureRedact(captureRedact() + parser.values(captureRedactOpt));
+
+    if (parser.isSet(replayOpt)) {
+        setReplay(parser.value(replayOpt));
+    }
+
+    if (parser.isSet(replayPacedOpt)) {
+        setReplayPaced(true);
+    }
+
+    if (parser.isSet(replayReportOpt)) {
+        setReplayReport(parser.value(replayReportOpt));
+    }
+
+    if (parser.isSet(replayCompareOpt)) {
+        setReplayCompare(parser.value(replayCompareOpt));
+    }
+
+    if (parser.isSet(parallelInitOpt)) {
+        setParallelInit(true);
+    }
+
     setHttpSocket(httpSocket() + parser.values(httpSocketOpt));
 
     setHttp2Socket(http2Socket() + parser.values(http2SocketOpt));
@@ -515,6 +783,11 @@ int WSGI::exec(Cutelyst::Application *app)
     Q_D(WSGI);
     std::cout << "Cutelyst-WSGI starting" << std::endl;
 
+    if (!d->replay.isEmpty()) {
+        d->app = app;
+        return d->runReplay();
+    }
+
 
 
     if (!qEnvironmentVariableIsSet("CUTELYST_WSGI_IGNORE_MASTER") && !d->master) {
@@ -611,6 +884,17 @@ int WSGI::exec(Cutelyst::Application *app)
         }
     }
 
+#ifdef Q_OS_UNIX
+    QVector<QHostAddress> addresses;
+    for (QObject *server : d->servers) {
+        auto tcpServer = qobject_cast<QTcpServer *>(server);
+        if (tcpServer) {
+            addresses.append(tcpServer->serverAddress());
+        }
+    }
+    UnixFork::setupCpuPlacement(this, d->processes, qMax(d->threads, 1), addresses);
+#endif
+
     d->app = app;
 
     if (!d->lazy) {
@@ -657,6 +941,8 @@ void WSGI::stop()
 }
 
 WSGIPrivate::~WSGIPrivate() {
+    delete watchdog;
+    delete capture;
     delete protoHTTP;
     delete protoHTTP2;
     delete protoFCGI;
@@ -1367,6 +1653,45 @@ int WSGI::cpuAffinity() const
     return d->cpuAffinity;
 }
 
+void WSGI::setCpuPlacement(const QString &placement)
+{
+    Q_D(WSGI);
+    d->cpuPlacement = placement;
+    Q_EMIT changed();
+}
+
+QString WSGI::cpuPlacement() const
+{
+    Q_D(const WSGI);
+    return d->cpuPlacement;
+}
+
+void WSGI::setCpuPlacementInterface(const QString &interface)
+{
+    Q_D(WSGI);
+    d->cpuPlacementInterface = interface;
+    Q_EMIT changed();
+}
+
+QString WSGI::cpuPlacementInterface() const
+{
+    Q_D(const WSGI);
+    return d->cpuPlacementInterface;
+}
+
+void WSGI::setNumaBindMemory(bool enable)
+{
+    Q_D(WSGI);
+    d->numaBindMemory = enable;
+    Q_EMIT changed();
+}
+
+bool WSGI::numaBindMemory() const
+{
+    Q_D(const WSGI);
+    return d->numaBindMemory;
+}
+
 void WSGI::setReusePort(bool enable)
 {
 #ifdef Q_OS_LINUX
@@ -1408,7 +1733,241 @@ bool WSGI::usingFrontendProxy() const
     return d->usingFrontendProxy;
 }
 
-void WSGIPrivate::setupApplication()
+void WSGI::setEventLoopLag(int value)
+{
+    Q_D(WSGI);
+    d->eventLoopLag = value;
+    Q_EMIT changed();
+}
+
+int WSGI::eventLoopLag() const
+{
+    Q_D(const WSGI);
+    return d->eventLoopLag;
+}
+
+void WSGI::setBlockingWatchdog(int value)
+{
+    Q_D(WSGI);
+    d->blockingWatchdog = value;
+    Q_EMIT changed();
+}
+
+int WSGI::blockingWatchdog() const
+{
+    Q_D(const WSGI);
+    return d->blockingWatchdog;
+}
+
+void WSGI::setBlockingWatchdogBacktrace(bool value)
+{
+    Q_D(WSGI);
+    d->blockingWatchdogBacktrace = value;
+    Q_EMIT changed();
+}
+
+bool WSGI::blockingWatchdogBacktrace() const
+{
+    Q_D(const WSGI);
+    return d->blockingWatchdogBacktrace;
+}
+
+void WSGI::setBlockingWatchdogSignal(int offset)
+{
+    Q_D(WSGI);
+    d->blockingWatchdogSignal = offset;
+    Q_EMIT changed();
+}
+
+int WSGI::blockingWatchdogSignal() const
+{
+    Q_D(const WSGI);
+    return d->blockingWatchdogSignal;
+}
+
+void WSGI::setIntrospectionSocket(const QString &value)
+{
+    Q_D(WSGI);
+    d->introspectionSocket = value;
+    Q_EMIT changed();
+}
+
+QString WSGI::introspectionSocket() const
+{
+    Q_D(const WSGI);
+    return d->introspectionSocket;
+}
+
+void WSGI::setCaptureFile(const QString &value)
+{
+    Q_D(WSGI);
+    d->captureFile = value;
+    Q_EMIT changed();
+}
+
+QString WSGI::captureFile() const
+{
+    Q_D(const WSGI);
+    return d->captureFile;
+}
+
+void WSGI::setCaptureSample(int value)
+{
+    Q_D(WSGI);
+    d->captureSample = value;
+    Q_EMIT changed();
+}
+
+int WSGI::captureSample() const
+{
+    Q_D(const WSGI);
+    return d->captureSample;
+}
+
+void WSGI::setCaptureRedact(const QStringList &value)
+{
+    Q_D(WSGI);
+    d->captureRedact = value;
+    Q_EMIT changed();
+}
+
+QStringList WSGI::captureRedact() const
+{
+    Q_D(const WSGI);
+    return d->captureRedact;
+}
+
+void WSGI::setReplay(const QString &value)
+{
+    Q_D(WSGI);
+    d->replay = value;
+    Q_EMIT changed();
+}
+
+QString WSGI::replay() const
+{
+    Q_D(const WSGI);
+    return d->replay;
+}
+
+void WSGI::setReplayPaced(bool value)
+{
+    Q_D(WSGI);
+    d->replayPaced = value;
+    Q_EMIT changed();
+}
+
+bool WSGI::replayPaced() const
+{
+    Q_D(const WSGI);
+    return d->replayPaced;
+}
+
+void WSGI::setReplayReport(const QString &value)
+{
+    Q_D(WSGI);
+    d->replayReport = value;
+    Q_EMIT changed();
+}
+
+QString WSGI::replayReport() const
+{
+    Q_D(const WSGI);
+    return d->replayReport;
+}
+
+void WSGI::setReplayCompare(const QString &value)
+{
+    Q_D(WSGI);
+    d->replayCompare = value;
+    Q_EMIT changed();
+}
+
+QString WSGI::replayCompare() const
+{
+    Q_D(const WSGI);
+    return d->replayCompare;
+}
+
+void WSGI::setEdgeTriggered(bool value)
+{
+    Q_D(WSGI);
+    d->edgeTriggered = value;
+    Q_EMIT changed();
+}
+
+bool WSGI::edgeTriggered() const
+{
+    Q_D(const WSGI);
+    return d->edgeTriggered;
+}
+
+void WSGI::setChunkedMinSize(int value)
+{
+    Q_D(WSGI);
+    d->chunkedMinSize = value;
+    Q_EMIT changed();
+}
+
+int WSGI::chunkedMinSize() const
+{
+    Q_D(const WSGI);
+    return d->chunkedMinSize;
+}
+
+void WSGI::setSslHandshakeThreads(int value)
+{
+    Q_D(WSGI);
+    d->sslHandshakeThreads = value;
+    Q_EMIT changed();
+}
+
+int WSGI::sslHandshakeThreads() const
+{
+    Q_D(const WSGI);
+    return d->sslHandshakeThreads;
+}
+
+void WSGI::setTcpDeferAccept(int value)
+{
+    Q_D(WSGI);
+    d->tcpDeferAccept = value;
+    Q_EMIT changed();
+}
+
+int WSGI::tcpDeferAccept() const
+{
+    Q_D(const WSGI);
+    return d->tcpDeferAccept;
+}
+
+void WSGI::setTcpFastOpen(int value)
+{
+    Q_D(WSGI);
+    d->tcpFastOpen = value;
+    Q_EMIT changed();
+}
+
+int WSGI::tcpFastOpen() const
+{
+    Q_D(const WSGI);
+    return d->tcpFastOpen;
+}
+
+void WSGI::setAcceptBatch(int value)
+{
+    Q_D(WSGI);
+    d->acceptBatch = value;
+    Q_EMIT changed();
+}
+
+int WSGI::acceptBatch() const
+{
+    Q_D(const WSGI);
+    return d->acceptBatch;
+}
+
+Cutelyst::Application *WSGIPrivate::loadApplication()
 {
     Cutelyst::Application *localApp = app;
     if (!localApp) {
@@ -1438,6 +1997,41 @@ void WSGIPrivate::setupApplication()
         qCDebug(CUTELYST_WSGI) << "Loaded application: " << QCoreApplication::applicationName();
     }
 
+    return localApp;
+}
+
+void WSGI::setParallelInit(bool value)
+{
+    Q_D(WSGI);
+    d->parallelInit = value;
+    Q_EMIT changed();
+}
+
+bool WSGI::parallelInit() const
+{
+    Q_D(const WSGI);
+    return d->parallelInit;
+}
+
+// Resident set size in KiB, used to report how setup scales with the number of threads
+static qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QFile::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields.at(1).toLongLong() * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+#endif
+    return -1;
+}
+
+void WSGIPrivate::setupApplication()
+{
+    Cutelyst::Application *localApp = loadApplication();
+
     if (!chdir2.isEmpty()) {
         std::cout << "Changing directory2 to: " << chdir2.toLatin1().constData()  << std::endl;
         if (!QDir::setCurrent(chdir2)) {
@@ -1445,7 +2039,13 @@ void WSGIPrivate::setupApplication()
         }
     }
 
-    if (threads > 1) {
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 memoryBefore = residentMemory();
+
+    if (threads > 1 && parallelInit) {
+        setupEnginesParallel(localApp);
+    } else if (threads > 1) {
         engine = createEngine(localApp, 0);
         for (int i = 1; i < threads; ++i) {
             if (createEngine(localApp, i)) {
@@ -1456,15 +2056,74 @@ void WSGIPrivate::setupApplication()
         engine = createEngine(localApp, 0);
     }
 
+    qCInfo(CUTELYST_WSGI) << "Initialized" << engines.size() << "engines in" << timer.elapsed() << "ms";
+    if (memoryBefore != -1) {
+        qCInfo(CUTELYST_WSGI) << "Engines setup grew resident memory by" << residentMemory() - memoryBefore << "KiB";
+    }
+
     if (!engine) {
         std::cerr << "Application failed to init, cheaping..." << std::endl;
         exit(15);
     }
 }
 
+int WSGIPrivate::runReplay()
+{
+    if (!chdir.isEmpty() && !QDir::setCurrent(chdir)) {
+        qFatal("Failed to chdir to: '%s'", chdir.toLatin1().constData());
+    }
+
+    Cutelyst::Application *localApp = loadApplication();
+
+    if (!chdir2.isEmpty() && !QDir::setCurrent(chdir2)) {
+        qFatal("Failed to chdir2 to: '%s'", chdir2.toLatin1().constData());
+    }
+
+    auto replayEngine = new ReplayEngine(localApp, opt);
+    replayEngine->setParent(this);
+    replayEngine->setConfig(config);
+    if (!replayEngine->init()) {
+        std::cerr << "Application failed to init, cheaping..." << std::endl;
+        return 15;
+    }
+
+    TrafficReplay trafficReplay(replayEngine);
+    if (!trafficReplay.run(replay, replayPaced)) {
+        return 1;
+    }
+
+    std::cout << trafficReplay.summary().constData() << std::endl;
+
+    if (!replayReport.isEmpty()) {
+        QFile file(replayReport);
+        if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+            std::cerr << "Failed to write replay report " << qPrintable(replayReport) << std::endl;
+            return 1;
+        }
+        file.write(QJsonDocument(trafficReplay.report()).toJson());
+    }
+
+    if (!replayCompare.isEmpty()) {
+        QFile file(replayCompare);
+        if (!file.open(QFile::ReadOnly)) {
+            std::cerr << "Failed to read replay baseline " << qPrintable(replayCompare) << std::endl;
+            return 1;
+        }
+        std::cout << trafficReplay.compare(QJsonDocument::fromJson(file.readAll()).object()).constData() << std::endl;
+    }
+
+    return 0;
+}
+
 void WSGIPrivate::engineShutdown(CWsgiEngine *engine)
 {
     engines.erase(std::remove(engines.begin(), engines.end(), engine), engines.end());
+    if (watchdog) {
+        watchdog->removeEngine(engine);
+    }
+    if (introspection) {
+        introspection->removeEngine(engine);
+    }
 
     const auto engineThread = engine->thread();
     if (QThread::currentThread() != engineThread) {
@@ -1504,12 +2163,62 @@ void WSGIPrivate::postFork(int workerId)
         qCDebug(CUTELYST_WSGI) << "Starting threads";
     }
 
+    // Threads do not survive fork() so the watchdog is created on each worker
+    if (blockingWatchdog > 0 && !watchdog) {
+        int backtraceSignal = 0;
+        if (blockingWatchdogBacktrace) {
+            backtraceSignal = EngineWatchdog::installBacktraceHandler(blockingWatchdogSignal);
+        }
+
+        watchdog = new EngineWatchdog(blockingWatchdog, backtraceSignal);
+        for (CWsgiEngine *engine : engines) {
+            watchdog->addEngine(engine);
+        }
+        watchdog->start();
+    }
+
+    if (!captureFile.isEmpty() && !capture) {
+        QString name = captureFile;
+        if (processes > 1) {
+            name += QLatin1Char('.') + QString::number(workerId);
+        }
+
+        capture = new TrafficCapture(captureSample, captureRedact);
+        if (capture->open(name)) {
+            for (CWsgiEngine *engine : engines) {
+                engine->setTrafficCapture(capture);
+            }
+        }
+    }
+
+    if (!introspectionSocket.isEmpty() && !introspection) {
+        QString name = introspectionSocket;
+        if (processes > 1) {
+            name += QLatin1Char('.') + QString::number(workerId);
+        }
+
+        introspection = new IntrospectionServer(this);
+        if (introspection->listen(name)) {
+            for (CWsgiEngine *engine : engines) {
+                introspection->addEngine(engine);
+            }
+        }
+    }
+
     for (CWsgiEngine *engine : engines) {
         QThread *thread = engine->thread();
         if (thread != qApp->thread()) {
 #ifdef Q_OS_LINUX
             if (!qEnvironmentVariableIsSet("CUTELYST_QT_EVENT_LOOP")) {
+#ifdef HAVE_IO_URING
+                if (qEnvironmentVariableIsSet("CUTELYST_URING_EVENT_LOOP")) {
+                    thread->setEventDispatcher(new EventDispatcherURing);
+                } else {
+                    thread->setEventDispatcher(new EventDispatcherEPoll);
+                }
+#else
                 thread->setEventDispatcher(new EventDispatcherEPoll);
+#endif
             }
 #endif
 
@@ -1545,7 +2254,66 @@ void WSGIPrivate::writePidFile(const QString &filename)
     file.write(QByteArray::number(QCoreApplication::applicationPid()) + '\n');
 }
 
-CWsgiEngine *WSGIPrivate::createEngine(Application *app, int core)
+namespace {
+
+// Initializes the engine application and hands it back to the main thread
+class EngineInitThread : public QThread
+{
+public:
+    EngineInitThread(CWsgiEngine *engine, QThread *target) : m_engine(engine), m_target(target) {
+        m_engine->moveToThread(this);
+    }
+
+    void run() override {
+        m_ok = m_engine->init();
+        m_engine->moveToThread(m_target);
+    }
+
+    inline CWsgiEngine *engine() const { return m_engine; }
+    inline bool ok() const { return m_ok; }
+
+private:
+    CWsgiEngine *m_engine;
+    QThread *m_target;
+    bool m_ok = false;
+};
+
+}
+
+void WSGIPrivate::setupEnginesParallel(Application *app)
+{
+    // Engines and their applications are created here as
+    // Q_INVOKABLE constructors are not required to be thread safe
+    std::vector<EngineInitThread *> initThreads;
+    for (int i = 0; i < threads; ++i) {
+        initThreads.push_back(new EngineInitThread(newEngine(app, i), thread()));
+    }
+
+    for (EngineInitThread *initThread : initThreads) {
+        initThread->start();
+    }
+
+    for (EngineInitThread *initThread : initThreads) {
+        initThread->wait();
+
+        CWsgiEngine *initEngine = initThread->engine();
+        const int core = initEngine->workerCore();
+        if (initThread->ok()) {
+            addEngine(initEngine);
+            if (core == 0) {
+                engine = initEngine;
+            } else {
+                ++workersNotRunning;
+            }
+        } else {
+            std::cerr << "Application failed to init(), cheaping core: " << core << std::endl;
+            delete initEngine;
+        }
+        delete initThread;
+    }
+}
+
+CWsgiEngine *WSGIPrivate::newEngine(Application *app, int core)
 {
     Q_Q(WSGI);
 
@@ -1557,12 +2325,26 @@ CWsgiEngine *WSGIPrivate::createEngine(Application *app, int core)
 
     engine->setConfig(config);
     engine->setServers(servers);
+
+    return engine;
+}
+
+CWsgiEngine *WSGIPrivate::createEngine(Application *app, int core)
+{
+    auto engine = newEngine(app, core);
     if (!engine->init()) {
         std::cerr << "Application failed to init(), cheaping core: " << core << std::endl;
         delete engine;
         return nullptr;
     }
 
+    addEngine(engine);
+
+    return engine;
+}
+
+void WSGIPrivate::addEngine(CWsgiEngine *engine)
+{
     engines.push_back(engine);
 
     if (threads > 1) {
@@ -1571,8 +2353,6 @@ CWsgiEngine *WSGIPrivate::createEngine(Application *app, int core)
     } else {
         engine->setParent(this);
     }
-
-    return engine;
 }
 
 void WSGIPrivate::loadConfig(const QString &file, bool json)
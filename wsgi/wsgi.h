@@ -267,7 +267,10 @@ public:
     int listenQueue() const;
 
     /**
-     * Defines the buffer size used when parsing requests
+     * Defines the buffer size used when parsing requests, HTTP/1.1 connections
+     * start with a small buffer that grows up to this size and is given back
+     * to a per thread pool while the connection is idle. Requests whose request
+     * line or headers don't fit are answered with 414 or 431 respectively.
      * @accessors bufferSize(), setBufferSize()
      */
     Q_PROPERTY(int buffer_size READ bufferSize WRITE setBufferSize NOTIFY changed)
@@ -276,7 +279,9 @@ public:
 
     /**
      * Defines the maximum buffer size of POST request, if a request has a content length
-     * that is bigger than the post buffer size a temporary file is created instead
+     * that is bigger than the post buffer size a temporary file is created instead.
+     * When set to 0 HTTP/1.1 requests are dispatched as soon as the headers are parsed,
+     * actions marked with :StreamingBody read the body while it's being received
      * @accessors postBuffering(), setPostBuffering()
      */
     Q_PROPERTY(qint64 post_buffering READ postBuffering WRITE setPostBuffering NOTIFY changed)
@@ -401,6 +406,40 @@ public:
     void setCpuAffinity(int value);
     int cpuAffinity() const;
 
+    /**
+     * Defines how worker threads are placed on CPUs, @c index (the default) assigns
+     * CPUs by their number, the topology aware placements read the CPUs, SMT siblings and
+     * NUMA nodes from sysfs: @c spread gives each worker core its own physical core alternating
+     * NUMA nodes, @c compact fills SMT siblings and nodes one after the other and @c listener
+     * prefers the NUMA node of the network interface being listened on.
+     * cpuAffinity() sets how many CPUs each worker core gets, defaulting to one.
+     * @accessors cpuPlacement(), setCpuPlacement()
+     * \note Linux only
+     */
+    Q_PROPERTY(QString cpu_placement READ cpuPlacement WRITE setCpuPlacement NOTIFY changed)
+    void setCpuPlacement(const QString &placement);
+    QString cpuPlacement() const;
+
+    /**
+     * Defines the network interface used by the @c listener CPU placement, by default the
+     * interfaces of the listening addresses are used.
+     * @accessors cpuPlacementInterface(), setCpuPlacementInterface()
+     * \note Linux only
+     */
+    Q_PROPERTY(QString cpu_placement_interface READ cpuPlacementInterface WRITE setCpuPlacementInterface NOTIFY changed)
+    void setCpuPlacementInterface(const QString &interface);
+    QString cpuPlacementInterface() const;
+
+    /**
+     * Prefers allocating the memory of each worker thread on the NUMA node of its CPUs,
+     * used with the topology aware CPU placements.
+     * @accessors numaBindMemory(), setNumaBindMemory()
+     * \note Linux only
+     */
+    Q_PROPERTY(bool numa_bind_memory READ numaBindMemory WRITE setNumaBindMemory NOTIFY changed)
+    void setNumaBindMemory(bool enable);
+    bool numaBindMemory() const;
+
     /**
      * Enable SO_REUSEPORT for the sockets
      * @accessors reusePort(), setReusePort()
@@ -428,6 +467,192 @@ public:
     void setUsingFrontendProxy(bool enable);
     bool usingFrontendProxy() const;
 
+    /**
+     * Defines the interval in milliseconds used to probe the event loop lag of each
+     * worker thread, the lag histogram is logged on shutdown and when the
+     * blocking watchdog reports a thread. Disabled by default (0).
+     * @accessors eventLoopLag(), setEventLoopLag()
+     */
+    Q_PROPERTY(int event_loop_lag READ eventLoopLag WRITE setEventLoopLag NOTIFY changed)
+    void setEventLoopLag(int value);
+    int eventLoopLag() const;
+
+    /**
+     * Defines the time in milliseconds a worker thread may spend processing a single
+     * request before the watchdog logs its action stack and request path.
+     * Disabled by default (0).
+     * @accessors blockingWatchdog(), setBlockingWatchdog()
+     */
+    Q_PROPERTY(int blocking_watchdog READ blockingWatchdog WRITE setBlockingWatchdog NOTIFY changed)
+    void setBlockingWatchdog(int value);
+    int blockingWatchdog() const;
+
+    /**
+     * Defines if the blocking watchdog should also dump the native backtrace
+     * of the blocked thread to stderr
+     * @accessors blockingWatchdogBacktrace(), setBlockingWatchdogBacktrace()
+     * \note Linux only
+     */
+    Q_PROPERTY(bool blocking_watchdog_backtrace READ blockingWatchdogBacktrace WRITE setBlockingWatchdogBacktrace NOTIFY changed)
+    void setBlockingWatchdogBacktrace(bool value);
+    bool blockingWatchdogBacktrace() const;
+
+    /**
+     * Defines the real-time signal, as an offset from SIGRTMIN, sent to blocked
+     * threads to dump their native backtrace, defaults to 0 (SIGRTMIN). Change it
+     * if the application already uses that signal.
+     * @accessors blockingWatchdogSignal(), setBlockingWatchdogSignal()
+     * \note Linux only
+     */
+    Q_PROPERTY(int blocking_watchdog_signal READ blockingWatchdogSignal WRITE setBlockingWatchdogSignal NOTIFY changed)
+    void setBlockingWatchdogSignal(int offset);
+    int blockingWatchdogSignal() const;
+
+    /**
+     * Defines the local socket name used to dump the live state of each worker process
+     * as JSON: open connections, in flight requests, HTTP/2 streams, websocket buffers
+     * and the shared versus private memory of the process (Linux only).
+     * When more than one process is spawned the worker id is appended to the name.
+     * @accessors introspectionSocket(), setIntrospectionSocket()
+     */
+    Q_PROPERTY(QString introspection_socket READ introspectionSocket WRITE setIntrospectionSocket NOTIFY changed)
+    void setIntrospectionSocket(const QString &value);
+    QString introspectionSocket() const;
+
+    /**
+     * Defines the file where sampled requests are recorded to be later fed
+     * back with replay. When more than one process is spawned the worker id
+     * is appended to the file name.
+     * @accessors captureFile(), setCaptureFile()
+     */
+    Q_PROPERTY(QString capture_file READ captureFile WRITE setCaptureFile NOTIFY changed)
+    void setCaptureFile(const QString &value);
+    QString captureFile() const;
+
+    /**
+     * Defines that one of every N requests is recorded by capture_file,
+     * by default all requests are recorded.
+     * @accessors captureSample(), setCaptureSample()
+     */
+    Q_PROPERTY(int capture_sample READ captureSample WRITE setCaptureSample NOTIFY changed)
+    void setCaptureSample(int value);
+    int captureSample() const;
+
+    /**
+     * Defines the header names whose values are replaced by REDACTED in the
+     * capture file, names starting with '?' redact query parameters instead.
+     * Authorization, Proxy-Authorization and Cookie headers are always redacted.
+     * @accessors captureRedact(), setCaptureRedact()
+     */
+    Q_PROPERTY(QStringList capture_redact READ captureRedact WRITE setCaptureRedact NOTIFY changed)
+    void setCaptureRedact(const QStringList &value);
+    QStringList captureRedact() const;
+
+    /**
+     * Defines a file recorded with capture_file to be replayed on an in-process
+     * engine instead of listening on sockets, a summary with throughput and per
+     * action latency, CPU and allocations is printed at the end.
+     * @accessors replay(), setReplay()
+     */
+    Q_PROPERTY(QString replay READ replay WRITE setReplay NOTIFY changed)
+    void setReplay(const QString &value);
+    QString replay() const;
+
+    /**
+     * Defines if replay should respect the original pacing of the recorded
+     * requests instead of running at full speed.
+     * @accessors replayPaced(), setReplayPaced()
+     */
+    Q_PROPERTY(bool replay_paced READ replayPaced WRITE setReplayPaced NOTIFY changed)
+    void setReplayPaced(bool value);
+    bool replayPaced() const;
+
+    /**
+     * Defines a file where the replay report is saved as JSON, to be used
+     * as replay_compare baseline on another build.
+     * @accessors replayReport(), setReplayReport()
+     */
+    Q_PROPERTY(QString replay_report READ replayReport WRITE setReplayReport NOTIFY changed)
+    void setReplayReport(const QString &value);
+    QString replayReport() const;
+
+    /**
+     * Defines a JSON replay report from a previous run, the per action
+     * latency, CPU and allocation differences are printed after the replay.
+     * @accessors replayCompare(), setReplayCompare()
+     */
+    Q_PROPERTY(QString replay_compare READ replayCompare WRITE setReplayCompare NOTIFY changed)
+    void setReplayCompare(const QString &value);
+    QString replayCompare() const;
+
+    /**
+     * Defines if the engines of each thread should initialize their application
+     * in parallel, reducing startup and reload time with many threads.
+     * Application::init() must not rely on being called from the main thread.
+     * @accessors parallelInit(), setParallelInit()
+     */
+    Q_PROPERTY(bool parallel_init READ parallelInit WRITE setParallelInit NOTIFY changed)
+    void setParallelInit(bool value);
+    bool parallelInit() const;
+
+    /**
+     * Defines if TCP connections should use edge triggered epoll notifications,
+     * sockets are drained on every read notification and enabling the write
+     * notifier no longer requires an epoll_ctl() call.
+     * @accessors edgeTriggered(), setEdgeTriggered()
+     * @note Only the Linux EPoll event loop supports this.
+     */
+    Q_PROPERTY(bool edge_triggered READ edgeTriggered WRITE setEdgeTriggered NOTIFY changed)
+    void setEdgeTriggered(bool value);
+    bool edgeTriggered() const;
+
+    /**
+     * Defines the minimum size of the chunks used when an HTTP/1.1 response is
+     * written without a Content-Length, smaller writes are coalesced while the
+     * request is not async. Set to 0 to write each chunk right away.
+     * @accessors chunkedMinSize(), setChunkedMinSize()
+     */
+    Q_PROPERTY(int chunked_min_size READ chunkedMinSize WRITE setChunkedMinSize NOTIFY changed)
+    void setChunkedMinSize(int value);
+    int chunkedMinSize() const;
+
+    /**
+     * Defines the number of threads used to complete the TLS handshake of HTTPS
+     * connections, sockets are only handed to an engine once encrypted.
+     * Set to 0 to do the handshake on the engine thread.
+     * @accessors sslHandshakeThreads(), setSslHandshakeThreads()
+     */
+    Q_PROPERTY(int ssl_handshake_threads READ sslHandshakeThreads WRITE setSslHandshakeThreads NOTIFY changed)
+    void setSslHandshakeThreads(int value);
+    int sslHandshakeThreads() const;
+
+    /**
+     * Sets TCP_DEFER_ACCEPT on TCP listening sockets, connections are only
+     * accepted once request data arrives or after this many seconds. (Linux only)
+     * @accessors tcpDeferAccept(), setTcpDeferAccept()
+     */
+    Q_PROPERTY(int tcp_defer_accept READ tcpDeferAccept WRITE setTcpDeferAccept NOTIFY changed)
+    void setTcpDeferAccept(int value);
+    int tcpDeferAccept() const;
+
+    /**
+     * Enables TCP_FASTOPEN on TCP listening sockets with the given
+     * queue length of pending fast open requests. (Linux only)
+     * @accessors tcpFastOpen(), setTcpFastOpen()
+     */
+    Q_PROPERTY(int tcp_fastopen READ tcpFastOpen WRITE setTcpFastOpen NOTIFY changed)
+    void setTcpFastOpen(int value);
+    int tcpFastOpen() const;
+
+    /**
+     * Defines the maximum number of connections accepted from a TCP listening
+     * socket on each wake up, the default is 64. (Linux only)
+     * @accessors acceptBatch(), setAcceptBatch()
+     */
+    Q_PROPERTY(int accept_batch READ acceptBatch WRITE setAcceptBatch NOTIFY changed)
+    void setAcceptBatch(int value);
+    int acceptBatch() const;
+
 Q_SIGNALS:
     /**
      * It is emitted once the server is ready.
@@ -32,6 +32,9 @@ namespace CWSGI {
 
 class Protocol;
 class ProtocolHttp2;
+class EngineWatchdog;
+class IntrospectionServer;
+class TrafficCapture;
 class WSGIPrivate : public QObject
 {
     Q_OBJECT
@@ -44,13 +47,18 @@ public:
     bool listenTcp(const QString &line, Protocol *protocol, bool secure);
     void listenLocalSockets();
     bool listenLocal(const QString &line, Protocol *protocol);
+    Cutelyst::Application *loadApplication();
     void setupApplication();
+    int runReplay();
     void engineShutdown(CWsgiEngine *engine);
     void workerStarted();
     void postFork(int workerId);
     void writePidFile(const QString &filename);
 
     CWsgiEngine *createEngine(Cutelyst::Application *app, int core);
+    CWsgiEngine *newEngine(Cutelyst::Application *app, int core);
+    void addEngine(CWsgiEngine *engine);
+    void setupEnginesParallel(Cutelyst::Application *app);
 
     void loadConfig(const QString &file, bool json);
     void applyConfig(const QVariantMap &config);
@@ -91,6 +99,9 @@ public:
     QString umask;
     bool noInitgroups = false;
     int cpuAffinity = 0;
+    QString cpuPlacement;
+    QString cpuPlacementInterface;
+    bool numaBindMemory = false;
     bool reusePort = false;
     qint64 postBuffering = -1;
     qint64 postBufferingBufsize = 4096;
@@ -98,6 +109,9 @@ public:
     ProtocolHttp2 *protoHTTP2 = nullptr;
     Protocol *protoFCGI = nullptr;
     AbstractFork *genericFork = nullptr;
+    EngineWatchdog *watchdog = nullptr;
+    IntrospectionServer *introspection = nullptr;
+    TrafficCapture *capture = nullptr;
     int bufferSize = 4096;
     int workersNotRunning = 1;
     int threads = 1;
@@ -117,6 +131,25 @@ public:
     bool upgradeH2c = false;
     bool httpsH2 = false;
     bool usingFrontendProxy = false;
+    int eventLoopLag = 0;
+    int blockingWatchdog = 0;
+    bool blockingWatchdogBacktrace = false;
+    int blockingWatchdogSignal = 0;
+    QString introspectionSocket;
+    QString captureFile;
+    int captureSample = 1;
+    QStringList captureRedact;
+    QString replay;
+    bool replayPaced = false;
+    QString replayReport;
+    QString replayCompare;
+    bool parallelInit = false;
+    bool edgeTriggered = false;
+    int chunkedMinSize = 4096;
+    int sslHandshakeThreads = 0;
+    int tcpDeferAccept = 0;
+    int tcpFastOpen = 0;
+    int acceptBatch = 64;
 
 Q_SIGNALS:
     void postForked(int workerId);